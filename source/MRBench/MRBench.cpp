@@ -0,0 +1,704 @@
+#include "MRMesh/MRMesh.h"
+#include "MRMesh/MRAABBTree.h"
+#include "MRMesh/MRCube.h"
+#include "MRMesh/MRTorus.h"
+#include "MRMesh/MRUVSphere.h"
+#include "MRMesh/MRMeshSubdivide.h"
+#include "MRMesh/MRMeshDecimate.h"
+#include "MRMesh/MRMeshDecimateParallel.h"
+#include "MRMesh/MRMeshDecimateTiled.h"
+#include "MRMesh/MRMeshBoolean.h"
+#include "MRMesh/MRMeshProject.h"
+#include "MRMesh/MRMeshIntersect.h"
+#include "MRMesh/MRMeshCollide.h"
+#include "MRMesh/MRLine3.h"
+#include "MRMesh/MRMeshRelax.h"
+#include "MRMesh/MRMeshNormals.h"
+#include "MRMesh/MROffset.h"
+#include "MRMesh/MRPointCloud.h"
+#include "MRMesh/MRPointCloudTriangulation.h"
+#include "MRMesh/MRMeshLoad.h"
+#include "MRMesh/MRMeshSave.h"
+#include "MRMesh/MRSerializer.h"
+#include "MRMesh/MRAffineXf3.h"
+#include "MRMesh/MRLog.h"
+#include "MRMesh/MRTimer.h"
+#include "MRMesh/MRStringConvert.h"
+#include "MRPch/MRSpdlog.h"
+#include "MRPch/MRTBB.h"
+#include <boost/program_options.hpp>
+#include <boost/exception/diagnostic_information.hpp>
+#include <json/json.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <regex>
+#include <thread>
+
+namespace
+{
+
+using namespace MR;
+
+// the operation to measure on the input of some scale
+struct PreparedBenchmark
+{
+    // the number of processed items (faces, points, queries) in one run, for throughput reporting
+    size_t numItems = 0;
+    std::string itemsName;
+    // restores the input modified by the previous run, not measured
+    std::function<void()> reset;
+    // measured operation
+    std::function<void()> run;
+};
+
+struct Benchmark
+{
+    std::string name;
+    // prepares the input of given scale (1 - smallest), the inputs grow approximately 4 times on each scale
+    std::function<PreparedBenchmark( int scale )> prepare;
+};
+
+// the resolution of generated primitives on given scale
+int resolution( int scale )
+{
+    return 64 << scale;
+}
+
+Mesh makeSphere( int scale )
+{
+    return makeUVSphere( 1.0f, resolution( scale ), resolution( scale ) );
+}
+
+// cube subdivided to approximately the same number of faces as the sphere of the same scale
+Mesh makeSubdividedCube( int scale )
+{
+    auto mesh = makeCube();
+    SubdivideSettings settings;
+    settings.maxEdgeLen = 2.0f / resolution( scale );
+    settings.maxEdgeSplits = INT_MAX;
+    subdivideMesh( mesh, settings );
+    return mesh;
+}
+
+// randomly renumbers the faces, vertices and edges of the mesh to destroy the locality of its data
+void shuffleMesh( Mesh& mesh )
+{
+    std::mt19937 rng( 0 );
+    auto randomMap = [&]<typename I>( size_t size, Vector<I, I>& map )
+    {
+        std::vector<I> ids( size );
+        for ( size_t i = 0; i < size; ++i )
+            ids[i] = I( i );
+        std::shuffle( ids.begin(), ids.end(), rng );
+        map = Vector<I, I>( std::move( ids ) );
+    };
+    FaceMap fmap;
+    VertMap vmap;
+    randomMap( mesh.topology.faceSize(), fmap );
+    randomMap( mesh.topology.vertSize(), vmap );
+    std::vector<int> ids( mesh.topology.undirectedEdgeSize() );
+    for ( size_t i = 0; i < ids.size(); ++i )
+        ids[i] = 2 * int( i );
+    std::shuffle( ids.begin(), ids.end(), rng );
+    WholeEdgeMap emap( ids.size() );
+    for ( UndirectedEdgeId ue{ 0 }; ue < emap.size(); ++ue )
+        emap[ue] = EdgeId( ids[ue] );
+    mesh.pack( fmap, vmap, emap );
+}
+
+// the suffix of the names of the benchmarks with AABB trees built by given method
+std::string splitMethodSuffix( AABBTreeSplitMethod method )
+{
+    switch ( method )
+    {
+    case AABBTreeSplitMethod::SAH:
+        return "/SAH";
+    case AABBTreeSplitMethod::Morton:
+        return "/Morton";
+    default:
+        return "";
+    }
+}
+
+// parallel slightly inclined rays going down from the grid of size x size points above given box
+std::vector<Line3f> makeRayGrid( const Box3f& box, int size )
+{
+    std::vector<Line3f> res;
+    res.reserve( size_t( size ) * size );
+    const Vector3f dir = Vector3f( 0.1f, 0.2f, -1.0f ).normalized();
+    for ( int y = 0; y < size; ++y )
+        for ( int x = 0; x < size; ++x )
+            res.push_back( Line3f{ Vector3f(
+                box.min.x + box.size().x * ( x + 0.5f ) / size,
+                box.min.y + box.size().y * ( y + 0.5f ) / size,
+                box.max.z + 1 ), dir } );
+    return res;
+}
+
+std::vector<Benchmark> makeBenchmarks()
+{
+    std::vector<Benchmark> res;
+
+    for ( auto method : { AABBTreeSplitMethod::Median, AABBTreeSplitMethod::SAH, AABBTreeSplitMethod::Morton } )
+    {
+        res.push_back( { "AABBTree" + splitMethodSuffix( method ), [method] ( int scale )
+        {
+            auto mesh = std::make_shared<Mesh>( makeSphere( scale ) );
+            PreparedBenchmark b;
+            b.numItems = mesh->topology.numValidFaces();
+            b.itemsName = "faces";
+            b.run = [mesh, method] { AABBTree tree( *mesh, { .splitMethod = method } ); };
+            return b;
+        } } );
+    }
+
+    res.push_back( { "AABBTree/refit", [] ( int scale )
+    {
+        auto mesh = std::make_shared<Mesh>( makeSphere( scale ) );
+        auto tree = std::make_shared<AABBTree>( *mesh );
+        // not-rigid motion of the points keeping topology
+        for ( auto& p : mesh->points )
+            p = Vector3f( p.x * 1.5f, p.y, p.z + 0.2f * std::sin( 3 * p.x ) );
+        PreparedBenchmark b;
+        b.numItems = mesh->topology.numValidFaces();
+        b.itemsName = "faces";
+        b.run = [mesh, tree] { tree->refit( *mesh ); };
+        return b;
+    } } );
+
+    // binary trees built by different methods, and the wide tree made from the binary one
+    const std::pair<AABBTreeSplitMethod, bool> queryTrees[] =
+    {
+        { AABBTreeSplitMethod::Median, false },
+        { AABBTreeSplitMethod::SAH, false },
+        { AABBTreeSplitMethod::Median, true }
+    };
+    for ( auto [method, wide] : queryTrees )
+    {
+        const auto suffix = splitMethodSuffix( method ) + ( wide ? "/wide" : "" );
+        res.push_back( { "findProjection" + suffix, [method, wide] ( int scale )
+        {
+            auto mesh = std::make_shared<Mesh>( makeTorus( 1.0f, 0.3f, resolution( scale ), resolution( scale ) ) );
+            mesh->rebuildAABBTree( { .splitMethod = method } );
+            if ( wide )
+                mesh->getWideAABBTree();
+            auto queries = std::make_shared<std::vector<Vector3f>>( size_t( 1 ) << ( 14 + scale ) );
+            std::mt19937 gen( 0 );
+            std::uniform_real_distribution<float> dist( -1.5f, 1.5f );
+            for ( auto& q : *queries )
+                q = Vector3f( dist( gen ), dist( gen ), dist( gen ) );
+            PreparedBenchmark b;
+            b.numItems = queries->size();
+            b.itemsName = "queries";
+            b.run = [mesh, queries, wide]
+            {
+                tbb::parallel_for( tbb::blocked_range<size_t>( 0, queries->size() ), [&] ( const tbb::blocked_range<size_t>& range )
+                {
+                    for ( size_t i = range.begin(); i < range.end(); ++i )
+                        (void)findProjection( ( *queries )[i], *mesh, FLT_MAX, nullptr, 0, wide );
+                } );
+            };
+            return b;
+        } } );
+
+        res.push_back( { "rayMeshIntersect" + suffix, [method, wide] ( int scale )
+        {
+            auto mesh = std::make_shared<Mesh>( makeTorus( 1.0f, 0.3f, resolution( scale ), resolution( scale ) ) );
+            mesh->rebuildAABBTree( { .splitMethod = method } );
+            if ( wide )
+                mesh->getWideAABBTree();
+            auto rays = std::make_shared<std::vector<Line3f>>( makeRayGrid( mesh->computeBoundingBox(), resolution( scale ) ) );
+            PreparedBenchmark b;
+            b.numItems = rays->size();
+            b.itemsName = "rays";
+            b.run = [mesh, rays, wide]
+            {
+                tbb::parallel_for( tbb::blocked_range<size_t>( 0, rays->size() ), [&] ( const tbb::blocked_range<size_t>& range )
+                {
+                    for ( size_t i = range.begin(); i < range.end(); ++i )
+                        (void)rayMeshIntersect( *mesh, ( *rays )[i], 0.0f, FLT_MAX, nullptr, true, wide );
+                } );
+            };
+            return b;
+        } } );
+    }
+
+    res.push_back( { "rayMeshIntersect/packets", [] ( int scale )
+    {
+        auto mesh = std::make_shared<Mesh>( makeTorus( 1.0f, 0.3f, resolution( scale ), resolution( scale ) ) );
+        mesh->getAABBTree();
+        auto rays = std::make_shared<std::vector<Line3f>>( makeRayGrid( mesh->computeBoundingBox(), resolution( scale ) ) );
+        PreparedBenchmark b;
+        b.numItems = rays->size();
+        b.itemsName = "rays";
+        b.run = [mesh, rays] { (void)rayMeshIntersect( *mesh, *rays ); };
+        return b;
+    } } );
+
+    for ( bool wide : { false, true } )
+    {
+        res.push_back( { wide ? "findCollidingTriangles/wide" : "findCollidingTriangles", [wide] ( int scale )
+        {
+            auto meshA = std::make_shared<Mesh>( makeTorus( 1.0f, 0.3f, resolution( scale ), resolution( scale ) / 2 ) );
+            auto meshB = std::make_shared<Mesh>( makeTorus( 1.0f, 0.3f, resolution( scale ) * 3 / 4, resolution( scale ) * 3 / 8 ) );
+            for ( const auto& mesh : { meshA, meshB } )
+            {
+                mesh->getAABBTree();
+                if ( wide )
+                    mesh->getWideAABBTree();
+            }
+            const auto rigidB2A = AffineXf3f::xfAround( Matrix3f::rotation( Vector3f( 1, 1, 0 ).normalized(), 0.3f ), Vector3f( 0.5f, 0, 0 ) );
+            PreparedBenchmark b;
+            b.numItems = meshA->topology.numValidFaces() + meshB->topology.numValidFaces();
+            b.itemsName = "faces";
+            b.run = [meshA, meshB, rigidB2A, wide] { (void)findCollidingTriangles( *meshA, *meshB, &rigidB2A, false, wide ); };
+            return b;
+        } } );
+    }
+
+    for ( bool indexedQueue : { false, true } )
+    {
+        res.push_back( { indexedQueue ? "decimateMesh/indexedQueue" : "decimateMesh", [indexedQueue] ( int scale )
+        {
+            auto source = std::make_shared<Mesh>( makeSubdividedCube( scale ) );
+            auto mesh = std::make_shared<Mesh>();
+            PreparedBenchmark b;
+            b.numItems = source->topology.numValidFaces();
+            b.itemsName = "faces";
+            b.reset = [source, mesh] { *mesh = *source; };
+            b.run = [mesh, indexedQueue]
+            {
+                DecimateSettings settings;
+                settings.maxError = 1e-3f;
+                settings.indexedQueue = indexedQueue;
+                decimateMesh( *mesh, settings );
+            };
+            return b;
+        } } );
+    }
+
+    for ( int levels : { 1, 3 } )
+    {
+        res.push_back( { fmt::format( "decimateParallelMesh/levels:{}", levels ), [levels] ( int scale )
+        {
+            auto source = std::make_shared<Mesh>( makeSubdividedCube( scale ) );
+            auto mesh = std::make_shared<Mesh>();
+            PreparedBenchmark b;
+            b.numItems = source->topology.numValidFaces();
+            b.itemsName = "faces";
+            b.reset = [source, mesh] { *mesh = *source; };
+            b.run = [mesh, levels]
+            {
+                DecimateParallelSettings settings;
+                settings.maxError = 1e-3f;
+                settings.subdivideParts = 64;
+                settings.subdivideLevels = levels;
+                decimateParallelMesh( *mesh, settings );
+            };
+            return b;
+        } } );
+    }
+
+    res.push_back( { "decimateMeshTiled", [] ( int scale )
+    {
+        auto source = std::make_shared<Mesh>( makeSubdividedCube( scale ) );
+        auto folder = std::make_shared<UniqueTemporaryFolder>( FolderCallback{} );
+        PreparedBenchmark b;
+        b.numItems = source->topology.numValidFaces();
+        b.itemsName = "faces";
+        b.run = [source, folder]
+        {
+            TiledDecimateSettings settings;
+            settings.decimate.maxError = 1e-3f;
+            // about 8 tiles
+            settings.memoryBudget = size_t( source->topology.numValidFaces() ) * 32;
+            settings.tempDir = *folder;
+            (void)decimateMeshTiled( trianglesStreamFromMesh( *source ), *folder / "decimated.ply", settings );
+        };
+        return b;
+    } } );
+
+    for ( int parallelIterations : { 0, 3 } )
+    {
+        res.push_back( { parallelIterations ? "remesh/parallel" : "remesh", [parallelIterations] ( int scale )
+        {
+            auto source = std::make_shared<Mesh>( makeSphere( scale ) );
+            auto mesh = std::make_shared<Mesh>();
+            PreparedBenchmark b;
+            b.numItems = source->topology.numValidFaces();
+            b.itemsName = "faces";
+            b.reset = [source, mesh] { *mesh = *source; };
+            b.run = [mesh, parallelIterations, scale]
+            {
+                RemeshSettings settings;
+                // approximately the same number of faces in the result as in the input
+                settings.targetEdgeLen = 3.0f / resolution( scale );
+                settings.parallelIterations = parallelIterations;
+                remesh( *mesh, settings );
+            };
+            return b;
+        } } );
+    }
+
+    res.push_back( { "relax", [] ( int scale )
+    {
+        auto source = std::make_shared<Mesh>( makeSphere( scale ) );
+        auto mesh = std::make_shared<Mesh>();
+        PreparedBenchmark b;
+        b.numItems = source->topology.numValidVerts();
+        b.itemsName = "verts";
+        b.reset = [source, mesh] { *mesh = *source; };
+        b.run = [mesh]
+        {
+            MeshRelaxParams params;
+            params.iterations = 5;
+            relax( *mesh, params );
+        };
+        return b;
+    } } );
+
+    res.push_back( { "packOptimally", [] ( int scale )
+    {
+        auto source = std::make_shared<Mesh>( makeSphere( scale ) );
+        shuffleMesh( *source );
+        auto mesh = std::make_shared<Mesh>();
+        PreparedBenchmark b;
+        b.numItems = source->topology.numValidFaces();
+        b.itemsName = "faces";
+        b.reset = [source, mesh] { *mesh = *source; };
+        b.run = [mesh] { mesh->packOptimally(); };
+        return b;
+    } } );
+
+    // the algorithms on the meshes with randomly shuffled elements and after their optimal packing
+    for ( bool packed : { false, true } )
+    {
+        const std::string suffix = packed ? "/packed" : "/shuffled";
+        res.push_back( { "relax" + suffix, [packed] ( int scale )
+        {
+            auto source = std::make_shared<Mesh>( makeSphere( scale ) );
+            shuffleMesh( *source );
+            if ( packed )
+                source->packOptimally();
+            auto mesh = std::make_shared<Mesh>();
+            PreparedBenchmark b;
+            b.numItems = source->topology.numValidVerts();
+            b.itemsName = "verts";
+            b.reset = [source, mesh] { *mesh = *source; };
+            b.run = [mesh]
+            {
+                MeshRelaxParams params;
+                params.iterations = 5;
+                relax( *mesh, params );
+            };
+            return b;
+        } } );
+
+        res.push_back( { "computePerVertNormals" + suffix, [packed] ( int scale )
+        {
+            auto mesh = std::make_shared<Mesh>( makeSphere( scale ) );
+            shuffleMesh( *mesh );
+            if ( packed )
+                mesh->packOptimally();
+            PreparedBenchmark b;
+            b.numItems = mesh->topology.numValidVerts();
+            b.itemsName = "verts";
+            b.run = [mesh] { (void)computePerVertNormals( *mesh ); };
+            return b;
+        } } );
+    }
+
+    res.push_back( { "boolean", [] ( int scale )
+    {
+        auto meshA = std::make_shared<Mesh>( makeSphere( scale ) );
+        auto meshB = std::make_shared<Mesh>( makeSphere( scale ) );
+        meshB->transform( AffineXf3f::translation( Vector3f( 0.5f, 0.1f, 0.05f ) ) );
+        meshA->getAABBTree();
+        meshB->getAABBTree();
+        PreparedBenchmark b;
+        b.numItems = meshA->topology.numValidFaces() + meshB->topology.numValidFaces();
+        b.itemsName = "faces";
+        b.run = [meshA, meshB] { (void)boolean( *meshA, *meshB, BooleanOperation::Union ); };
+        return b;
+    } } );
+
+#if !defined( __EMSCRIPTEN__) && !defined( MRMESH_NO_VOXEL )
+    res.push_back( { "offsetMesh", [] ( int scale )
+    {
+        auto mesh = std::make_shared<Mesh>( makeSphere( scale ) );
+        PreparedBenchmark b;
+        b.numItems = mesh->topology.numValidFaces();
+        b.itemsName = "faces";
+        b.run = [mesh, scale]
+        {
+            OffsetParameters params;
+            params.voxelSize = 4.0f / resolution( scale );
+            (void)offsetMesh( *mesh, 0.1f, params );
+        };
+        return b;
+    } } );
+#endif
+
+    res.push_back( { "triangulatePointCloud", [] ( int scale )
+    {
+        const auto sphere = makeSphere( scale - 1 );
+        auto cloud = std::make_shared<PointCloud>();
+        cloud->points = sphere.points;
+        cloud->validPoints = sphere.topology.getValidVerts();
+        PreparedBenchmark b;
+        b.numItems = cloud->validPoints.count();
+        b.itemsName = "points";
+        b.run = [cloud] { (void)triangulatePointCloud( *cloud ); };
+        return b;
+    } } );
+
+    // per-call overhead of a scoped timer in a parallel loop: seconds per call = 1 / items_per_second
+    res.push_back( { "TimerOverhead", [] ( int scale )
+    {
+        PreparedBenchmark b;
+        b.numItems = size_t( 1 ) << ( 20 + 2 * scale );
+        b.itemsName = "timers";
+        b.run = [n = b.numItems]
+        {
+            MR_NAMED_TIMER( "TimerOverhead" );
+            tbb::parallel_for( tbb::blocked_range<size_t>( 0, n ), [&] ( const tbb::blocked_range<size_t>& range )
+            {
+                for ( size_t i = range.begin(); i < range.end(); ++i )
+                {
+                    MR_NAMED_TIMER( "TimerOverheadLeaf" );
+                }
+            } );
+        };
+        return b;
+    } } );
+
+    for ( std::string ext : { ".mrmesh", ".ply", ".stl", ".obj", ".off" } )
+    {
+        res.push_back( { "MeshLoad" + ext, [ext] ( int scale )
+        {
+            // the folder is removed when the last copy of the benchmark functions is destroyed
+            auto folder = std::make_shared<UniqueTemporaryFolder>( [] ( const std::filesystem::path& ) {} );
+            const auto mesh = makeSphere( scale );
+            const std::filesystem::path file = std::filesystem::path( *folder ) / ( "mesh" + ext );
+            PreparedBenchmark b;
+            b.numItems = mesh.topology.numValidFaces();
+            b.itemsName = "faces";
+            if ( auto saveRes = MeshSave::toAnySupportedFormat( mesh, file ); !saveRes )
+            {
+                spdlog::error( "Cannot save {}: {}", utf8string( file ), saveRes.error() );
+                return b;
+            }
+            b.run = [folder, file] { (void)MeshLoad::fromAnySupportedFormat( file ); };
+            return b;
+        } } );
+    }
+
+    res.push_back( { "MeshLoad.stl/ascii", [] ( int scale )
+    {
+        auto folder = std::make_shared<UniqueTemporaryFolder>( [] ( const std::filesystem::path& ) {} );
+        const auto mesh = makeSphere( scale );
+        const std::filesystem::path file = std::filesystem::path( *folder ) / "mesh.stl";
+        PreparedBenchmark b;
+        b.numItems = mesh.topology.numValidFaces();
+        b.itemsName = "faces";
+        std::ofstream out( file );
+        out << "solid sphere\n";
+        for ( auto f : mesh.topology.getValidFaces() )
+        {
+            VertId vs[3];
+            mesh.topology.getTriVerts( f, vs );
+            out << "facet normal 0 0 0\n outer loop\n";
+            for ( auto v : vs )
+                out << "  vertex " << mesh.points[v].x << ' ' << mesh.points[v].y << ' ' << mesh.points[v].z << '\n';
+            out << " endloop\nendfacet\n";
+        }
+        out << "endsolid sphere\n";
+        out.close();
+        if ( !out )
+        {
+            spdlog::error( "Cannot save {}", utf8string( file ) );
+            return b;
+        }
+        b.run = [folder, file] { (void)MeshLoad::fromASCIIStl( file ); };
+        return b;
+    } } );
+
+    // the same binary files read from std::istream instead of memory mapping
+    for ( std::string ext : { ".mrmesh", ".stl" } )
+    {
+        res.push_back( { "MeshLoad" + ext + "/stream", [ext] ( int scale )
+        {
+            auto folder = std::make_shared<UniqueTemporaryFolder>( [] ( const std::filesystem::path& ) {} );
+            const auto mesh = makeSphere( scale );
+            const std::filesystem::path file = std::filesystem::path( *folder ) / ( "mesh" + ext );
+            PreparedBenchmark b;
+            b.numItems = mesh.topology.numValidFaces();
+            b.itemsName = "faces";
+            if ( auto saveRes = MeshSave::toAnySupportedFormat( mesh, file ); !saveRes )
+            {
+                spdlog::error( "Cannot save {}: {}", utf8string( file ), saveRes.error() );
+                return b;
+            }
+            b.run = [folder, file, ext]
+            {
+                std::ifstream in( file, std::ifstream::binary );
+                (void)MeshLoad::fromAnySupportedFormat( in, "*" + ext );
+            };
+            return b;
+        } } );
+    }
+
+    return res;
+}
+
+struct Measurement
+{
+    std::string name;
+    int scale = 0;
+    int threads = 0;
+    size_t numItems = 0;
+    std::string itemsName;
+    std::vector<double> times; // seconds of each repetition
+};
+
+double median( std::vector<double> v )
+{
+    std::sort( v.begin(), v.end() );
+    return v.empty() ? 0 : v[v.size() / 2];
+}
+
+Json::Value toJson( const std::vector<Measurement>& measurements )
+{
+    Json::Value root;
+    root["context"]["num_cpus"] = std::thread::hardware_concurrency();
+#ifdef NDEBUG
+    root["context"]["build_type"] = "release";
+#else
+    root["context"]["build_type"] = "debug";
+#endif
+    auto& benchmarks = root["benchmarks"];
+    benchmarks = Json::arrayValue;
+    for ( const auto& m : measurements )
+    {
+        Json::Value b;
+        b["name"] = fmt::format( "{}/scale:{}/threads:{}", m.name, m.scale, m.threads );
+        b["benchmark"] = m.name;
+        b["scale"] = m.scale;
+        b["threads"] = m.threads;
+        b["items"] = Json::UInt64( m.numItems );
+        b["items_name"] = m.itemsName;
+        b["repetitions"] = int( m.times.size() );
+        b["min_time_s"] = *std::min_element( m.times.begin(), m.times.end() );
+        const auto med = median( m.times );
+        b["median_time_s"] = med;
+        b["items_per_second"] = med > 0 ? m.numItems / med : 0.0;
+        benchmarks.append( b );
+    }
+    return root;
+}
+
+} // anonymous namespace
+
+int main( int argc, char** argv )
+{
+    namespace po = boost::program_options;
+    po::options_description desc( "Usage: MRBench [options]\nMeasures performance of core geometry algorithms on generated inputs\nOptions" );
+    desc.add_options()
+        ( "help,h", "produce help message" )
+        ( "list", "print names of all benchmarks" )
+        ( "filter", po::value<std::string>(), "run only the benchmarks which names match given regular expression" )
+        ( "scales", po::value<std::vector<int>>()->multitoken(), "input scales to run, each next scale is approximately 4 times larger (default 1 2 3)" )
+        ( "threads", po::value<std::vector<int>>()->multitoken(), "numbers of threads to run with (default 1 and all hardware threads)" )
+        ( "repetitions", po::value<int>()->default_value( 3 ), "number of measured runs of each benchmark" )
+        ( "json", po::value<std::string>(), "save results in given JSON file" )
+        ;
+
+    po::variables_map vm;
+    try
+    {
+        po::store( po::parse_command_line( argc, argv, desc ), vm );
+        po::notify( vm );
+    }
+    catch ( const std::exception& e )
+    {
+        std::cerr << boost::diagnostic_information( e ) << "\n" << desc << "\n";
+        return 1;
+    }
+    if ( vm.count( "help" ) )
+    {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    MR::setupLoggerByDefault();
+    const auto benchmarks = makeBenchmarks();
+    if ( vm.count( "list" ) )
+    {
+        for ( const auto& b : benchmarks )
+            std::cout << b.name << "\n";
+        return 0;
+    }
+
+    std::regex filter( vm.count( "filter" ) ? vm["filter"].as<std::string>() : ".*" );
+    const auto scales = vm.count( "scales" ) ? vm["scales"].as<std::vector<int>>() : std::vector<int>{ 1, 2, 3 };
+    const int hwThreads = int( std::max( 1u, std::thread::hardware_concurrency() ) );
+    auto threads = vm.count( "threads" ) ? vm["threads"].as<std::vector<int>>() : std::vector<int>{ 1, hwThreads };
+    auto lessThanOne = []( int x ) { return x < 1; };
+    if ( std::any_of( scales.begin(), scales.end(), lessThanOne ) || std::any_of( threads.begin(), threads.end(), lessThanOne ) )
+    {
+        std::cerr << "Scales and numbers of threads must be at least 1\n" << desc << "\n";
+        return 1;
+    }
+    std::sort( threads.begin(), threads.end() );
+    threads.erase( std::unique( threads.begin(), threads.end() ), threads.end() );
+    const int repetitions = std::max( 1, vm["repetitions"].as<int>() );
+
+    std::vector<Measurement> measurements;
+    std::cout << fmt::format( "{:<32} {:>5} {:>7} {:>12} {:>12} {:>14}\n", "benchmark", "scale", "threads", "items", "median, s", "items/s" );
+    for ( const auto& benchmark : benchmarks )
+    {
+        if ( !std::regex_search( benchmark.name, filter ) )
+            continue;
+        for ( int scale : scales )
+        {
+            const auto prepared = benchmark.prepare( scale );
+            if ( !prepared.run )
+                continue;
+            for ( int numThreads : threads )
+            {
+                tbb::global_control control( tbb::global_control::max_allowed_parallelism, numThreads );
+                Measurement m{ benchmark.name, scale, numThreads, prepared.numItems, prepared.itemsName, {} };
+                for ( int r = 0; r < repetitions; ++r )
+                {
+                    if ( prepared.reset )
+                        prepared.reset();
+                    const auto start = std::chrono::steady_clock::now();
+                    prepared.run();
+                    m.times.push_back( std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count() );
+                }
+                const auto med = median( m.times );
+                std::cout << fmt::format( "{:<32} {:>5} {:>7} {:>12} {:>12.4f} {:>14.0f}\n",
+                    m.name, m.scale, m.threads, m.numItems, med, med > 0 ? m.numItems / med : 0.0 );
+                measurements.push_back( std::move( m ) );
+            }
+        }
+    }
+
+    if ( vm.count( "json" ) )
+    {
+        const std::filesystem::path jsonFile = vm["json"].as<std::string>();
+        std::ofstream out( jsonFile );
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "  ";
+        std::unique_ptr<Json::StreamWriter> writer( builder.newStreamWriter() );
+        if ( !out || writer->write( toJson( measurements ), &out ) != 0 || !out )
+        {
+            std::cerr << "Cannot write " << jsonFile << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -3,9 +3,14 @@
 #include "MRMesh.h"
 #include "MRTimer.h"
 #include "MRUVSphere.h"
+#include "MRTorus.h"
+#include "MRMeshIntersect.h"
+#include "MRMeshProject.h"
+#include "MRLine3.h"
 #include "MRBitSetParallelFor.h"
 #include "MRGTest.h"
 #include "MRPch/MRTBB.h"
+#include <thread>
 
 namespace MR
 {
@@ -19,7 +24,7 @@ bool AABBTree::containsSameNumberOfTris( const Mesh & mesh ) const
     return int(nodes_.size()) == getNumNodes( mesh.topology.numValidFaces() );
 }
 
-AABBTree::AABBTree( const Mesh & mesh )
+AABBTree::AABBTree( const Mesh & mesh, const AABBTreeSettings & settings )
 {
     MR_TIMER;
 
@@ -49,7 +54,52 @@ AABBTree::AABBTree( const Mesh & mesh )
         }
     } );
 
-    nodes_ = makeAABBTreeNodeVec( std::move( boxedFaces ) );
+    nodes_ = makeAABBTreeNodeVec( std::move( boxedFaces ), settings );
+}
+
+// recomputes the boxes of given subtree, optionally splitting the job on given number of threads
+static void refitSubtree( AABBTree::NodeVec & nodes, const Mesh & mesh, AABBTree::NodeId n, int numThreads )
+{
+    auto & node = nodes[n];
+    if ( node.leaf() )
+    {
+        Vector3f a, b, c;
+        mesh.getTriPoints( node.leafId(), a, b, c );
+        Box3f box;
+        box.include( a );
+        box.include( b );
+        box.include( c );
+        // same micro expansion as in construction
+        node.box = box.insignificantlyExpanded();
+        return;
+    }
+
+    if ( numThreads >= 2 )
+    {
+        const int rThreads = numThreads / 2;
+        const int lThreads = numThreads - rThreads;
+        tbb::task_group group;
+        group.run( [&] () { refitSubtree( nodes, mesh, node.r, rThreads ); } );
+        refitSubtree( nodes, mesh, node.l, lThreads );
+        group.wait();
+    }
+    else
+    {
+        refitSubtree( nodes, mesh, node.l, 1 );
+        refitSubtree( nodes, mesh, node.r, 1 );
+    }
+    node.box = nodes[node.l].box;
+    node.box.include( nodes[node.r].box );
+}
+
+void AABBTree::refit( const Mesh & mesh )
+{
+    MR_TIMER;
+    assert( containsSameNumberOfTris( mesh ) );
+    if ( nodes_.empty() )
+        return;
+    // several subtasks per thread give better load balancing if the subtrees are unequal
+    refitSubtree( nodes_, mesh, rootNodeId(), 4 * std::thread::hardware_concurrency() );
 }
 
 FaceBitSet AABBTree::getSubtreeFaces( NodeId subtreeRoot ) const
@@ -149,4 +199,153 @@ TEST(MRMesh, AABBTree)
     assert( tree.nodes().empty() );
 }
 
+TEST(MRMesh, AABBTreeSAH)
+{
+    Mesh torus = makeTorus( 1, 0.3f, 32, 16 );
+    AABBTree tree( torus, { .splitMethod = AABBTreeSplitMethod::SAH } );
+    EXPECT_EQ( tree.nodes().size(), getNumNodes( torus.topology.numValidFaces() ) );
+    EXPECT_TRUE( tree.containsSameNumberOfTris( torus ) );
+    EXPECT_EQ( tree[AABBTree::rootNodeId()].box, torus.computeBoundingBox().insignificantlyExpanded() );
+    EXPECT_EQ( tree.getSubtreeFaces( AABBTree::rootNodeId() ), torus.topology.getValidFaces() );
+
+    // each node box shall contain the boxes of its children
+    for ( const auto & node : tree.nodes() )
+    {
+        if ( node.leaf() )
+            continue;
+        EXPECT_TRUE( node.box.contains( tree[node.l].box.min ) && node.box.contains( tree[node.l].box.max ) );
+        EXPECT_TRUE( node.box.contains( tree[node.r].box.min ) && node.box.contains( tree[node.r].box.max ) );
+    }
+}
+
+// checks that ray and projection queries give the same results in the trees built by median and SAH splits
+TEST(MRMesh, AABBTreeSAHQueries)
+{
+    Mesh medianMesh = makeTorus( 1, 0.3f, 32, 16 );
+    Mesh sahMesh = medianMesh;
+    medianMesh.rebuildAABBTree( {} );
+    sahMesh.rebuildAABBTree( { .splitMethod = AABBTreeSplitMethod::SAH } );
+
+    const auto box = medianMesh.computeBoundingBox();
+    constexpr int RaysPerDim = 32;
+    const Vector3f rayDir = Vector3f( 0.1f, 0.2f, -1.0f ).normalized();
+    for ( int y = 0; y < RaysPerDim; ++y )
+        for ( int x = 0; x < RaysPerDim; ++x )
+        {
+            const Line3f ray{ Vector3f(
+                box.min.x + box.size().x * ( x + 0.5f ) / RaysPerDim,
+                box.min.y + box.size().y * ( y + 0.5f ) / RaysPerDim,
+                box.max.z + 1 ), rayDir };
+            const auto medianHit = rayMeshIntersect( medianMesh, ray );
+            const auto sahHit = rayMeshIntersect( sahMesh, ray );
+            ASSERT_EQ( bool( medianHit ), bool( sahHit ) );
+            if ( medianHit )
+            {
+                EXPECT_NEAR( medianHit->distanceAlongLine, sahHit->distanceAlongLine, 1e-5f );
+            }
+        }
+
+    constexpr int PointsPerDim = 8;
+    for ( int z = 0; z < PointsPerDim; ++z )
+        for ( int y = 0; y < PointsPerDim; ++y )
+            for ( int x = 0; x < PointsPerDim; ++x )
+            {
+                const auto p = box.min + mult( box.size(), Vector3f( x + 0.5f, y + 0.5f, z + 0.5f ) / float( PointsPerDim ) );
+                EXPECT_NEAR( findProjection( p, medianMesh ).distSq, findProjection( p, sahMesh ).distSq, 1e-6f );
+            }
+}
+
+// checks that the tree refit in place after the motion of points has consistent node boxes, the same root box as the tree built anew and gives the same ray hits
+TEST(MRMesh, AABBTreeRefit)
+{
+    Mesh torus = makeTorus( 1, 0.3f, 32, 16 );
+    const auto & oldTree = torus.getAABBTree();
+
+    // not-rigid motion of the points keeping topology
+    tbb::parallel_for( tbb::blocked_range<VertId>( 0_v, VertId( torus.points.size() ) ), [&]( const tbb::blocked_range<VertId> & range )
+    {
+        for ( VertId v = range.begin(); v < range.end(); ++v )
+        {
+            auto & p = torus.points[v];
+            p = Vector3f( p.x * 1.5f, p.y, p.z + 0.2f * std::sin( 3 * p.x ) );
+        }
+    } );
+    torus.invalidateCaches( true );
+    EXPECT_EQ( torus.getAABBTreeNotCreate(), nullptr );
+
+    const auto & refitTree = torus.getAABBTree();
+    const AABBTree newTree( torus );
+
+    // the tree object is updated in place
+    EXPECT_EQ( &refitTree, &oldTree );
+    EXPECT_EQ( refitTree.getBoundingBox(), newTree.getBoundingBox() );
+    EXPECT_EQ( refitTree.getBoundingBox(), torus.computeBoundingBox().insignificantlyExpanded() );
+    for ( const auto & node : refitTree.nodes() )
+    {
+        if ( node.leaf() )
+            continue;
+        Box3f box = refitTree[node.l].box;
+        box.include( refitTree[node.r].box );
+        EXPECT_EQ( node.box, box );
+    }
+
+    const Line3f ray( Vector3f( 0.2f, 1.1f, 2 ), Vector3f( 0, 0, -1 ) );
+    const auto refitHit = rayMeshIntersect( torus, ray );
+    torus.invalidateCaches();
+    const auto newHit = rayMeshIntersect( torus, ray );
+    ASSERT_TRUE( refitHit && newHit );
+    EXPECT_EQ( refitHit->proj.face, newHit->proj.face );
+}
+
+TEST(MRMesh, AABBTreeMorton)
+{
+    Mesh torus = makeTorus( 1, 0.3f, 64, 32 );
+    const AABBTree tree( torus, { .splitMethod = AABBTreeSplitMethod::Morton } );
+    EXPECT_EQ( tree.nodes().size(), getNumNodes( torus.topology.numValidFaces() ) );
+    EXPECT_EQ( tree.getBoundingBox(), torus.computeBoundingBox().insignificantlyExpanded() );
+    EXPECT_EQ( tree.getSubtreeFaces( AABBTree::rootNodeId() ), torus.topology.getValidFaces() );
+
+    // the same layout as in other trees: left child follows its parent, and each node box is the union of children boxes
+    for ( AABBTree::NodeId n{ 0 }; n < tree.nodes().size(); ++n )
+    {
+        const auto & node = tree[n];
+        if ( node.leaf() )
+            continue;
+        EXPECT_EQ( node.l, n + 1 );
+        Box3f box = tree[node.l].box;
+        box.include( tree[node.r].box );
+        EXPECT_EQ( node.box, box );
+    }
+
+    Mesh mortonTorus = torus;
+    mortonTorus.rebuildAABBTree( { .splitMethod = AABBTreeSplitMethod::Morton } );
+    for ( int i = 0; i < 100; ++i )
+    {
+        const auto p = Vector3f( std::cos( 0.1f * i ), std::sin( 0.1f * i ), 0.01f * ( i - 50 ) ) * 1.2f;
+        EXPECT_EQ( findProjection( p, torus ).distSq, findProjection( p, mortonTorus ).distSq );
+        const Line3f ray( p, Vector3f( 0.1f, 0.2f, -1.0f ) );
+        const auto hit = rayMeshIntersect( torus, ray );
+        const auto mortonHit = rayMeshIntersect( mortonTorus, ray );
+        ASSERT_EQ( bool( hit ), bool( mortonHit ) );
+        if ( hit )
+        {
+            EXPECT_EQ( hit->distanceAlongLine, mortonHit->distanceAlongLine );
+        }
+    }
+}
+
+// the trees built by all split methods contain each face exactly once and have the same bounding box
+TEST(MRMesh, AABBTreeSplitMethods)
+{
+    const Mesh torus = makeTorus( 1, 0.3f, 32, 16 );
+    for ( auto method : { AABBTreeSplitMethod::Median, AABBTreeSplitMethod::SAH, AABBTreeSplitMethod::Morton } )
+    {
+        const AABBTree tree( torus, { .splitMethod = method } );
+        EXPECT_TRUE( tree.containsSameNumberOfTris( torus ) );
+        EXPECT_EQ( tree.nodes().size(), getNumNodes( torus.topology.numValidFaces() ) );
+        EXPECT_EQ( tree.getSubtreeFaces( AABBTree::rootNodeId() ), torus.topology.getValidFaces() );
+        EXPECT_EQ( tree.getBoundingBox(), torus.computeBoundingBox().insignificantlyExpanded() );
+    }
+}
+
 } //namespace MR
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "MRAABBTreeNode.h"
+#include "MRAABBTreeSettings.h"
 #include "MRVector.h"
 
 namespace MR
@@ -31,7 +32,13 @@ public:
     [[nodiscard]] MRMESH_API bool containsSameNumberOfTris( const Mesh & mesh ) const;
 
     /// creates tree for given mesh
-    MRMESH_API AABBTree( const Mesh & mesh );
+    MRMESH_API AABBTree( const Mesh & mesh, const AABBTreeSettings & settings = {} );
+
+    /// recomputes the boxes of all nodes from the current positions of mesh points bottom-up in parallel,
+    /// keeping tree structure; this is much faster than construction of new tree,
+    /// but valid only if mesh topology has not changed since tree construction;
+    /// the queries become slower if the points have moved much relative to each other
+    MRMESH_API void refit( const Mesh & mesh );
 
     /// returns all faces in the subtree with given root
     [[nodiscard]] MRMESH_API FaceBitSet getSubtreeFaces( NodeId subtreeRoot ) const;
@@ -4,7 +4,10 @@
 #include "MRGTest.h"
 #include "MRPch/MRTBB.h"
 #include "MRPch/MRSpdlog.h"
+#include <array>
 #include <atomic>
+#include <bit>
+#include <cstdint>
 #include <stack>
 #include <thread>
 
@@ -20,10 +23,11 @@ struct Subtree
 {
     using NodeId = typename AABBTreeNode<T>::NodeId;
 
-    Subtree( NodeId root, int f, int n ) : root( root ), firstLeaf( f ), numLeaves( n ) { }
+    Subtree( NodeId root, int f, int n, int d ) : root( root ), firstLeaf( f ), numLeaves( n ), depth( d ) { }
     NodeId root; // of subtree
     int firstLeaf = 0;
     int numLeaves = 0;
+    int depth = 0; // of subtree root in the whole tree
     NodeId lastNode() const { return root + getNumNodes( numLeaves ); }
     bool leaf() const { assert( numLeaves >= 1 );  return numLeaves == 1; }
 };
@@ -38,25 +42,144 @@ public:
     using Subtree = MR::Subtree<T>;
     using BoxT = typename T::BoxT;
 
-    NodeVec construct( std::vector<BoxedLeaf<T>> boxedLeaves );
+    NodeVec construct( std::vector<BoxedLeaf<T>> boxedLeaves, const AABBTreeSettings & settings );
 
 private:
     std::vector<BoxedLeaf<T>> boxedLeaves_;
     NodeVec nodes_;
+    AABBTreeSettings settings_;
+    // Morton codes of boxedLeaves_ in increasing order, only for Morton split method
+    std::vector<std::uint64_t> mortonCodes_;
 
 private:
     // [firstLeaf, result) will go to left child and [result, lastLeaf) - to the right child
-    int particionLeaves( BoxT & box, int firstLeaf, int lastLeaf );
+    int particionLeaves( BoxT & box, int firstLeaf, int lastLeaf, int depth );
+    // same as particionLeaves but selects the split minimizing surface area heuristic;
+    // returns firstLeaf if all leaves have the same center or the split makes the tree too high
+    int particionLeavesSAH( int firstLeaf, int lastLeaf, int depth );
     // constructs not-leaf node
     std::pair<Subtree, Subtree> makeNode( const Subtree & s );
     // constructs given subtree, optionally splitting the job on given number of threads
     void makeSubtree( const Subtree & s, int numThreads );
+
+    // sorts boxedLeaves_ by Morton codes of their box centers and fills mortonCodes_
+    void sortLeavesByMortonCodes();
+    // returns the first leaf with the highest bit different in Morton codes of [firstLeaf, lastLeaf) set
+    int particionLeavesMorton( int firstLeaf, int lastLeaf, int depth ) const;
+    // constructs given subtree from the leaves sorted by Morton codes, optionally splitting the job on given number of threads
+    void makeMortonSubtree( const Subtree & s, int numThreads );
 };
 
+// spreads lower 21 bits of given value so that there are two zero bits between each pair of original bits
+static std::uint64_t spreadBits3( std::uint64_t x )
+{
+    x &= 0x1fffff;
+    x = ( x | x << 32 ) & 0x1f00000000ffffull;
+    x = ( x | x << 16 ) & 0x1f0000ff0000ffull;
+    x = ( x | x << 8 ) & 0x100f00f00f00f00full;
+    x = ( x | x << 4 ) & 0x10c30c30c30c30c3ull;
+    x = ( x | x << 2 ) & 0x1249249249249249ull;
+    return x;
+}
+
+// spreads lower 31 bits of given value so that there is one zero bit between each pair of original bits
+static std::uint64_t spreadBits2( std::uint64_t x )
+{
+    x &= 0x7fffffff;
+    x = ( x | x << 16 ) & 0x0000ffff0000ffffull;
+    x = ( x | x << 8 ) & 0x00ff00ff00ff00ffull;
+    x = ( x | x << 4 ) & 0x0f0f0f0f0f0f0f0full;
+    x = ( x | x << 2 ) & 0x3333333333333333ull;
+    x = ( x | x << 1 ) & 0x5555555555555555ull;
+    return x;
+}
+
+// returns 63-bit Morton code for 3D point or 62-bit Morton code for 2D point with the coordinates in [0,1]
+template<typename V>
+static std::uint64_t mortonCode( const V & unitPos )
+{
+    constexpr int Dims = V::elements;
+    static_assert( Dims == 2 || Dims == 3 );
+    constexpr int BitsPerDim = Dims == 3 ? 21 : 31;
+    constexpr auto MaxCoord = double( ( 1u << BitsPerDim ) - 1 );
+    std::uint64_t res = 0;
+    for ( int i = 0; i < Dims; ++i )
+    {
+        const auto c = std::uint64_t( std::clamp( double( unitPos[i] ) * MaxCoord, 0.0, MaxCoord ) );
+        if constexpr ( Dims == 3 )
+            res |= spreadBits3( c ) << ( 2 - i );
+        else
+            res |= spreadBits2( c ) << ( 1 - i );
+    }
+    return res;
+}
+
+// sorts the pairs by their first 64-bit key in parallel, using least significant digit radix sort;
+// only lower numBits of the keys are considered
+template<typename P>
+static void parallelRadixSort( std::vector<P> & items, int numBits )
+{
+    MR_TIMER;
+    constexpr int DigitBits = 11;
+    constexpr int NumBuckets = 1 << DigitBits;
+    constexpr size_t MinBlockSize = 1 << 14;
+    const size_t numBlocks = std::clamp( items.size() / MinBlockSize, size_t( 1 ), size_t( 4 * std::thread::hardware_concurrency() ) );
+    const size_t blockSize = ( items.size() + numBlocks - 1 ) / numBlocks;
+
+    std::vector<P> tmp( items.size() );
+    // counts[b][d] is the number of items with digit d in block b, then the position of the first of them in sorted array
+    std::vector<std::array<size_t, NumBuckets>> counts( numBlocks );
+    for ( int shift = 0; shift < numBits; shift += DigitBits )
+    {
+        auto digit = [shift]( const P & p ) { return int( ( p.first >> shift ) & ( NumBuckets - 1 ) ); };
+        tbb::parallel_for( tbb::blocked_range<size_t>( 0, numBlocks, 1 ), [&]( const tbb::blocked_range<size_t> & range )
+        {
+            for ( size_t b = range.begin(); b < range.end(); ++b )
+            {
+                auto & c = counts[b];
+                c.fill( 0 );
+                const auto end = std::min( items.size(), ( b + 1 ) * blockSize );
+                for ( size_t i = b * blockSize; i < end; ++i )
+                    ++c[digit( items[i] )];
+            }
+        } );
+
+        size_t pos = 0;
+        for ( int d = 0; d < NumBuckets; ++d )
+        {
+            for ( size_t b = 0; b < numBlocks; ++b )
+            {
+                const auto n = counts[b][d];
+                counts[b][d] = pos;
+                pos += n;
+            }
+        }
+
+        tbb::parallel_for( tbb::blocked_range<size_t>( 0, numBlocks, 1 ), [&]( const tbb::blocked_range<size_t> & range )
+        {
+            for ( size_t b = range.begin(); b < range.end(); ++b )
+            {
+                auto & c = counts[b];
+                const auto end = std::min( items.size(), ( b + 1 ) * blockSize );
+                for ( size_t i = b * blockSize; i < end; ++i )
+                    tmp[c[digit( items[i] )]++] = items[i];
+            }
+        } );
+        items.swap( tmp );
+    }
+}
+
 template<typename T>
-int AABBTreeMaker<T>::particionLeaves( BoxT & box, int firstLeaf, int lastLeaf )
+int AABBTreeMaker<T>::particionLeaves( BoxT & box, int firstLeaf, int lastLeaf, int depth )
 {
     assert( firstLeaf + 1 < lastLeaf );
+    if ( settings_.splitMethod == AABBTreeSplitMethod::SAH )
+    {
+        const int midLeaf = particionLeavesSAH( firstLeaf, lastLeaf, depth );
+        if ( midLeaf > firstLeaf )
+            return midLeaf;
+    }
+
     auto boxDiag = box.max - box.min;
     const int splitDim = int( std::max_element( begin( boxDiag ), end( boxDiag ) ) - begin( boxDiag ) );
 
@@ -69,6 +192,90 @@ int AABBTreeMaker<T>::particionLeaves( BoxT & box, int firstLeaf, int lastLeaf )
     return midLeaf;
 }
 
+template<typename T>
+int AABBTreeMaker<T>::particionLeavesSAH( int firstLeaf, int lastLeaf, int depth )
+{
+    assert( firstLeaf + 1 < lastLeaf );
+    constexpr int MaxBins = 64; // to avoid allocations
+    const int numBins = std::clamp( settings_.sahBins, 2, MaxBins );
+    const int numLeaves = lastLeaf - firstLeaf;
+
+    BoxT centerBox;
+    for ( int i = firstLeaf; i < lastLeaf; ++i )
+        centerBox.include( boxedLeaves_[i].box.center() );
+    const auto centerDiag = centerBox.max - centerBox.min;
+
+    auto getBin = [&]( const BoxedLeaf<T> & l, int dim )
+    {
+        const auto pos = ( l.box.center()[dim] - centerBox.min[dim] ) * numBins / centerDiag[dim];
+        return std::min( int( pos ), numBins - 1 );
+    };
+
+    struct Bin
+    {
+        BoxT box;
+        int numLeaves = 0;
+    };
+    using ValueType = typename BoxT::T;
+    ValueType bestCost = std::numeric_limits<ValueType>::max();
+    int bestDim = -1;
+    int bestBin = 0;
+    int bestNumLeft = 0;
+    for ( int dim = 0; dim < decltype( BoxT::min )::elements; ++dim )
+    {
+        if ( !( centerDiag[dim] > 0 ) )
+            continue;
+
+        Bin bins[MaxBins];
+        for ( int i = firstLeaf; i < lastLeaf; ++i )
+        {
+            auto & bin = bins[getBin( boxedLeaves_[i], dim )];
+            bin.box.include( boxedLeaves_[i].box );
+            ++bin.numLeaves;
+        }
+
+        // rightCosts[b] is the cost of the right child made of bins [b, numBins)
+        ValueType rightCosts[MaxBins];
+        BoxT acc;
+        int accLeaves = 0;
+        for ( int b = numBins - 1; b > 0; --b )
+        {
+            acc.include( bins[b].box );
+            accLeaves += bins[b].numLeaves;
+            rightCosts[b] = boxSurfaceArea( acc ) * accLeaves;
+        }
+
+        acc = BoxT{};
+        accLeaves = 0;
+        for ( int b = 1; b < numBins; ++b )
+        {
+            acc.include( bins[b - 1].box );
+            accLeaves += bins[b - 1].numLeaves;
+            if ( accLeaves <= 0 || accLeaves >= numLeaves )
+                continue;
+            const auto cost = boxSurfaceArea( acc ) * accLeaves + rightCosts[b];
+            if ( cost < bestCost )
+            {
+                bestCost = cost;
+                bestDim = dim;
+                bestBin = b;
+                bestNumLeft = accLeaves;
+            }
+        }
+    }
+    if ( bestDim < 0 )
+        return firstLeaf;
+    if ( depth + 1 + getMedianTreeHeight( std::max( bestNumLeft, numLeaves - bestNumLeft ) ) > MaxAABBTreeHeight )
+        return firstLeaf;
+
+    auto it = std::partition( boxedLeaves_.data() + firstLeaf, boxedLeaves_.data() + lastLeaf,
+        [&]( const BoxedLeaf<T> & l )
+        {
+            return getBin( l, bestDim ) < bestBin;
+        } );
+    return int( it - boxedLeaves_.data() );
+}
+
 template<typename T>
 auto AABBTreeMaker<T>::makeNode( const Subtree & s ) -> std::pair<Subtree, Subtree>
 {
@@ -78,15 +285,15 @@ auto AABBTreeMaker<T>::makeNode( const Subtree & s ) -> std::pair<Subtree, Subtr
     for ( size_t i = 0; i < s.numLeaves; ++i )
         node.box.include( boxedLeaves_[s.firstLeaf + i].box );
 
-    const int midLeaf = particionLeaves( node.box, s.firstLeaf, s.firstLeaf + s.numLeaves );
+    const int midLeaf = particionLeaves( node.box, s.firstLeaf, s.firstLeaf + s.numLeaves, s.depth );
     const int leftNumLeaves = midLeaf - s.firstLeaf;
     const int rightNumLeaves = s.numLeaves - leftNumLeaves;
     node.l = s.root + 1;
     node.r = s.root + 1 + getNumNodes( leftNumLeaves );
     return
     {
-        Subtree( node.l, s.firstLeaf, leftNumLeaves ),
-        Subtree( node.r, midLeaf,     rightNumLeaves )
+        Subtree( node.l, s.firstLeaf, leftNumLeaves,  s.depth + 1 ),
+        Subtree( node.r, midLeaf,     rightNumLeaves, s.depth + 1 )
     };
 }
 
@@ -130,28 +337,149 @@ void AABBTreeMaker<T>::makeSubtree( const Subtree & s, int numThreads )
 }
 
 template<typename T>
-auto AABBTreeMaker<T>::construct( std::vector<BoxedLeaf<T>> boxedLeaves ) -> NodeVec
+void AABBTreeMaker<T>::sortLeavesByMortonCodes()
+{
+    MR_TIMER;
+    const auto numLeaves = boxedLeaves_.size();
+    using V = decltype( BoxT::min );
+
+    const auto centerBox = tbb::parallel_reduce( tbb::blocked_range<size_t>( 0, numLeaves ), BoxT{},
+        [&]( const tbb::blocked_range<size_t> & range, BoxT box )
+        {
+            for ( size_t i = range.begin(); i < range.end(); ++i )
+                box.include( boxedLeaves_[i].box.center() );
+            return box;
+        },
+        []( BoxT a, const BoxT & b )
+        {
+            a.include( b );
+            return a;
+        } );
+    V invSize;
+    for ( int i = 0; i < V::elements; ++i )
+    {
+        const auto size = centerBox.max[i] - centerBox.min[i];
+        invSize[i] = size > 0 ? 1 / size : 0;
+    }
+
+    std::vector<std::pair<std::uint64_t, int>> codes( numLeaves );
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, numLeaves ), [&]( const tbb::blocked_range<size_t> & range )
+    {
+        for ( size_t i = range.begin(); i < range.end(); ++i )
+        {
+            const auto center = boxedLeaves_[i].box.center();
+            V unitPos;
+            for ( int k = 0; k < V::elements; ++k )
+                unitPos[k] = ( center[k] - centerBox.min[k] ) * invSize[k];
+            codes[i] = { mortonCode( unitPos ), int( i ) };
+        }
+    } );
+    parallelRadixSort( codes, V::elements == 3 ? 63 : 62 );
+
+    std::vector<BoxedLeaf<T>> sortedLeaves( numLeaves );
+    mortonCodes_.resize( numLeaves );
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, numLeaves ), [&]( const tbb::blocked_range<size_t> & range )
+    {
+        for ( size_t i = range.begin(); i < range.end(); ++i )
+        {
+            mortonCodes_[i] = codes[i].first;
+            sortedLeaves[i] = boxedLeaves_[codes[i].second];
+        }
+    } );
+    boxedLeaves_ = std::move( sortedLeaves );
+}
+
+template<typename T>
+int AABBTreeMaker<T>::particionLeavesMorton( int firstLeaf, int lastLeaf, int depth ) const
+{
+    assert( firstLeaf + 1 < lastLeaf );
+    const int numLeaves = lastLeaf - firstLeaf;
+    const auto firstCode = mortonCodes_[firstLeaf];
+    const auto lastCode = mortonCodes_[lastLeaf - 1];
+    if ( firstCode == lastCode )
+        return firstLeaf + numLeaves / 2;
+
+    // all codes in the range have common prefix, and the next bit is zero in the first part and one in the second part
+    const auto splitBit = std::uint64_t( 1 ) << ( 63 - std::countl_zero( firstCode ^ lastCode ) );
+    const int midLeaf = int( std::partition_point( mortonCodes_.data() + firstLeaf, mortonCodes_.data() + lastLeaf,
+        [splitBit]( std::uint64_t code ) { return ( code & splitBit ) == 0; } ) - mortonCodes_.data() );
+    assert( midLeaf > firstLeaf && midLeaf < lastLeaf );
+
+    if ( depth + 1 + getMedianTreeHeight( std::max( midLeaf - firstLeaf, lastLeaf - midLeaf ) ) > MaxAABBTreeHeight )
+        return firstLeaf + numLeaves / 2;
+    return midLeaf;
+}
+
+template<typename T>
+void AABBTreeMaker<T>::makeMortonSubtree( const Subtree & s, int numThreads )
+{
+    auto & node = nodes_[s.root];
+    if ( s.leaf() )
+    {
+        node.setLeafId( boxedLeaves_[s.firstLeaf].leafId );
+        node.box = boxedLeaves_[s.firstLeaf].box;
+        return;
+    }
+
+    const int midLeaf = particionLeavesMorton( s.firstLeaf, s.firstLeaf + s.numLeaves, s.depth );
+    const int leftNumLeaves = midLeaf - s.firstLeaf;
+    node.l = s.root + 1;
+    node.r = s.root + 1 + getNumNodes( leftNumLeaves );
+    const Subtree ls( node.l, s.firstLeaf, leftNumLeaves, s.depth + 1 );
+    const Subtree rs( node.r, midLeaf, s.numLeaves - leftNumLeaves, s.depth + 1 );
+
+    if ( numThreads >= 2 && s.numLeaves >= 32 )
+    {
+        const int rThreads = numThreads / 2;
+        const int lThreads = numThreads - rThreads;
+        tbb::task_group group;
+        group.run( [&] () { makeMortonSubtree( rs, rThreads ); } );
+        makeMortonSubtree( ls, lThreads );
+        group.wait();
+    }
+    else
+    {
+        makeMortonSubtree( ls, 1 );
+        makeMortonSubtree( rs, 1 );
+    }
+
+    // boxes are computed bottom-up, since the split does not need them
+    node.box = nodes_[node.l].box;
+    node.box.include( nodes_[node.r].box );
+}
+
+template<typename T>
+auto AABBTreeMaker<T>::construct( std::vector<BoxedLeaf<T>> boxedLeaves, const AABBTreeSettings & settings ) -> NodeVec
 {
     MR_TIMER;
 
     boxedLeaves_ = std::move( boxedLeaves );
+    settings_ = settings;
 
     const auto numLeaves = (int)boxedLeaves_.size();
     nodes_.resize( getNumNodes( numLeaves ) );
-    makeSubtree( Subtree( NodeId{ 0 }, 0, numLeaves ), std::thread::hardware_concurrency() );
+    if ( settings_.splitMethod == AABBTreeSplitMethod::Morton )
+    {
+        sortLeavesByMortonCodes();
+        // more subtasks than threads since the subtrees of Morton split can be unequal
+        makeMortonSubtree( Subtree( NodeId{ 0 }, 0, numLeaves, 0 ), 4 * std::thread::hardware_concurrency() );
+    }
+    else
+        makeSubtree( Subtree( NodeId{ 0 }, 0, numLeaves, 0 ), std::thread::hardware_concurrency() );
 
     return std::move( nodes_ );
 }
 
 template<typename T>
-AABBTreeNodeVec<T> makeAABBTreeNodeVec( std::vector<BoxedLeaf<T>> boxedLeaves )
+AABBTreeNodeVec<T> makeAABBTreeNodeVec( std::vector<BoxedLeaf<T>> boxedLeaves, const AABBTreeSettings & settings )
 {
-    return AABBTreeMaker<T>().construct( std::move( boxedLeaves ) );
+    return AABBTreeMaker<T>().construct( std::move( boxedLeaves ), settings );
 }
 
-template AABBTreeNodeVec<FaceTreeTraits3> makeAABBTreeNodeVec( std::vector<BoxedLeaf<FaceTreeTraits3>> boxedLeaves );
-template AABBTreeNodeVec<LineTreeTraits2> makeAABBTreeNodeVec( std::vector<BoxedLeaf<LineTreeTraits2>> boxedLeaves );
-template AABBTreeNodeVec<LineTreeTraits3> makeAABBTreeNodeVec( std::vector<BoxedLeaf<LineTreeTraits3>> boxedLeaves );
+template AABBTreeNodeVec<FaceTreeTraits3> makeAABBTreeNodeVec( std::vector<BoxedLeaf<FaceTreeTraits3>> boxedLeaves, const AABBTreeSettings & settings );
+template AABBTreeNodeVec<LineTreeTraits2> makeAABBTreeNodeVec( std::vector<BoxedLeaf<LineTreeTraits2>> boxedLeaves, const AABBTreeSettings & settings );
+template AABBTreeNodeVec<LineTreeTraits3> makeAABBTreeNodeVec( std::vector<BoxedLeaf<LineTreeTraits3>> boxedLeaves, const AABBTreeSettings & settings );
+template AABBTreeNodeVec<ObjTreeTraits> makeAABBTreeNodeVec( std::vector<BoxedLeaf<ObjTreeTraits>> boxedLeaves, const AABBTreeSettings & settings );
 
 TEST(MRMesh, TBBTask)
 {
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "MRAABBTreeNode.h"
+#include "MRAABBTreeSettings.h"
 #include "MRVector.h"
+#include <bit>
 
 namespace MR
 {
@@ -23,8 +25,32 @@ inline int getNumNodes( int numLeaves )
     return 2 * numLeaves - 1;
 }
 
+/// returns the height of the binary tree with given number of leaves built by median splits
+inline int getMedianTreeHeight( int numLeaves )
+{
+    assert( numLeaves > 0 );
+    return int( std::bit_width( unsigned( numLeaves - 1 ) ) );
+}
+
+/// the queries traverse trees using fixed-size stacks of 32 elements, so SAH split is replaced with median split
+/// if otherwise the tree could become higher than this
+constexpr int MaxAABBTreeHeight = 31;
+
+/// returns the surface area of 3D box or the perimeter of 2D box, which is proportional to the probability of hitting the box by a random ray
+template<typename V>
+inline typename V::ValueType boxSurfaceArea( const Box<V> & box )
+{
+    if ( !box.valid() )
+        return 0;
+    const auto d = box.size();
+    if constexpr ( V::elements == 3 )
+        return 2 * ( d.x * d.y + d.y * d.z + d.z * d.x );
+    else
+        return 2 * ( d.x + d.y );
+}
+
 template<typename T>
-AABBTreeNodeVec<T> makeAABBTreeNodeVec( std::vector<BoxedLeaf<T>> boxedLeaves );
+AABBTreeNodeVec<T> makeAABBTreeNodeVec( std::vector<BoxedLeaf<T>> boxedLeaves, const AABBTreeSettings & settings = {} );
 
 /// \}
 
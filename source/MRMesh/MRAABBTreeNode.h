@@ -24,6 +24,8 @@ template<typename V>
 using LineTreeTraits = ABBTreeTraits<UndirectedEdgeId, Box<V>>;
 using LineTreeTraits2 = LineTreeTraits<Vector2f>;
 using LineTreeTraits3 = LineTreeTraits<Vector3f>;
+/// the tree of bounding boxes of whole objects (e.g. operands of many-mesh booleans)
+using ObjTreeTraits = ABBTreeTraits<ObjId, Box3f>;
 
 template<typename T>
 struct AABBTreeNode
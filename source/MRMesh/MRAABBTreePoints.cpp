@@ -1,4 +1,5 @@
 #include "MRAABBTreePoints.h"
+#include "MRAABBTreeMaker.h"
 #include "MRPointCloud.h"
 #include "MRTimer.h"
 #include "MRUVSphere.h"
@@ -7,6 +8,7 @@
 #include "MRHeapBytes.h"
 #include "MRPch/MRTBB.h"
 #include "MRGTest.h"
+#include <cfloat>
 #include <stack>
 #include <thread>
 
@@ -14,60 +16,141 @@ namespace MR
 {
 
 // returns the number of nodes in the binary tree with given number of points
-inline int getNumNodesPoints( int numPoints )
+inline int getNumNodesPoints( int numPoints, int maxNumPointsInLeaf = AABBTreePoints::MaxNumPointsInLeaf )
 {
     assert( numPoints > 0 );
-    return 2 * ( ( numPoints + AABBTreePoints::MaxNumPointsInLeaf - 1 ) / AABBTreePoints::MaxNumPointsInLeaf ) - 1;
+    return 2 * ( ( numPoints + maxNumPointsInLeaf - 1 ) / maxNumPointsInLeaf ) - 1;
 }
 
 struct SubtreePoints
 {
-    SubtreePoints( AABBTreePoints::NodeId root, int f, int n ) : root( root ), firstPoint( f ), numPoints( n )
+    SubtreePoints( AABBTreePoints::NodeId root, int f, int n, int d ) : root( root ), firstPoint( f ), numPoints( n ), depth( d )
     {
     }
     AABBTreePoints::NodeId root; // of subtree
     int firstPoint = 0;
     int numPoints = 0;
-    AABBTreePoints::NodeId lastNode() const
-    {
-        return root + getNumNodesPoints( numPoints );
-    }
-    bool leaf() const
-    {
-        assert( numPoints >= 1 );
-        return numPoints <= AABBTreePoints::MaxNumPointsInLeaf;
-    }
+    int depth = 0; // of subtree root in the whole tree
 };
 
 class AABBTreePointsMaker
 {
 public:
     std::pair<AABBTreePoints::NodeVec,std::vector<AABBTreePoints::Point>> construct(
-        const VertCoords & points, const VertBitSet & validPoints );
+        const VertCoords & points, const VertBitSet & validPoints, const AABBTreeSettings & settings );
 
 private:
     std::vector<AABBTreePoints::Point> orderedPoints_;
     AABBTreePoints::NodeVec nodes_;
+    AABBTreeSettings settings_;
 
 private:
+    bool leaf( const SubtreePoints& s ) const
+    {
+        assert( s.numPoints >= 1 );
+        return s.numPoints <= settings_.maxNumPointsInLeaf;
+    }
     // [firstPoint, result) will go to left child and [result, lastPoint) - to the right child
-    int partitionPoints( Box3f& box, int firstPoint, int lastPoint );
+    int partitionPoints( Box3f& box, int firstPoint, int lastPoint, int depth );
+    // finds the dimension and the approximate number of points in left child minimizing surface area heuristic,
+    // returns {-1, 0} if all points are the same
+    std::pair<int, int> findSAHSplit( int firstPoint, int lastPoint ) const;
     // constructs not-leaf node
     std::pair<SubtreePoints, SubtreePoints> makeNode( const SubtreePoints& s );
     // constructs given subtree, optionally splitting the job on given number of threads
     void makeSubtree( const SubtreePoints& s, int numThreads );
 };
 
-int AABBTreePointsMaker::partitionPoints( Box3f& box, int firstPoint, int lastPoint )
+std::pair<int, int> AABBTreePointsMaker::findSAHSplit( int firstPoint, int lastPoint ) const
 {
-    assert( firstPoint + AABBTreePoints::MaxNumPointsInLeaf < lastPoint );
+    constexpr int MaxBins = 64; // to avoid allocations
+    const int numBins = std::clamp( settings_.sahBins, 2, MaxBins );
+    const int numPoints = lastPoint - firstPoint;
+
+    Box3f box;
+    for ( int i = firstPoint; i < lastPoint; ++i )
+        box.include( orderedPoints_[i].coord );
+    const auto boxDiag = box.max - box.min;
+
+    struct Bin
+    {
+        Box3f box;
+        int numPoints = 0;
+    };
+    float bestCost = FLT_MAX;
+    std::pair<int, int> res{ -1, 0 };
+    for ( int dim = 0; dim < 3; ++dim )
+    {
+        if ( !( boxDiag[dim] > 0 ) )
+            continue;
+
+        Bin bins[MaxBins];
+        for ( int i = firstPoint; i < lastPoint; ++i )
+        {
+            const auto & p = orderedPoints_[i].coord;
+            auto & bin = bins[std::min( int( ( p[dim] - box.min[dim] ) * numBins / boxDiag[dim] ), numBins - 1 )];
+            bin.box.include( p );
+            ++bin.numPoints;
+        }
+
+        // rightCosts[b] is the cost of the right child made of bins [b, numBins)
+        float rightCosts[MaxBins];
+        Box3f acc;
+        int accPoints = 0;
+        for ( int b = numBins - 1; b > 0; --b )
+        {
+            acc.include( bins[b].box );
+            accPoints += bins[b].numPoints;
+            rightCosts[b] = boxSurfaceArea( acc ) * accPoints;
+        }
+
+        acc = Box3f{};
+        accPoints = 0;
+        for ( int b = 1; b < numBins; ++b )
+        {
+            acc.include( bins[b - 1].box );
+            accPoints += bins[b - 1].numPoints;
+            if ( accPoints <= 0 || accPoints >= numPoints )
+                continue;
+            const auto cost = boxSurfaceArea( acc ) * accPoints + rightCosts[b];
+            if ( cost < bestCost )
+            {
+                bestCost = cost;
+                res = { dim, accPoints };
+            }
+        }
+    }
+    return res;
+}
+
+int AABBTreePointsMaker::partitionPoints( Box3f& box, int firstPoint, int lastPoint, int depth )
+{
+    const int maxNumPointsInLeaf = settings_.maxNumPointsInLeaf;
+    assert( firstPoint + maxNumPointsInLeaf < lastPoint );
     auto boxDiag = box.max - box.min;
     std::array<double, 3> boxSizes = {boxDiag.x, boxDiag.y, boxDiag.z};
-    const int splitDim = int( std::max_element( boxSizes.begin(), boxSizes.end() ) - boxSizes.begin() );
+    const int medianSplitDim = int( std::max_element( boxSizes.begin(), boxSizes.end() ) - boxSizes.begin() );
+    int splitDim = medianSplitDim;
 
     int midPoint = firstPoint + ( lastPoint - firstPoint ) / 2;
+    if ( settings_.splitMethod == AABBTreeSplitMethod::SAH )
+    {
+        const auto [sahDim, sahNumLeft] = findSAHSplit( firstPoint, lastPoint );
+        if ( sahDim >= 0 )
+        {
+            splitDim = sahDim;
+            // round to full leaves, keeping at least one leaf in each child
+            const int numLeaves = ( lastPoint - firstPoint + maxNumPointsInLeaf - 1 ) / maxNumPointsInLeaf;
+            const int numLeftLeaves = std::clamp( ( sahNumLeft + maxNumPointsInLeaf / 2 ) / maxNumPointsInLeaf, 1, numLeaves - 1 );
+            if ( depth + 1 + getMedianTreeHeight( std::max( numLeftLeaves, numLeaves - numLeftLeaves ) ) <= MaxAABBTreeHeight )
+                midPoint = firstPoint + numLeftLeaves * maxNumPointsInLeaf;
+            else
+                splitDim = medianSplitDim;
+        }
+    }
     // to minimize the total number of nodes
-    midPoint += ( AABBTreePoints::MaxNumPointsInLeaf - ( midPoint % AABBTreePoints::MaxNumPointsInLeaf ) ) % AABBTreePoints::MaxNumPointsInLeaf; 
+    midPoint += ( maxNumPointsInLeaf - ( midPoint % maxNumPointsInLeaf ) ) % maxNumPointsInLeaf;
+    assert( midPoint < lastPoint );
     std::nth_element( orderedPoints_.data() + firstPoint, orderedPoints_.data() + midPoint, orderedPoints_.data() + lastPoint,
         [&]( const AABBTreePoints::Point& a, const AABBTreePoints::Point& b )
     {
@@ -78,29 +161,29 @@ int AABBTreePointsMaker::partitionPoints( Box3f& box, int firstPoint, int lastPo
 
 std::pair<SubtreePoints, SubtreePoints> AABBTreePointsMaker::makeNode( const SubtreePoints& s )
 {
-    assert( !s.leaf() );
+    assert( !leaf( s ) );
     auto& node = nodes_[s.root];
     assert( !node.box.valid() );
     for ( size_t i = 0; i < s.numPoints; ++i )
         node.box.include( orderedPoints_[s.firstPoint + i].coord );
 
-    const int midPoint = partitionPoints( node.box, s.firstPoint, s.firstPoint + s.numPoints );
+    const int midPoint = partitionPoints( node.box, s.firstPoint, s.firstPoint + s.numPoints, s.depth );
     const int leftNumPoints = midPoint - s.firstPoint;
     const int rightNumPoints = s.numPoints - leftNumPoints;
     node.leftOrFirst = s.root + 1;
-    node.rightOrLast = s.root + 1 + getNumNodesPoints( leftNumPoints );
+    node.rightOrLast = s.root + 1 + getNumNodesPoints( leftNumPoints, settings_.maxNumPointsInLeaf );
     return
     {
-        SubtreePoints( node.leftOrFirst, s.firstPoint, leftNumPoints ),
-        SubtreePoints( node.rightOrLast, midPoint,     rightNumPoints )
+        SubtreePoints( node.leftOrFirst, s.firstPoint, leftNumPoints,  s.depth + 1 ),
+        SubtreePoints( node.rightOrLast, midPoint,     rightNumPoints, s.depth + 1 )
     };
 }
 
 void AABBTreePointsMaker::makeSubtree( const SubtreePoints& s, int numThreads )
 {
-    assert( s.root + getNumNodesPoints( s.numPoints ) <= nodes_.size() );
+    assert( s.root + getNumNodesPoints( s.numPoints, settings_.maxNumPointsInLeaf ) <= nodes_.size() );
 
-    if ( numThreads >= 2 && s.numPoints > 3 * AABBTreePoints::MaxNumPointsInLeaf )
+    if ( numThreads >= 2 && s.numPoints > 3 * settings_.maxNumPointsInLeaf )
     {
         const auto& lr = makeNode( s );
         const int rThreads = numThreads / 2;
@@ -119,7 +202,7 @@ void AABBTreePointsMaker::makeSubtree( const SubtreePoints& s, int numThreads )
     {
         const SubtreePoints x = stack.top();
         stack.pop();
-        if ( x.leaf() )
+        if ( leaf( x ) )
         {
             auto& node = nodes_[x.root];
             node.setLeafPointRange( x.firstPoint, x.firstPoint + x.numPoints );
@@ -137,7 +220,7 @@ void AABBTreePointsMaker::makeSubtree( const SubtreePoints& s, int numThreads )
 }
 
 std::pair<AABBTreePoints::NodeVec, std::vector<AABBTreePoints::Point>> AABBTreePointsMaker::construct(
-    const VertCoords & points, const VertBitSet & validPoints )
+    const VertCoords & points, const VertBitSet & validPoints, const AABBTreeSettings & settings )
 {
     MR_TIMER;
 
@@ -145,34 +228,37 @@ std::pair<AABBTreePoints::NodeVec, std::vector<AABBTreePoints::Point>> AABBTreeP
     if ( numPoints <= 0 )
         return {};
 
+    settings_ = settings;
+    settings_.maxNumPointsInLeaf = std::max( 1, settings_.maxNumPointsInLeaf );
+
     orderedPoints_.resize( numPoints );
     int n = 0;
     for ( auto v : validPoints )
         orderedPoints_[n++] = { points[v], v };
 
-    nodes_.resize( getNumNodesPoints( numPoints ) );
-    makeSubtree( SubtreePoints( AABBTreePoints::rootNodeId(), 0, numPoints ), std::thread::hardware_concurrency() );
+    nodes_.resize( getNumNodesPoints( numPoints, settings_.maxNumPointsInLeaf ) );
+    makeSubtree( SubtreePoints( AABBTreePoints::rootNodeId(), 0, numPoints, 0 ), std::thread::hardware_concurrency() );
 
     return {std::move( nodes_ ),std::move( orderedPoints_ )};
 }
 
-AABBTreePoints::AABBTreePoints( const PointCloud& pointCloud )
+AABBTreePoints::AABBTreePoints( const PointCloud& pointCloud, const AABBTreeSettings & settings )
 {
-    auto [nodes, orderedPoints] = AABBTreePointsMaker().construct( pointCloud.points, pointCloud.validPoints );
+    auto [nodes, orderedPoints] = AABBTreePointsMaker().construct( pointCloud.points, pointCloud.validPoints, settings );
     nodes_ = std::move( nodes ); 
     orderedPoints_ = std::move( orderedPoints );
 }
 
-AABBTreePoints::AABBTreePoints( const Mesh& mesh )
+AABBTreePoints::AABBTreePoints( const Mesh& mesh, const AABBTreeSettings & settings )
 {
-    auto [nodes, orderedPoints] = AABBTreePointsMaker().construct( mesh.points, mesh.topology.getValidVerts() );
+    auto [nodes, orderedPoints] = AABBTreePointsMaker().construct( mesh.points, mesh.topology.getValidVerts(), settings );
     nodes_ = std::move( nodes );
     orderedPoints_ = std::move( orderedPoints );
 }
 
-AABBTreePoints::AABBTreePoints( const VertCoords & points, const VertBitSet & validPoints )
+AABBTreePoints::AABBTreePoints( const VertCoords & points, const VertBitSet & validPoints, const AABBTreeSettings & settings )
 {
-    auto [nodes, orderedPoints] = AABBTreePointsMaker().construct( points, validPoints );
+    auto [nodes, orderedPoints] = AABBTreePointsMaker().construct( points, validPoints, settings );
     nodes_ = std::move( nodes );
     orderedPoints_ = std::move( orderedPoints );
 }
@@ -204,6 +290,30 @@ TEST( MRMesh, AABBTreePoints )
     assert( tree.nodes().empty() );
 }
 
+TEST( MRMesh, AABBTreePointsSAH )
+{
+    PointCloud spherePC = meshToPointCloud( makeUVSphere( 1, 32, 32 ) );
+    const AABBTreeSettings settings{ .splitMethod = AABBTreeSplitMethod::SAH, .maxNumPointsInLeaf = 8 };
+    AABBTreePoints tree( spherePC, settings );
+    const int numPoints = int( spherePC.validPoints.count() );
+    EXPECT_EQ( tree.nodes().size(), getNumNodesPoints( numPoints, settings.maxNumPointsInLeaf ) );
+
+    VertBitSet treePoints;
+    for ( const auto & node : tree.nodes() )
+    {
+        if ( !node.leaf() )
+            continue;
+        const auto [first, last] = node.getLeafPointRange();
+        EXPECT_LE( last - first, settings.maxNumPointsInLeaf );
+        for ( int i = first; i < last; ++i )
+        {
+            EXPECT_TRUE( node.box.contains( tree.orderedPoints()[i].coord ) );
+            treePoints.autoResizeSet( tree.orderedPoints()[i].id );
+        }
+    }
+    EXPECT_EQ( treePoints, spherePC.validPoints );
+}
+
 TEST( MRMesh, AABBTreePointsFromMesh )
 {
     Mesh sphere = makeUVSphere( 1, 8, 8 );
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "MRAABBTreeSettings.h"
 #include "MRBox.h"
 #include "MRId.h"
 #include "MRVector.h"
@@ -44,13 +45,14 @@ public:
     [[nodiscard]] const std::vector<Point>& orderedPoints() const { return orderedPoints_; }
 
     /// creates tree for given point cloud
-    MRMESH_API AABBTreePoints( const PointCloud& pointCloud );
+    MRMESH_API AABBTreePoints( const PointCloud& pointCloud, const AABBTreeSettings & settings = {} );
     /// creates tree for vertices of given mesh
-    MRMESH_API AABBTreePoints( const Mesh& mesh );
+    MRMESH_API AABBTreePoints( const Mesh& mesh, const AABBTreeSettings & settings = {} );
     /// creates tree from given valid points
-    MRMESH_API AABBTreePoints( const VertCoords & points, const VertBitSet & validPoints );
+    MRMESH_API AABBTreePoints( const VertCoords & points, const VertBitSet & validPoints, const AABBTreeSettings & settings = {} );
 
-    /// maximum number of points in leaf node of tree (all of leafs should have this number of points except last one)
+    /// default maximum number of points in leaf node of tree (all of leafs should have this number of points except last one),
+    /// can be changed by AABBTreeSettings::maxNumPointsInLeaf
     constexpr static int MaxNumPointsInLeaf = 16;
 
     AABBTreePoints( AABBTreePoints && ) noexcept = default;
@@ -12,7 +12,7 @@ namespace MR
 {
 
 template<typename V>
-AABBTreePolyline<V>::AABBTreePolyline( const typename PolylineTraits<V>::Polyline & polyline )
+AABBTreePolyline<V>::AABBTreePolyline( const typename PolylineTraits<V>::Polyline & polyline, const AABBTreeSettings & settings )
 {
     MR_TIMER;
 
@@ -42,11 +42,11 @@ AABBTreePolyline<V>::AABBTreePolyline( const typename PolylineTraits<V>::Polylin
         }
     } );
 
-    nodes_ = makeAABBTreeNodeVec( std::move( boxedLines ) );
+    nodes_ = makeAABBTreeNodeVec( std::move( boxedLines ), settings );
 }
 
 template<typename V>
-AABBTreePolyline<V>::AABBTreePolyline( const Mesh& mesh, const UndirectedEdgeBitSet & edgeSet )
+AABBTreePolyline<V>::AABBTreePolyline( const Mesh& mesh, const UndirectedEdgeBitSet & edgeSet, const AABBTreeSettings & settings )
 {
     MR_TIMER;
 
@@ -72,11 +72,11 @@ AABBTreePolyline<V>::AABBTreePolyline( const Mesh& mesh, const UndirectedEdgeBit
         }
     } );
 
-    nodes_ = makeAABBTreeNodeVec( std::move( boxedLines ) );
+    nodes_ = makeAABBTreeNodeVec( std::move( boxedLines ), settings );
 }
 
-template AABBTreePolyline<Vector2f>::AABBTreePolyline( const Polyline2 & );
-template AABBTreePolyline<Vector3f>::AABBTreePolyline( const Polyline3 & );
-template AABBTreePolyline<Vector3f>::AABBTreePolyline( const Mesh &, const UndirectedEdgeBitSet & );
+template AABBTreePolyline<Vector2f>::AABBTreePolyline( const Polyline2 &, const AABBTreeSettings & );
+template AABBTreePolyline<Vector3f>::AABBTreePolyline( const Polyline3 &, const AABBTreeSettings & );
+template AABBTreePolyline<Vector3f>::AABBTreePolyline( const Mesh &, const UndirectedEdgeBitSet &, const AABBTreeSettings & );
 
 } //namespace MR
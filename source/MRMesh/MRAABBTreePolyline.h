@@ -1,6 +1,7 @@
 #pragma once
 
 #include "MRAABBTreeNode.h"
+#include "MRAABBTreeSettings.h"
 #include "MRVector.h"
 
 namespace MR
@@ -53,9 +54,9 @@ public:
     }
 
     /// creates tree for given polyline
-    MRMESH_API AABBTreePolyline( const typename PolylineTraits<V>::Polyline & polyline );
+    MRMESH_API AABBTreePolyline( const typename PolylineTraits<V>::Polyline & polyline, const AABBTreeSettings & settings = {} );
     /// creates tree for selected edges on the mesh (only for 3d tree)
-    MRMESH_API AABBTreePolyline( const Mesh& mesh, const UndirectedEdgeBitSet & edgeSet );
+    MRMESH_API AABBTreePolyline( const Mesh& mesh, const UndirectedEdgeBitSet & edgeSet, const AABBTreeSettings & settings = {} );
 
     AABBTreePolyline( AABBTreePolyline && ) noexcept = default;
     AABBTreePolyline & operator =( AABBTreePolyline && ) noexcept = default;
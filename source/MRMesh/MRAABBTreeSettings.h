@@ -0,0 +1,42 @@
+#pragma once
+
+#include "MRMeshFwd.h"
+
+namespace MR
+{
+
+/// \addtogroup AABBTreeGroup
+/// \{
+
+/// the way a set of leaves is divided in two children during AABB tree construction
+enum class AABBTreeSplitMethod
+{
+    /// the leaves are divided in two halves along the longest dimension of node's box;
+    /// fastest construction, and the tree is perfectly balanced
+    Median,
+    /// the leaves are divided to minimize surface area heuristic among binned candidates in all dimensions;
+    /// slower construction, but the tree has less overlapping boxes and ray/projection queries visit less nodes
+    SAH,
+    /// the leaves are sorted by Morton codes of their box centers (linear BVH), and each node is divided
+    /// on the highest bit different in the codes of its leaves; the fastest construction for huge meshes
+    /// since all levels are built in parallel, but the tree is a bit worse for queries than with Median;
+    /// not supported by AABBTreePoints, which uses Median split instead
+    Morton
+};
+
+/// parameters of AABB tree construction
+struct AABBTreeSettings
+{
+    AABBTreeSplitMethod splitMethod = AABBTreeSplitMethod::Median;
+
+    /// the number of candidate bins per dimension evaluated in SAH split
+    int sahBins = 16;
+
+    /// maximum number of points in a leaf node of AABBTreePoints;
+    /// leaves of AABBTree and AABBTreePolyline always reference exactly one face or line respectively
+    int maxNumPointsInLeaf = 16;
+};
+
+/// \}
+
+} // namespace MR
@@ -3,6 +3,7 @@
 #include "MRBitSet.h"
 #include "MRPch/MRTBB.h"
 #include "MRProgressCallback.h"
+#include "MRTimer.h"
 #include <atomic>
 #include <thread>
 
@@ -13,16 +14,19 @@ namespace MR
 /// \{
 
 /// executes given function f for each bit in bs in parallel threads;
-/// it is guaranteed that every individual block in bit-set is processed by one thread only
+/// it is guaranteed that every individual block in bit-set is processed by one thread only;
+/// the timers inside f are attributed to the active timer of the calling thread
 template <typename BS, typename F>
 void BitSetParallelForAll( const BS & bs, F f )
 {
     using IndexType = typename BS::IndexType;
 
     const int endBlock = int( bs.size() + BS::bits_per_block - 1 ) / BS::bits_per_block;
+    const auto timerParent = currentTimerRecord();
     tbb::parallel_for( tbb::blocked_range<int>( 0, endBlock ), 
         [&]( const tbb::blocked_range<int> & range )
         {
+            TimerParentScope timerScope( timerParent );
             IndexType id{ range.begin() * BitSet::bits_per_block };
             const IndexType idEnd{ range.end() < endBlock ? range.end() * BS::bits_per_block : bs.size() };
             for ( ; id < idEnd; ++id )
@@ -49,10 +53,12 @@ bool BitSetParallelForAll( const BS& bs, F f, ProgressCallback progressCb )
 
     const int endBlock = int( bs.size() + BS::bits_per_block - 1 ) / BS::bits_per_block;
     auto mainThreadId = std::this_thread::get_id();
+    const auto timerParent = currentTimerRecord();
     std::atomic<bool> keepGoing{ true };
     tbb::parallel_for( tbb::blocked_range<int>( 0, endBlock ),
         [&] ( const tbb::blocked_range<int>& range )
     {
+        TimerParentScope timerScope( timerParent );
         IndexType id{ range.begin() * BitSet::bits_per_block };
         const IndexType idEnd{ range.end() < endBlock ? range.end() * BS::bits_per_block : bs.size() };
         auto idBegin = int( id );
@@ -547,7 +547,7 @@ std::optional<OneMeshIntersection> centralIntersection( const Mesh& mesh, const
                                                 float closeEdgeEps,
                                                 CenterInterType& type )
 {
-    MR_TIMER;
+    MR_LEAF_TIMER;
     type = CenterInterType::Common;
     if ( prev.primitiveId.index() == OneMeshIntersection::Face || next.primitiveId.index() == OneMeshIntersection::Face )
         return centralIntersectionForFaces( mesh, prev, curr, next );
@@ -1054,7 +1054,7 @@ void invalidateFace( MeshTopology& topology, FullRemovedFacesInfo& removedFaceIn
 // back-iterate removed face info to find correct splice edge for vert->face->vert like paths (second vert should find correct face edge for splice)
 EdgeId iterateRemovedFacesInfoToFindLeftEdge( const MeshTopology& topology, const FullRemovedFacesInfo& removedFaces, int contId, int interId, FaceId f, VertId v )
 {
-    MR_TIMER
+    MR_LEAF_TIMER
     for ( int backContId = contId; backContId >= 0; --backContId )
     {
         int prevInter = backContId == contId ? ( interId - 1 ) : ( int( removedFaces[backContId].size() ) - 1 );
@@ -1461,7 +1461,7 @@ void connectEdges( MeshTopology& topology, EdgeId botEdge, EdgeId topEdge, EdgeI
 // cuts one edge and connects all intersecting contours with pieces
 void cutOneEdge( Mesh& mesh,
                  const EdgeData& edgeData, const OneMeshContours& contours, 
-                 const SortIntersectionsData* sortData,
+                 const std::vector<int>& sortedIntersectionsIndices,
                  FaceMap* new2OldMap )
 {
     assert( !edgeData.intersections.empty() );
@@ -1477,8 +1477,6 @@ void cutOneEdge( Mesh& mesh,
     mesh.topology.setLeft( baseEdge, FaceId{} );
     mesh.topology.setLeft( baseEdge.sym(), FaceId{} );
 
-    auto sortedIntersectionsIndices = sortIntersectionsAlongBaseEdge( mesh, baseEdge, edgeData, sortData );
-
     EdgeId e = baseEdge;       
     // disconnect edge e from its origin
     EdgeId e0;
@@ -1541,12 +1539,29 @@ void cutEdgesIntoPieces( Mesh& mesh,
                          FaceMap* new2OldMap )
 {
     MR_TIMER;
-    for ( const auto& edgeInfo : edgeData )
+    // sorting of intersections along an edge does not depend on the cuts of other edges, so all edges are sorted in parallel first
+    Vector<std::vector<int>, UndirectedEdgeId> sortedIntersections( edgeData.size() );
+    tbb::parallel_for( tbb::blocked_range<UndirectedEdgeId>( 0_ue, UndirectedEdgeId( int( edgeData.size() ) ) ),
+        [&] ( const tbb::blocked_range<UndirectedEdgeId>& range )
+    {
+        for ( auto ue = range.begin(); ue < range.end(); ++ue )
+        {
+            const auto& edgeInfo = edgeData[ue];
+            if ( edgeInfo.intersections.empty() )
+                continue;
+            const auto& intInfo = edgeInfo.intersections[0];
+            EdgeId baseEdge = std::get<EdgeId>( contours[intInfo.contourId].intersections[intInfo.intersectionId].primitiveId );
+            sortedIntersections[ue] = sortIntersectionsAlongBaseEdge( mesh, baseEdge, edgeInfo, sortData );
+        }
+    } );
+
+    for ( auto ue = 0_ue; ue < edgeData.size(); ++ue )
     {
+        const auto& edgeInfo = edgeData[ue];
         if ( edgeInfo.intersections.empty() )
             continue;
 
-        cutOneEdge( mesh, edgeInfo, contours, sortData, new2OldMap );
+        cutOneEdge( mesh, edgeInfo, contours, sortedIntersections[ue], new2OldMap );
     }
 }
 
@@ -1615,6 +1630,8 @@ CutMeshResult cutMesh( Mesh& mesh, const OneMeshContours& contours, const CutMes
         EdgeId e;
         FaceId oldf;
         FillHolePlan plan;
+        EdgeId firstNewEdge; // the holes filled in parallel use preliminary created edges and faces
+        FaceId firstNewFace;
     };
     std::vector<HoleDesc> holeRepresentativeEdges;
     auto addHoleDesc = [&]( EdgeId e, FaceId oldf )
@@ -1646,17 +1663,18 @@ CutMeshResult cutMesh( Mesh& mesh, const OneMeshContours& contours, const CutMes
     // prepare in parallel the plan to fill every contour
     Timer t( "get TriangulateContourPlans" );
     tbb::parallel_for( tbb::blocked_range<size_t>( 0, holeRepresentativeEdges.size() ),
-        [&]( const tbb::blocked_range<size_t>& range )
+        withTimerParent( [&]( const tbb::blocked_range<size_t>& range )
     {
         for ( size_t i = range.begin(); i < range.end(); ++i )
         {
             auto & hd = holeRepresentativeEdges[i];
             hd.plan = getTriangulateContourPlan( mesh, hd.e );
         }
-    } );
+    } ) );
     // fill contours
 
     t.restart( "run TriangulateContourPlans" );
+    auto isTrivialFill = [] ( const FillHolePlan& plan ) { return plan.items.empty() && plan.numNewTris > 1; };
     int numNewTris = 0;
     for ( const auto & hd : holeRepresentativeEdges )
         numNewTris += hd.plan.numNewTris;
@@ -1666,8 +1684,46 @@ CutMeshResult cutMesh( Mesh& mesh, const OneMeshContours& contours, const CutMes
     if ( params.new2OldMap )
         params.new2OldMap->reserve( expectedTotalTris );
 
+    // trivial fillings add new vertices, so they are executed sequentially
     for ( auto & hd : holeRepresentativeEdges )
-        executeTriangulateContourPlan( mesh, hd.e, hd.plan, hd.oldf, params.new2OldMap );
+        if ( isTrivialFill( hd.plan ) )
+            executeTriangulateContourPlan( mesh, hd.e, hd.plan, hd.oldf, params.new2OldMap );
+
+    // all other holes get their ranges of new edges and faces, and then they are filled in parallel
+    const auto faceSize0 = mesh.topology.faceSize();
+    size_t numNewEdges = 0;
+    for ( auto & hd : holeRepresentativeEdges )
+    {
+        if ( isTrivialFill( hd.plan ) )
+            continue;
+        hd.firstNewEdge = EdgeId( int( mesh.topology.edgeSize() + 2 * numNewEdges ) );
+        hd.firstNewFace = FaceId( int( mesh.topology.faceSize() ) );
+        numNewEdges += hd.plan.items.size();
+        for ( int i = 0; i < hd.plan.numNewTris; ++i )
+            (void)mesh.topology.addFaceId();
+    }
+    mesh.topology.edgeReserve( mesh.topology.edgeSize() + 2 * numNewEdges );
+    for ( size_t i = 0; i < numNewEdges; ++i )
+        (void)mesh.topology.makeEdge();
+    if ( params.new2OldMap )
+        params.new2OldMap->resize( mesh.topology.faceSize() );
+
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, holeRepresentativeEdges.size() ),
+        withTimerParent( [&]( const tbb::blocked_range<size_t>& range )
+    {
+        for ( size_t i = range.begin(); i < range.end(); ++i )
+        {
+            auto & hd = holeRepresentativeEdges[i];
+            if ( isTrivialFill( hd.plan ) )
+                continue;
+            executeFillHolePlan( mesh.topology, hd.e, hd.plan, hd.firstNewEdge, hd.firstNewFace );
+            if ( params.new2OldMap )
+                for ( FaceId f = hd.firstNewFace; f < hd.firstNewFace + hd.plan.numNewTris; ++f )
+                    ( *params.new2OldMap )[f] = hd.oldf;
+        }
+    } ) );
+    if ( mesh.topology.faceSize() > faceSize0 )
+        mesh.topology.computeValidsFromEdges();
 
     assert( mesh.topology.faceSize() == expectedTotalTris );
     if ( params.new2OldMap )
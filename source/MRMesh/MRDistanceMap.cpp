@@ -271,6 +271,7 @@ tl::expected<MR::DistanceMap, std::string> loadDistanceMapFromImage( const std::
 template <typename T = float>
 DistanceMap computeDistanceMap_( const MeshPart& mp, const MeshToDistanceMapParams& params )
 {
+    MR_TIMER
     DistanceMap distMap( params.resolution.x, params.resolution.y );
 
     // precomputed some values
@@ -295,51 +296,31 @@ DistanceMap computeDistanceMap_( const MeshPart& mp, const MeshToDistanceMapPara
 
     T xStep_1 = T( 1 ) / T( params.resolution.x );
     T yStep_1 = T( 1 ) / T( params.resolution.y );
-    if ( params.useDistanceLimits )
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, params.resolution.x ),
+        withTimerParent( [&] ( const tbb::blocked_range<size_t>& range )
     {
-        tbb::parallel_for( tbb::blocked_range<size_t>( 0, params.resolution.x ),
-            [&] ( const tbb::blocked_range<size_t>& range )
+        // the rays of one column are traced together in packets of neighbouring pixels
+        std::vector<Line3<T>> lines( params.resolution.y );
+        for ( size_t x = range.begin(); x < range.end(); x++ )
         {
-            for ( size_t x = range.begin(); x < range.end(); x++ )
+            for ( size_t y = 0; y < params.resolution.y; y++ )
             {
-                for ( size_t y = 0; y < params.resolution.y; y++ )
-                {
-                    Vector3<T> rayOri = Vector3<T>( ori ) +
-                        Vector3<T>( params.xRange ) * ( ( T( x ) + T( 0.5 ) ) * xStep_1 ) +
-                        Vector3<T>( params.yRange ) * ( ( T( y ) + T( 0.5 ) ) * yStep_1 );
-                    if ( auto meshIntersectionRes = rayMeshIntersect( mp, Line3<T>( Vector3<T>( rayOri ), Vector3<T>( params.direction ) ),
-                        -std::numeric_limits<T>::max(), std::numeric_limits<T>::max(), &prec ) )
-                    {
-                        if ( ( meshIntersectionRes->distanceAlongLine < params.minValue ) || ( meshIntersectionRes->distanceAlongLine > params.maxValue ) )
-                            distMap.set( x, y, meshIntersectionRes->distanceAlongLine );
-                    }
-                }
+                Vector3<T> rayOri = Vector3<T>( ori ) +
+                    Vector3<T>( params.xRange ) * ( ( T( x ) + T( 0.5 ) ) * xStep_1 ) +
+                    Vector3<T>( params.yRange ) * ( ( T( y ) + T( 0.5 ) ) * yStep_1 );
+                lines[y] = Line3<T>( rayOri, Vector3<T>( params.direction ) );
             }
-        } );
-    }
-    else
-    {
-        tbb::parallel_for( tbb::blocked_range<size_t>( 0, params.resolution.x ),
-            [&] ( const tbb::blocked_range<size_t>& range )
-        {
-            for ( size_t x = range.begin(); x < range.end(); x++ )
-            //debug line
-            //for ( size_t x = 0; x < params.resX; x++ )
+            const auto meshIntersectionRes = rayMeshIntersect( mp, lines, -std::numeric_limits<T>::max(), std::numeric_limits<T>::max(), &prec );
+            for ( size_t y = 0; y < params.resolution.y; y++ )
             {
-                for ( size_t y = 0; y < params.resolution.y; y++ )
-                {
-                    Vector3<T> rayOri = Vector3<T>( ori ) +
-                        Vector3<T>( params.xRange ) * ( ( T( x ) + T( 0.5 ) ) * xStep_1 ) +
-                        Vector3<T>( params.yRange ) * ( ( T( y ) + T( 0.5 ) ) * yStep_1 );
-                    if ( auto meshIntersectionRes = rayMeshIntersect( mp, Line3<T>( Vector3<T>( rayOri ), Vector3<T>( params.direction ) ),
-                        -std::numeric_limits<T>::max(), std::numeric_limits<T>::max(), &prec ) )
-                    {
-                        distMap.set( x, y, meshIntersectionRes->distanceAlongLine );
-                    }
-                }
+                if ( !meshIntersectionRes[y] )
+                    continue;
+                const float dist = meshIntersectionRes[y]->distanceAlongLine;
+                if ( !params.useDistanceLimits || ( dist < params.minValue ) || ( dist > params.maxValue ) )
+                    distMap.set( x, y, dist );
             }
-        } );
-    }
+        }
+    } ) );
 
     if ( params.allowNegativeValues )
     {
@@ -225,6 +225,7 @@ void FreeFormDeformer::apply() const
             meshPoints[VertId( i )] = applyToNormedPoint_( meshPointsNormedPoses_[i], xPlane, yLine, buffer.local() );
         }
     } );
+    mesh_.invalidateCaches( true );
 }
 
 Vector3f FreeFormDeformer::applySinglePoint( const Vector3f& point ) const
@@ -3,11 +3,14 @@
 #include "MRMesh.h"
 #include "MRMeshPart.h"
 #include "MRPointCloud.h"
+#include "MRColor.h"
 #include "MRRegionBoundary.h"
 #include "MRVolumeIndexer.h"
 #include "MRTimer.h"
 #include "MRUVSphere.h"
 #include "MRGTest.h"
+#include <parallel_hashmap/phmap.h>
+#include <optional>
 
 namespace MR
 {
@@ -18,31 +21,39 @@ struct GridElement
     float centerDistSq = FLT_MAX;
 };
 
-class Grid : public VolumeIndexer
+// uniform subdivision of a box on voxels
+class GridGeometry : public VolumeIndexer
 {
 public:
-    Grid( const Box3f & box, const Vector3i & dims );
+    GridGeometry( const Box3f & box, const Vector3i & dims );
     // finds voxel containing given point
     Vector3i pointPos( const Vector3f & p ) const;
     // finds center of given voxel
     Vector3f voxelCenter( const Vector3i & pos ) const;
+
+private:
+    Box3f box_; 
+    Vector3f voxelSize_;
+    Vector3f recipVoxelSize_;
+};
+
+class Grid : public GridGeometry
+{
+public:
+    Grid( const Box3f & box, const Vector3i & dims );
     // if given point is closer to the center of its voxel, then it is remembered
     void addVertex( const Vector3f & p, VertId vid );
     // returns all sampled points after addition
     VertBitSet getSamples() const;
 
 private:
-    Box3f box_; 
-    Vector3f voxelSize_;
-    Vector3f recipVoxelSize_;
     std::vector<GridElement> voxels_;
 };
 
-Grid::Grid( const Box3f & box, const Vector3i & dims )
+GridGeometry::GridGeometry( const Box3f & box, const Vector3i & dims )
     : VolumeIndexer( dims )
     , box_( box )
 {
-    voxels_.resize( size_ );
     const auto boxSz = box.max - box.min;
     voxelSize_.x = boxSz.x / dims.x;
     voxelSize_.y = boxSz.y / dims.y;
@@ -52,7 +63,7 @@ Grid::Grid( const Box3f & box, const Vector3i & dims )
     recipVoxelSize_.z = 1 / voxelSize_.z;
 }
 
-inline Vector3i Grid::pointPos( const Vector3f & p ) const
+inline Vector3i GridGeometry::pointPos( const Vector3f & p ) const
 {
     return
     {
@@ -62,7 +73,7 @@ inline Vector3i Grid::pointPos( const Vector3f & p ) const
     };
 }
 
-inline Vector3f Grid::voxelCenter( const Vector3i & pos ) const
+inline Vector3f GridGeometry::voxelCenter( const Vector3i & pos ) const
 {
     return
     {
@@ -72,6 +83,12 @@ inline Vector3f Grid::voxelCenter( const Vector3i & pos ) const
     };
 }
 
+Grid::Grid( const Box3f & box, const Vector3i & dims )
+    : GridGeometry( box, dims )
+{
+    voxels_.resize( size_ );
+}
+
 void Grid::addVertex( const Vector3f & p, VertId vid )
 {
     const auto pos = pointPos( p );
@@ -98,6 +115,19 @@ VertBitSet Grid::getSamples() const
     return res;
 }
 
+// returns the number of voxels of approximately given size along each dimension of the box
+static Vector3i gridDims( const Box3f & bbox, float voxelSize )
+{
+    const auto bboxSz = bbox.max - bbox.min;
+    constexpr float maxVoxelsInOneDim = 1 << 10;
+    return
+    {
+        (int) std::min( std::ceil( bboxSz.x / voxelSize ), maxVoxelsInOneDim ),
+        (int) std::min( std::ceil( bboxSz.y / voxelSize ), maxVoxelsInOneDim ),
+        (int) std::min( std::ceil( bboxSz.z / voxelSize ), maxVoxelsInOneDim )
+    };
+}
+
 VertBitSet verticesGridSampling( const MeshPart & mp, float voxelSize )
 {
     MR_TIMER;
@@ -110,14 +140,7 @@ VertBitSet verticesGridSampling( const MeshPart & mp, float voxelSize )
     }
 
     const auto bbox = mp.mesh.computeBoundingBox( mp.region );
-    const auto bboxSz = bbox.max - bbox.min;
-    constexpr float maxVoxelsInOneDim = 1 << 10;
-    const Vector3i dims
-    {
-        (int) std::min( std::ceil( bboxSz.x / voxelSize ), maxVoxelsInOneDim ),
-        (int) std::min( std::ceil( bboxSz.y / voxelSize ), maxVoxelsInOneDim ),
-        (int) std::min( std::ceil( bboxSz.z / voxelSize ), maxVoxelsInOneDim )
-    };
+    const auto dims = gridDims( bbox, voxelSize );
 
     Grid grid( bbox, dims );
     if ( mp.region )
@@ -142,14 +165,7 @@ VertBitSet pointGridSampling( const PointCloud & cloud, float voxelSize )
     MR_TIMER;
 
     const auto bbox = cloud.getBoundingBox();
-    const auto bboxSz = bbox.max - bbox.min;
-    constexpr float maxVoxelsInOneDim = 1 << 10;
-    const Vector3i dims
-    {
-        (int) std::min( std::ceil( bboxSz.x / voxelSize ), maxVoxelsInOneDim ),
-        (int) std::min( std::ceil( bboxSz.y / voxelSize ), maxVoxelsInOneDim ),
-        (int) std::min( std::ceil( bboxSz.z / voxelSize ), maxVoxelsInOneDim )
-    };
+    const auto dims = gridDims( bbox, voxelSize );
 
     Grid grid( bbox, dims );
     for ( auto v : cloud.validPoints )
@@ -158,6 +174,89 @@ VertBitSet pointGridSampling( const PointCloud & cloud, float voxelSize )
     return grid.getSamples();
 }
 
+tl::expected<PointCloud, std::string> pointGridSampling( const PointsStream & stream, float voxelSize, Vector<Color, VertId> * colors )
+{
+    MR_TIMER;
+    const auto bbox = computeBoundingBox( stream );
+    if ( !bbox )
+        return tl::make_unexpected( bbox.error() );
+
+    // only the voxels with points are stored
+    struct Sample
+    {
+        float centerDistSq = FLT_MAX;
+        size_t index = 0; // in the stream
+        Vector3f point;
+        Vector3f normal;
+        Color color;
+    };
+    phmap::flat_hash_map<size_t, Sample> samples;
+    std::optional<GridGeometry> grid;
+    if ( voxelSize > 0.f && bbox->valid() )
+        grid.emplace( *bbox, gridDims( *bbox, voxelSize ) );
+
+    bool hasNormals = true, hasColors = true;
+    size_t index = 0;
+    auto res = stream( [&]( const PointsChunk & chunk )
+    {
+        hasNormals = hasNormals && chunk.normals;
+        hasColors = hasColors && chunk.colors;
+        for ( size_t i = 0; i < chunk.size; ++i, ++index )
+        {
+            const auto & p = chunk.points[i];
+            size_t key = index;
+            float distSq = 0;
+            if ( grid )
+            {
+                const auto pos = grid->pointPos( p );
+                key = grid->toVoxelId( pos );
+                distSq = ( p - grid->voxelCenter( pos ) ).lengthSq();
+            }
+            auto & sample = samples[key];
+            if ( distSq < sample.centerDistSq )
+            {
+                sample.centerDistSq = distSq;
+                sample.index = index;
+                sample.point = p;
+                sample.normal = chunk.normals ? chunk.normals[i] : Vector3f{};
+                sample.color = chunk.colors ? chunk.colors[i] : Color{};
+            }
+        }
+        return true;
+    } );
+    if ( !res )
+        return tl::make_unexpected( std::move( res.error() ) );
+
+    std::vector<const Sample *> sorted;
+    sorted.reserve( samples.size() );
+    for ( const auto & [key, sample] : samples )
+        sorted.push_back( &sample );
+    std::sort( sorted.begin(), sorted.end(), []( const Sample * a, const Sample * b ) { return a->index < b->index; } );
+
+    PointCloud cloud;
+    cloud.points.reserve( sorted.size() );
+    for ( const auto * s : sorted )
+        cloud.points.push_back( s->point );
+    if ( hasNormals )
+    {
+        cloud.normals.reserve( sorted.size() );
+        for ( const auto * s : sorted )
+            cloud.normals.push_back( s->normal );
+    }
+    if ( colors )
+    {
+        colors->clear();
+        if ( hasColors )
+        {
+            colors->reserve( sorted.size() );
+            for ( const auto * s : sorted )
+                colors->push_back( s->color );
+        }
+    }
+    cloud.validPoints.resize( cloud.points.size(), true );
+    return cloud;
+}
+
 TEST( MRMesh, GridSampling )
 {
     auto sphereMesh = makeUVSphere();
@@ -165,6 +264,17 @@ TEST( MRMesh, GridSampling )
     auto samples = verticesGridSampling( sphereMesh, 0.5f );
     auto sampleCount = samples.count();
     EXPECT_LE( sampleCount, numVerts );
+
+    PointCloud cloud;
+    cloud.points = sphereMesh.points;
+    cloud.validPoints = sphereMesh.topology.getValidVerts();
+    auto cloudSamples = pointGridSampling( cloud, 0.5f );
+    auto streamSamples = pointGridSampling( pointsStreamFromCloud( cloud, nullptr, 100 ), 0.5f );
+    ASSERT_TRUE( streamSamples.has_value() );
+    ASSERT_EQ( streamSamples->points.size(), cloudSamples.count() );
+    int i = 0;
+    for ( auto v : cloudSamples )
+        EXPECT_EQ( streamSamples->points[VertId( i++ )], cloud.points[v] );
 }
 
 } //namespace MR
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "MRMeshFwd.h"
+#include "MRPointsStream.h"
 
 namespace MR
 {
@@ -10,5 +11,9 @@ namespace MR
 MRMESH_API VertBitSet verticesGridSampling( const MeshPart & mp, float voxelSize );
 // the same for point cloud
 MRMESH_API VertBitSet pointGridSampling( const PointCloud & cloud, float voxelSize );
+// the same for the stream of points: the bounding box is found in the first pass, and only the samples are kept in memory during the second pass;
+// returns sampled points (with normals and colors if the stream has them) in the order of the stream
+MRMESH_API tl::expected<PointCloud, std::string> pointGridSampling( const PointsStream & stream, float voxelSize,
+    Vector<Color, VertId> * colors = nullptr );
 
 } //namespace MR
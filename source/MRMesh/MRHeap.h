@@ -28,6 +28,8 @@ public:
 
     /// constructs heap for given number of elements, assigning given default value to each element
     Heap( int size, T def = {}, P pred = {} );
+    /// constructs heap from given elements in linear time, the ids of the elements must be all numbers in [0, elements.size())
+    explicit Heap( std::vector<Element> elements, P pred = {} );
     /// returns the size of the heap
     int size() const { return (int)heap_.size(); }
     /// increases the size of the heap by adding elements at the end
@@ -71,6 +73,22 @@ Heap<T, I, P>::Heap( int size, T def, P pred )
     }
 }
 
+template <typename T, typename I, typename P>
+Heap<T, I, P>::Heap( std::vector<Element> elements, P pred )
+    : heap_( std::move( elements ) )
+    , id2PosInHeap_( heap_.size() )
+    , pred_( pred )
+{
+    for ( int i = 0; i < heap_.size(); ++i )
+        id2PosInHeap_[ heap_[i].id ] = i;
+    // sift down all elements having children starting from the last one
+    for ( int i = size() / 2 - 1; i >= 0; --i )
+    {
+        const auto e = heap_[i];
+        setSmallerValue( e.id, e.val );
+    }
+}
+
 template <typename T, typename I, typename P>
 void Heap<T, I, P>::resize( int size, T def )
 {
@@ -0,0 +1,149 @@
+#include "MRMappedFile.h"
+#include "MRStringConvert.h"
+#include "MRGTest.h"
+#include <fstream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace MR
+{
+
+tl::expected<MappedFile, std::string> MappedFile::open( const std::filesystem::path & file )
+{
+    MappedFile res;
+#ifdef _WIN32
+    HANDLE fileHandle = CreateFileW( file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+    if ( fileHandle == INVALID_HANDLE_VALUE )
+        return tl::make_unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
+
+    LARGE_INTEGER fileSize;
+    if ( !GetFileSizeEx( fileHandle, &fileSize ) )
+    {
+        CloseHandle( fileHandle );
+        return tl::make_unexpected( std::string( "Cannot get the size of file " ) + utf8string( file ) );
+    }
+    res.size_ = size_t( fileSize.QuadPart );
+    if ( res.size_ == 0 )
+    {
+        // empty files cannot be mapped
+        CloseHandle( fileHandle );
+        return res;
+    }
+
+    HANDLE mapping = CreateFileMappingW( fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr );
+    // the view keeps the mapping and the file opened
+    CloseHandle( fileHandle );
+    if ( !mapping )
+        return tl::make_unexpected( std::string( "Cannot map file " ) + utf8string( file ) );
+    res.data_ = (const char*)MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+    CloseHandle( mapping );
+    if ( !res.data_ )
+        return tl::make_unexpected( std::string( "Cannot map file " ) + utf8string( file ) );
+#else
+    const int fd = ::open( file.c_str(), O_RDONLY );
+    if ( fd < 0 )
+        return tl::make_unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
+
+    struct stat st;
+    if ( fstat( fd, &st ) != 0 )
+    {
+        ::close( fd );
+        return tl::make_unexpected( std::string( "Cannot get the size of file " ) + utf8string( file ) );
+    }
+    res.size_ = size_t( st.st_size );
+    if ( res.size_ == 0 )
+    {
+        // empty files cannot be mapped
+        ::close( fd );
+        return res;
+    }
+
+    void * ptr = mmap( nullptr, res.size_, PROT_READ, MAP_PRIVATE, fd, 0 );
+    // the mapping keeps the file opened
+    ::close( fd );
+    if ( ptr == MAP_FAILED )
+    {
+        res.size_ = 0;
+        return tl::make_unexpected( std::string( "Cannot map file " ) + utf8string( file ) );
+    }
+#ifndef __EMSCRIPTEN__
+    // the files are usually parsed from the beginning to the end
+    madvise( ptr, res.size_, MADV_SEQUENTIAL );
+#endif
+    res.data_ = (const char*)ptr;
+#endif
+    return res;
+}
+
+MappedFile::MappedFile( MappedFile && b ) noexcept : data_( b.data_ ), size_( b.size_ )
+{
+    b.data_ = nullptr;
+    b.size_ = 0;
+}
+
+MappedFile & MappedFile::operator =( MappedFile && b ) noexcept
+{
+    if ( this != &b )
+    {
+        close();
+        std::swap( data_, b.data_ );
+        std::swap( size_, b.size_ );
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+void MappedFile::close()
+{
+    if ( data_ )
+    {
+#ifdef _WIN32
+        UnmapViewOfFile( data_ );
+#else
+        munmap( const_cast<char*>( data_ ), size_ );
+#endif
+    }
+    data_ = nullptr;
+    size_ = 0;
+}
+
+TEST(MRMesh, MappedFile)
+{
+    const auto path = std::filesystem::temp_directory_path() / "MRMappedFileTest.bin";
+    const std::string content = "mapped file content";
+    {
+        std::ofstream out( path, std::ofstream::binary );
+        out << content;
+    }
+
+    auto file = MappedFile::open( path );
+    ASSERT_TRUE( file.has_value() );
+    ASSERT_EQ( file->size(), content.size() );
+    EXPECT_EQ( std::string( file->data(), file->size() ), content );
+
+    MappedFile moved = std::move( *file );
+    EXPECT_EQ( file->data(), nullptr );
+    EXPECT_EQ( std::string( moved.data(), moved.size() ), content );
+    moved.close();
+    EXPECT_EQ( moved.size(), 0 );
+
+    std::error_code ec;
+    std::filesystem::remove( path, ec );
+    EXPECT_FALSE( MappedFile::open( path ).has_value() );
+}
+
+} // namespace MR
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "MRMeshFwd.h"
+#include <tl/expected.hpp>
+#include <filesystem>
+#include <string>
+
+namespace MR
+{
+
+/// read-only view of whole file content mapped in the memory of the process;
+/// the pages are loaded by the operating system on first access, without intermediate buffers of file streams
+class MappedFile
+{
+public:
+    /// maps given file in memory
+    [[nodiscard]] MRMESH_API static tl::expected<MappedFile, std::string> open( const std::filesystem::path & file );
+
+    MappedFile() = default;
+    MRMESH_API MappedFile( MappedFile && b ) noexcept;
+    MRMESH_API MappedFile & operator =( MappedFile && b ) noexcept;
+    MRMESH_API ~MappedFile();
+
+    /// returns the pointer on the first byte of the file
+    [[nodiscard]] const char * data() const { return data_; }
+    /// returns the size of the file in bytes
+    [[nodiscard]] size_t size() const { return size_; }
+
+    /// unmaps the file
+    MRMESH_API void close();
+
+private:
+    const char * data_ = nullptr;
+    size_t size_ = 0;
+};
+
+} // namespace MR
@@ -9,6 +9,7 @@
 #include "MRMeshTriPoint.h"
 #include "MRBitSetParallelFor.h"
 #include "MRAABBTree.h"
+#include "MRWideAABBTree.h"
 #include "MRTriangleIntersection.h"
 #include "MRMeshIntersect.h"
 #include "MRLine3.h"
@@ -19,6 +20,10 @@
 #include "MRCube.h"
 #include "MRTriMath.h"
 #include "MRPch/MRTBB.h"
+#include "MRTorus.h"
+#include "MRMeshNormals.h"
+#include "MRMeshProject.h"
+#include <random>
 
 namespace MR
 {
@@ -567,7 +572,7 @@ void Mesh::transform( const AffineXf3f & xf )
                 points[v] = xf(points[v]);
         }
     });
-    invalidateCaches();
+    invalidateCaches( true );
 }
 
 VertId Mesh::addPoint( const Vector3f & pos )
@@ -687,6 +692,77 @@ void Mesh::pack( FaceMap * outFmap, VertMap * outVmap, WholeEdgeMap * outEmap, b
     *this = std::move( packed );
 }
 
+void Mesh::pack( const FaceMap & fmap, const VertMap & vmap, const WholeEdgeMap & emap )
+{
+    MR_TIMER
+
+    VertCoords packedPoints( topology.numValidVerts() );
+    BitSetParallelFor( topology.getValidVerts(), [&]( VertId v )
+    {
+        packedPoints[vmap[v]] = points[v];
+    } );
+    topology.pack( fmap, vmap, emap );
+    points = std::move( packedPoints );
+    invalidateCaches();
+}
+
+void Mesh::packOptimally( FaceMap * outFmap, VertMap * outVmap, WholeEdgeMap * outEmap )
+{
+    MR_TIMER
+
+    FaceMap fmap( topology.faceSize() );
+    VertMap vmap( topology.vertSize() );
+    WholeEdgeMap emap( topology.undirectedEdgeSize() );
+    FaceId nextFace{ 0 };
+    VertId nextVert{ 0 };
+    EdgeId nextEdge{ 0 };
+    auto mapEdge = [&]( EdgeId e )
+    {
+        auto & ne = emap[e.undirected()];
+        if ( ne )
+            return;
+        ne = nextEdge;
+        nextEdge += 2;
+        for ( auto v : { topology.org( e ), topology.dest( e ) } )
+        {
+            if ( v && !vmap[v] )
+                vmap[v] = nextVert++;
+        }
+    };
+
+    if ( topology.numValidFaces() > 0 )
+    {
+        // the leaves of the tree built by Morton split are ordered along Z-curve
+        AABBTreeSettings settings;
+        settings.splitMethod = AABBTreeSplitMethod::Morton;
+        const AABBTree tree( *this, settings );
+        for ( const auto & node : tree.nodes() )
+        {
+            if ( !node.leaf() )
+                continue;
+            const auto f = node.leafId();
+            fmap[f] = nextFace++;
+            for ( auto e : leftRing( topology, f ) )
+                mapEdge( e );
+        }
+    }
+    // the edges without faces
+    for ( UndirectedEdgeId ue{ 0 }; ue < emap.size(); ++ue )
+    {
+        if ( !topology.isLoneEdge( ue ) )
+            mapEdge( ue );
+    }
+
+    pack( fmap, vmap, emap );
+
+    if ( outFmap )
+        *outFmap = std::move( fmap );
+    if ( outVmap )
+        *outVmap = std::move( vmap );
+    if ( outEmap )
+        *outEmap = std::move( emap );
+}
+
 bool Mesh::projectPoint( const Vector3f& point, PointOnFace& res, float maxDistSq, const FaceBitSet * region, const AffineXf3f * xf ) const
 {
     auto proj = findProjection( point, { *this, region }, maxDistSq, xf );
@@ -718,21 +794,85 @@ std::optional<MeshProjectionResult> Mesh::projectPoint( const Vector3f& point, f
 
 const AABBTree & Mesh::getAABBTree() const 
 { 
-    const auto & res = AABBTreeOwner_.getOrCreate( [this]{ return AABBTree( *this ); } );
+    const auto & res = AABBTreeOwner_.getOrCreate( [this]{ return AABBTree( *this ); }, [this]( AABBTree & tree )
+    {
+        // protection against wrong geometry only invalidation
+        if ( tree.containsSameNumberOfTris( *this ) )
+            tree.refit( *this );
+        else
+            tree = AABBTree( *this );
+    } );
     assert( res.containsSameNumberOfTris( *this ) );
     return res;
 }
 
-void Mesh::invalidateCaches()
+const AABBTree & Mesh::rebuildAABBTree( const AABBTreeSettings & settings )
 {
     AABBTreeOwner_.reset();
+    WideAABBTreeOwner_.reset();
+    return AABBTreeOwner_.getOrCreate( [this, &settings]{ return AABBTree( *this, settings ); } );
+}
+
+const WideAABBTree & Mesh::getWideAABBTree() const
+{
+    // outdated wide tree is recreated from refit binary tree
+    return WideAABBTreeOwner_.getOrCreate( [this]{ return WideAABBTree( getAABBTree() ); } );
+}
+
+const WideAABBTree * Mesh::getWideAABBTreeNotCreate() const
+{
+    // the tree existing before geometry only invalidation is considered existing
+    if ( WideAABBTreeOwner_.needsUpdate() )
+        return &getWideAABBTree();
+    return WideAABBTreeOwner_.get();
+}
+
+static UndirectedEdgeScalars computeEdgeLengths( const Mesh & mesh )
+{
+    MR_TIMER
+    UndirectedEdgeScalars res( mesh.topology.undirectedEdgeSize() );
+    tbb::parallel_for( tbb::blocked_range( 0_ue, UndirectedEdgeId( res.size() ) ), [&]( const tbb::blocked_range<UndirectedEdgeId> & range )
+    {
+        for ( UndirectedEdgeId ue = range.begin(); ue < range.end(); ++ue )
+            res[ue] = mesh.topology.isLoneEdge( ue ) ? 0.0f : mesh.edgeLength( ue );
+    } );
+    return res;
+}
+
+const VertNormals & Mesh::getCachedVertNormals() const
+{
+    return vertNormalsOwner_.getOrCreate( [this]{ return computePerVertNormals( *this ); },
+        [this]( VertNormals & normals ) { normals = computePerVertNormals( *this ); } );
+}
+
+const UndirectedEdgeScalars & Mesh::getCachedEdgeLengths() const
+{
+    return edgeLengthsOwner_.getOrCreate( [this]{ return computeEdgeLengths( *this ); } );
+}
+
+void Mesh::invalidateCaches( bool geometryOnly )
+{
+    edgeLengthsOwner_.reset();
+    if ( geometryOnly )
+    {
+        AABBTreeOwner_.markNeedsUpdate();
+        WideAABBTreeOwner_.markNeedsUpdate();
+        vertNormalsOwner_.markNeedsUpdate();
+        return;
+    }
+    AABBTreeOwner_.reset();
+    WideAABBTreeOwner_.reset();
+    vertNormalsOwner_.reset();
 }
 
 size_t Mesh::heapBytes() const
 {
     return topology.heapBytes()
         + points.heapBytes()
-        + AABBTreeOwner_.heapBytes();
+        + AABBTreeOwner_.heapBytes()
+        + WideAABBTreeOwner_.heapBytes()
+        + vertNormalsOwner_.heapBytes()
+        + edgeLengthsOwner_.heapBytes();
 }
 
 Vector3f Mesh::findCenterFromPoints() const
@@ -894,4 +1034,95 @@ TEST(MRMesh, SplitFace)
     EXPECT_EQ( mesh.topology.lastNotLoneEdge(), EdgeId(11) ); // 6*2 = 12 half-edges in total
 }
 
+// shuffles the elements of the mesh, then checks that packOptimally keeps the geometry, the topology and the orientation of all triangles
+TEST(MRMesh, PackOptimally)
+{
+    Mesh mesh = makeTorus( 1, 0.3f, 32, 16 );
+    std::mt19937 rng( 0 );
+    auto randomMap = [&]<typename I>( size_t size, int step, Vector<I, I> & map )
+    {
+        std::vector<int> ids( size );
+        for ( size_t i = 0; i < size; ++i )
+            ids[i] = int( i ) * step;
+        std::shuffle( ids.begin(), ids.end(), rng );
+        map.resize( size );
+        for ( size_t i = 0; i < size; ++i )
+            map[I( i )] = I( ids[i] );
+    };
+    FaceMap fmap;
+    VertMap vmap;
+    randomMap( mesh.topology.faceSize(), 1, fmap );
+    randomMap( mesh.topology.vertSize(), 1, vmap );
+    WholeEdgeMap emap( mesh.topology.undirectedEdgeSize() );
+    {
+        std::vector<int> ids( emap.size() );
+        for ( size_t i = 0; i < ids.size(); ++i )
+            ids[i] = 2 * int( i );
+        std::shuffle( ids.begin(), ids.end(), rng );
+        for ( UndirectedEdgeId ue{ 0 }; ue < emap.size(); ++ue )
+            emap[ue] = EdgeId( ids[ue] );
+    }
+    mesh.pack( fmap, vmap, emap );
+    EXPECT_TRUE( mesh.topology.checkValidity() );
+
+    Mesh optimal = mesh;
+    FaceMap optimalFmap;
+    VertMap optimalVmap;
+    optimal.packOptimally( &optimalFmap, &optimalVmap );
+    EXPECT_TRUE( optimal.topology.checkValidity() );
+    EXPECT_EQ( optimal.topology.numValidFaces(), mesh.topology.numValidFaces() );
+    EXPECT_EQ( optimal.topology.numValidVerts(), mesh.topology.numValidVerts() );
+    EXPECT_EQ( optimal.topology.undirectedEdgeSize(), mesh.topology.undirectedEdgeSize() );
+    for ( auto v : mesh.topology.getValidVerts() )
+        EXPECT_EQ( mesh.points[v], optimal.points[optimalVmap[v]] );
+    for ( auto f : mesh.topology.getValidFaces() )
+    {
+        // the same vertices in the same cyclic order
+        VertId vs[3], optimalVs[3];
+        mesh.topology.getTriVerts( f, vs );
+        optimal.topology.getTriVerts( optimalFmap[f], optimalVs );
+        int shift = 0;
+        while ( shift < 3 && optimalVs[shift] != optimalVmap[vs[0]] )
+            ++shift;
+        ASSERT_LT( shift, 3 );
+        for ( int i = 0; i < 3; ++i )
+            EXPECT_EQ( optimalVs[( i + shift ) % 3], optimalVmap[vs[i]] );
+    }
+    EXPECT_NEAR( mesh.volume(), optimal.volume(), 1e-4 );
+}
+
+TEST(MRMesh, ConcurrentCaches)
+{
+    Mesh mesh = makeTorus( 1, 0.3f, 256, 128 );
+    const auto & constMesh = mesh;
+    constexpr int NumThreads = 16;
+    std::vector<const AABBTree *> trees( NumThreads );
+    std::vector<const VertNormals *> normals( NumThreads );
+    std::vector<float> distsSq( NumThreads );
+    // many threads request the caches at the same time, only one builds each of them
+    tbb::parallel_for( 0, NumThreads, [&]( int i )
+    {
+        trees[i] = &constMesh.getAABBTree();
+        normals[i] = &constMesh.getCachedVertNormals();
+        distsSq[i] = findProjection( Vector3f( 2, 0, float( i ) / NumThreads ), constMesh ).distSq;
+    } );
+    for ( int i = 0; i < NumThreads; ++i )
+    {
+        EXPECT_EQ( trees[i], trees[0] );
+        EXPECT_EQ( normals[i], normals[0] );
+        EXPECT_GT( distsSq[i], 0.0f );
+    }
+    EXPECT_EQ( constMesh.getCachedVertNormals(), computePerVertNormals( mesh ) );
+
+    const auto & lengths = constMesh.getCachedEdgeLengths();
+    EXPECT_EQ( lengths.size(), mesh.topology.undirectedEdgeSize() );
+    EXPECT_FLOAT_EQ( lengths[0_ue], mesh.edgeLength( 0_ue ) );
+
+    // geometry-only change updates the normals in place
+    mesh.transform( AffineXf3f::linear( Matrix3f::rotation( Vector3f::plusZ(), Vector3f::plusX() ) ) );
+    EXPECT_EQ( mesh.getAABBTreeNotCreate(), nullptr );
+    EXPECT_EQ( &constMesh.getCachedVertNormals(), normals[0] );
+    EXPECT_EQ( constMesh.getCachedVertNormals(), computePerVertNormals( mesh ) );
+}
+
 } //namespace MR
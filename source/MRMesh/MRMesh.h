@@ -216,6 +216,14 @@ struct [[nodiscard]] Mesh
     // tightly packs all arrays eliminating lone edges and invalid face, verts and points,
     // optionally returns mappings: old.id -> new.id
     MRMESH_API void pack( FaceMap * outFmap = nullptr, VertMap * outVmap = nullptr, WholeEdgeMap * outEmap = nullptr, bool rearrangeTriangles = false );
+    // tightly packs all arrays placing the elements in the order given by complete maps: old.id -> new.id,
+    // see MeshTopology::pack( fmap, vmap, emap )
+    MRMESH_API void pack( const FaceMap & fmap, const VertMap & vmap, const WholeEdgeMap & emap );
+    // tightly packs all arrays and reorders the elements to put the elements close in space also close in memory:
+    // faces are ordered along Morton space-filling curve of their centers, and vertices and edges in the order
+    // of first reference from the faces; it reduces cache misses in all algorithms iterating over neighbours;
+    // optionally returns mappings: old.id -> new.id
+    MRMESH_API void packOptimally( FaceMap * outFmap = nullptr, VertMap * outVmap = nullptr, WholeEdgeMap * outEmap = nullptr );
 
     // finds closest point on this mesh (or its region) to given point;
     // xf is mesh-to-point transformation, if not specified then identity transformation is assumed
@@ -228,9 +236,26 @@ struct [[nodiscard]] Mesh
     MRMESH_API const AABBTree & getAABBTree() const;
     /// returns cached aabb-tree for this mesh, but does not create it if it did not exist
     const AABBTree * getAABBTreeNotCreate() const { return AABBTreeOwner_.get(); }
-
-    // Invalidates caches (e.g. aabb-tree) after a change in mesh geometry or topology
-    MRMESH_API void invalidateCaches();
+    /// replaces cached aabb-tree for this mesh with the one built using given settings (e.g. SAH for faster queries),
+    /// the tree will be rebuilt with default settings after next invalidateCaches() unless it is geometry only
+    MRMESH_API const AABBTree & rebuildAABBTree( const AABBTreeSettings & settings );
+
+    /// returns cached wide (4-ary) aabb-tree for this mesh, creating it from getAABBTree() if it did not exist in a thread-safe manner;
+    /// it is traversed instead of binary tree by rayMeshIntersect in float precision, findProjection without transformation
+    /// and findCollidingTriangles if requested by their parameters
+    MRMESH_API const WideAABBTree & getWideAABBTree() const;
+    /// returns cached wide aabb-tree for this mesh, but does not create it if it did not exist
+    MRMESH_API const WideAABBTree * getWideAABBTreeNotCreate() const;
+
+    /// returns cached normals of all vertices (see computePerVertNormals), computing them if they did not exist in a thread-safe manner
+    MRMESH_API const VertNormals & getCachedVertNormals() const;
+    /// returns cached lengths of all undirected edges (zero for lone edges), computing them if they did not exist in a thread-safe manner
+    MRMESH_API const UndirectedEdgeScalars & getCachedEdgeLengths() const;
+
+    /// Invalidates caches (e.g. aabb-tree) after a change in mesh geometry or topology;
+    /// \param geometryOnly if true then only the coordinates of points have changed and the topology is the same,
+    /// so existing aabb-tree is not deleted but refit (its boxes are recomputed keeping structure) lazily on next access
+    MRMESH_API void invalidateCaches( bool geometryOnly = false );
 
     // returns the amount of memory this object occupies on heap
     [[nodiscard]] MRMESH_API size_t heapBytes() const;
@@ -240,6 +265,9 @@ struct [[nodiscard]] Mesh
 
 private:
     mutable UniqueThreadSafeOwner<AABBTree> AABBTreeOwner_;
+    mutable UniqueThreadSafeOwner<WideAABBTree> WideAABBTreeOwner_;
+    mutable UniqueThreadSafeOwner<VertNormals> vertNormalsOwner_;
+    mutable UniqueThreadSafeOwner<UndirectedEdgeScalars> edgeLengthsOwner_;
 };
 
 // deprecated, please use MR_WRITER directly
@@ -1,5 +1,6 @@
 #include "MRMeshCollide.h"
 #include "MRAABBTree.h"
+#include "MRWideAABBTree.h"
 #include "MRMesh.h"
 #include "MRTriangleIntersection.h"
 #include "MRTimer.h"
@@ -17,7 +18,95 @@ struct NodeNode
     NodeNode( AABBTree::NodeId a, AABBTree::NodeId b ) : aNode( a ), bNode( b ) { }
 };
 
-std::vector<FaceFace> findCollidingTriangles( const MeshPart & a, const MeshPart & b, const AffineXf3f * rigidB2A, bool firstIntersectionOnly )
+// one child of a wide node: either a node or a face, with its box
+struct WideChild
+{
+    int child = 0; // encoded as in WideAABBTree::Node::children
+    Box3f box; // in the space of mesh A
+    bool leaf() const { return child < 0; }
+};
+
+struct WideChildChild
+{
+    WideChild a;
+    WideChild b;
+};
+
+// finds all pairs of faces with intersecting boxes using wide trees of both meshes
+static std::vector<FaceFace> findBoxCollidingTrianglesWide( const MeshPart & a, const WideAABBTree & aTree,
+    const MeshPart & b, const WideAABBTree & bTree, const AffineXf3f * rigidB2A )
+{
+    MR_TIMER;
+    std::vector<FaceFace> res;
+    if ( aTree.nodes().empty() || bTree.nodes().empty() )
+        return res;
+
+    std::vector<WideChildChild> subtasks{ { { 0, aTree.getBoundingBox() }, { 0, transformed( bTree.getBoundingBox(), rigidB2A ) } } };
+    while ( !subtasks.empty() )
+    {
+        const auto s = subtasks.back();
+        subtasks.pop_back();
+
+        if ( s.a.leaf() && s.b.leaf() )
+        {
+            const FaceId aFace( -1 - s.a.child );
+            const FaceId bFace( -1 - s.b.child );
+            if ( ( !a.region || a.region->test( aFace ) ) && ( !b.region || b.region->test( bFace ) ) )
+                res.emplace_back( aFace, bFace );
+            continue;
+        }
+
+        // the children of node B that overlap with given box
+        auto forEachBChild = [&]( const WideAABBTree::Node & bNode, const Box3f & aBox, auto && callback )
+        {
+            for ( int j = 0; j < WideAABBTree::Width && !bNode.empty( j ); ++j )
+            {
+                const auto bBox = transformed( bNode.box( j ), rigidB2A );
+                if ( bBox.intersects( aBox ) )
+                    callback( WideChild{ bNode.children[j], bBox } );
+            }
+        };
+        // the children of node A that overlap with given box
+        auto forEachAChild = [&]( const WideAABBTree::Node & aNode, const Box3f & bBox, auto && callback )
+        {
+            const int mask = boxIntersectChildren( aNode, bBox );
+            for ( int i = 0; i < WideAABBTree::Width && !aNode.empty( i ); ++i )
+                if ( mask & ( 1 << i ) )
+                    callback( WideChild{ aNode.children[i], aNode.box( i ) } );
+        };
+
+        if ( s.a.leaf() )
+        {
+            forEachBChild( bTree[WideAABBTree::NodeId( s.b.child )], s.a.box, [&]( const WideChild & bc )
+            {
+                subtasks.push_back( { s.a, bc } );
+            } );
+        }
+        else if ( s.b.leaf() )
+        {
+            forEachAChild( aTree[WideAABBTree::NodeId( s.a.child )], s.b.box, [&]( const WideChild & ac )
+            {
+                subtasks.push_back( { ac, s.b } );
+            } );
+        }
+        else
+        {
+            // split both nodes testing each child of B against all children of A at once
+            const auto & aNode = aTree[WideAABBTree::NodeId( s.a.child )];
+            forEachBChild( bTree[WideAABBTree::NodeId( s.b.child )], s.a.box, [&]( const WideChild & bc )
+            {
+                forEachAChild( aNode, bc.box, [&]( const WideChild & ac )
+                {
+                    subtasks.push_back( { ac, bc } );
+                } );
+            } );
+        }
+    }
+    return res;
+}
+
+// finds all pairs of faces with intersecting boxes using binary trees of both meshes
+static std::vector<FaceFace> findBoxCollidingTriangles( const MeshPart & a, const MeshPart & b, const AffineXf3f * rigidB2A )
 {
     MR_TIMER;
 
@@ -81,6 +170,16 @@ std::vector<FaceFace> findCollidingTriangles( const MeshPart & a, const MeshPart
             subtasks.emplace_back( s.aNode, bNode.r );
         }
     }
+    return res;
+}
+
+std::vector<FaceFace> findCollidingTriangles( const MeshPart & a, const MeshPart & b, const AffineXf3f * rigidB2A, bool firstIntersectionOnly, bool useWideTrees )
+{
+    MR_TIMER;
+
+    auto res = useWideTrees ?
+        findBoxCollidingTrianglesWide( a, a.mesh.getWideAABBTree(), b, b.mesh.getWideAABBTree(), rigidB2A ) :
+        findBoxCollidingTriangles( a, b, rigidB2A );
 
     std::atomic<int> firstIntersection{ (int)res.size() };
     tbb::parallel_for( tbb::blocked_range<int>( 0, (int)res.size() ),
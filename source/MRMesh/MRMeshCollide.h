@@ -13,9 +13,10 @@ namespace MR
  * \brief finds all pairs of colliding triangles from two meshes or two mesh regions
  * \param rigidB2A rigid transformation from B-mesh space to A mesh space, nullptr considered as identity transformation
  * \param firstIntersectionOnly if true then the function returns at most one pair of intersecting triangles and returns faster
+ * \param useWideTrees if true then Mesh::getWideAABBTree() of both meshes (created if necessary) are traversed instead of binary AABB trees
  */
 MRMESH_API std::vector<FaceFace> findCollidingTriangles( const MeshPart & a, const MeshPart & b, 
-    const AffineXf3f * rigidB2A = nullptr, bool firstIntersectionOnly = false );
+    const AffineXf3f * rigidB2A = nullptr, bool firstIntersectionOnly = false, bool useWideTrees = false );
 
 /// the same as \ref findCollidingTriangles, but returns one bite set per mesh with colliding triangles
 MRMESH_API std::pair<FaceBitSet, FaceBitSet> findCollidingTriangleBitsets( const MeshPart& a, const MeshPart& b,
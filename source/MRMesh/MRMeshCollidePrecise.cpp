@@ -98,8 +98,44 @@ PreciseCollisionResult findCollidingEdgeTrisPrecise( const MeshPart & a, const M
         return l < r;
     };
 
+    // edge-triangle pairs to check for intersection, accumulated to be checked by batches
+    struct EdgeTriBatch
+    {
+        std::vector<std::array<PreciseVertCoords, 5>> coords;
+        std::vector<EdgeTri> edgeTris;
+        std::vector<bool> edgeFromA;
+        std::vector<TriangleSegmentIntersectResult> isects;
+
+        size_t size() const { return edgeTris.size(); }
+        void add( const std::array<PreciseVertCoords, 5> & vs, EdgeId e, FaceId tri, bool fromA )
+        {
+            coords.push_back( vs );
+            edgeTris.emplace_back( e, tri );
+            edgeFromA.push_back( fromA );
+        }
+        // checks all accumulated pairs and appends intersecting ones in given result in the order of addition
+        void flush( PreciseCollisionResult & res )
+        {
+            isects.resize( size() );
+            doTriangleSegmentIntersect( coords.data(), isects.data(), size() );
+            for ( size_t i = 0; i < size(); ++i )
+            {
+                if ( !isects[i] )
+                    continue;
+                auto et = edgeTris[i];
+                if ( !isects[i].dIsLeftFromABC )
+                    et.edge = et.edge.sym();
+                ( edgeFromA[i] ? res.edgesAtrisB : res.edgesBtrisA ).push_back( et );
+            }
+            coords.clear();
+            edgeTris.clear();
+            edgeFromA.clear();
+        }
+    };
+    constexpr size_t MaxBatchSize = 256;
+
     const int aVertsSize = (int)a.mesh.topology.vertSize();
-    auto checkTwoTris = [&]( FaceId aTri, FaceId bTri, PreciseCollisionResult & res )
+    auto checkTwoTris = [&]( FaceId aTri, FaceId bTri, EdgeTriBatch & batch )
     {
         PreciseVertCoords avc[3], bvc[3];
         a.mesh.topology.getTriVerts( aTri, avc[0].id, avc[1].id, avc[2].id );
@@ -113,60 +149,22 @@ PreciseCollisionResult findCollidingEdgeTrisPrecise( const MeshPart & a, const M
             bvc[j].id += aVertsSize;
         }
 
-        // check edges from A
-        int numA = 0;
+        // add edges from A
         EdgeId aEdge = a.mesh.topology.edgeWithLeft( aTri );
-        auto aEdgeCheck = [&]( int v0, int v1 )
-        {
-            if ( !checkEdge( aEdge, a ) )
-                return EdgeId{};
-            auto isect = doTriangleSegmentIntersect( { bvc[0], bvc[1], bvc[2], avc[v0], avc[v1] } );
-            if ( !isect )
-                return EdgeId{};
-            return isect.dIsLeftFromABC ? aEdge : aEdge.sym();
-        };
-        if ( auto e = aEdgeCheck( 0, 1 ) )
-        {
-            res.edgesAtrisB.emplace_back( e, bTri );
-        }
-        aEdge = a.mesh.topology.prev( aEdge.sym() );
-        if ( auto e = aEdgeCheck( 1, 2 ) )
-        {
-            res.edgesAtrisB.emplace_back( e, bTri );
-        }
-        aEdge = a.mesh.topology.prev( aEdge.sym() );
-        if ( numA < 2 )
+        for ( int j = 0; j < 3; ++j )
         {
-            if ( auto e = aEdgeCheck( 2, 0 ) )
-                res.edgesAtrisB.emplace_back( e, bTri );
+            if ( checkEdge( aEdge, a ) )
+                batch.add( { bvc[0], bvc[1], bvc[2], avc[j], avc[( j + 1 ) % 3] }, aEdge, bTri, true );
+            aEdge = a.mesh.topology.prev( aEdge.sym() );
         }
 
-        // check edges from B
-        int numB = 0;
+        // add edges from B
         EdgeId bEdge = b.mesh.topology.edgeWithLeft( bTri );
-        auto bEdgeCheck = [&]( int v0, int v1 )
-        {
-            if ( !checkEdge( bEdge, b ) )
-                return EdgeId{};
-            auto isect = doTriangleSegmentIntersect( { avc[0], avc[1], avc[2], bvc[v0], bvc[v1] } );
-            if ( !isect )
-                return EdgeId{};
-            return isect.dIsLeftFromABC ? bEdge : bEdge.sym();
-        };
-        if ( auto e = bEdgeCheck( 0, 1 ) )
-        {
-            res.edgesBtrisA.emplace_back( e, aTri );
-        }
-        bEdge = b.mesh.topology.prev( bEdge.sym() );
-        if ( auto e = bEdgeCheck( 1, 2 ) )
-        {
-            res.edgesBtrisA.emplace_back( e, aTri );
-        }
-        bEdge = b.mesh.topology.prev( bEdge.sym() );
-        if ( numB < 2 )
+        for ( int j = 0; j < 3; ++j )
         {
-            if ( auto e = bEdgeCheck( 2, 0 ) )
-                res.edgesBtrisA.emplace_back( e, aTri );
+            if ( checkEdge( bEdge, b ) )
+                batch.add( { avc[0], avc[1], avc[2], bvc[j], bvc[( j + 1 ) % 3] }, bEdge, aTri, false );
+            bEdge = b.mesh.topology.prev( bEdge.sym() );
         }
     };
 
@@ -175,6 +173,7 @@ PreciseCollisionResult findCollidingEdgeTrisPrecise( const MeshPart & a, const M
         [&]( const tbb::blocked_range<size_t>& range )
     {
         std::vector<NodeNode> mySubtasks;
+        EdgeTriBatch batch;
         for ( auto is = range.begin(); is < range.end(); ++is )
         {
             mySubtasks.push_back( subtasks[is] );
@@ -201,7 +200,9 @@ PreciseCollisionResult findCollidingEdgeTrisPrecise( const MeshPart & a, const M
                     const auto bFace = bNode.leafId();
                     if ( b.region && !b.region->test( bFace ) )
                         continue;
-                    checkTwoTris( aFace, bFace, myRes );
+                    checkTwoTris( aFace, bFace, batch );
+                    if ( batch.size() >= MaxBatchSize )
+                        batch.flush( myRes );
                     continue;
                 }
         
@@ -219,6 +220,7 @@ PreciseCollisionResult findCollidingEdgeTrisPrecise( const MeshPart & a, const M
                     mySubtasks.emplace_back( s.aNode, bNode.r );
                 }
             }
+            batch.flush( myRes );
             subtaskRes[is] = std::move( myRes );
         }
     } );
@@ -0,0 +1,446 @@
+#include "MRMeshLoad.h"
+#include "MRMeshSave.h"
+#include "MRMesh.h"
+#include "MRBox.h"
+#include "MRMappedFile.h"
+#include "MRTextParse.h"
+#include "MRIOFormatsRegistry.h"
+#include "MRStringConvert.h"
+#include "MRTorus.h"
+#include "MRTimer.h"
+#include "MRGTest.h"
+#include "MRPch/MRTBB.h"
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace MR
+{
+
+// Layout of .mrcmesh file (all numbers are little-endian):
+//   header: CompressedMrmeshHeader
+//   vertex blocks, then triangle blocks, each block is: uint32 number of bytes, uint32 first new vertex, bytes
+// vertex block: for each vertex three zigzag varints of the differences of quantized coordinates with the previous vertex;
+// triangle block: for each corner a varint of ( first new vertex - vertex ), where first new vertex is
+//   one more than the maximal vertex referenced before; the vertices are numbered in the order of first reference,
+//   so new vertices are encoded by zero and recently referenced vertices by small numbers
+
+namespace
+{
+
+struct CompressedMrmeshHeader
+{
+    char magic[4] = { 'M', 'R', 'C', 'M' };
+    std::uint32_t version = 1;
+    std::uint32_t positionBits = 0;
+    std::uint32_t blockSize = 0;
+    std::uint32_t numVerts = 0;
+    std::uint32_t numTris = 0;
+    float boxMin[3] = {};
+    float boxMax[3] = {};
+};
+static_assert( sizeof( CompressedMrmeshHeader ) == 48, "check your padding" );
+
+struct BlockHeader
+{
+    std::uint32_t numBytes = 0;
+    std::uint32_t firstNewVert = 0;
+};
+static_assert( sizeof( BlockHeader ) == 8, "check your padding" );
+
+} // anonymous namespace
+
+static void writeVarint( std::string & out, std::uint32_t v )
+{
+    while ( v >= 0x80 )
+    {
+        out.push_back( char( v | 0x80 ) );
+        v >>= 7;
+    }
+    out.push_back( char( v ) );
+}
+
+// returns false if the buffer ends before the number
+static bool readVarint( const char *& p, const char * end, std::uint32_t & v )
+{
+    v = 0;
+    for ( int shift = 0; shift < 35 && p < end; shift += 7 )
+    {
+        const auto byte = std::uint8_t( *p++ );
+        v |= std::uint32_t( byte & 0x7F ) << shift;
+        if ( !( byte & 0x80 ) )
+            return true;
+    }
+    return false;
+}
+
+static std::uint32_t zigzag( std::int32_t v )
+{
+    return ( std::uint32_t( v ) << 1 ) ^ std::uint32_t( v >> 31 );
+}
+
+// returns the signed difference in two's complement form, to be added with unsigned wrap-around,
+// which cannot overflow on malformed input unlike signed arithmetic
+static std::uint32_t unzigzag( std::uint32_t v )
+{
+    return ( v >> 1 ) ^ ( 0u - ( v & 1 ) );
+}
+
+// the steps of quantization grid along each axis
+static Vector3d quantizationSteps( const CompressedMrmeshHeader & header )
+{
+    const double maxQ = double( ( std::uint64_t( 1 ) << header.positionBits ) - 1 );
+    Vector3d res;
+    for ( int k = 0; k < 3; ++k )
+        res[k] = ( double( header.boxMax[k] ) - double( header.boxMin[k] ) ) / maxQ;
+    return res;
+}
+
+namespace MeshSave
+{
+
+tl::expected<void, std::string> toCompressedMrmesh( const Mesh & mesh, const std::filesystem::path & file,
+    const CompressedMrmeshSaveOptions & options, ProgressCallback callback )
+{
+    std::ofstream out( file, std::ofstream::binary );
+    if ( !out )
+        return tl::make_unexpected( std::string( "Cannot open file for writing " ) + utf8string( file ) );
+
+    return toCompressedMrmesh( mesh, out, options, callback );
+}
+
+tl::expected<void, std::string> toCompressedMrmesh( const Mesh & mesh, std::ostream & out,
+    const CompressedMrmeshSaveOptions & options, ProgressCallback callback )
+{
+    MR_TIMER
+    if ( options.positionBits < 1 || options.positionBits > 31 || options.blockSize <= 0 )
+        return tl::make_unexpected( std::string( "Invalid options of compressed mrmesh format" ) );
+
+    // number vertices in the order of first reference from the faces
+    const auto & topology = mesh.topology;
+    Vector<VertId, VertId> newIds( topology.vertSize() );
+    std::vector<VertId> verts; // old ids in the order of new ids
+    std::vector<std::uint32_t> tris; // three new vertex ids per triangle
+    std::vector<std::uint32_t> firstNewVerts; // in each triangle block
+    verts.reserve( topology.numValidVerts() );
+    tris.reserve( 3 * size_t( topology.numValidFaces() ) );
+    for ( auto f : topology.getValidFaces() )
+    {
+        if ( tris.size() % ( 3 * size_t( options.blockSize ) ) == 0 )
+            firstNewVerts.push_back( std::uint32_t( verts.size() ) );
+        VertId vs[3];
+        topology.getTriVerts( f, vs );
+        for ( auto v : vs )
+        {
+            if ( !newIds[v] )
+            {
+                newIds[v] = VertId( verts.size() );
+                verts.push_back( v );
+            }
+            tris.push_back( std::uint32_t( newIds[v] ) );
+        }
+    }
+
+    CompressedMrmeshHeader header;
+    header.positionBits = std::uint32_t( options.positionBits );
+    header.blockSize = std::uint32_t( options.blockSize );
+    header.numVerts = std::uint32_t( verts.size() );
+    header.numTris = std::uint32_t( tris.size() / 3 );
+    Box3f box;
+    for ( auto v : verts )
+        box.include( mesh.points[v] );
+    if ( box.valid() )
+    {
+        for ( int k = 0; k < 3; ++k )
+        {
+            header.boxMin[k] = box.min[k];
+            header.boxMax[k] = box.max[k];
+        }
+    }
+    out.write( (const char*)&header, sizeof( header ) );
+
+    const Vector3d step = quantizationSteps( header );
+    const auto maxQ = std::int64_t( ( std::uint64_t( 1 ) << header.positionBits ) - 1 );
+    const size_t numVertBlocks = ( verts.size() + options.blockSize - 1 ) / options.blockSize;
+    const size_t numTriBlocks = firstNewVerts.size();
+    const size_t numBlocks = numVertBlocks + numTriBlocks;
+
+    auto encodeBlock = [&]( size_t b, std::string & block )
+    {
+        block.clear();
+        BlockHeader bh;
+        block.append( (const char*)&bh, sizeof( bh ) );
+        if ( b < numVertBlocks )
+        {
+            const size_t begin = b * options.blockSize;
+            const size_t end = std::min( verts.size(), begin + options.blockSize );
+            std::int32_t prev[3] = { 0, 0, 0 };
+            for ( size_t i = begin; i < end; ++i )
+            {
+                const auto & p = mesh.points[verts[i]];
+                for ( int k = 0; k < 3; ++k )
+                {
+                    const auto q = step[k] > 0 ?
+                        std::int32_t( std::clamp( std::llround( ( double( p[k] ) - header.boxMin[k] ) / step[k] ), 0LL, (long long)maxQ ) ) : 0;
+                    writeVarint( block, zigzag( q - prev[k] ) );
+                    prev[k] = q;
+                }
+            }
+        }
+        else
+        {
+            const size_t tb = b - numVertBlocks;
+            const size_t begin = tb * 3 * options.blockSize;
+            const size_t end = std::min( tris.size(), begin + 3 * options.blockSize );
+            bh.firstNewVert = firstNewVerts[tb];
+            auto nextNew = bh.firstNewVert;
+            for ( size_t i = begin; i < end; ++i )
+            {
+                const auto v = tris[i];
+                writeVarint( block, nextNew - v );
+                if ( v == nextNew )
+                    ++nextNew;
+            }
+        }
+        bh.numBytes = std::uint32_t( block.size() - sizeof( bh ) );
+        std::memcpy( block.data(), &bh, sizeof( bh ) );
+    };
+
+    // encode the blocks in parallel by batches, and write each batch as soon as it is ready
+    const size_t batchSize = std::max( 1u, 4 * std::thread::hardware_concurrency() );
+    std::vector<std::string> blocks( std::min( batchSize, numBlocks ) );
+    for ( size_t batchBegin = 0; batchBegin < numBlocks; batchBegin += batchSize )
+    {
+        const size_t batchEnd = std::min( numBlocks, batchBegin + batchSize );
+        tbb::parallel_for( tbb::blocked_range<size_t>( batchBegin, batchEnd, 1 ), [&]( const tbb::blocked_range<size_t> & range )
+        {
+            for ( size_t b = range.begin(); b < range.end(); ++b )
+                encodeBlock( b, blocks[b - batchBegin] );
+        } );
+        for ( size_t b = batchBegin; b < batchEnd; ++b )
+            out.write( blocks[b - batchBegin].data(), blocks[b - batchBegin].size() );
+        if ( callback && !callback( float( batchEnd ) / numBlocks ) )
+            return tl::make_unexpected( std::string( "Saving canceled" ) );
+    }
+
+    if ( !out )
+        return tl::make_unexpected( std::string( "Error saving in compressed mrmesh format" ) );
+
+    if ( callback )
+        callback( 1.f );
+    return {};
+}
+
+} // namespace MeshSave
+
+namespace MeshLoad
+{
+
+static tl::expected<Mesh, std::string> fromCompressedMrmeshBuffer( const char * data, size_t size, ProgressCallback callback )
+{
+    MR_TIMER
+    CompressedMrmeshHeader header;
+    if ( size < sizeof( header ) )
+        return tl::make_unexpected( std::string( "Compressed mrmesh file is too short" ) );
+    std::memcpy( &header, data, sizeof( header ) );
+    if ( std::memcmp( header.magic, CompressedMrmeshHeader{}.magic, sizeof( header.magic ) ) != 0 )
+        return tl::make_unexpected( std::string( "File is not in compressed mrmesh format" ) );
+    if ( header.version != 1 || header.positionBits < 1 || header.positionBits > 31 || header.blockSize == 0 )
+        return tl::make_unexpected( std::string( "Unsupported version of compressed mrmesh format" ) );
+
+    if ( header.numVerts > std::uint32_t( INT_MAX ) || header.numTris > std::uint32_t( INT_MAX ) )
+        return tl::make_unexpected( std::string( "Too many elements in compressed mrmesh file" ) );
+
+    const size_t numVertBlocks = ( size_t( header.numVerts ) + header.blockSize - 1 ) / header.blockSize;
+    const size_t numTriBlocks = ( size_t( header.numTris ) + header.blockSize - 1 ) / header.blockSize;
+    const size_t numBlocks = numVertBlocks + numTriBlocks;
+    // do not trust the counts in the header before allocating the memory for them:
+    // each block has its header, and each coordinate and each corner take at least one byte
+    const auto minSize = sizeof( header ) + numBlocks * sizeof( BlockHeader ) + 3 * ( size_t( header.numVerts ) + header.numTris );
+    if ( size < minSize )
+        return tl::make_unexpected( std::string( "Compressed mrmesh file is too short" ) );
+
+    // find the beginnings of all blocks
+    std::vector<size_t> blockStarts( numBlocks );
+    size_t pos = sizeof( header );
+    for ( size_t b = 0; b < numBlocks; ++b )
+    {
+        BlockHeader bh;
+        if ( size - pos < sizeof( bh ) )
+            return tl::make_unexpected( std::string( "Compressed mrmesh file is too short" ) );
+        std::memcpy( &bh, data + pos, sizeof( bh ) );
+        blockStarts[b] = pos;
+        pos += sizeof( bh );
+        if ( size - pos < bh.numBytes )
+            return tl::make_unexpected( std::string( "Compressed mrmesh file is too short" ) );
+        pos += bh.numBytes;
+    }
+
+    const Vector3d step = quantizationSteps( header );
+    const auto maxQ = std::uint32_t( ( std::uint64_t( 1 ) << header.positionBits ) - 1 );
+    VertCoords points( header.numVerts );
+    Triangulation t( header.numTris );
+    std::vector<char> blockFailed( numBlocks, false );
+    auto decodeBlock = [&]( size_t b )
+    {
+        BlockHeader bh;
+        std::memcpy( &bh, data + blockStarts[b], sizeof( bh ) );
+        const char * p = data + blockStarts[b] + sizeof( bh );
+        const char * end = p + bh.numBytes;
+        if ( b < numVertBlocks )
+        {
+            const size_t begin = b * header.blockSize;
+            const size_t endVert = std::min( size_t( header.numVerts ), begin + header.blockSize );
+            std::uint32_t q[3] = { 0, 0, 0 };
+            for ( size_t i = begin; i < endVert; ++i )
+            {
+                Vector3f pt;
+                for ( int k = 0; k < 3; ++k )
+                {
+                    std::uint32_t d;
+                    if ( !readVarint( p, end, d ) )
+                    {
+                        blockFailed[b] = true;
+                        return;
+                    }
+                    q[k] += unzigzag( d );
+                    if ( q[k] > maxQ )
+                    {
+                        blockFailed[b] = true;
+                        return;
+                    }
+                    pt[k] = float( header.boxMin[k] + q[k] * step[k] );
+                }
+                points[VertId( i )] = pt;
+            }
+        }
+        else
+        {
+            const size_t tb = b - numVertBlocks;
+            const size_t begin = 3 * tb * header.blockSize;
+            const size_t endCorner = std::min( 3 * size_t( header.numTris ), begin + 3 * header.blockSize );
+            auto nextNew = bh.firstNewVert;
+            for ( size_t i = begin; i < endCorner; ++i )
+            {
+                std::uint32_t d;
+                if ( !readVarint( p, end, d ) || d > nextNew || nextNew - d >= header.numVerts )
+                {
+                    blockFailed[b] = true;
+                    return;
+                }
+                const auto v = nextNew - d;
+                if ( d == 0 )
+                    ++nextNew;
+                t[FaceId( i / 3 )][i % 3] = VertId( int( v ) );
+            }
+        }
+    };
+    if ( !parallelForChunks( numBlocks, decodeBlock, callback ) )
+        return tl::make_unexpected( std::string( "Loading canceled" ) );
+    for ( auto failed : blockFailed )
+        if ( failed )
+            return tl::make_unexpected( std::string( "Error decoding compressed mrmesh file" ) );
+
+    return Mesh::fromTrianglesDuplicatingNonManifoldVertices( std::move( points ), t );
+}
+
+tl::expected<Mesh, std::string> fromCompressedMrmesh( const std::filesystem::path& file, Vector<Color, VertId>*, ProgressCallback callback )
+{
+    if ( auto mapped = MappedFile::open( file ) )
+        return addFileNameInError( fromCompressedMrmeshBuffer( mapped->data(), mapped->size(), callback ), file );
+
+    // fallback for the files that cannot be mapped
+    std::ifstream in( file, std::ifstream::binary );
+    if ( !in )
+        return tl::make_unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
+
+    return addFileNameInError( fromCompressedMrmesh( in, nullptr, callback ), file );
+}
+
+tl::expected<Mesh, std::string> fromCompressedMrmesh( std::istream& in, Vector<Color, VertId>*, ProgressCallback callback )
+{
+    MR_TIMER
+    std::ostringstream oss;
+    oss << in.rdbuf();
+    if ( !in )
+        return tl::make_unexpected( std::string( "Error reading compressed mrmesh file" ) );
+    const auto buf = std::move( oss ).str();
+    return fromCompressedMrmeshBuffer( buf.data(), buf.size(), callback );
+}
+
+MR_ADD_MESH_LOADER( IOFilter( "Compressed MrMesh (.mrcmesh)", "*.mrcmesh" ), fromCompressedMrmesh )
+
+} // namespace MeshLoad
+
+TEST(MRMesh, CompressedMrmesh)
+{
+    const Mesh torus = makeTorus( 1, 0.3f, 256, 128 );
+    MeshSave::CompressedMrmeshSaveOptions options;
+    options.blockSize = 1000;
+
+    std::stringstream compressed;
+    ASSERT_TRUE( MeshSave::toCompressedMrmesh( torus, compressed, options ).has_value() );
+    std::stringstream native;
+    ASSERT_TRUE( MeshSave::toMrmesh( torus, native ).has_value() );
+    EXPECT_LT( compressed.str().size() * 4, native.str().size() );
+
+    auto loaded = MeshLoad::fromCompressedMrmesh( compressed );
+    ASSERT_TRUE( loaded.has_value() );
+    EXPECT_EQ( loaded->topology.numValidFaces(), torus.topology.numValidFaces() );
+    EXPECT_EQ( loaded->topology.numValidVerts(), torus.topology.numValidVerts() );
+    EXPECT_EQ( loaded->topology.findHoleRepresentiveEdges().size(), 0 );
+
+    // vertices are renumbered in the order of first reference from faces
+    const auto box = torus.computeBoundingBox();
+    const float maxError = box.size().length() / float( 1 << options.positionBits );
+    for ( FaceId f{ 0 }; f < torus.topology.faceSize(); ++f )
+    {
+        VertId a[3], b[3];
+        torus.topology.getTriVerts( f, a );
+        loaded->topology.getTriVerts( f, b );
+        // the triangles can start from different corners
+        float minDist = FLT_MAX;
+        for ( int r = 0; r < 3; ++r )
+        {
+            float dist = 0;
+            for ( int i = 0; i < 3; ++i )
+                dist = std::max( dist, ( torus.points[a[i]] - loaded->points[b[( i + r ) % 3]] ).length() );
+            minDist = std::min( minDist, dist );
+        }
+        EXPECT_LE( minDist, maxError );
+    }
+
+    auto broken = compressed.str();
+    broken.resize( broken.size() / 2 );
+    std::istringstream brokenIn( broken );
+    EXPECT_FALSE( MeshLoad::fromCompressedMrmesh( brokenIn ).has_value() );
+
+    // huge counts in the header must be rejected before allocating the memory for them
+    auto hugeCounts = compressed.str();
+    const std::uint32_t hugeCount = 0x7FFFFFFF;
+    std::memcpy( hugeCounts.data() + offsetof( CompressedMrmeshHeader, numVerts ), &hugeCount, sizeof( hugeCount ) );
+    std::istringstream hugeCountsIn( hugeCounts );
+    EXPECT_FALSE( MeshLoad::fromCompressedMrmesh( hugeCountsIn ).has_value() );
+
+    // the sum of differences of coordinates out of quantization range
+    CompressedMrmeshHeader header;
+    header.positionBits = 31;
+    header.blockSize = 2;
+    header.numVerts = 2;
+    std::string overflow( (const char*)&header, sizeof( header ) );
+    std::string block;
+    for ( int i = 0; i < 6; ++i )
+        writeVarint( block, zigzag( INT_MAX ) );
+    BlockHeader bh;
+    bh.numBytes = std::uint32_t( block.size() );
+    overflow.append( (const char*)&bh, sizeof( bh ) );
+    overflow += block;
+    std::istringstream overflowIn( overflow );
+    EXPECT_FALSE( MeshLoad::fromCompressedMrmesh( overflowIn ).has_value() );
+}
+
+} //namespace MR
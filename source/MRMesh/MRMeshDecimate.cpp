@@ -10,7 +10,13 @@
 #include "MRGTest.h"
 #include "MRMeshDelone.h"
 #include "MRMeshSubdivide.h"
+#include "MRMeshProject.h"
+#include "MRHeap.h"
+#include "MRTorus.h"
+#include "MRCube.h"
+#include "MREdgeIterator.h"
 #include "MRPch/MRTBB.h"
+#include <atomic>
 #include <queue>
 
 namespace MR
@@ -20,18 +26,35 @@ namespace MR
 // 1) faces: left( e ) and right( e );
 // 2) vertex org( e )/dest( e ) if given edge was their only edge, otherwise only dest( e );
 // 3) edges: e, next( e.sym() ), prev( e.sym() );
-// returns prev( e ) if it is valid
-EdgeId collapseEdge( MeshTopology & topology, const EdgeId e )
+// returns prev( e ) if it is valid;
+// if beforeComputeValids then valid elements' bit-sets in topology are not updated, and the collapses of the edges far enough apart can be done in parallel,
+// MeshTopology::computeValidsFromEdges() must be called after all of them
+EdgeId collapseEdge( MeshTopology & topology, const EdgeId e, bool beforeComputeValids = false )
 {
-    topology.setLeft( e, FaceId() );
-    topology.setLeft( e.sym(), FaceId() );
+    auto setLeft = [&]( EdgeId a, FaceId f )
+    {
+        if ( beforeComputeValids )
+            topology.setLeftBeforeComputeValids( a, f );
+        else
+            topology.setLeft( a, f );
+    };
+    auto setOrg = [&]( EdgeId a, VertId v )
+    {
+        if ( beforeComputeValids )
+            topology.setOrgBeforeComputeValids( a, v );
+        else
+            topology.setOrg( a, v );
+    };
+
+    setLeft( e, FaceId() );
+    setLeft( e.sym(), FaceId() );
 
     if ( topology.next( e ) == e )
     {
-        topology.setOrg( e, VertId() );
+        setOrg( e, VertId() );
         const EdgeId b = topology.prev( e.sym() );
         if ( b == e.sym() )
-            topology.setOrg( e.sym(), VertId() );
+            setOrg( e.sym(), VertId() );
         else
             topology.splice( b, e.sym() );
 
@@ -39,7 +62,7 @@ EdgeId collapseEdge( MeshTopology & topology, const EdgeId e )
         return EdgeId();
     }
 
-    topology.setOrg( e.sym(), VertId() );
+    setOrg( e.sym(), VertId() );
 
     const EdgeId ePrev = topology.prev( e );
     const EdgeId eNext = topology.next( e );
@@ -72,8 +95,8 @@ EdgeId collapseEdge( MeshTopology & topology, const EdgeId e )
         {
             topology.splice( topology.prev( ePrev ), ePrev );
             topology.splice( topology.prev( ePrev.sym() ), ePrev.sym() );
-            topology.setOrg( ePrev, {} );
-            topology.setOrg( ePrev.sym(), {} );
+            setOrg( ePrev, {} );
+            setOrg( ePrev.sym(), {} );
         }
     }
 
@@ -86,8 +109,8 @@ EdgeId collapseEdge( MeshTopology & topology, const EdgeId e )
         {
             topology.splice( topology.prev( eNext ), eNext );
             topology.splice( topology.prev( eNext.sym() ), eNext.sym() );
-            topology.setOrg( eNext, {} );
-            topology.setOrg( eNext.sym(), {} );
+            setOrg( eNext, {} );
+            setOrg( eNext.sym(), {} );
         }
     }
 
@@ -117,6 +140,9 @@ private:
     };
     std::priority_queue<QueueElement> queue_;
     UndirectedEdgeBitSet presentInQueue_;
+    // used instead of queue_ if settings_.indexedQueue, the edges not in the queue have FLT_MAX value
+    using EdgeHeap = Heap<float, UndirectedEdgeId, std::greater<float>>;
+    std::optional<EdgeHeap> heap_;
     DecimateResult res_;
     std::vector<VertId> originNeis_;
     std::vector<Vector3f> triDblAreas_; // directed double areas of newly formed triangles to check that they are consistently oriented
@@ -125,6 +151,14 @@ private:
     bool initializeQueue_();
     std::optional<QueueElement> computeQueueElement_( UndirectedEdgeId ue, QuadraticForm3f * outCollapseForm = nullptr, Vector3f * outCollapsePos = nullptr ) const;
     void addInQueueIfMissing_( UndirectedEdgeId ue );
+    // takes the element with the smallest cost from the queue
+    std::optional<QueueElement> popQueue_();
+    // returns the element taken from the queue back with new cost
+    void pushQueue_( const QueueElement & qe );
+    // the element taken from the queue was not returned there
+    void setNotInQueue_( UndirectedEdgeId ue );
+    // recomputes the cost of the edge in the heap
+    void updateInQueue_( UndirectedEdgeId ue );
     VertId collapse_( EdgeId edgeToCollapse, const Vector3f & collapsePos );
 };
 
@@ -244,16 +278,42 @@ bool MeshDecimator::initializeQueue_()
     if ( settings_.progressCallback && !settings_.progressCallback( 0.1f ) )
         return false;
 
-    EdgeMetricCalc calc( *this );
-    parallel_reduce( tbb::blocked_range<UndirectedEdgeId>( UndirectedEdgeId{0}, UndirectedEdgeId{mesh_.topology.undirectedEdgeSize()} ), calc );
+    if ( settings_.indexedQueue )
+    {
+        // the costs are written directly in heap elements without intermediate vector to reduce peak memory
+        std::vector<EdgeHeap::Element> elements( mesh_.topology.undirectedEdgeSize() );
+        tbb::parallel_for( tbb::blocked_range<UndirectedEdgeId>( UndirectedEdgeId{0}, UndirectedEdgeId{mesh_.topology.undirectedEdgeSize()} ),
+            withTimerParent( [&]( const tbb::blocked_range<UndirectedEdgeId> & r )
+        {
+            for ( UndirectedEdgeId ue = r.begin(); ue < r.end(); ++ue )
+            {
+                elements[ue] = { ue, FLT_MAX };
+                EdgeId e{ ue };
+                if ( mesh_.topology.isLoneEdge( e ) || !isInRegion( e ) )
+                    continue;
+                if ( auto qe = computeQueueElement_( ue ) )
+                    elements[ue].val = qe->c;
+            }
+        } ) );
+
+        if ( settings_.progressCallback && !settings_.progressCallback( 0.2f ) )
+            return false;
 
-    if ( settings_.progressCallback && !settings_.progressCallback( 0.2f ) )
-        return false;
+        heap_.emplace( std::move( elements ) );
+    }
+    else
+    {
+        EdgeMetricCalc calc( *this );
+        parallel_reduce( tbb::blocked_range<UndirectedEdgeId>( UndirectedEdgeId{0}, UndirectedEdgeId{mesh_.topology.undirectedEdgeSize()} ), calc );
+
+        if ( settings_.progressCallback && !settings_.progressCallback( 0.2f ) )
+            return false;
 
-    presentInQueue_.resize( mesh_.topology.undirectedEdgeSize() );
-    for ( const auto & qe : calc.elements() )
-        presentInQueue_.set( qe.uedgeId );
-    queue_ = std::priority_queue<QueueElement>{ std::less<QueueElement>(), calc.takeElements() };
+        presentInQueue_.resize( mesh_.topology.undirectedEdgeSize() );
+        for ( const auto & qe : calc.elements() )
+            presentInQueue_.set( qe.uedgeId );
+        queue_ = std::priority_queue<QueueElement>{ std::less<QueueElement>(), calc.takeElements() };
+    }
 
     if ( settings_.progressCallback && !settings_.progressCallback( 0.25f ) )
         return false;
@@ -314,6 +374,13 @@ auto MeshDecimator::computeQueueElement_( UndirectedEdgeId ue, QuadraticForm3f *
 void MeshDecimator::addInQueueIfMissing_( UndirectedEdgeId ue )
 {
     EdgeId e{ ue };
+    if ( heap_ )
+    {
+        if ( heap_->value( ue ) < FLT_MAX )
+            return;
+        updateInQueue_( ue );
+        return;
+    }
     if ( !isInRegion( e ) )
         return;
     if ( presentInQueue_.test_set( ue ) )
@@ -322,6 +389,50 @@ void MeshDecimator::addInQueueIfMissing_( UndirectedEdgeId ue )
         queue_.push( *qe );
 }
 
+auto MeshDecimator::popQueue_() -> std::optional<QueueElement>
+{
+    std::optional<QueueElement> res;
+    if ( heap_ )
+    {
+        const auto top = heap_->top();
+        if ( top.val < FLT_MAX )
+        {
+            res = QueueElement{ .c = top.val, .uedgeId = top.id };
+            heap_->setValue( top.id, FLT_MAX );
+        }
+    }
+    else if ( !queue_.empty() )
+    {
+        res = queue_.top();
+        assert( presentInQueue_.test( res->uedgeId ) );
+        queue_.pop();
+    }
+    return res;
+}
+
+void MeshDecimator::pushQueue_( const QueueElement & qe )
+{
+    if ( heap_ )
+        heap_->setValue( qe.uedgeId, qe.c );
+    else
+        queue_.push( qe );
+}
+
+void MeshDecimator::updateInQueue_( UndirectedEdgeId ue )
+{
+    assert( heap_ );
+    std::optional<QueueElement> qe;
+    if ( isInRegion( EdgeId{ ue } ) )
+        qe = computeQueueElement_( ue );
+    heap_->setValue( ue, qe ? qe->c : FLT_MAX );
+}
+
+void MeshDecimator::setNotInQueue_( UndirectedEdgeId ue )
+{
+    if ( !heap_ )
+        presentInQueue_.reset( ue );
+}
+
 VertId MeshDecimator::collapse_( EdgeId edgeToCollapse, const Vector3f & collapsePos )
 {
     auto & topology = mesh_.topology;
@@ -445,11 +556,9 @@ DecimateResult MeshDecimator::run()
     int lastProgressFacesDeleted = 0;
     const int maxFacesDeleted = std::min(
         settings_.region ? (int)settings_.region->count() : mesh_.topology.numValidFaces(), settings_.maxDeletedFaces );
-    while ( !queue_.empty() )
+    while ( auto popped = popQueue_() )
     {
-        auto topQE = queue_.top();
-        assert( presentInQueue_.test( topQE.uedgeId ) );
-        queue_.pop();
+        const auto topQE = *popped;
         if ( res_.facesDeleted >= settings_.maxDeletedFaces || res_.vertsDeleted >= settings_.maxDeletedVertices )
         {
             res_.errorIntroduced = std::sqrt( topQE.c );
@@ -466,7 +575,7 @@ DecimateResult MeshDecimator::run()
         if ( mesh_.topology.isLoneEdge( topQE.uedgeId ) )
         {
             // edge has been deleted by this moment
-            presentInQueue_.reset( topQE.uedgeId );
+            setNotInQueue_( topQE.uedgeId );
             continue;
         }
 
@@ -475,17 +584,17 @@ DecimateResult MeshDecimator::run()
         auto qe = computeQueueElement_( topQE.uedgeId, &collapseForm, &collapsePos );
         if ( !qe )
         {
-            presentInQueue_.reset( topQE.uedgeId );
+            setNotInQueue_( topQE.uedgeId );
             continue;
         }
 
         if ( qe->c > topQE.c )
         {
-            queue_.push( *qe );
+            pushQueue_( *qe );
             continue;
         }
 
-        presentInQueue_.reset( topQE.uedgeId );
+        setNotInQueue_( topQE.uedgeId );
         VertId collapseVert = collapse_( topQE.uedgeId, collapsePos );
         if ( !collapseVert )
             continue;
@@ -494,7 +603,11 @@ DecimateResult MeshDecimator::run()
 
         for ( EdgeId e : orgRing( mesh_.topology, collapseVert ) )
         {
-            addInQueueIfMissing_( e.undirected() );
+            // the costs of the edges incident to collapsed vertex are changed, and the heap updates them immediately
+            if ( heap_ )
+                updateInQueue_( e.undirected() );
+            else
+                addInQueueIfMissing_( e.undirected() );
             if ( mesh_.topology.left( e ) )
                 addInQueueIfMissing_( mesh_.topology.prev( e.sym() ).undirected() );
         }
@@ -535,11 +648,709 @@ DecimateResult decimateMesh( Mesh & mesh, const DecimateSettings & settings )
     return md.run();
 }
 
+namespace
+{
+
+// mixes the bits of edge id to get pseudo-random but deterministic order of edges with equal levels
+inline uint32_t hashEdgeId( UndirectedEdgeId ue )
+{
+    uint32_t x = uint32_t( (int)ue );
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+// the key of candidate edge: the edges with higher levels are preferred, and the edges of the same level are ordered pseudo-randomly;
+// the keys of all edges are distinct and not zero
+inline uint64_t edgeKey( float level, UndirectedEdgeId ue )
+{
+    const auto l = uint64_t( std::clamp( level, 0.0f, 255.0f ) );
+    return ( l << 56 ) | ( uint64_t( hashEdgeId( ue ) >> 8 ) << 32 ) | uint64_t( (int)ue + 1 );
+}
+
+// the form of the vertex created by the split of the edge between vertices with given forms and positions
+inline QuadraticForm3f splitForm( const QuadraticForm3f & qo, const Vector3f & po, const QuadraticForm3f & qd, const Vector3f & pd, const Vector3f & pos )
+{
+    QuadraticForm3f res;
+    res.A = 0.5f * ( qo.A + qd.A );
+    res.c = 0.5f * ( qo.eval( po - pos ) + qd.eval( pd - pos ) );
+    return res;
+}
+
+class ParallelRemesher
+{
+public:
+    ParallelRemesher( Mesh & mesh, const RemeshSettings & settings );
+    bool run();
+
+private:
+    Mesh & mesh_;
+    MeshTopology & topology_;
+    const RemeshSettings & settings_;
+    const float minLenSq_;
+    const float maxLenSq_;
+    // the limit of squared error of collapses and vertex moves, the same as in sequential remesh
+    const float maxErrorSq_;
+    // the copy of input mesh (and region), the vertices are projected on it after all moves
+    Mesh original_;
+    FaceBitSet originalRegion_;
+    // the forms of squared distances to the planes of original faces near each vertex, relative to its current position
+    Vector<QuadraticForm3f, VertId> forms_;
+    // the edges to be processed in current round, and after it the edges left unprocessed
+    UndirectedEdgeBitSet candidates_;
+    // the vertices near the changes of previous round: the edges incident to them are checked again in next round,
+    // and other edges keep their state
+    VertBitSet dirtyVerts_;
+    bool firstRound_ = true;
+    // the maximal key of the candidate edges affecting each vertex, zero if none
+    std::unique_ptr<std::atomic<uint64_t>[]> vertKeys_;
+    size_t vertKeysSize_ = 0;
+    Vector<uint64_t, UndirectedEdgeId> edgeKeys_;
+
+    // sets candidates_ to the edges satisfying given predicate; in the first round of a pass checks all edges, and later only the edges near dirtyVerts_
+    template<typename IsCandidate>
+    void findCandidates_( const IsCandidate & isCandidate );
+
+    // selects maximal subset of candidates_, where no two edges affect the same vertex, preferring the edges with greater keys,
+    // and removes selected edges from candidates_; the selection does not depend on the number of threads
+    template<typename GetKey, typename ForEachVert>
+    std::vector<UndirectedEdgeId> selectIndependent_( const GetKey & getKey, const ForEachVert & forEachVert );
+
+    // returns true if the candidates are much fewer than all edges, so a parallel round would be inefficient
+    bool fewCandidates_() const { return candidates_.count() * 256 < topology_.undirectedEdgeSize(); }
+    // returns candidates_ in the order of decreasing keys
+    template<typename GetKey>
+    std::vector<UndirectedEdgeId> sortedCandidates_( const GetKey & getKey ) const;
+
+    // each round processes in parallel an independent set of candidate edges;
+    // if only few candidates remain (probably near the same vertices), they are processed sequentially and the pass is finished;
+    // returns false if no more rounds are necessary in the pass
+    bool splitRound_();
+    bool collapseRound_();
+    bool flipRound_();
+    // moves inner vertices toward the centers of their neighbors in tangent planes
+    void relax_();
+
+    // returns the closest point on the original surface
+    Vector3f project_( const Vector3f & p ) const;
+
+    struct Collapse
+    {
+        QuadraticForm3f form;
+        Vector3f pos;
+    };
+    // checks topological and geometrical conditions for the collapse of given edge,
+    // and returns the position of remaining vertex minimizing the error and its form
+    std::optional<Collapse> computeCollapse_( EdgeId e ) const;
+};
+
+ParallelRemesher::ParallelRemesher( Mesh & mesh, const RemeshSettings & settings )
+    : mesh_( mesh )
+    , topology_( mesh.topology )
+    , settings_( settings )
+    , minLenSq_( sqr( 0.8f * settings.targetEdgeLen ) )
+    , maxLenSq_( sqr( 4.0f / 3 * settings.targetEdgeLen ) )
+    , maxErrorSq_( sqr( settings.targetEdgeLen / 2 ) )
+    , original_( mesh )
+{
+    MR_TIMER
+    if ( settings_.region )
+        originalRegion_ = *settings_.region;
+    (void)original_.getAABBTree();
+
+    const MeshPart mp{ original_, settings_.region ? &originalRegion_ : nullptr };
+    const float stabilizer = DecimateSettings{}.stabilizer;
+    forms_.resize( topology_.vertSize() );
+    BitSetParallelFor( topology_.getValidVerts(), [&]( VertId v )
+    {
+        forms_[v] = computeFormAtVertex( mp, v, stabilizer );
+    } );
+}
+
+Vector3f ParallelRemesher::project_( const Vector3f & p ) const
+{
+    return findProjection( p, { original_, settings_.region ? &originalRegion_ : nullptr } ).proj.point;
+}
+
+template<typename IsCandidate>
+void ParallelRemesher::findCandidates_( const IsCandidate & isCandidate )
+{
+    MR_TIMER
+    UndirectedEdgeBitSet candidates( topology_.undirectedEdgeSize() );
+    BitSetParallelForAll( candidates, [&]( UndirectedEdgeId ue )
+    {
+        const EdgeId e = ue;
+        if ( topology_.isLoneEdge( e ) )
+            return;
+        if ( firstRound_ || dirtyVerts_.test( topology_.org( e ) ) || dirtyVerts_.test( topology_.dest( e ) ) )
+        {
+            if ( isCandidate( e ) )
+                candidates.set( ue );
+        }
+        else if ( ue < candidates_.size() && candidates_.test( ue ) )
+            candidates.set( ue ); // the conditions for remaining candidate did not change
+
+    } );
+    candidates_ = std::move( candidates );
+    dirtyVerts_.clear();
+    dirtyVerts_.resize( topology_.vertSize() );
+    firstRound_ = false;
+}
+
+template<typename GetKey, typename ForEachVert>
+std::vector<UndirectedEdgeId> ParallelRemesher::selectIndependent_( const GetKey & getKey, const ForEachVert & forEachVert )
+{
+    MR_TIMER
+    const auto vertSize = topology_.vertSize();
+    if ( vertKeysSize_ < vertSize )
+    {
+        vertKeysSize_ = vertSize + vertSize / 2;
+        vertKeys_ = std::make_unique<std::atomic<uint64_t>[]>( vertKeysSize_ );
+    }
+    // the vertices affected by already selected edges
+    constexpr uint64_t taken = ~uint64_t( 0 );
+
+    // repeat until the selection is maximal: every remaining candidate either selected or affects a vertex of a selected edge
+    edgeKeys_.resize( candidates_.size() );
+    BitSetParallelFor( candidates_, [&]( UndirectedEdgeId ue )
+    {
+        edgeKeys_[ue] = getKey( ue );
+    } );
+
+    UndirectedEdgeBitSet selected( candidates_.size() );
+    UndirectedEdgeBitSet remaining = candidates_;
+    UndirectedEdgeBitSet winners( candidates_.size() );
+    while ( remaining.any() )
+    {
+        BitSetParallelFor( remaining, [&]( UndirectedEdgeId ue )
+        {
+            const auto key = edgeKeys_[ue];
+            forEachVert( ue, [&]( VertId v )
+            {
+                auto & vk = vertKeys_[v];
+                auto prev = vk.load( std::memory_order_relaxed );
+                while ( prev < key && !vk.compare_exchange_weak( prev, key, std::memory_order_relaxed ) )
+                    {}
+            } );
+        } );
+
+        winners.reset();
+        BitSetParallelFor( remaining, [&]( UndirectedEdgeId ue )
+        {
+            const auto key = edgeKeys_[ue];
+            bool maximal = true;
+            forEachVert( ue, [&]( VertId v )
+            {
+                if ( vertKeys_[v].load( std::memory_order_relaxed ) != key )
+                    maximal = false;
+            } );
+            if ( maximal )
+                winners.set( ue );
+        } );
+
+        BitSetParallelFor( winners, [&]( UndirectedEdgeId ue )
+        {
+            forEachVert( ue, [&]( VertId v )
+            {
+                vertKeys_[v].store( taken, std::memory_order_relaxed );
+            } );
+        } );
+        selected |= winners;
+        remaining -= winners;
+
+        // other candidates are dropped if they affect the vertices of selected edges, and clear their keys in free vertices
+        BitSetParallelFor( remaining, [&]( UndirectedEdgeId ue )
+        {
+            bool free = true;
+            forEachVert( ue, [&]( VertId v )
+            {
+                auto & vk = vertKeys_[v];
+                const auto key = vk.load( std::memory_order_relaxed );
+                if ( key == taken )
+                    free = false;
+                else if ( key != 0 )
+                    vk.store( 0, std::memory_order_relaxed );
+            } );
+            if ( !free )
+                remaining.reset( ue );
+        } );
+    }
+
+    BitSetParallelFor( selected, [&]( UndirectedEdgeId ue )
+    {
+        forEachVert( ue, [&]( VertId v )
+        {
+            vertKeys_[v].store( 0, std::memory_order_relaxed );
+        } );
+    } );
+
+    candidates_ -= selected;
+
+    std::vector<UndirectedEdgeId> res;
+    res.reserve( selected.count() );
+    for ( auto ue : selected )
+        res.push_back( ue );
+    return res;
+}
+
+template<typename GetKey>
+std::vector<UndirectedEdgeId> ParallelRemesher::sortedCandidates_( const GetKey & getKey ) const
+{
+    std::vector<std::pair<uint64_t, UndirectedEdgeId>> keyEdges;
+    keyEdges.reserve( candidates_.count() );
+    for ( auto ue : candidates_ )
+        keyEdges.emplace_back( getKey( ue ), ue );
+    std::sort( keyEdges.begin(), keyEdges.end(), std::greater() );
+
+    std::vector<UndirectedEdgeId> res;
+    res.reserve( keyEdges.size() );
+    for ( const auto & ke : keyEdges )
+        res.push_back( ke.second );
+    return res;
+}
+
+bool ParallelRemesher::splitRound_()
+{
+    MR_TIMER
+
+    findCandidates_( [&]( EdgeId e )
+    {
+        if ( settings_.notFlippable && settings_.notFlippable->test( e.undirected() ) )
+            return false;
+        const FaceId l = topology_.left( e );
+        const FaceId r = topology_.right( e );
+        if ( !MR::contains( settings_.region, l ) && !MR::contains( settings_.region, r ) )
+            return false;
+        // both faces are subdivided, so they must be in the region
+        if ( ( l && !MR::contains( settings_.region, l ) ) || ( r && !MR::contains( settings_.region, r ) ) )
+            return false;
+        return mesh_.edgeLengthSq( e ) > maxLenSq_;
+    } );
+    if ( candidates_.none() )
+        return false;
+
+    // the split of the edge changes the rings of its vertices and the vertices opposite to it
+    auto forEachVert = [&]( UndirectedEdgeId ue, const auto & f )
+    {
+        const EdgeId e = ue;
+        f( topology_.org( e ) );
+        f( topology_.dest( e ) );
+        if ( topology_.left( e ) )
+            f( topology_.dest( topology_.next( e ) ) );
+        if ( topology_.right( e ) )
+            f( topology_.dest( topology_.prev( e ) ) );
+    };
+    // longer edges are split first
+    auto getKey = [&]( UndirectedEdgeId ue )
+    {
+        return edgeKey( 2 * std::log2( mesh_.edgeLengthSq( ue ) / maxLenSq_ ), ue );
+    };
+
+    if ( fewCandidates_() )
+    {
+        // the lengths of the candidates and their adjacency to the region are not changed by the splits of other edges
+        for ( UndirectedEdgeId ue : sortedCandidates_( getKey ) )
+        {
+            const EdgeId e = ue;
+            const VertId o = topology_.org( e );
+            const VertId d = topology_.dest( e );
+            const auto po = mesh_.orgPnt( e );
+            const auto pd = mesh_.destPnt( e );
+            const auto pos = project_( 0.5f * ( po + pd ) );
+            const auto e0 = mesh_.splitEdge( e, pos, settings_.region );
+            forms_.autoResizeSet( topology_.org( e ), splitForm( forms_[o], po, forms_[d], pd, pos ) );
+            if ( settings_.onEdgeSplit )
+                settings_.onEdgeSplit( e0, e );
+        }
+        return false;
+    }
+
+    const auto sel = selectIndependent_( getKey, forEachVert );
+
+    // allocate new elements for all splits in advance
+    struct NewIds
+    {
+        EdgeId e0, el, er;
+        FaceId fl, fr;
+        VertId v;
+    };
+    std::vector<NewIds> newIds( sel.size() );
+    size_t edgeSize = topology_.edgeSize();
+    size_t faceSize = topology_.faceSize();
+    size_t vertSize = topology_.vertSize();
+    for ( size_t i = 0; i < sel.size(); ++i )
+    {
+        const EdgeId e = sel[i];
+        auto & ids = newIds[i];
+        ids.e0 = EdgeId( edgeSize );
+        edgeSize += 2;
+        if ( topology_.left( e ) )
+        {
+            ids.el = EdgeId( edgeSize );
+            edgeSize += 2;
+            ids.fl = FaceId( faceSize++ );
+        }
+        if ( topology_.right( e ) )
+        {
+            ids.er = EdgeId( edgeSize );
+            edgeSize += 2;
+            ids.fr = FaceId( faceSize++ );
+        }
+        ids.v = VertId( vertSize++ );
+    }
+    while ( topology_.edgeSize() < edgeSize )
+        (void)topology_.makeEdge();
+    topology_.faceResize( faceSize );
+    topology_.vertResize( vertSize );
+    mesh_.points.resize( vertSize );
+    forms_.resize( vertSize );
+
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, sel.size() ), withTimerParent( [&]( const tbb::blocked_range<size_t> & range )
+    {
+        for ( size_t i = range.begin(); i < range.end(); ++i )
+        {
+            const EdgeId e = sel[i];
+            const auto & ids = newIds[i];
+            const VertId o = topology_.org( e );
+            const VertId d = topology_.dest( e );
+            const auto po = mesh_.points[o];
+            const auto pd = mesh_.points[d];
+            const auto pos = project_( 0.5f * ( po + pd ) );
+            forms_[ids.v] = splitForm( forms_[o], po, forms_[d], pd, pos );
+            topology_.splitEdgeBeforeComputeValids( e, ids.e0, ids.el, ids.er, ids.fl, ids.fr, ids.v );
+            mesh_.points[ids.v] = pos;
+        }
+    } ) );
+    topology_.computeValidsFromEdges();
+    // all edges with changed lengths are incident to new vertices
+    dirtyVerts_.resize( vertSize, true );
+
+    for ( size_t i = 0; i < sel.size(); ++i )
+    {
+        const auto & ids = newIds[i];
+        if ( settings_.region )
+        {
+            if ( ids.fl )
+                settings_.region->autoResizeSet( ids.fl );
+            if ( ids.fr )
+                settings_.region->autoResizeSet( ids.fr );
+        }
+        if ( settings_.onEdgeSplit )
+            settings_.onEdgeSplit( ids.e0, sel[i] );
+    }
+    return true;
+}
+
+auto ParallelRemesher::computeCollapse_( EdgeId e ) const -> std::optional<Collapse>
+{
+    const VertId o = topology_.org( e );
+    const VertId d = topology_.dest( e );
+    // all faces around both vertices must be present and in the region, so boundary edges are never collapsed in parallel mode
+    // (as documented in RemeshSettings::parallelIterations)
+    if ( topology_.isBdVertex( o, settings_.region ) || topology_.isBdVertex( d, settings_.region ) )
+        return {};
+
+    if ( settings_.notFlippable )
+    {
+        for ( EdgeId x : { e, topology_.next( e ), topology_.prev( e ), topology_.next( e.sym() ), topology_.prev( e.sym() ) } )
+            if ( settings_.notFlippable->test( x.undirected() ) )
+                return {};
+    }
+
+    const VertId vl = topology_.dest( topology_.next( e ) );
+    const VertId vr = topology_.dest( topology_.prev( e ) );
+    if ( vl == vr )
+        return {};
+    auto degree = [&]( VertId v )
+    {
+        int res = 0;
+        for ( [[maybe_unused]] EdgeId x : orgRing( topology_, v ) )
+            ++res;
+        return res;
+    };
+    // the vertices opposite to the edge lose one neighbor each
+    if ( degree( vl ) <= 3 || degree( vr ) <= 3 )
+        return {};
+
+    for ( EdgeId x : orgRing( topology_, e.sym() ) )
+    {
+        const VertId n = topology_.dest( x );
+        if ( n == o || n == vl || n == vr )
+            continue;
+        // the vertices must have no other common neighbors than vl and vr
+        for ( EdgeId y : orgRing( topology_, e ) )
+            if ( topology_.dest( y ) == n )
+                return {};
+    }
+
+    // the position minimizing the error as in decimateMesh, moved on the original surface
+    const auto po = mesh_.points[o];
+    const auto pd = mesh_.points[d];
+    auto [form, pos] = sum( forms_[o], po, forms_[d], pd );
+    pos = project_( pos );
+    form.c = forms_[o].eval( po - pos ) + forms_[d].eval( pd - pos );
+    if ( form.c > maxErrorSq_ )
+        return {};
+
+    for ( EdgeId ev : { e, e.sym() } )
+    {
+        const auto vpos = mesh_.orgPnt( ev );
+        for ( EdgeId x : orgRing( topology_, ev ) )
+        {
+            const auto npos = mesh_.destPnt( x );
+            // the collapse shall not create too long edges
+            if ( x != ev && ( npos - pos ).lengthSq() > maxLenSq_ )
+                return {};
+            // and flip the triangles remaining around the vertex
+            if ( x == ev || x == topology_.prev( ev ) )
+                continue;
+            const auto npos1 = mesh_.destPnt( topology_.next( x ) );
+            const auto n0 = cross( npos - vpos, npos1 - vpos );
+            const auto n1 = cross( npos - pos, npos1 - pos );
+            if ( dot( n0, n1 ) <= 0 )
+                return {};
+        }
+    }
+    return Collapse{ form, pos };
+}
+
+bool ParallelRemesher::collapseRound_()
+{
+    MR_TIMER
+
+    findCandidates_( [&]( EdgeId e )
+    {
+        return mesh_.edgeLengthSq( e ) < minLenSq_ && computeCollapse_( e ).has_value();
+    } );
+    if ( candidates_.none() )
+        return false;
+
+    // the collapse of the edge changes the rings of its vertices and their neighbors,
+    // and its conditions depend on the positions of all of them
+    auto forEachVert = [&]( UndirectedEdgeId ue, const auto & f )
+    {
+        const EdgeId e = ue;
+        for ( EdgeId x : orgRing( topology_, e ) )
+            f( topology_.dest( x ) );
+        for ( EdgeId x : orgRing( topology_, e.sym() ) )
+            f( topology_.dest( x ) );
+    };
+    // shorter edges are collapsed first
+    auto getKey = [&]( UndirectedEdgeId ue )
+    {
+        return edgeKey( 2 * std::log2( minLenSq_ / mesh_.edgeLengthSq( ue ) ), ue );
+    };
+
+    if ( fewCandidates_() )
+    {
+        for ( UndirectedEdgeId ue : sortedCandidates_( getKey ) )
+        {
+            const EdgeId e = ue;
+            // the conditions are checked again since previous collapses could change them
+            if ( topology_.isLoneEdge( e ) || mesh_.edgeLengthSq( e ) >= minLenSq_ )
+                continue;
+            const auto collapse = computeCollapse_( e );
+            if ( !collapse )
+                continue;
+            const VertId o = topology_.org( e );
+            if ( settings_.region )
+            {
+                settings_.region->reset( topology_.left( e ) );
+                settings_.region->reset( topology_.right( e ) );
+            }
+            collapseEdge( topology_, e );
+            mesh_.points[o] = collapse->pos;
+            forms_[o] = collapse->form;
+        }
+        return false;
+    }
+
+    const auto sel = selectIndependent_( getKey, forEachVert );
+
+    std::vector<std::pair<FaceId, FaceId>> deletedFaces( settings_.region ? sel.size() : 0 );
+    // the collapsed vertex and the vertices opposite to the edge
+    std::vector<std::array<VertId, 3>> changedVerts( sel.size() );
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, sel.size() ), withTimerParent( [&]( const tbb::blocked_range<size_t> & range )
+    {
+        for ( size_t i = range.begin(); i < range.end(); ++i )
+        {
+            const EdgeId e = sel[i];
+            const VertId o = topology_.org( e );
+            // the selected edges are far apart, so the conditions of collapse are the same as when they were found
+            const auto collapse = computeCollapse_( e );
+            assert( collapse );
+            if ( !collapse )
+                continue; // changedVerts[i] and deletedFaces[i] remain invalid
+            if ( settings_.region )
+                deletedFaces[i] = { topology_.left( e ), topology_.right( e ) };
+            changedVerts[i] = { o, topology_.dest( topology_.next( e ) ), topology_.dest( topology_.prev( e ) ) };
+            collapseEdge( topology_, e, true );
+            mesh_.points[o] = collapse->pos;
+            forms_[o] = collapse->form;
+        }
+    } ) );
+    topology_.computeValidsFromEdges();
+
+    // the conditions of collapse are changed only for the edges incident to the moved vertex and its neighbors,
+    // and for the edges opposite to the vertices, which lost one neighbor
+    for ( const auto & vs : changedVerts )
+    {
+        if ( !vs[0] )
+            continue;
+        dirtyVerts_.set( vs[0] );
+        for ( VertId v : vs )
+            for ( EdgeId x : orgRing( topology_, v ) )
+                dirtyVerts_.set( topology_.dest( x ) );
+    }
+
+    for ( const auto & [l, r] : deletedFaces )
+    {
+        if ( !l )
+            continue;
+        settings_.region->reset( l );
+        settings_.region->reset( r );
+    }
+    return true;
+}
+
+bool ParallelRemesher::flipRound_()
+{
+    MR_TIMER
+
+    DeloneSettings deloneSettings;
+    deloneSettings.maxAngleChange = settings_.maxAngleChangeAfterFlip;
+    deloneSettings.region = settings_.region;
+    deloneSettings.notFlippable = settings_.notFlippable;
+
+    findCandidates_( [&]( EdgeId e )
+    {
+        return !checkDeloneQuadrangleInMesh( mesh_, e, deloneSettings );
+    } );
+    if ( candidates_.none() )
+        return false;
+
+    // the flip of the edge changes only the rings of the quadrangle's vertices
+    auto forEachVert = [&]( UndirectedEdgeId ue, const auto & f )
+    {
+        const EdgeId e = ue;
+        f( topology_.org( e ) );
+        f( topology_.dest( e ) );
+        f( topology_.dest( topology_.next( e ) ) );
+        f( topology_.dest( topology_.prev( e ) ) );
+    };
+    auto getKey = [&]( UndirectedEdgeId ue )
+    {
+        return edgeKey( 0, ue );
+    };
+
+    if ( fewCandidates_() )
+    {
+        for ( UndirectedEdgeId ue : sortedCandidates_( getKey ) )
+            if ( !checkDeloneQuadrangleInMesh( mesh_, ue, deloneSettings ) )
+                topology_.flipEdge( ue );
+        return false;
+    }
+
+    const auto sel = selectIndependent_( getKey, forEachVert );
+
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, sel.size() ), withTimerParent( [&]( const tbb::blocked_range<size_t> & range )
+    {
+        for ( size_t i = range.begin(); i < range.end(); ++i )
+            topology_.flipEdge( sel[i] );
+    } ) );
+
+    // the flip changes the quadrangles only of the edges inside the quadrangle of flipped edge
+    for ( UndirectedEdgeId ue : sel )
+        forEachVert( ue, [&]( VertId v ) { dirtyVerts_.set( v ); } );
+    return true;
+}
+
+void ParallelRemesher::relax_()
+{
+    MR_TIMER
+
+    // all new positions are computed from the old ones, so the result does not depend on the processing order
+    VertCoords newPoints = mesh_.points;
+    BitSetParallelFor( topology_.getValidVerts(), [&]( VertId v )
+    {
+        const EdgeId e0 = topology_.edgeWithOrg( v );
+        if ( topology_.isBdVertexInOrg( e0, settings_.region ) )
+            return;
+        Vector3f sum;
+        int num = 0;
+        for ( EdgeId e : orgRing( topology_, e0 ) )
+        {
+            // the vertices of not-flippable edges are kept in place
+            if ( settings_.notFlippable && settings_.notFlippable->test( e.undirected() ) )
+                return;
+            sum += mesh_.destPnt( e );
+            ++num;
+        }
+        const auto & pos = mesh_.points[v];
+        const auto norm = mesh_.normal( v );
+        auto shift = sum / float( num ) - pos;
+        shift -= dot( shift, norm ) * norm;
+        const auto newPos = project_( pos + 0.5f * shift );
+        // the vertices on sharp features are not moved away from them
+        auto & form = forms_[v];
+        const auto error = form.eval( pos - newPos );
+        if ( error > maxErrorSq_ )
+            return;
+        newPoints[v] = newPos;
+        form.c = error;
+    } );
+    mesh_.points = std::move( newPoints );
+}
+
+bool ParallelRemesher::run()
+{
+    MR_TIMER
+
+    // limits the number of rounds in each pass, normally it finishes much earlier when no candidates remain
+    constexpr int maxRounds = 64;
+    const int numIters = settings_.parallelIterations;
+    for ( int iter = 0; iter < numIters; ++iter )
+    {
+        if ( settings_.progressCallback && !settings_.progressCallback( float( iter ) / numIters ) )
+            return false;
+        firstRound_ = true;
+        for ( int r = 0; r < maxRounds && splitRound_(); ++r )
+            {}
+        firstRound_ = true;
+        for ( int r = 0; r < maxRounds && collapseRound_(); ++r )
+            {}
+        firstRound_ = true;
+        for ( int r = 0; r < maxRounds && flipRound_(); ++r )
+            {}
+        relax_();
+    }
+
+    if ( settings_.packMesh )
+    {
+        FaceMap fmap;
+        mesh_.pack( settings_.region ? &fmap : nullptr );
+        if ( settings_.region )
+            *settings_.region = settings_.region->getMapping( fmap, topology_.faceSize() );
+    }
+
+    if ( settings_.progressCallback && !settings_.progressCallback( 1.0f ) )
+        return false;
+    return true;
+}
+
+} //anonymous namespace
+
 bool remesh( MR::Mesh& mesh, const RemeshSettings & settings )
 {
     MR_TIMER;
     MR_WRITER( mesh );
 
+    if ( settings.parallelIterations > 0 )
+        return ParallelRemesher( mesh, settings ).run();
+
     if ( settings.progressCallback && !settings.progressCallback( 0.0f ) )
         return false;
 
@@ -595,4 +1406,87 @@ TEST( MRMesh, MeshDecimate )
     ASSERT_GT(decimateResults.facesDeleted, 0);
 }
 
+TEST( MRMesh, MeshDecimateIndexedQueue )
+{
+    const Mesh torus = makeTorus( 1.0f, 0.3f, 64, 32 );
+    DecimateSettings settings;
+    settings.maxError = 1e-2f;
+
+    Mesh mesh0 = torus;
+    const auto res0 = decimateMesh( mesh0, settings );
+
+    settings.indexedQueue = true;
+    Mesh mesh1 = torus;
+    const auto res1 = decimateMesh( mesh1, settings );
+
+    EXPECT_FALSE( res1.cancelled );
+    EXPECT_GT( res1.vertsDeleted, 0 );
+    EXPECT_TRUE( mesh1.topology.isClosed() );
+    // both queues collapse the edges in approximately the same order
+    EXPECT_LT( std::abs( res1.facesDeleted - res0.facesDeleted ), res0.facesDeleted / 20 );
+}
+
+TEST( MRMesh, RemeshParallel )
+{
+    const Mesh torus = makeTorus( 1.0f, 0.3f, 64, 32 );
+    RemeshSettings settings;
+    settings.targetEdgeLen = 0.04f;
+    settings.parallelIterations = 3;
+
+    Mesh mesh0 = torus;
+    EXPECT_TRUE( remesh( mesh0, settings ) );
+    EXPECT_TRUE( mesh0.topology.checkValidity() );
+    EXPECT_TRUE( mesh0.topology.isClosed() );
+    EXPECT_GT( mesh0.topology.numValidFaces(), torus.topology.numValidFaces() );
+
+    double sumLen = 0;
+    int numEdges = 0;
+    for ( auto ue : undirectedEdges( mesh0.topology ) )
+    {
+        sumLen += mesh0.edgeLength( ue );
+        ++numEdges;
+    }
+    const auto avgLen = sumLen / numEdges;
+    EXPECT_GT( avgLen, 0.8 * settings.targetEdgeLen );
+    EXPECT_LT( avgLen, 1.2 * settings.targetEdgeLen );
+
+    // the surface does not shrink
+    float maxDistSq = 0;
+    for ( auto v : mesh0.topology.getValidVerts() )
+        maxDistSq = std::max( maxDistSq, findProjection( mesh0.points[v], torus ).distSq );
+    EXPECT_LT( maxDistSq, sqr( 1e-5f ) );
+
+    // the result does not depend on the number of threads
+    Mesh mesh1 = torus;
+    tbb::task_arena( 1 ).execute( [&] { remesh( mesh1, settings ); } );
+    EXPECT_EQ( mesh0.topology, mesh1.topology );
+    EXPECT_EQ( mesh0.points, mesh1.points );
+}
+
+TEST( MRMesh, RemeshParallelSharp )
+{
+    const Mesh cube = makeCube();
+    RemeshSettings settings;
+    settings.targetEdgeLen = 0.05f;
+    settings.parallelIterations = 5;
+
+    Mesh mesh = cube;
+    EXPECT_TRUE( remesh( mesh, settings ) );
+    EXPECT_TRUE( mesh.topology.checkValidity() );
+    EXPECT_TRUE( mesh.topology.isClosed() );
+
+    // the vertices stay on the input surface
+    float maxDistSq = 0;
+    for ( auto v : mesh.topology.getValidVerts() )
+        maxDistSq = std::max( maxDistSq, findProjection( mesh.points[v], cube ).distSq );
+    EXPECT_LT( maxDistSq, sqr( 1e-5f ) );
+
+    // and the sharp edges and corners of the input are not eroded
+    maxDistSq = 0;
+    for ( auto ue : undirectedEdges( cube.topology ) )
+        for ( float t = 0; t <= 1; t += 0.125f )
+            maxDistSq = std::max( maxDistSq, findProjection( ( 1 - t ) * cube.orgPnt( ue ) + t * cube.destPnt( ue ), mesh ).distSq );
+    EXPECT_LT( maxDistSq, sqr( 0.2f * settings.targetEdgeLen ) );
+}
+
 } //namespace MR
@@ -80,6 +80,10 @@ struct DecimateSettings
     Vector<QuadraticForm3f, VertId> * vertForms = nullptr;
     ///  whether to pack mesh at the end
     bool packMesh = false;
+    /// if true then the edges are kept in indexed heap with in-place update of collapse cost after each collapse,
+    /// otherwise in the priority queue, where an edge is pushed again each time its cost increases;
+    /// the heap takes less memory and time on large meshes, but the order of equal-cost collapses may differ
+    bool indexedQueue = false;
     /// callback to report algorithm progress and cancel it by user request
     ProgressCallback progressCallback = {};
 };
@@ -153,6 +157,16 @@ struct RemeshSettings
     bool packMesh = false;
     /// this function is called each time edge (e) is split into (e1->e), but before the ring is made Delone
     std::function<void(EdgeId e1, EdgeId e)> onEdgeSplit;
+    /// if positive then instead of sequential subdivision and decimation, given number of iterations is performed each consisting of the passes:
+    /// splitting of the edges longer than 4/3 of targetEdgeLen, collapsing of the edges shorter than 4/5 of targetEdgeLen,
+    /// Delone edge flips and tangential relaxation of inner vertices;
+    /// every pass processes independent sets of edges (without common vertices nearby) in parallel, so the result does not depend on the number of threads;
+    /// all new and moved vertices are projected on the input surface, and the collapses and the moves of vertices are rejected
+    /// if their quadratic error exceeds targetEdgeLen / 2 (maxError of decimation in sequential mode), which preserves sharp features;
+    /// useCurvature is ignored in this mode, and onEdgeSplit is called sequentially after each parallel round of splits;
+    /// unlike sequential mode, only the edges with both vertices inside the region (not on mesh or region boundary) are collapsed,
+    /// so short edges on the boundary and the edges touching it are kept (long boundary edges are still split)
+    int parallelIterations = 0;
     /// callback to report algorithm progress and cancel it by user request
     ProgressCallback progressCallback;
 };
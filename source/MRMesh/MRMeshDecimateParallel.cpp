@@ -5,55 +5,67 @@
 #include "MRMeshBuilder.h"
 #include "MRQuadraticForm.h"
 #include "MRBitSetParallelFor.h"
+#include "MRTorus.h"
+#include "MRGTest.h"
 #include "MRPch/MRTBB.h"
+#include <cmath>
 
 namespace MR
 {
 
-DecimateResult decimateParallelMesh( MR::Mesh & mesh, const DecimateParallelSettings & settings )
+namespace
 {
-    MR_TIMER;
 
-    DecimateSettings seqSettings;
-    seqSettings.strategy = settings.strategy;
-    seqSettings.maxError = settings.maxError;
-    seqSettings.maxEdgeLen = settings.maxEdgeLen;
-    seqSettings.maxTriangleAspectRatio = settings.maxTriangleAspectRatio;
-    seqSettings.criticalTriAspectRatio = settings.criticalTriAspectRatio;
-    seqSettings.stabilizer = settings.stabilizer;
-    seqSettings.optimizeVertexPos = settings.optimizeVertexPos;
-    seqSettings.region = settings.region;
-    seqSettings.touchBdVertices = settings.touchBdVertices;
-    if ( settings.preCollapse )
-    {
-        seqSettings.preCollapse = [&mesh, cb = settings.preCollapse]( MR::EdgeId edgeToCollapse, const MR::Vector3f & newEdgeOrgPos ) -> bool
-        {
-            return cb( mesh.topology.org( edgeToCollapse ), mesh.topology.dest( edgeToCollapse ), newEdgeOrgPos );
-        };
-    }
-    if ( settings.adjustCollapse )
+// subdivides the faces of the mesh on approximately given number of parts by a regular grid,
+// which planes are shifted on given fraction of the cell size from the minimum of mesh bounding box
+std::vector<FaceBitSet> getGridParts( const Mesh & mesh, int numParts, float shift )
+{
+    MR_TIMER;
+    const auto box = mesh.computeBoundingBox();
+    const auto size = box.size();
+    Vector3i counts( 1, 1, 1 );
+    while ( counts.x * counts.y * counts.z < numParts )
     {
-        seqSettings.adjustCollapse = [&mesh, cb = settings.adjustCollapse]( MR::EdgeId edgeToCollapse, float & collapseErrorSq, Vector3f & collapsePos )
-        {
-            cb( mesh.topology.org( edgeToCollapse ), mesh.topology.dest( edgeToCollapse ), collapseErrorSq, collapsePos );
-        };
+        // split the axis with the largest cell size
+        int axis = 0;
+        for ( int i = 1; i < 3; ++i )
+            if ( size[i] * counts[axis] > size[axis] * counts[i] )
+                axis = i;
+        counts[axis] *= 2;
     }
+    Vector3f cellSize;
+    for ( int i = 0; i < 3; ++i )
+        cellSize[i] = size[i] > 0 ? size[i] / counts[i] : 1.0f;
+    // due to the shift, the cells along each axis can be one more
+    const Vector3i dims = counts + Vector3i( 1, 1, 1 );
 
-    DecimateResult res;
-    if ( settings.subdivideParts <= 1 )
+    Vector<int, FaceId> faceCell( mesh.topology.faceSize() );
+    BitSetParallelFor( mesh.topology.getValidFaces(), [&]( FaceId f )
     {
-        seqSettings.progressCallback = settings.progressCallback;
-        res = decimateMesh( mesh, seqSettings );
-        return res;
-    }
+        const auto c = mesh.triCenter( f ) - box.min;
+        Vector3i ci;
+        for ( int i = 0; i < 3; ++i )
+            ci[i] = std::clamp( int( std::floor( c[i] / cellSize[i] + shift ) ), 0, counts[i] );
+        faceCell[f] = ci.x + dims.x * ( ci.y + dims.y * ci.z );
+    } );
 
-    MR_WRITER( mesh );
-    const auto & tree = mesh.getAABBTree();
-    const auto subroots = tree.getSubtrees( settings.subdivideParts );
-    const auto sz = subroots.size();
+    std::vector<FaceBitSet> parts( size_t( dims.x ) * dims.y * dims.z );
+    for ( auto f : mesh.topology.getValidFaces() )
+        parts[faceCell[f]].autoResizeSet( f );
+    std::erase_if( parts, []( const FaceBitSet & part ) { return part.none(); } );
+    return parts;
+}
 
-    if ( settings.progressCallback && !settings.progressCallback( 0.05f ) )
-        return res;
+// decimates given parts of the mesh in parallel without touching part boundaries, then recombines the mesh from the parts;
+// unitedVertForms: on input (if not empty) the quadratic forms of mesh vertices, on output the forms of all remaining vertices;
+// returns false if the operation was cancelled
+bool decimateParts( Mesh & mesh, size_t sz, const std::function<FaceBitSet( size_t )> & getPartFaces,
+    const DecimateSettings & seqSettings, const DecimateParallelSettings & settings,
+    Vector<QuadraticForm3f, VertId> & unitedVertForms, DecimateResult & res, const ProgressCallback & progressCallback )
+{
+    MR_TIMER;
+    // the forms of part boundary vertices are already computed on full mesh on levels after the first one
+    const bool formsGiven = !unitedVertForms.empty();
 
     struct alignas(64) SubMesh
     {
@@ -72,14 +84,14 @@ DecimateResult decimateParallelMesh( MR::Mesh & mesh, const DecimateParallelSett
     tbb::parallel_for( tbb::blocked_range<size_t>( 0, sz ),
         [&]( const tbb::blocked_range<size_t>& range )
     {
-        const bool reportProgressFromThisThread = settings.progressCallback && mainThreadId == std::this_thread::get_id();
+        const bool reportProgressFromThisThread = progressCallback && mainThreadId == std::this_thread::get_id();
         for ( size_t i = range.begin(); i < range.end(); ++i )
         {
             auto reportThreadProgress = [&]( float p )
             {
                 if ( cancelled.load( std::memory_order_relaxed ) )
                     return false;
-                if ( reportProgressFromThisThread && !settings.progressCallback( 0.05f + 0.7f * ( finishedSubmeshes.load( std::memory_order_relaxed ) + p ) / sz ) )
+                if ( reportProgressFromThisThread && !progressCallback( 0.75f * ( finishedSubmeshes.load( std::memory_order_relaxed ) + p ) / sz ) )
                 {
                     cancelled.store( true, std::memory_order_relaxed );
                     return false;
@@ -88,7 +100,7 @@ DecimateResult decimateParallelMesh( MR::Mesh & mesh, const DecimateParallelSett
             };
             if ( !reportThreadProgress( 0 ) )
                 break;
-            auto faces = tree.getSubtreeFaces( subroots[i] );
+            auto faces = getPartFaces( i );
             auto & submesh = submeshes[i];
             VertMap vertSubToFull;
             FaceHashMap faceFullToSub;
@@ -103,6 +115,13 @@ DecimateResult decimateParallelMesh( MR::Mesh & mesh, const DecimateParallelSett
 
             auto subSeqSettings = seqSettings;
             subSeqSettings.touchBdVertices = false;
+            if ( formsGiven )
+            {
+                submesh.mVertForms.resize( vertSubToFull.size() );
+                for ( VertId v{ 0 }; v < vertSubToFull.size(); ++v )
+                    if ( auto fv = vertSubToFull[v] )
+                        submesh.mVertForms[v] = unitedVertForms[fv];
+            }
             subSeqSettings.vertForms = &submesh.mVertForms;
             if ( settings.region )
             {
@@ -113,7 +132,7 @@ DecimateResult decimateParallelMesh( MR::Mesh & mesh, const DecimateParallelSett
             {
                 subSeqSettings.preCollapse = [&submesh, &vertSubToFull, cb = settings.preCollapse]( MR::EdgeId edgeToCollapse, const MR::Vector3f & newEdgeOrgPos ) -> bool
                 {
-                    return cb( 
+                    return cb(
                         vertSubToFull[ submesh.m.topology.org( edgeToCollapse ) ],
                         vertSubToFull[ submesh.m.topology.dest( edgeToCollapse ) ],
                         newEdgeOrgPos );
@@ -123,7 +142,7 @@ DecimateResult decimateParallelMesh( MR::Mesh & mesh, const DecimateParallelSett
             {
                 subSeqSettings.adjustCollapse = [&submesh, &vertSubToFull, cb = settings.adjustCollapse]( MR::EdgeId edgeToCollapse, float & collapseErrorSq, Vector3f & collapsePos )
                 {
-                    cb( 
+                    cb(
                         vertSubToFull[ submesh.m.topology.org( edgeToCollapse ) ],
                         vertSubToFull[ submesh.m.topology.dest( edgeToCollapse ) ],
                         collapseErrorSq, collapsePos );
@@ -131,7 +150,7 @@ DecimateResult decimateParallelMesh( MR::Mesh & mesh, const DecimateParallelSett
             }
             if ( reportProgressFromThisThread )
                 subSeqSettings.progressCallback = [reportThreadProgress]( float p ) { return reportThreadProgress( 0.1f + 0.75f * p ); };
-            else if ( settings.progressCallback )
+            else if ( progressCallback )
                 subSeqSettings.progressCallback = [&cancelled]( float ) { return !cancelled.load( std::memory_order_relaxed ); };
             submesh.decimRes = decimateMesh( submesh.m, subSeqSettings );
             if ( submesh.decimRes.cancelled || !reportThreadProgress( 0.85f ) )
@@ -162,11 +181,11 @@ DecimateResult decimateParallelMesh( MR::Mesh & mesh, const DecimateParallelSett
         }
     } );
 
-    if ( cancelled.load( std::memory_order_relaxed ) || ( settings.progressCallback && !settings.progressCallback( 0.75f ) ) )
-        return res;
+    if ( cancelled.load( std::memory_order_relaxed ) || ( progressCallback && !progressCallback( 0.75f ) ) )
+        return false;
 
     // recombine mesh from parts
-    MR::Vector<MR::QuadraticForm3f, MR::VertId> unitedVertForms( mesh.topology.vertSize() );
+    unitedVertForms.resize( mesh.topology.vertSize() );
     VertBitSet bdOfSomePiece( mesh.topology.vertSize() );
     Triangulation t;
     if ( settings.region )
@@ -197,36 +216,136 @@ DecimateResult decimateParallelMesh( MR::Mesh & mesh, const DecimateParallelSett
                 unitedVertForms[fv] = submesh.mVertForms[v];
             }
         }
+        res.facesDeleted += submesh.decimRes.facesDeleted;
+        res.vertsDeleted += submesh.decimRes.vertsDeleted;
     }
 
-    if ( settings.progressCallback && !settings.progressCallback( 0.8f ) )
-        return res;
+    if ( progressCallback && !progressCallback( 0.8f ) )
+        return false;
 
     mesh.topology = MeshBuilder::fromTriangles( t );
 
-    if ( settings.progressCallback && !settings.progressCallback( 0.85f ) )
-        return res;
+    if ( progressCallback && !progressCallback( 0.85f ) )
+        return false;
 
-    BitSetParallelFor( bdOfSomePiece, [&]( VertId v )
+    if ( !formsGiven )
     {
-        unitedVertForms[v] = computeFormAtVertex( { mesh, settings.region }, v, settings.stabilizer );
-    } );
+        BitSetParallelFor( bdOfSomePiece, [&]( VertId v )
+        {
+            unitedVertForms[v] = computeFormAtVertex( { mesh, settings.region }, v, settings.stabilizer );
+        } );
+    }
+
+    return !progressCallback || progressCallback( 1.0f );
+}
+
+} // anonymous namespace
+
+DecimateResult decimateParallelMesh( MR::Mesh & mesh, const DecimateParallelSettings & settings )
+{
+    MR_TIMER;
+
+    DecimateSettings seqSettings;
+    seqSettings.strategy = settings.strategy;
+    seqSettings.maxError = settings.maxError;
+    seqSettings.maxEdgeLen = settings.maxEdgeLen;
+    seqSettings.maxTriangleAspectRatio = settings.maxTriangleAspectRatio;
+    seqSettings.criticalTriAspectRatio = settings.criticalTriAspectRatio;
+    seqSettings.stabilizer = settings.stabilizer;
+    seqSettings.optimizeVertexPos = settings.optimizeVertexPos;
+    seqSettings.region = settings.region;
+    seqSettings.touchBdVertices = settings.touchBdVertices;
+    seqSettings.indexedQueue = settings.indexedQueue;
+    if ( settings.preCollapse )
+    {
+        seqSettings.preCollapse = [&mesh, cb = settings.preCollapse]( MR::EdgeId edgeToCollapse, const MR::Vector3f & newEdgeOrgPos ) -> bool
+        {
+            return cb( mesh.topology.org( edgeToCollapse ), mesh.topology.dest( edgeToCollapse ), newEdgeOrgPos );
+        };
+    }
+    if ( settings.adjustCollapse )
+    {
+        seqSettings.adjustCollapse = [&mesh, cb = settings.adjustCollapse]( MR::EdgeId edgeToCollapse, float & collapseErrorSq, Vector3f & collapsePos )
+        {
+            cb( mesh.topology.org( edgeToCollapse ), mesh.topology.dest( edgeToCollapse ), collapseErrorSq, collapsePos );
+        };
+    }
 
-    if ( settings.progressCallback && !settings.progressCallback( 0.9f ) )
+    DecimateResult res;
+    if ( settings.subdivideParts <= 1 )
+    {
+        seqSettings.progressCallback = settings.progressCallback;
+        res = decimateMesh( mesh, seqSettings );
+        return res;
+    }
+
+    MR_WRITER( mesh );
+    if ( settings.progressCallback && !settings.progressCallback( 0.05f ) )
         return res;
 
+    DecimateResult partsRes;
+    MR::Vector<MR::QuadraticForm3f, MR::VertId> unitedVertForms;
+    const int numLevels = std::max( 1, settings.subdivideLevels );
+    for ( int level = 0; level < numLevels; ++level )
+    {
+        ProgressCallback levelProgress;
+        if ( settings.progressCallback )
+        {
+            const float from = 0.05f + 0.85f * level / numLevels;
+            const float to = 0.05f + 0.85f * ( level + 1 ) / numLevels;
+            levelProgress = [cb = settings.progressCallback, from, to]( float p ) { return cb( from + ( to - from ) * p ); };
+        }
+        bool completed = false;
+        if ( level == 0 )
+        {
+            const auto & tree = mesh.getAABBTree();
+            const auto subroots = tree.getSubtrees( settings.subdivideParts );
+            completed = decimateParts( mesh, subroots.size(), [&]( size_t i ) { return tree.getSubtreeFaces( subroots[i] ); },
+                seqSettings, settings, unitedVertForms, partsRes, levelProgress );
+        }
+        else
+        {
+            // each next level has coarser grid with the planes shifted relative to the boundaries of previous parts
+            const int numParts = std::max( 2, settings.subdivideParts >> level );
+            const float shift = std::fmod( level * 0.618034f, 1.0f );
+            const auto parts = getGridParts( mesh, numParts, shift );
+            completed = decimateParts( mesh, parts.size(), [&]( size_t i ) { return parts[i]; },
+                seqSettings, settings, unitedVertForms, partsRes, levelProgress );
+        }
+        if ( !completed )
+            return res;
+    }
+
     seqSettings.vertForms = &unitedVertForms;
     if ( settings.progressCallback )
         seqSettings.progressCallback = [cb = settings.progressCallback](float p) { return cb( 0.9f + 0.1f * p ); };
     res = decimateMesh( mesh, seqSettings );
     // update res from submesh decimations
-    for ( const auto & submesh : submeshes )
-    {
-        res.facesDeleted += submesh.decimRes.facesDeleted;
-        res.vertsDeleted += submesh.decimRes.vertsDeleted;
-    }
+    res.facesDeleted += partsRes.facesDeleted;
+    res.vertsDeleted += partsRes.vertsDeleted;
 
     return res;
 }
 
+TEST( MRMesh, DecimateParallelLevels )
+{
+    const Mesh torus = makeTorus( 1.0f, 0.3f, 256, 128 );
+
+    DecimateParallelSettings settings;
+    settings.maxError = 1e-2f;
+    settings.subdivideParts = 1;
+    Mesh seqMesh = torus;
+    decimateParallelMesh( seqMesh, settings );
+
+    settings.subdivideParts = 8;
+    settings.subdivideLevels = 3;
+    Mesh mesh = torus;
+    const auto res = decimateParallelMesh( mesh, settings );
+    EXPECT_FALSE( res.cancelled );
+    EXPECT_EQ( res.facesDeleted, torus.topology.numValidFaces() - mesh.topology.numValidFaces() );
+    EXPECT_TRUE( mesh.topology.isClosed() );
+    // the part boundaries of all levels must be decimated as well as the rest of the mesh
+    EXPECT_LT( std::abs( mesh.topology.numValidFaces() - seqMesh.topology.numValidFaces() ), seqMesh.topology.numValidFaces() / 20 );
+}
+
 } //namespace MR
@@ -36,8 +36,14 @@ struct DecimateParallelSettings
     FaceBitSet * region = nullptr;
     /// Whether to allow collapsing edges having at least one vertex on (region) boundary
     bool touchBdVertices = true;
+    /// Whether to keep the edges in indexed heap instead of priority queue, see DecimateSettings::indexedQueue
+    bool indexedQueue = false;
     /// Subdivides mesh on given number of parts to process them in parallel
     int subdivideParts = 32;
+    /// The number of parallel subdivision levels: each next level splits the mesh again on twice less parts
+    /// with the boundaries shifted relative to the previous level, so the vertices near previous part boundaries
+    /// are decimated in parallel too, and only the vertices near the boundaries of the last level are left for final sequential decimation
+    int subdivideLevels = 1;
     /**
      * \brief  The user can provide this optional callback that is invoked immediately before edge collapse;
      * \details It receives both vertices of the edge being collapsed: v1 will disappear,
@@ -0,0 +1,606 @@
+#include "MRMeshDecimateTiled.h"
+#include "MRPointsTiling.h"
+#include "MRMesh.h"
+#include "MRMeshBuilder.h"
+#include "MRIdentifyVertices.h"
+#include "MRMeshLoad.h"
+#include "MRSerializer.h"
+#include "MRStringConvert.h"
+#include "MRHash.h"
+#include "MRTorus.h"
+#include "MRTimer.h"
+#include "MRGTest.h"
+#include "MRPch/MRSpdlog.h"
+#include <climits>
+#include <fstream>
+#include <optional>
+
+namespace MR
+{
+
+namespace
+{
+
+// a triangle spilled in the file of a tile
+struct TileTriangle
+{
+    MeshBuilder::ThreePoints p;
+    int flags = 0;
+};
+
+enum TileTriangleFlags : int
+{
+    OwnTriangle = 1, // the triangle is saved in the result by this tile
+    SeamTriangle = 2 // the vertices of the triangle belong to different tiles
+};
+
+// rough estimation of the memory per triangle needed for in-core decimation: the mesh, quadratic forms, the queue of edges
+constexpr size_t BytesPerTriangle = 256;
+
+// the vertices identified by their coordinates, and their indices in the output mesh
+using VertexMap = phmap::flat_hash_map<Vector3f, int, phmap::priv::hash_default_hash<Vector3f>, MeshBuilder::equalVector3f>;
+
+struct PassParams
+{
+    TrianglesStream triangles;
+    std::filesystem::path outPlyFile;
+    std::filesystem::path tempDir;
+    // the limits of deletions in all tiles, SIZE_MAX means no limit
+    size_t maxDeletedFaces = SIZE_MAX;
+    size_t maxDeletedVertices = SIZE_MAX;
+    // the box of the histogram grid, the bounding box of the triangles if not set
+    std::optional<Box3f> gridBox;
+    // if set then only the edges with at least one of these vertices (or the vertices appeared after their collapses) are collapsed
+    const VertexMap* prevSeams = nullptr;
+};
+
+struct PassResult
+{
+    VertexMap seamVerts; // all locked vertices of the tiles
+    Box3f gridBox;
+    size_t numTiles = 0;
+    size_t facesDeleted = 0;
+    size_t vertsDeleted = 0;
+};
+
+// splits the triangles on tiles, decimates each tile with locked seams, and saves the result in binary PLY file
+tl::expected<PassResult, std::string> decimatePass( const PassParams& params, const TiledDecimateSettings& settings, const ProgressCallback& progressCb )
+{
+    MR_TIMER
+    using namespace detail;
+    // stages: bounding box 0-5%, histogram 5-10%, spilling the tiles 10-25%, decimation of the tiles 25-90%, saving 90-100%
+    bool canceled = false;
+    auto report = [&]( float from, float to, float p )
+    {
+        if ( progressCb && !progressCb( from + ( to - from ) * p ) )
+            canceled = true;
+        return !canceled;
+    };
+    auto cancelError = []() { return tl::make_unexpected( std::string( "Operation was canceled" ) ); };
+    const auto& triangles = params.triangles;
+
+    Box3f box;
+    size_t numTriangles = 0;
+    auto res = triangles( [&]( const TrianglesChunk& chunk )
+    {
+        for ( size_t i = 0; i < chunk.size; ++i )
+            for ( const auto& p : chunk.triangles[i] )
+                box.include( p );
+        numTriangles += chunk.size;
+        return report( 0.0f, 0.05f, 0.0f );
+    } );
+    if ( !res )
+        return tl::make_unexpected( std::move( res.error() ) );
+    if ( canceled )
+        return cancelError();
+    if ( numTriangles == 0 )
+        return tl::make_unexpected( std::string( "No triangles to decimate" ) );
+
+    PassResult result;
+    result.gridBox = params.gridBox ? *params.gridBox : box;
+    const PointsGrid grid( result.gridBox );
+    auto centroidCell = [&]( const MeshBuilder::ThreePoints& t )
+    {
+        return grid.cell( ( t[0] + t[1] + t[2] ) / 3.0f );
+    };
+    PointsHistogram hist;
+    size_t streamed = 0;
+    res = triangles( [&]( const TrianglesChunk& chunk )
+    {
+        for ( size_t i = 0; i < chunk.size; ++i )
+            hist.add( centroidCell( chunk.triangles[i] ) );
+        streamed += chunk.size;
+        return report( 0.05f, 0.1f, float( streamed ) / numTriangles );
+    } );
+    if ( !res )
+        return tl::make_unexpected( std::move( res.error() ) );
+    if ( canceled )
+        return cancelError();
+    hist.accumulate();
+
+    const size_t maxTileTriangles = std::clamp( settings.memoryBudget / BytesPerTriangle, size_t( 4096 ), size_t( INT_MAX / 4 ) );
+    std::vector<Tile> tiles;
+    res = splitOnTiles( grid, hist, Vector3i{}, maxTileTriangles, { 0, 0, 0 }, { HistRes, HistRes, HistRes }, tiles );
+    if ( !res )
+        return tl::make_unexpected( std::move( res.error() ) );
+    result.numTiles = tiles.size();
+    // each vertex belongs to the tile of its cell, and the cells without centroids of triangles are given to the closest tiles
+    std::vector<int> cellOwner( size_t( HistRes ) * HistRes * HistRes, -1 );
+    for ( int t = 0; t < tiles.size(); ++t )
+    {
+        const auto& tile = tiles[t];
+        for ( int z = tile.lo.z; z < tile.hi.z; ++z )
+            for ( int y = tile.lo.y; y < tile.hi.y; ++y )
+                for ( int x = tile.lo.x; x < tile.hi.x; ++x )
+                    cellOwner[PointsGrid::index( { x, y, z } )] = t;
+    }
+    for ( int z = 0; z < HistRes; ++z )
+        for ( int y = 0; y < HistRes; ++y )
+            for ( int x = 0; x < HistRes; ++x )
+            {
+                auto& owner = cellOwner[PointsGrid::index( { x, y, z } )];
+                if ( owner >= 0 )
+                    continue;
+                const auto center = grid.cellsBox( { x, y, z }, { x + 1, y + 1, z + 1 } ).center();
+                float minDistSq = FLT_MAX;
+                for ( int t = 0; t < tiles.size(); ++t )
+                {
+                    const float distSq = ( tiles[t].core.getBoxClosestPointTo( center ) - center ).lengthSq();
+                    if ( distSq < minDistSq )
+                    {
+                        minDistSq = distSq;
+                        owner = t;
+                    }
+                }
+            }
+    spdlog::info( "Tiled decimation: {} triangles in {} tiles", numTriangles, tiles.size() );
+
+    TempFiles tempFiles;
+    for ( int t = 0; t < tiles.size(); ++t )
+        tempFiles.files.push_back( params.tempDir / ( "tile" + std::to_string( t ) + ".bin" ) );
+    const auto vertsPath = params.tempDir / "vertices.bin";
+    const auto trianglesPath = params.tempDir / "triangles.bin";
+    tempFiles.files.push_back( vertsPath );
+    tempFiles.files.push_back( trianglesPath );
+    // the tile files are appended, so remove the files left by previous runs
+    for ( const auto& f : tempFiles.files )
+    {
+        std::error_code ec;
+        std::filesystem::remove( f, ec );
+    }
+
+    // spill the triangles of each tile and the seam triangles touching it in the file of the tile
+    {
+        const size_t bufferSize = std::clamp( settings.memoryBudget / 4 / tiles.size() / sizeof( TileTriangle ), size_t( 1024 ), size_t( 65536 ) );
+        std::vector<std::vector<TileTriangle>> buffers( tiles.size() );
+        bool writeFailed = false;
+        auto flush = [&]( int t )
+        {
+            auto& buf = buffers[t];
+            std::ofstream out( tempFiles.files[t], std::ios::binary | std::ios::app );
+            out.write( (const char*)buf.data(), buf.size() * sizeof( TileTriangle ) );
+            writeFailed = writeFailed || !out;
+            buf.clear();
+        };
+        auto push = [&]( int t, const TileTriangle& tt )
+        {
+            buffers[t].push_back( tt );
+            if ( buffers[t].size() >= bufferSize )
+                flush( t );
+        };
+
+        streamed = 0;
+        res = triangles( [&]( const TrianglesChunk& chunk )
+        {
+            for ( size_t i = 0; i < chunk.size; ++i )
+            {
+                const auto& tri = chunk.triangles[i];
+                int own[3];
+                for ( int j = 0; j < 3; ++j )
+                    own[j] = cellOwner[PointsGrid::index( grid.cell( tri[j] ) )];
+                if ( own[0] == own[1] && own[1] == own[2] )
+                {
+                    push( own[0], { tri, OwnTriangle } );
+                    continue;
+                }
+                push( own[0], { tri, OwnTriangle | SeamTriangle } );
+                if ( own[1] != own[0] )
+                    push( own[1], { tri, SeamTriangle } );
+                if ( own[2] != own[0] && own[2] != own[1] )
+                    push( own[2], { tri, SeamTriangle } );
+            }
+            streamed += chunk.size;
+            return !writeFailed && report( 0.1f, 0.25f, float( streamed ) / numTriangles );
+        } );
+        for ( int t = 0; t < tiles.size(); ++t )
+            if ( !buffers[t].empty() )
+                flush( t );
+        if ( !res )
+            return tl::make_unexpected( std::move( res.error() ) );
+        if ( canceled )
+            return cancelError();
+        if ( writeFailed )
+            return tl::make_unexpected( "Cannot write temporary file in " + utf8string( params.tempDir ) );
+        if ( streamed != numTriangles )
+            return tl::make_unexpected( std::string( "The stream of triangles has changed between the passes" ) );
+    }
+
+    size_t totalTileTriangles = 0;
+    for ( int t = 0; t < tiles.size(); ++t )
+    {
+        std::error_code ec;
+        const auto size = std::filesystem::file_size( tempFiles.files[t], ec );
+        if ( !ec )
+            totalTileTriangles += size / sizeof( TileTriangle );
+    }
+
+    std::ofstream vertsOut( vertsPath, std::ios::binary );
+    std::ofstream trianglesOut( trianglesPath, std::ios::binary );
+    if ( !vertsOut || !trianglesOut )
+        return tl::make_unexpected( "Cannot write temporary file in " + utf8string( params.tempDir ) );
+    size_t numVerts = 0;
+    size_t numFaces = 0;
+    size_t processedTriangles = 0;
+    auto limitInTile = []( size_t total, double share )
+    {
+        return total == SIZE_MAX ? INT_MAX : int( std::min( double( total ) * share, double( INT_MAX ) ) );
+    };
+
+    for ( int t = 0; t < tiles.size(); ++t )
+    {
+        std::vector<TileTriangle> tileTriangles;
+        {
+            const auto& path = tempFiles.files[t];
+            std::error_code ec;
+            const auto size = std::filesystem::file_size( path, ec );
+            if ( ec )
+                continue; // no triangles in the tile
+            tileTriangles.resize( size / sizeof( TileTriangle ) );
+            std::ifstream in( path, std::ios::binary );
+            in.read( (char*)tileTriangles.data(), tileTriangles.size() * sizeof( TileTriangle ) );
+            if ( !in )
+                return tl::make_unexpected( "Cannot read temporary file " + utf8string( path ) );
+            in.close();
+            std::filesystem::remove( path, ec );
+        }
+        const auto tileStart = float( processedTriangles ) / totalTileTriangles;
+        const auto tileEnd = float( processedTriangles + tileTriangles.size() ) / totalTileTriangles;
+        const double share = double( tileTriangles.size() ) / totalTileTriangles;
+        processedTriangles += tileTriangles.size();
+
+        // identify the vertices by their coordinates
+        Triangulation tris;
+        tris.reserve( tileTriangles.size() );
+        VertCoords points;
+        FaceBitSet ownFaces;
+        VertBitSet locked;
+        {
+            VertexMap localVerts;
+            for ( const auto& tt : tileTriangles )
+            {
+                ThreeVertIds ids;
+                for ( int j = 0; j < 3; ++j )
+                {
+                    auto [it, inserted] = localVerts.insert( { tt.p[j], int( points.size() ) } );
+                    if ( inserted )
+                        points.push_back( tt.p[j] );
+                    ids[j] = VertId( it->second );
+                }
+                // the triangles with repeating vertices are skipped in all tiles
+                if ( ids[0] == ids[1] || ids[1] == ids[2] || ids[2] == ids[0] )
+                    continue;
+                const FaceId f( tris.size() );
+                tris.push_back( ids );
+                if ( tt.flags & OwnTriangle )
+                    ownFaces.autoResizeSet( f );
+                if ( tt.flags & SeamTriangle )
+                    for ( auto v : ids )
+                        locked.autoResizeSet( v );
+            }
+        }
+        tileTriangles = {};
+        ownFaces.resize( tris.size() );
+
+        std::vector<MeshBuilder::VertDuplication> dups;
+        Mesh mesh;
+        mesh.topology = MeshBuilder::fromTrianglesDuplicatingNonManifoldVertices( tris, &dups );
+        mesh.points = std::move( points );
+        mesh.points.resize( std::max( mesh.points.size(), size_t( mesh.topology.vertSize() ) ) );
+        locked.resize( mesh.points.size() );
+        // the duplicates of non-manifold vertices and the triangles not added in the mesh are saved as is
+        for ( const auto& d : dups )
+        {
+            mesh.points[d.dupVert] = mesh.points[d.srcVert];
+            locked.set( d.srcVert );
+            locked.set( d.dupVert );
+        }
+        FaceBitSet rejectedFaces( tris.size() );
+        for ( FaceId f{ 0 }; f < tris.size(); ++f )
+        {
+            if ( mesh.topology.hasFace( f ) )
+                continue;
+            rejectedFaces.set( f );
+            for ( auto v : tris[f] )
+                locked.set( v );
+        }
+
+        DecimateSettings decSettings = settings.decimate;
+        decSettings.region = nullptr;
+        decSettings.vertForms = nullptr;
+        decSettings.packMesh = false;
+        decSettings.maxDeletedFaces = std::min( decSettings.maxDeletedFaces, limitInTile( params.maxDeletedFaces, share ) );
+        decSettings.maxDeletedVertices = std::min( decSettings.maxDeletedVertices, limitInTile( params.maxDeletedVertices, share ) );
+        // the vertices of previous seams and the vertices appeared after their collapses
+        VertBitSet collapsible;
+        if ( params.prevSeams )
+        {
+            collapsible.resize( mesh.points.size() );
+            for ( auto v : mesh.topology.getValidVerts() )
+                if ( params.prevSeams->count( mesh.points[v] ) )
+                    collapsible.set( v );
+        }
+        decSettings.preCollapse = [&, userPreCollapse = settings.decimate.preCollapse]( EdgeId e, const Vector3f& newPos )
+        {
+            const auto o = mesh.topology.org( e );
+            const auto d = mesh.topology.dest( e );
+            if ( locked.test( o ) || locked.test( d ) )
+                return false;
+            if ( params.prevSeams && !collapsible.test( o ) && !collapsible.test( d ) )
+                return false;
+            if ( userPreCollapse && !userPreCollapse( e, newPos ) )
+                return false;
+            if ( params.prevSeams )
+                collapsible.set( o );
+            return true;
+        };
+        decSettings.progressCallback = [&]( float p )
+        {
+            return report( 0.25f, 0.9f, tileStart + ( tileEnd - tileStart ) * p );
+        };
+        const auto decRes = decimateMesh( mesh, decSettings );
+        if ( decRes.cancelled || canceled )
+            return cancelError();
+        result.facesDeleted += decRes.facesDeleted;
+        result.vertsDeleted += decRes.vertsDeleted;
+
+        // save own triangles of the tile, the locked vertices get the same indices in all tiles
+        Vector<int, VertId> outIds( mesh.points.size(), -1 );
+        std::vector<Vector3f> outVerts;
+        auto outId = [&]( VertId v )
+        {
+            auto& id = outIds[v];
+            if ( id >= 0 )
+                return id;
+            id = int( numVerts );
+            if ( locked.test( v ) )
+            {
+                auto [it, inserted] = result.seamVerts.insert( { mesh.points[v], id } );
+                if ( !inserted )
+                    return id = it->second;
+            }
+            outVerts.push_back( mesh.points[v] );
+            ++numVerts;
+            return id;
+        };
+        std::vector<int> outTriangles;
+        for ( FaceId f{ 0 }; f < tris.size(); ++f )
+        {
+            if ( !ownFaces.test( f ) )
+                continue;
+            VertId v[3];
+            if ( mesh.topology.hasFace( f ) )
+                mesh.topology.getTriVerts( f, v );
+            else if ( rejectedFaces.test( f ) )
+                std::copy( tris[f].begin(), tris[f].end(), v );
+            else
+                continue;
+            for ( int j = 0; j < 3; ++j )
+                outTriangles.push_back( outId( v[j] ) );
+        }
+        if ( numVerts > size_t( INT_MAX ) )
+            return tl::make_unexpected( std::string( "Too many vertices in decimated mesh" ) );
+        vertsOut.write( (const char*)outVerts.data(), outVerts.size() * sizeof( Vector3f ) );
+        trianglesOut.write( (const char*)outTriangles.data(), outTriangles.size() * sizeof( int ) );
+        if ( !vertsOut || !trianglesOut )
+            return tl::make_unexpected( "Cannot write temporary file in " + utf8string( params.tempDir ) );
+        numFaces += outTriangles.size() / 3;
+    }
+    vertsOut.close();
+    trianglesOut.close();
+
+    std::ofstream out( params.outPlyFile, std::ofstream::binary );
+    if ( !out )
+        return tl::make_unexpected( std::string( "Cannot open file for writing " ) + utf8string( params.outPlyFile ) );
+    out << "ply\nformat binary_little_endian 1.0\ncomment MeshInspector.com\n"
+        "element vertex " << numVerts << "\nproperty float x\nproperty float y\nproperty float z\n"
+        "element face " << numFaces << "\nproperty list uchar int vertex_indices\nend_header\n";
+
+    static_assert( sizeof( Vector3f ) == 12, "wrong size of Vector3f" );
+    constexpr size_t BlockSize = 1 << 16;
+    {
+        std::ifstream vertsIn( vertsPath, std::ios::binary );
+        std::vector<Vector3f> block( BlockSize );
+        for ( size_t first = 0; first < numVerts; first += BlockSize )
+        {
+            const size_t n = std::min( BlockSize, numVerts - first );
+            if ( !vertsIn.read( (char*)block.data(), n * sizeof( Vector3f ) ) )
+                return tl::make_unexpected( "Cannot read temporary file " + utf8string( vertsPath ) );
+            out.write( (const char*)block.data(), n * sizeof( Vector3f ) );
+            if ( !report( 0.9f, 0.95f, float( first + n ) / numVerts ) )
+                return cancelError();
+        }
+    }
+
+    #pragma pack(push, 1)
+    struct PlyTriangle
+    {
+        char cnt = 3;
+        int v[3];
+    };
+    #pragma pack(pop)
+    static_assert( sizeof( PlyTriangle ) == 13, "check your padding" );
+
+    std::ifstream trianglesIn( trianglesPath, std::ios::binary );
+    std::vector<int> block( 3 * BlockSize );
+    std::vector<PlyTriangle> plyBlock( BlockSize );
+    for ( size_t first = 0; first < numFaces; first += BlockSize )
+    {
+        const size_t n = std::min( BlockSize, numFaces - first );
+        if ( !trianglesIn.read( (char*)block.data(), 3 * n * sizeof( int ) ) )
+            return tl::make_unexpected( "Cannot read temporary file " + utf8string( trianglesPath ) );
+        for ( size_t i = 0; i < n; ++i )
+            for ( int j = 0; j < 3; ++j )
+                plyBlock[i].v[j] = block[3 * i + j];
+        out.write( (const char*)plyBlock.data(), n * sizeof( PlyTriangle ) );
+        if ( !report( 0.95f, 1.0f, float( first + n ) / numFaces ) )
+            return cancelError();
+    }
+    if ( !out )
+        return tl::make_unexpected( std::string( "Error saving in PLY-format" ) );
+
+    return result;
+}
+
+} // anonymous namespace
+
+tl::expected<void, std::string> decimateMeshTiled( const TrianglesStream& triangles, const std::filesystem::path& outPlyFile,
+    const TiledDecimateSettings& settings, ProgressCallback progressCb )
+{
+    MR_TIMER
+    using namespace detail;
+    std::optional<UniqueTemporaryFolder> tempFolder;
+    std::filesystem::path tempDir = settings.tempDir;
+    if ( tempDir.empty() )
+    {
+        tempFolder.emplace( FolderCallback{} );
+        if ( !*tempFolder )
+            return tl::make_unexpected( std::string( "Cannot create temporary folder" ) );
+        tempDir = *tempFolder;
+    }
+    auto subprogress = [&]( float from, float to ) -> ProgressCallback
+    {
+        return [&progressCb, from, to]( float p )
+        {
+            return !progressCb || progressCb( from + ( to - from ) * p );
+        };
+    };
+    auto totalLimit = []( int limit )
+    {
+        return limit == INT_MAX ? SIZE_MAX : size_t( std::max( limit, 0 ) );
+    };
+
+    PassParams first;
+    first.triangles = triangles;
+    first.outPlyFile = settings.decimateSeams ? tempDir / "first_pass.ply" : outPlyFile;
+    first.tempDir = tempDir;
+    first.maxDeletedFaces = totalLimit( settings.decimate.maxDeletedFaces );
+    first.maxDeletedVertices = totalLimit( settings.decimate.maxDeletedVertices );
+    auto firstRes = decimatePass( first, settings, subprogress( 0.0f, settings.decimateSeams ? 0.8f : 1.0f ) );
+    if ( !firstRes )
+        return tl::make_unexpected( std::move( firstRes.error() ) );
+    if ( !settings.decimateSeams )
+        return {};
+
+    TempFiles firstPassFile{ { first.outPlyFile } };
+    if ( firstRes->numTiles <= 1 )
+    {
+        // no seams to decimate
+        std::error_code ec;
+        std::filesystem::rename( first.outPlyFile, outPlyFile, ec );
+        if ( ec )
+            std::filesystem::copy_file( first.outPlyFile, outPlyFile, std::filesystem::copy_options::overwrite_existing, ec );
+        if ( ec )
+            return tl::make_unexpected( std::string( "Cannot write file " ) + utf8string( outPlyFile ) );
+        return {};
+    }
+
+    // shift the planes between the tiles, so the seams of the first pass appear inside the tiles
+    const auto& firstBox = firstRes->gridBox;
+    const auto shift = PointsGrid( firstBox ).cellSize / 2.0f;
+    PassParams second;
+    second.triangles = [&first]( const TrianglesChunkCallback& onChunk )
+    {
+        return MeshLoad::streamTrianglesFromPly( first.outPlyFile, onChunk );
+    };
+    second.outPlyFile = outPlyFile;
+    second.tempDir = tempDir;
+    auto remains = []( size_t limit, size_t deleted )
+    {
+        return limit == SIZE_MAX ? SIZE_MAX : limit - std::min( limit, deleted );
+    };
+    second.maxDeletedFaces = remains( first.maxDeletedFaces, firstRes->facesDeleted );
+    second.maxDeletedVertices = remains( first.maxDeletedVertices, firstRes->vertsDeleted );
+    second.gridBox = Box3f( firstBox.min - shift, firstBox.max - shift );
+    second.prevSeams = &firstRes->seamVerts;
+    auto secondRes = decimatePass( second, settings, subprogress( 0.8f, 1.0f ) );
+    if ( !secondRes )
+        return tl::make_unexpected( std::move( secondRes.error() ) );
+    return {};
+}
+
+TEST(MRMesh, DecimateMeshTiled)
+{
+    UniqueTemporaryFolder folder( {} );
+    ASSERT_TRUE( bool( folder ) );
+
+    const Mesh torus = makeTorus( 1.0f, 0.3f, 256, 128 );
+    const auto numFaces = torus.topology.numValidFaces();
+
+    TiledDecimateSettings settings;
+    settings.decimate.maxError = 1e-2f;
+    // small budget to get several tiles
+    settings.memoryBudget = 8192 * BytesPerTriangle;
+    settings.tempDir = folder;
+
+    auto decimated = [&]( bool decimateSeams )
+    {
+        settings.decimateSeams = decimateSeams;
+        const auto path = folder / ( decimateSeams ? "decimated2.ply" : "decimated1.ply" );
+        auto res = decimateMeshTiled( trianglesStreamFromMesh( torus ), path, settings );
+        EXPECT_TRUE( res.has_value() );
+        auto mesh = MeshLoad::fromPly( path );
+        EXPECT_TRUE( mesh.has_value() );
+        if ( !mesh )
+            return Mesh{};
+        // the tiles are stitched without holes and duplicated vertices
+        EXPECT_EQ( mesh->topology.numValidVerts(), mesh->topology.vertSize() );
+        EXPECT_TRUE( mesh->topology.findHoleRepresentiveEdges().empty() );
+        EXPECT_EQ( mesh->topology.numValidVerts() - mesh->topology.undirectedEdgeSize() + mesh->topology.numValidFaces(), 0 );
+        return std::move( *mesh );
+    };
+
+    const auto mesh1 = decimated( false );
+    const auto mesh2 = decimated( true );
+    EXPECT_LT( mesh1.topology.numValidFaces(), numFaces / 4 );
+    // the second pass decimates the seams almost as in-core decimation does
+    Mesh inCore = torus;
+    decimateMesh( inCore, settings.decimate );
+    EXPECT_LT( mesh2.topology.numValidFaces(), mesh1.topology.numValidFaces() );
+    EXPECT_LT( mesh2.topology.numValidFaces(), inCore.topology.numValidFaces() * 11 / 10 );
+
+    settings.decimate.maxDeletedFaces = numFaces / 2;
+    const auto mesh3 = decimated( true );
+    EXPECT_GE( mesh3.topology.numValidFaces(), numFaces / 2 - 2 );
+}
+
+TEST(MRMesh, SplitOnTilesBudget)
+{
+    using namespace detail;
+    const PointsGrid grid( Box3f( Vector3f( 0, 0, 0 ), Vector3f( 1, 1, 1 ) ) );
+    PointsHistogram hist;
+    for ( int i = 0; i < 10; ++i )
+        hist.add( { 1, 2, 3 } );
+    for ( int i = 0; i < 10; ++i )
+        hist.add( { 40, 50, 60 } );
+    hist.accumulate();
+
+    std::vector<Tile> tiles;
+    EXPECT_TRUE( splitOnTiles( grid, hist, Vector3i{}, 10, { 0, 0, 0 }, { HistRes, HistRes, HistRes }, tiles ).has_value() );
+    EXPECT_EQ( tiles.size(), 2 );
+
+    // a single cell has more elements than the budget allows
+    tiles.clear();
+    EXPECT_FALSE( splitOnTiles( grid, hist, Vector3i{}, 9, { 0, 0, 0 }, { HistRes, HistRes, HistRes }, tiles ).has_value() );
+}
+
+} //namespace MR
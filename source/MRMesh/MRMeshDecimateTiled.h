@@ -0,0 +1,48 @@
+#pragma once
+
+#include "MRMeshDecimate.h"
+#include "MRTrianglesStream.h"
+#include <filesystem>
+
+namespace MR
+{
+
+/**
+ * \brief Parameters of out-of-core mesh decimation
+ * \ingroup DecimateGroup
+ *
+ * \sa \ref decimateMeshTiled
+ */
+struct TiledDecimateSettings
+{
+    /// parameters of decimation inside each tile;
+    /// maxDeletedVertices and maxDeletedFaces limit the total number of deletions, which are distributed among the tiles proportionally to their triangles;
+    /// region, vertForms, packMesh and progressCallback are ignored;
+    /// preCollapse and adjustCollapse receive the edges of the mesh of current tile, and preCollapse is not called for the edges touching the seams
+    DecimateSettings decimate;
+    /// approximate upper limit in bytes of the memory consumed by decimation of one tile
+    /// (the operation fails if the densest 1/64 part of the bounding box along each dimension does not fit in it)
+    size_t memoryBudget = size_t( 4 ) << 30;
+    /// if true then the seams left by the tiles are decimated in the second pass over the result with the tiles shifted by half of histogram cell;
+    /// only the edges touching the seams of the first pass are collapsed there
+    bool decimateSeams = true;
+    /// directory for temporary files, which need the space for all triangles of the input and for the output of the first pass;
+    /// if empty then new folder in system temporary directory is used
+    std::filesystem::path tempDir;
+};
+
+/**
+ * \brief Decimates the mesh that can be larger than available memory, and saves the result in binary PLY file
+ * \details The vertices of the mesh are identified by exactly equal coordinates of the triangles in the stream.
+ * The space is split on tiles with approximately equal number of triangles fitting in memory budget, and each vertex belongs to the tile containing it.
+ * The triangles with the vertices in different tiles form the seams, and they are added in all tiles of their vertices.
+ * The triangles of all tiles are spilled on disk, then the tiles are decimated one by one by \ref decimateMesh
+ * with the quadratic forms of \ref computeFormAtVertex and with locked vertices of the seams,
+ * so each seam is the same in all its tiles and the tiles are stitched exactly.
+ * The resulting mesh is written in the file by the tiles, and only the vertices of the seams are kept in memory till the end.
+ * \ingroup DecimateGroup
+ */
+MRMESH_API tl::expected<void, std::string> decimateMeshTiled( const TrianglesStream& triangles, const std::filesystem::path& outPlyFile,
+    const TiledDecimateSettings& settings = {}, ProgressCallback progressCb = {} );
+
+} //namespace MR
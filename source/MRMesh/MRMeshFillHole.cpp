@@ -6,12 +6,14 @@
 #include "MRRingIterator.h"
 #include "MRPlane3.h"
 #include "MRMeshBuilder.h"
+#include "MRTorus.h"
 #include "MRMeshDelone.h"
 #include "MRHash.h"
 #include "MRPch/MRTBB.h"
 #include "MRGTest.h"
 #include <parallel_hashmap/phmap.h>
 #include <queue>
+#include <algorithm>
 #include <functional>
 
 namespace MR
@@ -161,7 +163,7 @@ void getTriangulationWeights( const MeshTopology& topology, const NewEdgesMap& m
 bool removeMultipleEdgesFromTriangulation( const MeshTopology& topology, NewEdgesMap& map, const EdgePath& loop,  const FillHoleMetric& metricRef,
     WeightedConn start, int maxPolygonSubdivisions )
 {
-    MR_TIMER;
+    MR_LEAF_TIMER;
 
     phmap::flat_hash_set<std::pair<VertId, VertId>> edgesInTriangulation;
     auto testExistance = [&] ( VertId a, VertId b )->bool
@@ -518,6 +520,42 @@ void executeFillHolePlan( Mesh & mesh, EdgeId a0, FillHolePlan & plan, FaceBitSe
     assert( plan.numNewTris == int( fsz - fsz0 ) );
 }
 
+void executeFillHolePlan( MeshTopology & topology, EdgeId a0, FillHolePlan & plan, EdgeId firstNewEdge, FaceId firstNewFace )
+{
+    FaceId nextFace = firstNewFace;
+    if ( plan.items.empty() )
+    {
+        assert( plan.numNewTris == 1 && topology.isLeftTri( a0 ) );
+        topology.setLeftBeforeComputeValids( a0, nextFace++ );
+    }
+    else
+    {
+        auto getEdge = [&]( int code )
+        {
+            if ( code >= 0 )
+                return EdgeId( code );
+            return EdgeId( plan.items[ -(code+1) ].edgeCode1 );
+        };
+        EdgeId nextEdge = firstNewEdge;
+        for ( int i = 0; i < plan.items.size(); ++i )
+        {
+            EdgeId a = getEdge( plan.items[i].edgeCode1 );
+            EdgeId b = getEdge( plan.items[i].edgeCode2 );
+            EdgeId c = nextEdge;
+            nextEdge += 2;
+            assert( topology.isLoneEdge( c ) );
+            topology.splice( a, c );
+            topology.splice( b, c.sym() );
+            if ( topology.isLeftTri( c ) )
+                topology.setLeftBeforeComputeValids( c, nextFace++ );
+            if ( topology.isLeftTri( c.sym() ) )
+                topology.setLeftBeforeComputeValids( c.sym(), nextFace++ );
+            plan.items[i].edgeCode1 = (int)c;
+        }
+    }
+    assert( plan.numNewTris == int( nextFace ) - int( firstNewFace ) );
+}
+
 // Sub cubic complexity
 FillHolePlan getFillHolePlan( const Mesh& mesh, EdgeId a0, const FillHoleParams& params )
 {
@@ -981,6 +1019,141 @@ TEST( MRMesh, buildCylinderBetweenTwoHoles )
     EXPECT_EQ( bdEdges.size(), 0 );
 }
 
+TEST( MRMesh, executeFillHolePlanParallel )
+{
+    Mesh mesh = makeTorus( 1.0f, 0.3f, 16, 16 );
+    VertId farV = 0_v;
+    for ( auto v : mesh.topology.getValidVerts() )
+        if ( ( mesh.points[v] - mesh.points[0_v] ).lengthSq() > ( mesh.points[farV] - mesh.points[0_v] ).lengthSq() )
+            farV = v;
+    FaceBitSet removeFaces;
+    for ( auto v : { 0_v, farV } )
+        for ( auto e : orgRing( mesh.topology, v ) )
+            removeFaces.autoResizeSet( mesh.topology.left( e ) );
+    mesh.topology.deleteFaces( removeFaces );
+    const auto numFaces0 = mesh.topology.numValidFaces();
+
+    auto holes = mesh.topology.findHoleRepresentiveEdges();
+    ASSERT_EQ( holes.size(), 2 );
+    std::vector<FillHolePlan> plans;
+    std::vector<EdgeId> firstNewEdges;
+    std::vector<FaceId> firstNewFaces;
+    int numNewTris = 0;
+    for ( auto e : holes )
+    {
+        plans.push_back( getFillHolePlan( mesh, e ) );
+        firstNewEdges.push_back( EdgeId( int( mesh.topology.edgeSize() ) ) );
+        firstNewFaces.push_back( FaceId( int( mesh.topology.faceSize() ) ) );
+        for ( int i = 0; i < plans.back().items.size(); ++i )
+            (void)mesh.topology.makeEdge();
+        for ( int i = 0; i < plans.back().numNewTris; ++i )
+            (void)mesh.topology.addFaceId();
+        numNewTris += plans.back().numNewTris;
+    }
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, holes.size(), 1 ), [&] ( const tbb::blocked_range<size_t>& range )
+    {
+        for ( size_t i = range.begin(); i < range.end(); ++i )
+            executeFillHolePlan( mesh.topology, holes[i], plans[i], firstNewEdges[i], firstNewFaces[i] );
+    } );
+    mesh.topology.computeValidsFromEdges();
+
+    EXPECT_EQ( mesh.topology.numValidFaces(), numFaces0 + numNewTris );
+    EXPECT_TRUE( mesh.topology.findHoleRepresentiveEdges().empty() );
+    EXPECT_TRUE( mesh.topology.checkValidity() );
+}
+
+TEST( MRMesh, executeFillHolePlanParallelAdjacent )
+{
+    Mesh mesh = makeTorus( 1.0f, 0.3f, 16, 16 );
+    auto & topology = mesh.topology;
+    // take the faces around vertex 0 and around its neighbours
+    FaceBitSet region;
+    for ( auto e : orgRing( topology, 0_v ) )
+        for ( auto e1 : orgRing( topology, topology.dest( e ) ) )
+            region.autoResizeSet( topology.left( e1 ) );
+
+    // join each face with at most two of its neighbours, so every group is a disk with simple boundary
+    std::vector<EdgeId> removeEdges;
+    FaceBitSet grouped( region.size() );
+    for ( auto f : region )
+    {
+        if ( grouped.test( f ) )
+            continue;
+        grouped.set( f );
+        int groupSize = 1;
+        for ( auto e : leftRing( topology, f ) )
+        {
+            auto r = topology.right( e );
+            if ( groupSize < 3 && r && region.test( r ) && !grouped.test( r ) )
+            {
+                grouped.set( r );
+                ++groupSize;
+                removeEdges.push_back( e );
+            }
+        }
+    }
+
+    // delete the faces and the edges inside the groups, the edges between groups stay,
+    // so the neighbour holes share boundary vertices
+    for ( auto f : region )
+        topology.setLeft( topology.edgeWithLeft( f ), FaceId{} );
+    for ( auto e : removeEdges )
+    {
+        topology.splice( topology.prev( e ), e );
+        topology.splice( topology.prev( e.sym() ), e.sym() );
+    }
+    ASSERT_TRUE( topology.checkValidity() );
+    const auto numFaces0 = topology.numValidFaces();
+
+    auto holes = topology.findHoleRepresentiveEdges();
+    ASSERT_GT( holes.size(), 10 );
+    std::vector<FillHolePlan> plans;
+    for ( auto e : holes )
+        plans.push_back( getFillHolePlan( mesh, e ) );
+
+    Mesh seqMesh = mesh;
+    auto seqPlans = plans;
+    for ( size_t i = 0; i < holes.size(); ++i )
+        executeFillHolePlan( seqMesh, holes[i], seqPlans[i] );
+
+    std::vector<EdgeId> firstNewEdges;
+    std::vector<FaceId> firstNewFaces;
+    int numNewTris = 0;
+    for ( const auto & plan : plans )
+    {
+        firstNewEdges.push_back( EdgeId( int( topology.edgeSize() ) ) );
+        firstNewFaces.push_back( FaceId( int( topology.faceSize() ) ) );
+        for ( int i = 0; i < plan.items.size(); ++i )
+            (void)topology.makeEdge();
+        for ( int i = 0; i < plan.numNewTris; ++i )
+            (void)topology.addFaceId();
+        numNewTris += plan.numNewTris;
+    }
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, holes.size(), 1 ), [&] ( const tbb::blocked_range<size_t>& range )
+    {
+        for ( size_t i = range.begin(); i < range.end(); ++i )
+            executeFillHolePlan( topology, holes[i], plans[i], firstNewEdges[i], firstNewFaces[i] );
+    } );
+    topology.computeValidsFromEdges();
+
+    EXPECT_EQ( topology.numValidFaces(), numFaces0 + numNewTris );
+    EXPECT_EQ( topology.numValidFaces(), seqMesh.topology.numValidFaces() );
+    EXPECT_TRUE( topology.findHoleRepresentiveEdges().empty() );
+    EXPECT_TRUE( topology.checkValidity() );
+    EXPECT_TRUE( seqMesh.topology.checkValidity() );
+
+    // both fillings must produce the same triangles, only the ids of the new faces can differ
+    auto sortedTris = []( const MeshTopology & t )
+    {
+        auto tris = t.getAllTriVerts();
+        for ( auto & tri : tris )
+            std::rotate( tri.begin(), std::min_element( tri.begin(), tri.end() ), tri.end() );
+        std::sort( tris.begin(), tris.end() );
+        return tris;
+    };
+    EXPECT_TRUE( sortedTris( topology ) == sortedTris( seqMesh.topology ) );
+}
+
 TEST( MRMesh, makeBridge )
 {
     MeshTopology topology;
@@ -150,6 +150,11 @@ struct FillHolePlan
 MRMESH_API FillHolePlan getFillHolePlan( const Mesh& mesh, EdgeId a0, const FillHoleParams& params = {} );
 /// quickly fills the hole given the plan (quickly compared to fillHole function)
 MRMESH_API void executeFillHolePlan( Mesh & mesh, EdgeId a0, FillHolePlan & plan, FaceBitSet * outNewFaces = nullptr );
+/// fills the hole given the plan as above, but instead of adding new elements uses already created lone edges
+/// [firstNewEdge, firstNewEdge + 2 * plan.items.size()) and not valid faces [firstNewFace, firstNewFace + plan.numNewTris),
+/// which allows filling distinct holes in parallel; MeshTopology::computeValidsFromEdges() must be called after all fillings;
+/// the plans adding new vertex (trivial filling) are not supported
+MRMESH_API void executeFillHolePlan( MeshTopology & topology, EdgeId a0, FillHolePlan & plan, EdgeId firstNewEdge, FaceId firstNewFace );
 
 /** \brief Fills hole in mesh trivially\n
   * \ingroup FillHoleGroup
@@ -46,6 +46,7 @@ class MRMESH_CLASS FaceTag;
 class MRMESH_CLASS VertTag;
 class MRMESH_CLASS PixelTag;
 class MRMESH_CLASS VoxelTag;
+class MRMESH_CLASS ObjTag;
 
 template <typename T> class Id;
 template <typename T, typename I> class Vector;
@@ -57,6 +58,7 @@ using FaceId = Id<FaceTag>;
 using VertId = Id<VertTag>;
 using PixelId = Id<PixelTag>;
 using VoxelId = Id<VoxelTag>;
+using ObjId = Id<ObjTag>;
 class ViewportId;
 class ViewportMask;
 
@@ -243,6 +245,7 @@ using WholeEdgeMap = Vector<EdgeId, UndirectedEdgeId>;
 using VertCoords = Vector<Vector3f, VertId>;
 using VertNormals = Vector<Vector3f, VertId>;
 using FaceNormals = Vector<Vector3f, FaceId>;
+using UndirectedEdgeScalars = Vector<float, UndirectedEdgeId>;
 
 template <typename K>
 using HashSet = phmap::flat_hash_set<K>;
@@ -274,6 +277,8 @@ struct MeshPart;
 struct PointCloud;
 class MRMESH_CLASS AABBTree;
 class MRMESH_CLASS AABBTreePoints;
+class MRMESH_CLASS WideAABBTree;
+struct AABBTreeSettings;
 template<typename T> class UniqueThreadSafeOwner;
 
 class PolylineTopology;
@@ -1,5 +1,6 @@
 #include "MRMeshIntersect.h"
 #include "MRAABBTree.h"
+#include "MRWideAABBTree.h"
 #include "MRMesh.h"
 #include "MRMeshPart.h"
 #include "MRRayBoxIntersection.h"
@@ -8,11 +9,15 @@
 #include "MRVector3.h"
 #include "MRLine3.h"
 #include "MRUVSphere.h"
+#include "MRTorus.h"
+#include "MRTimer.h"
 #include "MRGTest.h"
 #include "MRPch/MRSpdlog.h"
+#include "MRPch/MRTBB.h"
 #include "MRMeshLoad.h"
 #include "MRMeshBuilder.h"
 #include "MRMeshSave.h"
+#include <bit>
 
 namespace MR
 {
@@ -124,9 +129,97 @@ std::optional<MeshIntersectionResult> meshRayIntersect_( const MeshPart& meshPar
     }
 }
 
+// the same as meshRayIntersect_ but traverses the wide tree testing all children boxes of a node at once
+static std::optional<MeshIntersectionResult> meshRayIntersectWide_( const MeshPart& meshPart, const WideAABBTree& tree, const Line3f& line,
+    float rayStart, float rayEnd, const IntersectionPrecomputes<float>& prec, bool closestIntersect )
+{
+    const auto& m = meshPart.mesh;
+    if( tree.nodes().empty() )
+        return std::nullopt;
+
+    const WideRayPrecomputes ray( line.p, line.d );
+    constexpr int MaxStackSize = 128; // to avoid allocations
+    std::pair<WideAABBTree::NodeId, float> nodesStack[MaxStackSize];
+    int stackSize = 0;
+    nodesStack[stackSize++] = { tree.rootNodeId(), rayStart };
+
+    FaceId faceId;
+    TriPointf triP;
+    while( stackSize > 0 && ( closestIntersect || !faceId ) )
+    {
+        const auto [n, tEnter] = nodesStack[--stackSize];
+        if( !( tEnter < rayEnd ) )
+            continue;
+
+        const auto& node = tree[n];
+        float childEnter[WideAABBTree::Width];
+        const int hitMask = rayBoxIntersectChildren( node, ray, rayStart, rayEnd, childEnter );
+
+        // not-leaf children to visit, sorted in decreasing order of entering distance
+        std::pair<WideAABBTree::NodeId, float> toVisit[WideAABBTree::Width];
+        int numToVisit = 0;
+        for( int i = 0; i < WideAABBTree::Width && !node.empty( i ); ++i )
+        {
+            if( !( hitMask & ( 1 << i ) ) )
+                continue;
+            if( !node.leaf( i ) )
+            {
+                int j = numToVisit++;
+                for( ; j > 0 && toVisit[j - 1].second < childEnter[i]; --j )
+                    toVisit[j] = toVisit[j - 1];
+                toVisit[j] = { node.child( i ), childEnter[i] };
+                continue;
+            }
+            if( !( childEnter[i] < rayEnd ) )
+                continue;
+            const auto face = node.leafId( i );
+            if( meshPart.region && !meshPart.region->test( face ) )
+                continue;
+            VertId a, b, c;
+            m.topology.getTriVerts( face, a, b, c );
+            if( auto triIsect = rayTriangleIntersect( m.points[a] - line.p, m.points[b] - line.p, m.points[c] - line.p, prec ) )
+            {
+                if( triIsect->t < rayEnd && triIsect->t > rayStart )
+                {
+                    faceId = face;
+                    triP = triIsect->bary;
+                    rayEnd = triIsect->t;
+                    if( !closestIntersect )
+                        break;
+                }
+            }
+        }
+        for( int j = 0; j < numToVisit; ++j )
+        {
+            assert( stackSize < MaxStackSize );
+            nodesStack[stackSize++] = toVisit[j];
+        }
+    }
+
+    if( faceId.valid() )
+    {
+        MeshIntersectionResult res;
+        res.proj.face = faceId;
+        res.proj.point = line.p + rayEnd * line.d;
+        res.mtp = MeshTriPoint( m.topology.edgeWithLeft( faceId ), triP );
+        res.distanceAlongLine = rayEnd;
+        return res;
+    }
+    return std::nullopt;
+}
+
 std::optional<MeshIntersectionResult> rayMeshIntersect( const MeshPart& meshPart, const Line3f& line,
-    float rayStart, float rayEnd, const IntersectionPrecomputes<float>* prec, bool closestIntersect )
+    float rayStart, float rayEnd, const IntersectionPrecomputes<float>* prec, bool closestIntersect, bool useWideTree )
 {
+    if( useWideTree )
+    {
+        const auto& wideTree = meshPart.mesh.getWideAABBTree();
+        if( prec )
+            return meshRayIntersectWide_( meshPart, wideTree, line, rayStart, rayEnd, *prec, closestIntersect );
+        const IntersectionPrecomputes<float> precNew( line.d );
+        return meshRayIntersectWide_( meshPart, wideTree, line, rayStart, rayEnd, precNew, closestIntersect );
+    }
+
     if( prec )
     {
         return meshRayIntersect_<float>( meshPart, line, rayStart, rayEnd, *prec, closestIntersect );
@@ -152,6 +245,199 @@ std::optional<MeshIntersectionResult> rayMeshIntersect( const MeshPart& meshPart
     }
 }
 
+// the rays of one packet in structure-of-arrays layout, so each box is tested against all of them by vectorized loop
+template<typename T>
+struct RayPacket
+{
+    using Mask = unsigned;
+    static_assert( RayPacketSize <= sizeof( Mask ) * 8 );
+
+    T origin[3][RayPacketSize];
+    T invDir[3][RayPacketSize];
+    /// current end of the interval on each ray, decreased after each found intersection
+    T end[RayPacketSize];
+
+    /// returns the mask of rays intersecting given box within [rayStart, end[i]], and the ray parameters of entering the box
+    Mask intersectBox( const Box3f& box, T rayStart, T (&enter)[RayPacketSize] ) const
+    {
+        Mask res = 0;
+        for ( int i = 0; i < RayPacketSize; ++i )
+        {
+            T t0 = rayStart, t1 = end[i];
+            for ( int k = 0; k < 3; ++k )
+            {
+                const T l = ( T( box.min[k] ) - origin[k][i] ) * invDir[k][i];
+                const T r = ( T( box.max[k] ) - origin[k][i] ) * invDir[k][i];
+                t0 = std::max( t0, std::min( l, r ) );
+                t1 = std::min( t1, std::max( l, r ) );
+            }
+            enter[i] = t0;
+            res |= Mask( t0 <= t1 ) << i;
+        }
+        return res;
+    }
+};
+
+// finds intersections of up to RayPacketSize rays with the mesh during single traversal of the tree
+template<typename T>
+static void rayPacketMeshIntersect_( const MeshPart& meshPart, const AABBTree& tree, const Line3<T>* lines, int numRays,
+    T rayStart, T rayEnd, const IntersectionPrecomputes<T>* commonPrec, bool closestIntersect, std::optional<MeshIntersectionResult>* res )
+{
+    assert( numRays > 0 && numRays <= RayPacketSize );
+    using Mask = typename RayPacket<T>::Mask;
+    const auto& m = meshPart.mesh;
+
+    IntersectionPrecomputes<T> precs[RayPacketSize];
+    const IntersectionPrecomputes<T>* prec[RayPacketSize];
+    RayPacket<T> packet;
+    for ( int i = 0; i < RayPacketSize; ++i )
+    {
+        // not-used slots repeat the last ray, but they are excluded from all masks
+        const auto& line = lines[std::min( i, numRays - 1 )];
+        if ( commonPrec )
+            prec[i] = commonPrec;
+        else
+        {
+            precs[i] = IntersectionPrecomputes<T>( line.d );
+            prec[i] = &precs[i];
+        }
+        for ( int k = 0; k < 3; ++k )
+        {
+            packet.origin[k][i] = line.p[k];
+            packet.invDir[k][i] = ( line.d[k] == 0 ) ? std::numeric_limits<T>::max() : T( 1 ) / line.d[k];
+        }
+        packet.end[i] = rayEnd;
+    }
+
+    FaceId faces[RayPacketSize];
+    TriPointf triPs[RayPacketSize];
+    const Mask allRays = Mask( ( 1ull << numRays ) - 1 );
+    // the rays that do not need further search
+    Mask finished = 0;
+
+    T enter[RayPacketSize];
+    Mask mask = packet.intersectBox( tree[tree.rootNodeId()].box, rayStart, enter ) & allRays;
+    if ( !mask )
+        return;
+
+    constexpr int MaxStackSize = 32; // to avoid allocations
+    std::pair<AABBTree::NodeId, Mask> nodesStack[MaxStackSize];
+    int stackSize = 0;
+    nodesStack[stackSize++] = { tree.rootNodeId(), mask };
+
+    while ( stackSize > 0 && finished != allRays )
+    {
+        const auto [n, nodeMask] = nodesStack[--stackSize];
+        const auto& node = tree[n];
+        if ( node.leaf() )
+        {
+            const auto face = node.leafId();
+            if ( meshPart.region && !meshPart.region->test( face ) )
+                continue;
+            VertId a, b, c;
+            m.topology.getTriVerts( face, a, b, c );
+            for ( Mask rays = nodeMask & ~finished; rays; rays &= rays - 1 )
+            {
+                const int i = std::countr_zero( rays );
+                const auto& line = lines[i];
+                const Vector3<T> vA = Vector3<T>( m.points[a] ) - line.p;
+                const Vector3<T> vB = Vector3<T>( m.points[b] ) - line.p;
+                const Vector3<T> vC = Vector3<T>( m.points[c] ) - line.p;
+                if ( auto triIsect = rayTriangleIntersect( vA, vB, vC, *prec[i] ) )
+                {
+                    if ( triIsect->t < packet.end[i] && triIsect->t > rayStart )
+                    {
+                        faces[i] = face;
+                        triPs[i] = triIsect->bary;
+                        packet.end[i] = triIsect->t;
+                        if ( !closestIntersect )
+                            finished |= Mask( 1 ) << i;
+                    }
+                }
+            }
+            continue;
+        }
+
+        T lEnter[RayPacketSize], rEnter[RayPacketSize];
+        const Mask active = nodeMask & ~finished;
+        const Mask lMask = packet.intersectBox( tree[node.l].box, rayStart, lEnter ) & active;
+        const Mask rMask = packet.intersectBox( tree[node.r].box, rayStart, rEnter ) & active;
+        if ( lMask && rMask )
+        {
+            assert( stackSize + 2 <= MaxStackSize );
+            // the child entered first by the majority of common rays is visited first
+            int lFirstVotes = 0;
+            for ( Mask both = lMask & rMask; both; both &= both - 1 )
+            {
+                const int i = std::countr_zero( both );
+                lFirstVotes += lEnter[i] <= rEnter[i] ? 1 : -1;
+            }
+            if ( lFirstVotes >= 0 )
+            {
+                nodesStack[stackSize++] = { node.r, rMask };
+                nodesStack[stackSize++] = { node.l, lMask };
+            }
+            else
+            {
+                nodesStack[stackSize++] = { node.l, lMask };
+                nodesStack[stackSize++] = { node.r, rMask };
+            }
+        }
+        else if ( lMask )
+            nodesStack[stackSize++] = { node.l, lMask };
+        else if ( rMask )
+            nodesStack[stackSize++] = { node.r, rMask };
+    }
+
+    for ( int i = 0; i < numRays; ++i )
+    {
+        if ( !faces[i] )
+            continue;
+        MeshIntersectionResult r;
+        r.proj.face = faces[i];
+        r.proj.point = Vector3f( lines[i].p + packet.end[i] * lines[i].d );
+        r.mtp = MeshTriPoint( m.topology.edgeWithLeft( faces[i] ), triPs[i] );
+        r.distanceAlongLine = float( packet.end[i] );
+        res[i] = r;
+    }
+}
+
+template<typename T>
+static std::vector<std::optional<MeshIntersectionResult>> rayMeshIntersectMany_( const MeshPart& meshPart, const std::vector<Line3<T>>& lines,
+    T rayStart, T rayEnd, const IntersectionPrecomputes<T>* prec, bool closestIntersect )
+{
+    // called for each column of a distance map
+    MR_LEAF_TIMER
+    std::vector<std::optional<MeshIntersectionResult>> res( lines.size() );
+    const auto& tree = meshPart.mesh.getAABBTree();
+    if ( tree.nodes().size() == 0 )
+        return res;
+
+    const size_t numPackets = ( lines.size() + RayPacketSize - 1 ) / RayPacketSize;
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, numPackets ), [&]( const tbb::blocked_range<size_t>& range )
+    {
+        for ( size_t p = range.begin(); p < range.end(); ++p )
+        {
+            const size_t first = p * RayPacketSize;
+            const int numRays = int( std::min( lines.size() - first, size_t( RayPacketSize ) ) );
+            rayPacketMeshIntersect_( meshPart, tree, lines.data() + first, numRays, rayStart, rayEnd, prec, closestIntersect, res.data() + first );
+        }
+    } );
+    return res;
+}
+
+std::vector<std::optional<MeshIntersectionResult>> rayMeshIntersect( const MeshPart& meshPart, const std::vector<Line3f>& lines,
+    float rayStart, float rayEnd, const IntersectionPrecomputes<float>* prec, bool closestIntersect )
+{
+    return rayMeshIntersectMany_<float>( meshPart, lines, rayStart, rayEnd, prec, closestIntersect );
+}
+
+std::vector<std::optional<MeshIntersectionResult>> rayMeshIntersect( const MeshPart& meshPart, const std::vector<Line3d>& lines,
+    double rayStart, double rayEnd, const IntersectionPrecomputes<double>* prec, bool closestIntersect )
+{
+    return rayMeshIntersectMany_<double>( meshPart, lines, rayStart, rayEnd, prec, closestIntersect );
+}
+
 template<typename T>
 std::optional<MultiMeshIntersectionResult> rayMultiMeshAnyIntersect_( const std::vector<Line3Mesh<T>> & lineMeshes,
     T rayStart /*= 0.0f*/, T rayEnd /*= FLT_MAX */ )
@@ -348,4 +634,54 @@ TEST(MRMesh, MeshIntersect)
     }
 }
 
+// checks that batched packet tracing finds the same intersections as tracing rays one by one
+TEST(MRMesh, MeshIntersectMany)
+{
+    Mesh torus = makeTorus( 1, 0.3f, 32, 16 );
+    const auto box = torus.computeBoundingBox();
+
+    constexpr int RaysPerDim = 32;
+    std::vector<Line3f> rays;
+    rays.reserve( RaysPerDim * RaysPerDim );
+    const Vector3f rayDir = Vector3f( 0.1f, 0.2f, -1.0f ).normalized();
+    for ( int y = 0; y < RaysPerDim; ++y )
+        for ( int x = 0; x < RaysPerDim; ++x )
+            rays.push_back( Line3f{ Vector3f(
+                box.min.x + box.size().x * ( x + 0.5f ) / RaysPerDim,
+                box.min.y + box.size().y * ( y + 0.5f ) / RaysPerDim,
+                box.max.z + 1 ), rayDir } );
+    // a packet with not all slots used
+    rays.push_back( Line3f{ Vector3f( 1, 0, 1 ), Vector3f( 0, 0, -1 ) } );
+
+    const IntersectionPrecomputes<float> prec( rayDir );
+    std::vector<std::optional<MeshIntersectionResult>> single( rays.size() );
+    for ( size_t i = 0; i < rays.size(); ++i )
+        single[i] = rayMeshIntersect( torus, rays[i] );
+    const auto many = rayMeshIntersect( torus, rays );
+
+    ASSERT_EQ( many.size(), rays.size() );
+    int numHits = 0;
+    for ( size_t i = 0; i < rays.size(); ++i )
+    {
+        ASSERT_EQ( bool( single[i] ), bool( many[i] ) );
+        if ( !single[i] )
+            continue;
+        ++numHits;
+        EXPECT_NEAR( single[i]->distanceAlongLine, many[i]->distanceAlongLine, 1e-5f );
+    }
+    EXPECT_GT( numHits, 0 );
+    EXPECT_TRUE( many.back().has_value() );
+
+    const std::vector<Line3d> raysD( 1, Line3d( rays.back() ) );
+    const auto manyD = rayMeshIntersect( torus, raysD );
+    ASSERT_TRUE( manyD[0].has_value() );
+    EXPECT_NEAR( manyD[0]->distanceAlongLine, many.back()->distanceAlongLine, 1e-5f );
+
+    // given precomputes are valid only for the rays with the same direction
+    rays.pop_back();
+    const auto anyHits = rayMeshIntersect( torus, rays, 0.0f, FLT_MAX, &prec, false );
+    for ( size_t i = 0; i < rays.size(); ++i )
+        EXPECT_EQ( bool( single[i] ), bool( anyHits[i] ) );
+}
+
 } //namespace MR
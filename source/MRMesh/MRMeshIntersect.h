@@ -27,8 +27,10 @@ struct MeshIntersectionResult
 /// \p rayStart and \p rayEnd define the interval on the ray to detect an intersection.
 /// \p prec can be specified to reuse some precomputations (e.g. for checking many parallel rays).
 /// Finds the closest to ray origin intersection (or any intersection for better performance if \p !closestIntersect).
+/// \p useWideTree selects the traversal of Mesh::getWideAABBTree() (created if necessary) instead of binary AABB tree.
 MRMESH_API std::optional<MeshIntersectionResult> rayMeshIntersect( const MeshPart& meshPart, const Line3f& line,
-    float rayStart = 0.0f, float rayEnd = FLT_MAX, const IntersectionPrecomputes<float>* prec = nullptr, bool closestIntersect = true );
+    float rayStart = 0.0f, float rayEnd = FLT_MAX, const IntersectionPrecomputes<float>* prec = nullptr, bool closestIntersect = true,
+    bool useWideTree = false );
 
 /// Finds ray and mesh intersection in double-precision.
 /// \p rayStart and \p rayEnd define the interval on the ray to detect an intersection.
@@ -37,6 +39,22 @@ MRMESH_API std::optional<MeshIntersectionResult> rayMeshIntersect( const MeshPar
 MRMESH_API std::optional<MeshIntersectionResult> rayMeshIntersect( const MeshPart& meshPart, const Line3d& line,
     double rayStart = 0.0, double rayEnd = DBL_MAX, const IntersectionPrecomputes<double>* prec = nullptr, bool closestIntersect = true );
 
+/// the number of rays traced together in one traversal of AABB tree by batched \ref rayMeshIntersectManyF
+constexpr int RayPacketSize = 8;
+
+/// Finds intersections of many rays with mesh in float-precision, returning the result for each ray at the same index.
+/// The rays are split in packets of consecutive RayPacketSize rays, and each packet traverses AABB tree once,
+/// testing all its rays against a node box together; so it is much faster than tracing the rays one by one
+/// if neighbouring rays in \p lines are close to each other (e.g. parallel rays from neighbouring pixels of an image).
+/// \p prec can be specified only if all rays have the same direction.
+/// \anchor rayMeshIntersectManyF
+MRMESH_API std::vector<std::optional<MeshIntersectionResult>> rayMeshIntersect( const MeshPart& meshPart, const std::vector<Line3f>& lines,
+    float rayStart = 0.0f, float rayEnd = FLT_MAX, const IntersectionPrecomputes<float>* prec = nullptr, bool closestIntersect = true );
+
+/// Same as \ref rayMeshIntersectManyF, but use double precision
+MRMESH_API std::vector<std::optional<MeshIntersectionResult>> rayMeshIntersect( const MeshPart& meshPart, const std::vector<Line3d>& lines,
+    double rayStart = 0.0, double rayEnd = DBL_MAX, const IntersectionPrecomputes<double>* prec = nullptr, bool closestIntersect = true );
+
 struct MultiMeshIntersectionResult : MeshIntersectionResult
 {
     /// the intersection found in this mesh
@@ -11,8 +11,18 @@
 #include "MRColor.h"
 #include "MRPch/MRTBB.h"
 #include "MRProgressReadWrite.h"
+#include "MRMappedFile.h"
+#include "MRTextParse.h"
+#include "MRPlyHeader.h"
+#include "MRMeshSave.h"
+#include "MRTorus.h"
+#include "MRBox.h"
+#include "MRGTest.h"
 #include <array>
+#include <cstring>
+#include <fstream>
 #include <future>
+#include <sstream>
 
 #ifndef MRMESH_NO_OPENCTM
 #include "OpenCTM/openctm.h"
@@ -24,8 +34,50 @@ namespace MR
 namespace MeshLoad
 {
 
+// loads mesh in internal format directly from memory buffer, e.g. memory-mapped file
+static tl::expected<Mesh, std::string> fromMrmeshBuffer( const char* data, size_t size, ProgressCallback callback )
+{
+    MR_TIMER
+
+    Mesh mesh;
+    auto readRes = mesh.topology.read( data, size, callback ? [callback] ( float v )
+    {
+        return callback( v / 2.f );
+    } : callback );
+    if ( !readRes.has_value() )
+    {
+        std::string error = readRes.error();
+        if ( error != "Loading canceled" )
+            error = "Error reading topology from mrmesh - file:\n" + error;
+        return tl::make_unexpected( error );
+    }
+    size_t pos = *readRes;
+
+    // read points
+    std::uint32_t numPoints;
+    if ( size - pos < 4 )
+        return tl::make_unexpected( std::string( "Error reading the number of points from mrmesh-file" ) );
+    std::memcpy( &numPoints, data + pos, 4 );
+    pos += 4;
+    if ( size - pos < numPoints * sizeof( Vector3f ) )
+        return tl::make_unexpected( std::string( "Error reading  points from mrmesh-file" ) );
+    mesh.points.resize( numPoints );
+    if ( !copyByBlocks( ( char* )mesh.points.data(), data + pos, mesh.points.size() * sizeof( Vector3f ), callback ? [callback] ( float v )
+    {
+        return callback( v / 2.f + 0.5f );
+    } : callback ) )
+        return tl::make_unexpected( std::string( "Loading canceled" ) );
+
+    return std::move( mesh );
+}
+
 tl::expected<Mesh, std::string> fromMrmesh( const std::filesystem::path& file, Vector<Color, VertId>*, ProgressCallback callback )
 {
+    auto mapped = MappedFile::open( file );
+    if ( mapped )
+        return addFileNameInError( fromMrmeshBuffer( mapped->data(), mapped->size(), callback ), file );
+
+    // fallback for the files that cannot be mapped
     std::ifstream in( file, std::ifstream::binary );
     if ( !in )
         return tl::make_unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
@@ -66,66 +118,188 @@ tl::expected<Mesh, std::string> fromMrmesh( std::istream& in, Vector<Color, Vert
     return std::move( mesh );
 }
 
-tl::expected<Mesh, std::string> fromOff( const std::filesystem::path & file, Vector<Color, VertId>*, ProgressCallback callback )
+// reads all remaining content of the stream in a string
+static tl::expected<std::string, std::string> readAllText( std::istream& in )
 {
-    std::ifstream in( file );
+    std::ostringstream oss;
+    oss << in.rdbuf();
     if ( !in )
-        return tl::make_unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
+        return tl::make_unexpected( std::string( "Error reading the stream" ) );
+    return std::move( oss ).str();
+}
 
-    return addFileNameInError( fromOff( in, nullptr, callback ), file );
+// skips spaces, line ends and comments
+static const char* skipBlanksAndComments( const char* p, const char* end )
+{
+    while ( p < end )
+    {
+        if ( *p == '#' )
+            p = skipLine( p, end );
+        else if ( std::isspace( (unsigned char)*p ) )
+            ++p;
+        else
+            break;
+    }
+    return p;
 }
 
-tl::expected<Mesh, std::string> fromOff( std::istream& in, Vector<Color, VertId>*, ProgressCallback callback )
+// returns true if the line starting at p has some data other than a comment
+static bool isDataLine( const char* p, const char* end )
+{
+    p = skipSpaces( p, end );
+    return p < end && *p != '\n' && *p != '#';
+}
+
+// the records parsed from one chunk of OFF-file
+struct OffChunk
+{
+    Triangulation t;
+    std::string error;
+};
+
+// loads OFF directly from memory buffer, parsing the chunks of lines in parallel
+static tl::expected<Mesh, std::string> fromOffBuffer( const char* data, size_t size, ProgressCallback callback )
 {
     MR_TIMER
-    std::string header;
-    in >> header;
-    if ( !in || header != "OFF" )
+    const char* end = data + size;
+    const char* p = skipBlanksAndComments( data, end );
+    const char* headerEnd = skipToken( p, end );
+    if ( std::string_view( p, headerEnd - p ) != "OFF" )
         return tl::make_unexpected( std::string( "File is not in OFF-format" ) );
 
-    int numPoints, numPolygons, numUnused;
-    in >> numPoints >> numPolygons >> numUnused;
-    if ( !in || numPoints <= 0 || numPolygons <= 0 || numUnused != 0 )
+    int numPoints = 0, numPolygons = 0, numUnused = 0;
+    p = headerEnd;
+    for ( int * n : { &numPoints, &numPolygons, &numUnused } )
+    {
+        p = parseNumber( skipBlanksAndComments( p, end ), end, *n );
+        if ( !p )
+            return tl::make_unexpected( std::string( "Unsupported OFF-format" ) );
+    }
+    if ( numPoints <= 0 || numPolygons <= 0 || numUnused != 0 )
         return tl::make_unexpected( std::string( "Unsupported OFF-format" ) );
+    p = skipLine( p, end );
 
-    std::vector<Vector3f> points;
-    points.reserve( numPoints );
-
-    for ( int i = 0; i < numPoints; ++i )
+    // each not-empty line after the header is either a point or a polygon
+    const auto offsets = splitTextByLines( p, size_t( end - p ) );
+    const size_t numChunks = offsets.size() - 1;
+    std::vector<size_t> firstRecord( numChunks + 1, 0 );
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, numChunks, 1 ), [&]( const tbb::blocked_range<size_t> & range )
     {
-        float x, y, z;
-        in >> x >> y >> z;
-        if ( !in )
-            return tl::make_unexpected( std::string( "Points read error" ) );
-        points.emplace_back( x, y, z );
-        if ( callback && !( i & 0x3FF ) && !callback( float( i ) / numPoints * 0.5f ) )
-            return tl::make_unexpected( std::string( "Loading canceled" ) );
-    }
+        for ( size_t i = range.begin(); i < range.end(); ++i )
+        {
+            size_t numRecords = 0;
+            for ( const char* line = p + offsets[i]; line < p + offsets[i + 1]; line = skipLine( line, p + offsets[i + 1] ) )
+                numRecords += isDataLine( line, p + offsets[i + 1] );
+            firstRecord[i + 1] = numRecords;
+        }
+    } );
+    for ( size_t i = 0; i < numChunks; ++i )
+        firstRecord[i + 1] += firstRecord[i];
+    if ( firstRecord.back() < size_t( numPoints ) )
+        return tl::make_unexpected( std::string( "Points read error" ) );
+    if ( firstRecord.back() < size_t( numPoints ) + numPolygons )
+        return tl::make_unexpected( std::string( "Polygons read error" ) );
+
+    VertCoords points( numPoints );
+    std::vector<OffChunk> chunks( numChunks );
+    auto parseChunk = [&]( size_t i )
+    {
+        const char* chunkEnd = p + offsets[i + 1];
+        auto& chunk = chunks[i];
+        std::vector<int> poly;
+        size_t record = firstRecord[i];
+        for ( const char* line = p + offsets[i]; line < chunkEnd && record < size_t( numPoints ) + numPolygons; )
+        {
+            const char* lineEnd = skipLine( line, chunkEnd );
+            const char* q = line;
+            line = lineEnd;
+            if ( !isDataLine( q, lineEnd ) )
+                continue;
+            if ( record < size_t( numPoints ) )
+            {
+                double x, y, z; // double is used to correctly open coordinates like 1e-55 which are under of float-precision
+                if ( !( q = parseNumber( q, lineEnd, x ) ) || !( q = parseNumber( q, lineEnd, y ) ) || !( q = parseNumber( q, lineEnd, z ) ) )
+                {
+                    chunk.error = "Points read error";
+                    return;
+                }
+                points[VertId( record )] = Vector3f{ Vector3d{ x, y, z } };
+            }
+            else
+            {
+                int k = 0;
+                if ( !( q = parseNumber( q, lineEnd, k ) ) || k < 3 )
+                {
+                    chunk.error = "Polygons read error";
+                    return;
+                }
+                poly.resize( k );
+                for ( int j = 0; j < k; ++j )
+                {
+                    if ( !( q = parseNumber( q, lineEnd, poly[j] ) ) || poly[j] < 0 || poly[j] >= numPoints )
+                    {
+                        chunk.error = "Polygons read error";
+                        return;
+                    }
+                }
+                // triangulate polygon by a fan
+                for ( int j = 2; j < k; ++j )
+                    chunk.t.push_back( { VertId( poly[0] ), VertId( poly[j - 1] ), VertId( poly[j] ) } );
+            }
+            ++record;
+        }
+    };
+    if ( !parallelForChunks( numChunks, parseChunk, callback ) )
+        return tl::make_unexpected( std::string( "Loading canceled" ) );
 
     Triangulation t;
-    t.reserve( numPolygons );
-
-    for ( int i = 0; i < numPolygons; ++i )
+    size_t numTris = 0;
+    for ( const auto& chunk : chunks )
     {
-        int k, a, b, c;
-        in >> k >> a >> b >> c;
-        if ( !in || k != 3 )
-            return tl::make_unexpected( std::string( "Polygons read error" ) );
-        t.push_back( { VertId( a ), VertId( b ), VertId( c ) } );
-        if ( callback && !( i & 0x3FF ) && !callback( float( i ) / numPolygons* 0.5f + 0.5f ) )
-            return tl::make_unexpected( std::string( "Loading canceled" ) );
+        if ( !chunk.error.empty() )
+            return tl::make_unexpected( chunk.error );
+        numTris += chunk.t.size();
     }
+    t.reserve( numTris );
+    for ( const auto& chunk : chunks )
+        t.vec_.insert( t.vec_.end(), chunk.t.vec_.begin(), chunk.t.vec_.end() );
 
     return Mesh::fromTriangles( std::move( points ), t );
 }
 
-tl::expected<Mesh, std::string> fromObj( const std::filesystem::path & file, Vector<Color, VertId>*, ProgressCallback callback )
+tl::expected<Mesh, std::string> fromOff( const std::filesystem::path & file, Vector<Color, VertId>*, ProgressCallback callback )
 {
-    std::ifstream in( file );
+    if ( auto mapped = MappedFile::open( file ) )
+        return addFileNameInError( fromOffBuffer( mapped->data(), mapped->size(), callback ), file );
+
+    // fallback for the files that cannot be mapped
+    std::ifstream in( file, std::ifstream::binary );
     if ( !in )
         return tl::make_unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
 
-    return addFileNameInError( fromObj( in, nullptr, callback ), file );
+    return addFileNameInError( fromOff( in, nullptr, callback ), file );
+}
+
+tl::expected<Mesh, std::string> fromOff( std::istream& in, Vector<Color, VertId>*, ProgressCallback callback )
+{
+    MR_TIMER
+    auto text = readAllText( in );
+    if ( !text.has_value() )
+        return tl::make_unexpected( std::move( text.error() ) );
+    return fromOffBuffer( text->data(), text->size(), callback );
+}
+
+tl::expected<Mesh, std::string> fromObj( const std::filesystem::path & file, Vector<Color, VertId>*, ProgressCallback callback )
+{
+    MR_TIMER
+
+    auto objs = fromSceneObjFile( file, true, callback );
+    if ( !objs.has_value() )
+        return tl::make_unexpected( objs.error() );
+    if ( objs->size() != 1 )
+        return tl::make_unexpected( "OBJ-file is empty" );
+
+    return std::move( (*objs)[0].mesh );
 }
 
 tl::expected<Mesh, std::string> fromObj( std::istream& in, Vector<Color, VertId>*, ProgressCallback callback )
@@ -141,8 +315,93 @@ tl::expected<Mesh, std::string> fromObj( std::istream& in, Vector<Color, VertId>
     return std::move( (*objs)[0].mesh );
 }
 
+#pragma pack(push, 1)
+struct StlTriangle
+{
+    Vector3f normal;
+    Vector3f vert[3];
+    std::uint16_t attr;
+};
+#pragma pack(pop)
+static_assert( sizeof( StlTriangle ) == 50, "check your padding" );
+
+// loads binary STL directly from memory buffer, e.g. memory-mapped file
+static tl::expected<Mesh, std::string> fromBinaryStlBuffer( const char* data, size_t size, ProgressCallback callback )
+{
+    MR_TIMER
+
+    if ( size < 84 )
+        return tl::make_unexpected( std::string( "Error reading the number of triangles from STL-file" ) );
+    std::uint32_t numTris;
+    std::memcpy( &numTris, data + 80, 4 );
+    if ( size - 84 < size_t( 50 ) * numTris )
+        return tl::make_unexpected( std::string( "Binary STL-file is too short" ) );
+    const char* trisData = data + 84;
+
+    MeshBuilder::VertexIdentifier vi;
+    vi.reserve( numTris );
+
+    const auto itemsInChunk = std::min( numTris, 32768u );
+    std::vector<MeshBuilder::ThreePoints> chunk( itemsInChunk ), nextChunk( itemsInChunk );
+    // unpacks triangles [first, first + chunk.size()) from the buffer
+    auto unpackChunk = [trisData]( std::vector<MeshBuilder::ThreePoints> & chunk, size_t first )
+    {
+        for ( size_t i = 0; i < chunk.size(); ++i )
+        {
+            StlTriangle tri;
+            std::memcpy( &tri, trisData + ( first + i ) * sizeof( StlTriangle ), sizeof( StlTriangle ) );
+            for ( int j = 0; j < 3; ++j )
+                chunk[i][j] = tri.vert[j];
+        }
+    };
+    unpackChunk( chunk, 0 );
+
+    for ( ;; )
+    {
+        // next chunk is unpacked in parallel with adding current one
+        tbb::task_group taskGroup;
+        bool hasTask = false;
+        const size_t nextFirst = vi.numTris() + chunk.size();
+        if ( nextFirst < numTris )
+        {
+            nextChunk.resize( std::min( numTris - nextFirst, size_t( itemsInChunk ) ) );
+            hasTask = true;
+            taskGroup.run( [&unpackChunk, &nextChunk, nextFirst] ()
+            {
+                unpackChunk( nextChunk, nextFirst );
+            } );
+        }
+
+        vi.addTriangles( chunk );
+
+        if ( !hasTask )
+            break;
+        taskGroup.wait();
+        if ( callback && !callback( float( nextFirst ) / numTris ) )
+            return tl::make_unexpected( std::string( "Loading canceled" ) );
+        chunk.swap( nextChunk );
+    }
+
+    auto t = vi.takeTriangulation();
+    return Mesh::fromTrianglesDuplicatingNonManifoldVertices( vi.takePoints(), t );
+}
+
+static tl::expected<Mesh, std::string> fromASCIIStlBuffer( const char* data, size_t size, ProgressCallback callback );
+
 tl::expected<MR::Mesh, std::string> fromAnyStl( const std::filesystem::path& file, Vector<Color, VertId>*, ProgressCallback callback )
 {
+    if ( auto mapped = MappedFile::open( file ) )
+    {
+        auto resBin = fromBinaryStlBuffer( mapped->data(), mapped->size(), callback );
+        if ( resBin.has_value() || resBin.error() == "Loading canceled" )
+            return addFileNameInError( std::move( resBin ), file );
+        auto resAsc = fromASCIIStlBuffer( mapped->data(), mapped->size(), callback );
+        if ( resAsc.has_value() )
+            return resAsc;
+        return addFileNameInError<Mesh>( tl::make_unexpected( resBin.error() + '\n' + resAsc.error() ), file );
+    }
+
+    // fallback for the files that cannot be mapped
     std::ifstream in( file, std::ifstream::binary );
     if ( !in )
         return tl::make_unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
@@ -166,6 +425,10 @@ tl::expected<MR::Mesh, std::string> fromAnyStl( std::istream& in, Vector<Color,
 
 tl::expected<Mesh, std::string> fromBinaryStl( const std::filesystem::path & file, Vector<Color, VertId>*, ProgressCallback callback )
 {
+    if ( auto mapped = MappedFile::open( file ) )
+        return addFileNameInError( fromBinaryStlBuffer( mapped->data(), mapped->size(), callback ), file );
+
+    // fallback for the files that cannot be mapped
     std::ifstream in( file, std::ifstream::binary );
     if ( !in )
         return tl::make_unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
@@ -195,16 +458,6 @@ tl::expected<Mesh, std::string> fromBinaryStl( std::istream& in, Vector<Color, V
     MeshBuilder::VertexIdentifier vi;
     vi.reserve( numTris );
 
-    #pragma pack(push, 1)
-    struct StlTriangle
-    {
-        Vector3f normal;
-        Vector3f vert[3];
-        std::uint16_t attr;
-    };
-    #pragma pack(pop)
-    static_assert( sizeof( StlTriangle ) == 50, "check your padding" );
-
     const auto itemsInBuffer = std::min( numTris, 32768u );
     std::vector<StlTriangle> buffer( itemsInBuffer ), nextBuffer( itemsInBuffer );
     std::vector<MeshBuilder::ThreePoints> chunk( itemsInBuffer );
@@ -263,90 +516,97 @@ tl::expected<Mesh, std::string> fromBinaryStl( std::istream& in, Vector<Color, V
     return Mesh::fromTrianglesDuplicatingNonManifoldVertices( vi.takePoints(), t );
 }
 
-tl::expected<Mesh, std::string> fromASCIIStl( const std::filesystem::path& file, Vector<Color, VertId>*, ProgressCallback callback )
-{
-    std::ifstream in( file, std::ifstream::binary );
-    if ( !in )
-        return tl::make_unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
-
-    return addFileNameInError( fromASCIIStl( in, nullptr, callback ), file );
-}
-
-tl::expected<Mesh, std::string> fromASCIIStl( std::istream& in, Vector<Color, VertId>*, ProgressCallback callback )
+// loads ASCII STL directly from memory buffer, parsing the chunks of lines in parallel
+static tl::expected<Mesh, std::string> fromASCIIStlBuffer( const char* data, size_t size, ProgressCallback callback )
 {
-    MR_TIMER;
-
-    using HMap = ParallelHashMap<Vector3f, VertId>;
-    HMap hmap;
-    VertCoords points;
-    Triangulation t;
-
-    std::string line;
-    std::string prefix;
-    Vector3f point;
-    ThreeVertIds currTri;
-    int triPos = 0;
-    bool solidFound = false;
-
-    const auto posStart = in.tellg();
-    in.seekg( 0, std::ios_base::end );
-    const auto posEnd = in.tellg();
-    in.seekg( posStart );
-    const float streamSize = float( posEnd - posStart );
+    MR_TIMER
+    const char* end = data + size;
+    const char* p = skipBlanksAndComments( data, end );
+    if ( std::string_view( p, skipToken( p, end ) - p ) != "solid" )
+        return tl::make_unexpected( std::string( "Failed to find 'solid' prefix in ascii STL" ) );
 
-    for ( int i = 0; std::getline( in, line ); ++i )
+    // every facet has exactly three vertices, so the triangles are restored from the sequence of all vertices
+    const auto offsets = splitTextByLines( data, size );
+    const size_t numChunks = offsets.size() - 1;
+    std::vector<std::vector<Vector3f>> chunkVerts( numChunks );
+    std::vector<char> chunkFailed( numChunks, false );
+    auto parseChunk = [&]( size_t i )
     {
-        std::istringstream iss( line );
-        if ( !( iss >> prefix ) )
-            break;
-
-        if ( !solidFound )
-        {
-            if ( prefix == "solid" )
-                solidFound = true;
-            else
-                break;
-        }
-
-        if ( prefix == "outer" )
-        {
-            triPos = 0;
-            continue;
-        }
-        if ( prefix == "vertex" )
+        const char* chunkEnd = data + offsets[i + 1];
+        for ( const char* line = data + offsets[i]; line < chunkEnd; )
         {
+            const char* lineEnd = skipLine( line, chunkEnd );
+            const char* q = skipSpaces( line, lineEnd );
+            line = lineEnd;
+            const char* tokenEnd = skipToken( q, lineEnd );
+            if ( std::string_view( q, tokenEnd - q ) != "vertex" )
+                continue;
             double x, y, z; // double is used to correctly open coordinates like 1e-55 which are under of float-precision
-            if ( !( iss >> x >> y >> z ) )
-                break;
-            point = Vector3f{ Vector3d{ x, y, z } };
-
-            VertId& id = hmap[point];
-            if ( !id.valid() )
+            if ( !( q = parseNumber( tokenEnd, lineEnd, x ) ) || !( q = parseNumber( q, lineEnd, y ) ) || !( q = parseNumber( q, lineEnd, z ) ) )
             {
-                id = VertId( points.size() );
-                points.push_back( point );
+                chunkFailed[i] = true;
+                return;
             }
-            currTri[triPos] = id;
-            ++triPos;
-            continue;
-        }
-        if ( prefix == "endloop" )
-        {
-            t.push_back( currTri );
-            continue;
+            chunkVerts[i].emplace_back( Vector3d{ x, y, z } );
         }
-        if ( callback && !( i & 0x3FF ) )
+    };
+    if ( !parallelForChunks( numChunks, parseChunk, callback ? [&]( float v ) { return callback( v * 0.5f ); } : callback ) )
+        return tl::make_unexpected( std::string( "Loading canceled" ) );
+
+    std::vector<size_t> firstVert( numChunks + 1, 0 );
+    for ( size_t i = 0; i < numChunks; ++i )
+    {
+        if ( chunkFailed[i] )
+            return tl::make_unexpected( std::string( "Error reading vertex coordinates from ascii STL" ) );
+        firstVert[i + 1] = firstVert[i] + chunkVerts[i].size();
+    }
+    if ( firstVert.back() % 3 != 0 )
+        return tl::make_unexpected( std::string( "The number of vertices in ascii STL is not a multiple of 3" ) );
+
+    std::vector<MeshBuilder::ThreePoints> tris( firstVert.back() / 3 );
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, numChunks, 1 ), [&]( const tbb::blocked_range<size_t> & range )
+    {
+        for ( size_t i = range.begin(); i < range.end(); ++i )
         {
-            const float progress = float( in.tellg() - posStart ) / streamSize;
-            if ( !callback( progress ) )
-                return tl::make_unexpected( std::string( "Loading canceled" ) );
+            for ( size_t j = 0; j < chunkVerts[i].size(); ++j )
+            {
+                const auto v = firstVert[i] + j;
+                tris[v / 3][v % 3] = chunkVerts[i][j];
+            }
+            chunkVerts[i] = {};
         }
-    }
+    } );
+    if ( callback && !callback( 0.5f ) )
+        return tl::make_unexpected( std::string( "Loading canceled" ) );
 
-    if ( !solidFound )
-        return tl::make_unexpected( std::string( "Failed to find 'solid' prefix in ascii STL" ) );
+    MeshBuilder::VertexIdentifier vi;
+    vi.reserve( tris.size() );
+    vi.addTriangles( tris );
 
-    return Mesh::fromTrianglesDuplicatingNonManifoldVertices( std::move( points ), t );
+    auto t = vi.takeTriangulation();
+    return Mesh::fromTrianglesDuplicatingNonManifoldVertices( vi.takePoints(), t );
+}
+
+tl::expected<Mesh, std::string> fromASCIIStl( const std::filesystem::path& file, Vector<Color, VertId>*, ProgressCallback callback )
+{
+    if ( auto mapped = MappedFile::open( file ) )
+        return addFileNameInError( fromASCIIStlBuffer( mapped->data(), mapped->size(), callback ), file );
+
+    // fallback for the files that cannot be mapped
+    std::ifstream in( file, std::ifstream::binary );
+    if ( !in )
+        return tl::make_unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
+
+    return addFileNameInError( fromASCIIStl( in, nullptr, callback ), file );
+}
+
+tl::expected<Mesh, std::string> fromASCIIStl( std::istream& in, Vector<Color, VertId>*, ProgressCallback callback )
+{
+    MR_TIMER
+    auto text = readAllText( in );
+    if ( !text.has_value() )
+        return tl::make_unexpected( std::move( text.error() ) );
+    return fromASCIIStlBuffer( text->data(), text->size(), callback );
 }
 
 tl::expected<Mesh, std::string> fromPly( const std::filesystem::path& file, Vector<Color, VertId>* colors, ProgressCallback callback )
@@ -608,6 +868,203 @@ tl::expected<Mesh, std::string> fromAnySupportedFormat( std::istream& in, const
     return loader( in, colors, callback );
 }
 
+tl::expected<void, std::string> streamTrianglesFromBinaryStl( const std::filesystem::path& file, const TrianglesChunkCallback& onChunk,
+                                                              size_t chunkSize, ProgressCallback callback )
+{
+    MR_TIMER
+    std::ifstream in( file, std::ifstream::binary );
+    if ( !in )
+        return tl::make_unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
+
+    char header[80];
+    in.read( header, 80 );
+    std::uint32_t numTris = 0;
+    in.read( (char*)&numTris, 4 );
+    if ( !in )
+        return tl::make_unexpected( std::string( "Error reading the number of triangles from STL-file" ) );
+    std::error_code ec;
+    const auto fileSize = std::filesystem::file_size( file, ec );
+    if ( ec || fileSize < 84 + sizeof( StlTriangle ) * numTris )
+        return tl::make_unexpected( std::string( "Binary STL-file is too short" ) );
+
+    chunkSize = std::clamp( chunkSize, size_t( 1 ), size_t( std::max( numTris, 1u ) ) );
+    std::vector<StlTriangle> buffer( chunkSize );
+    std::vector<MeshBuilder::ThreePoints> triangles( chunkSize );
+    for ( size_t first = 0; first < numTris; first += chunkSize )
+    {
+        const size_t n = std::min( chunkSize, numTris - first );
+        if ( !in.read( (char*)buffer.data(), n * sizeof( StlTriangle ) ) )
+            return tl::make_unexpected( std::string( "Binary STL read error" ) );
+        for ( size_t i = 0; i < n; ++i )
+            for ( int j = 0; j < 3; ++j )
+                triangles[i][j] = buffer[i].vert[j];
+        if ( !onChunk( TrianglesChunk{ triangles.data(), n } ) )
+            return {};
+        if ( callback && !callback( float( first + n ) / numTris ) )
+            return tl::make_unexpected( std::string( "Loading canceled" ) );
+    }
+    return {};
+}
+
+tl::expected<void, std::string> streamTrianglesFromPly( const std::filesystem::path& file, const TrianglesChunkCallback& onChunk,
+                                                        size_t chunkSize, ProgressCallback callback )
+{
+    MR_TIMER
+    using namespace detail;
+    std::ifstream in( file, std::ifstream::binary );
+    if ( !in )
+        return tl::make_unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
+    const auto header = readPlyHeader( in );
+    if ( !header )
+        return tl::make_unexpected( header.error() );
+    if ( header->format == PlyFormat::Ascii )
+        return tl::make_unexpected( std::string( "Only binary PLY can be streamed" ) );
+    const bool swapBytes = header->format == PlyFormat::BinaryBigEndian;
+    const size_t dataStart = size_t( in.tellg() );
+    in.close();
+
+    auto mapped = MappedFile::open( file );
+    if ( !mapped )
+        return tl::make_unexpected( std::move( mapped.error() ) );
+    if ( mapped->size() < dataStart )
+        return tl::make_unexpected( std::string( "PLY file is too short" ) );
+    const char* const end = mapped->data() + mapped->size();
+
+    // find the vertex coordinates and the start of faces
+    const char* vertData = nullptr;
+    size_t numVerts = 0, vertStride = 0;
+    size_t coordOffset[3] = { SIZE_MAX, SIZE_MAX, SIZE_MAX };
+    PlyType coordType[3] = { PlyType::Unknown, PlyType::Unknown, PlyType::Unknown };
+    const char* p = mapped->data() + dataStart;
+    const PlyElement* faceElem = nullptr;
+    for ( const auto& elem : header->elements )
+    {
+        if ( elem.name == "face" )
+        {
+            faceElem = &elem;
+            break;
+        }
+        if ( elem.hasLists() )
+            return tl::make_unexpected( "PLY element " + elem.name + " with lists precedes the faces" );
+        size_t rowSize = 0;
+        for ( const auto& prop : elem.props )
+        {
+            if ( elem.name == "vertex" )
+                for ( int i = 0; i < 3; ++i )
+                    if ( prop.name.size() == 1 && prop.name[0] == 'x' + i )
+                    {
+                        coordOffset[i] = rowSize;
+                        coordType[i] = prop.type;
+                    }
+            rowSize += plyTypeSize( prop.type );
+        }
+        if ( elem.name == "vertex" )
+        {
+            vertData = p;
+            numVerts = elem.count;
+            vertStride = rowSize;
+        }
+        if ( size_t( end - p ) / std::max( rowSize, size_t( 1 ) ) < elem.count )
+            return tl::make_unexpected( std::string( "PLY file is too short" ) );
+        p += rowSize * elem.count;
+    }
+    if ( !vertData || coordOffset[0] == SIZE_MAX || coordOffset[1] == SIZE_MAX || coordOffset[2] == SIZE_MAX )
+        return tl::make_unexpected( std::string( "PLY file has no coordinates of vertices before the faces" ) );
+    if ( !faceElem )
+        return tl::make_unexpected( std::string( "PLY file has no faces" ) );
+    int indicesProp = -1;
+    for ( int i = 0; i < faceElem->props.size(); ++i )
+        if ( faceElem->props[i].isList() && ( indicesProp < 0 || faceElem->props[i].name == "vertex_indices" ) )
+            indicesProp = i;
+    if ( indicesProp < 0 )
+        return tl::make_unexpected( std::string( "PLY faces have no vertex indices" ) );
+    if ( faceElem->props[indicesProp].type == PlyType::Float32 || faceElem->props[indicesProp].type == PlyType::Float64 )
+        return tl::make_unexpected( std::string( "PLY vertex indices are not integer" ) );
+
+    auto vertex = [&]( long long i )
+    {
+        Vector3f res;
+        const char* v = vertData + size_t( i ) * vertStride;
+        for ( int j = 0; j < 3; ++j )
+            res[j] = float( readPlyValue( v + coordOffset[j], coordType[j], swapBytes ) );
+        return res;
+    };
+
+    chunkSize = std::max( chunkSize, size_t( 1 ) );
+    std::vector<MeshBuilder::ThreePoints> triangles;
+    triangles.reserve( chunkSize + 256 );
+    std::vector<long long> face;
+    const auto badFaces = []() { return tl::make_unexpected( std::string( "PLY faces are damaged" ) ); };
+    for ( size_t f = 0; f < faceElem->count; ++f )
+    {
+        for ( int i = 0; i < faceElem->props.size(); ++i )
+        {
+            const auto& prop = faceElem->props[i];
+            const auto size = plyTypeSize( prop.type );
+            if ( !prop.isList() )
+            {
+                if ( size_t( end - p ) < size )
+                    return badFaces();
+                p += size;
+                continue;
+            }
+            const auto countSize = plyTypeSize( prop.countType );
+            if ( size_t( end - p ) < countSize )
+                return badFaces();
+            const auto count = (long long)readPlyValue( p, prop.countType, swapBytes );
+            p += countSize;
+            if ( count < 0 || size_t( end - p ) / size < size_t( count ) )
+                return badFaces();
+            if ( i == indicesProp )
+            {
+                face.resize( count );
+                for ( long long j = 0; j < count; ++j )
+                {
+                    face[j] = (long long)readPlyValue( p + j * size, prop.type, swapBytes );
+                    if ( face[j] < 0 || size_t( face[j] ) >= numVerts )
+                        return tl::make_unexpected( std::string( "PLY face references not existing vertex" ) );
+                }
+            }
+            p += count * size;
+        }
+        for ( size_t j = 2; j < face.size(); ++j )
+            triangles.push_back( { vertex( face[0] ), vertex( face[j - 1] ), vertex( face[j] ) } );
+        face.clear();
+
+        if ( triangles.size() >= chunkSize || f + 1 == faceElem->count )
+        {
+            if ( !triangles.empty() && !onChunk( TrianglesChunk{ triangles.data(), triangles.size() } ) )
+                return {};
+            triangles.clear();
+            if ( callback && !callback( float( f + 1 ) / faceElem->count ) )
+                return tl::make_unexpected( std::string( "Loading canceled" ) );
+        }
+    }
+    return {};
+}
+
+tl::expected<void, std::string> streamTrianglesFromAnySupportedFormat( const std::filesystem::path& file, const TrianglesChunkCallback& onChunk,
+                                                                       size_t chunkSize, ProgressCallback callback )
+{
+    auto ext = utf8string( file.extension() );
+    for ( auto& c : ext )
+        c = (char)tolower( c );
+
+    if ( ext == ".stl" )
+        return streamTrianglesFromBinaryStl( file, onChunk, chunkSize, callback );
+    if ( ext == ".ply" )
+        return streamTrianglesFromPly( file, onChunk, chunkSize, callback );
+    return tl::make_unexpected( std::string( "unsupported file extension for streaming" ) );
+}
+
+TrianglesStream makeTrianglesStream( const std::filesystem::path& file, size_t chunkSize )
+{
+    return [file, chunkSize]( const TrianglesChunkCallback& onChunk )
+    {
+        return streamTrianglesFromAnySupportedFormat( file, onChunk, chunkSize );
+    };
+}
+
 /*
 MeshLoaderAdder __meshLoaderAdder( NamedMeshLoader{IOFilter( "MrMesh (.mrmesh)", "*.mrmesh" ),MeshLoader{static_cast<tl::expected<MR::Mesh, std::string>(*)(const std::filesystem::path&,Vector<Color, VertId>*)>(fromMrmesh)}} );
 */
@@ -623,4 +1080,158 @@ MR_ADD_MESH_LOADER( IOFilter( "Compact triangle-based mesh (.ctm)", "*.ctm" ), f
 
 } //namespace MeshLoad
 
+// compares the meshes loaded from memory-mapped files and from streams
+TEST(MRMesh, MeshLoadMapped)
+{
+    const Mesh torus = makeTorus( 1, 0.3f, 32, 16 );
+    const auto dir = std::filesystem::temp_directory_path();
+    const auto mrmeshPath = dir / "MRMeshLoadMappedTest.mrmesh";
+    const auto stlPath = dir / "MRMeshLoadMappedTest.stl";
+    ASSERT_TRUE( MeshSave::toMrmesh( torus, mrmeshPath ).has_value() );
+    ASSERT_TRUE( MeshSave::toBinaryStl( torus, stlPath ).has_value() );
+
+    auto mappedMrmesh = MeshLoad::fromMrmesh( mrmeshPath );
+    std::ifstream mrmeshIn( mrmeshPath, std::ifstream::binary );
+    auto streamMrmesh = MeshLoad::fromMrmesh( mrmeshIn );
+    auto mappedStl = MeshLoad::fromBinaryStl( stlPath );
+    std::ifstream stlIn( stlPath, std::ifstream::binary );
+    auto streamStl = MeshLoad::fromBinaryStl( stlIn );
+
+    ASSERT_TRUE( mappedMrmesh.has_value() && streamMrmesh.has_value() );
+    EXPECT_TRUE( *mappedMrmesh == torus );
+    EXPECT_TRUE( *mappedMrmesh == *streamMrmesh );
+    ASSERT_TRUE( mappedStl.has_value() && streamStl.has_value() );
+    EXPECT_TRUE( *mappedStl == *streamStl );
+    EXPECT_EQ( mappedStl->topology.numValidFaces(), torus.topology.numValidFaces() );
+    auto anyStl = MeshLoad::fromAnyStl( stlPath );
+    ASSERT_TRUE( anyStl.has_value() );
+    EXPECT_TRUE( *anyStl == *mappedStl );
+
+    mrmeshIn.close();
+    stlIn.close();
+    std::error_code ec;
+    std::filesystem::remove( mrmeshPath, ec );
+    std::filesystem::remove( stlPath, ec );
+}
+
+TEST(MRMesh, MeshLoadText)
+{
+    const Mesh torus = makeTorus( 1, 0.3f, 32, 16 );
+    const auto box = torus.computeBoundingBox();
+    auto checkLoaded = [&]( const tl::expected<Mesh, std::string> & loaded )
+    {
+        ASSERT_TRUE( loaded.has_value() );
+        EXPECT_EQ( loaded->topology.numValidFaces(), torus.topology.numValidFaces() );
+        EXPECT_EQ( loaded->topology.numValidVerts(), torus.topology.numValidVerts() );
+        const auto loadedBox = loaded->computeBoundingBox();
+        EXPECT_LT( ( loadedBox.min - box.min ).length(), 1e-5f );
+        EXPECT_LT( ( loadedBox.max - box.max ).length(), 1e-5f );
+    };
+
+    std::stringstream offStream, objStream, stlStream;
+    ASSERT_TRUE( MeshSave::toOff( torus, offStream ).has_value() );
+    ASSERT_TRUE( MeshSave::toObj( torus, objStream ).has_value() );
+    stlStream << "solid torus\n";
+    for ( auto f : torus.topology.getValidFaces() )
+    {
+        VertId vs[3];
+        torus.topology.getTriVerts( f, vs );
+        stlStream << "facet normal 0 0 0\n outer loop\n";
+        for ( auto v : vs )
+            stlStream << "  vertex " << torus.points[v].x << ' ' << torus.points[v].y << ' ' << torus.points[v].z << '\n';
+        stlStream << " endloop\nendfacet\n";
+    }
+    stlStream << "endsolid torus\n";
+
+    checkLoaded( MeshLoad::fromOff( offStream ) );
+    checkLoaded( MeshLoad::fromObj( objStream ) );
+    checkLoaded( MeshLoad::fromASCIIStl( stlStream ) );
+
+    std::istringstream badOff( "OFF\n3 1 0\n0 0 0\n1 0 0\n0 1 0\n3 0 1 3\n" );
+    EXPECT_FALSE( MeshLoad::fromOff( badOff ).has_value() );
+    std::istringstream badStl( "solid bad\nfacet normal 0 0 1\nouter loop\nvertex 0 0 0\nvertex 1 0 0\nendloop\nendfacet\nendsolid bad\n" );
+    EXPECT_FALSE( MeshLoad::fromASCIIStl( badStl ).has_value() );
+}
+
+// streams the triangles of the mesh saved in binary STL and PLY and compares them with the triangles of the mesh,
+// then streams the triangle from big-endian PLY
+TEST(MRMesh, MeshLoadStreamTriangles)
+{
+    const Mesh torus = makeTorus( 1, 0.3f, 32, 16 );
+    const auto dir = std::filesystem::temp_directory_path();
+    const auto stlPath = dir / "MRMeshLoadStreamTest.stl";
+    const auto plyPath = dir / "MRMeshLoadStreamTest.ply";
+    ASSERT_TRUE( MeshSave::toBinaryStl( torus, stlPath ).has_value() );
+    ASSERT_TRUE( MeshSave::toPly( torus, plyPath ).has_value() );
+
+    std::vector<MeshBuilder::ThreePoints> expected;
+    auto res = trianglesStreamFromMesh( torus )( [&]( const TrianglesChunk& chunk )
+    {
+        expected.insert( expected.end(), chunk.triangles, chunk.triangles + chunk.size );
+        return true;
+    } );
+    ASSERT_TRUE( res.has_value() );
+    ASSERT_EQ( expected.size(), torus.topology.numValidFaces() );
+
+    for ( const auto& path : { stlPath, plyPath } )
+    {
+        std::vector<MeshBuilder::ThreePoints> streamed;
+        res = MeshLoad::makeTrianglesStream( path, 100 )( [&]( const TrianglesChunk& chunk )
+        {
+            EXPECT_LE( chunk.size, 100 );
+            streamed.insert( streamed.end(), chunk.triangles, chunk.triangles + chunk.size );
+            return true;
+        } );
+        ASSERT_TRUE( res.has_value() );
+        ASSERT_EQ( streamed.size(), expected.size() );
+        for ( size_t i = 0; i < streamed.size(); ++i )
+        {
+            // the triangles can start from different vertices
+            int shift = 0;
+            while ( shift < 3 && streamed[i][shift] != expected[i][0] )
+                ++shift;
+            ASSERT_LT( shift, 3 );
+            for ( int j = 0; j < 3; ++j )
+                EXPECT_EQ( streamed[i][( j + shift ) % 3], expected[i][j] );
+        }
+    }
+
+    // big-endian PLY with Windows line endings in the header
+    {
+        std::ofstream out( plyPath, std::ofstream::binary );
+        out << "ply\r\nformat binary_big_endian 1.0\r\nelement vertex 3\r\n"
+            "property float x\r\nproperty float y\r\nproperty float z\r\n"
+            "element face 1\r\nproperty list uchar int vertex_indices\r\nend_header\r\n";
+        auto writeBigEndian = [&]<typename T>( T v )
+        {
+            char buf[sizeof( T )];
+            std::memcpy( buf, &v, sizeof( T ) );
+            std::reverse( buf, buf + sizeof( T ) );
+            out.write( buf, sizeof( T ) );
+        };
+        const Vector3f points[3] = { { 0, 0, 0 }, { 1, 0, 0 }, { 0, 2, 0 } };
+        for ( const auto& pt : points )
+            for ( int i = 0; i < 3; ++i )
+                writeBigEndian( pt[i] );
+        writeBigEndian( std::uint8_t( 3 ) );
+        for ( int i = 0; i < 3; ++i )
+            writeBigEndian( std::int32_t( i ) );
+    }
+    std::vector<MeshBuilder::ThreePoints> streamed;
+    res = MeshLoad::streamTrianglesFromPly( plyPath, [&]( const TrianglesChunk& chunk )
+    {
+        streamed.insert( streamed.end(), chunk.triangles, chunk.triangles + chunk.size );
+        return true;
+    } );
+    ASSERT_TRUE( res.has_value() );
+    ASSERT_EQ( streamed.size(), 1 );
+    EXPECT_EQ( streamed[0][0], Vector3f( 0, 0, 0 ) );
+    EXPECT_EQ( streamed[0][1], Vector3f( 1, 0, 0 ) );
+    EXPECT_EQ( streamed[0][2], Vector3f( 0, 2, 0 ) );
+
+    std::error_code ec;
+    std::filesystem::remove( stlPath, ec );
+    std::filesystem::remove( plyPath, ec );
+}
+
 } //namespace MR
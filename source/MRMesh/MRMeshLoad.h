@@ -4,6 +4,7 @@
 #include "MRIOFilters.h"
 #include "MRId.h"
 #include "MRProgressCallback.h"
+#include "MRTrianglesStream.h"
 #include <tl/expected.hpp>
 #include <filesystem>
 #include <istream>
@@ -19,12 +20,20 @@ namespace MeshLoad
 /// \ingroup IOGroup
 /// \{
 
-/// loads from internal file format
+/// loads from internal file format;
+/// the file is mapped in memory, and the arrays of mesh are filled by bulk copies from it
 MRMESH_API tl::expected<Mesh, std::string> fromMrmesh( const std::filesystem::path& file, Vector<Color, VertId>* colors = nullptr,
                                                        ProgressCallback callback = {} );
 MRMESH_API tl::expected<Mesh, std::string> fromMrmesh( std::istream& in, Vector<Color, VertId>* colors = nullptr,
                                                        ProgressCallback callback = {} );
 
+/// loads from compressed internal file format (.mrcmesh), see MeshSave::toCompressedMrmesh;
+/// the blocks of the file are decoded in parallel threads
+MRMESH_API tl::expected<Mesh, std::string> fromCompressedMrmesh( const std::filesystem::path& file, Vector<Color, VertId>* colors = nullptr,
+                                                                 ProgressCallback callback = {} );
+MRMESH_API tl::expected<Mesh, std::string> fromCompressedMrmesh( std::istream& in, Vector<Color, VertId>* colors = nullptr,
+                                                                 ProgressCallback callback = {} );
+
 /// loads from .off file
 MRMESH_API tl::expected<Mesh, std::string> fromOff( const std::filesystem::path& file, Vector<Color, VertId>* colors = nullptr,
                                                     ProgressCallback callback = {} );
@@ -42,7 +51,8 @@ MRMESH_API tl::expected<Mesh, std::string> fromAnyStl( const std::filesystem::pa
 MRMESH_API tl::expected<Mesh, std::string> fromAnyStl( std::istream& in, Vector<Color, VertId>* colors = nullptr,
                                                        ProgressCallback callback = {} );
 
-/// loads from binary .stl
+/// loads from binary .stl;
+/// the file is mapped in memory, and the triangles are parsed directly from it
 MRMESH_API tl::expected<Mesh, std::string> fromBinaryStl( const std::filesystem::path& file, Vector<Color, VertId>* colors = nullptr,
                                                           ProgressCallback callback = {} );
 MRMESH_API tl::expected<Mesh, std::string> fromBinaryStl( std::istream& in, Vector<Color, VertId>* colors = nullptr,
@@ -75,6 +85,23 @@ MRMESH_API tl::expected<Mesh, std::string> fromAnySupportedFormat( const std::fi
 MRMESH_API tl::expected<Mesh, std::string> fromAnySupportedFormat( std::istream& in, const std::string& extension, Vector<Color, VertId>* colors = nullptr,
                                                                    ProgressCallback callback = {} );
 
+/// reads the triangles from binary .stl file and passes them to onChunk by chunks of given size without loading whole mesh in memory
+MRMESH_API tl::expected<void, std::string> streamTrianglesFromBinaryStl( const std::filesystem::path& file, const TrianglesChunkCallback& onChunk,
+                                                                         size_t chunkSize = DefaultTrianglesChunkSize, ProgressCallback callback = {} );
+
+/// reads the faces from binary (little- or big-endian) .ply file and passes them (polygons are split on triangle fans) to onChunk by chunks of given size;
+/// the file is mapped in memory, and the vertices are read from the mapping by their indices without loading whole mesh in memory;
+/// the elements preceding the faces must not have lists
+MRMESH_API tl::expected<void, std::string> streamTrianglesFromPly( const std::filesystem::path& file, const TrianglesChunkCallback& onChunk,
+                                                                   size_t chunkSize = DefaultTrianglesChunkSize, ProgressCallback callback = {} );
+
+/// detects the format from file extension and streams the triangles from it
+MRMESH_API tl::expected<void, std::string> streamTrianglesFromAnySupportedFormat( const std::filesystem::path& file, const TrianglesChunkCallback& onChunk,
+                                                                                  size_t chunkSize = DefaultTrianglesChunkSize, ProgressCallback callback = {} );
+
+/// returns the stream reading the triangles from given file each time it is started
+[[nodiscard]] MRMESH_API TrianglesStream makeTrianglesStream( const std::filesystem::path& file, size_t chunkSize = DefaultTrianglesChunkSize );
+
 /// \}
 
 } // namespace MeshLoad
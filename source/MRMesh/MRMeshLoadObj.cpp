@@ -1,7 +1,12 @@
 #include "MRMeshLoadObj.h"
 #include "MRStringConvert.h"
 #include "MRMeshBuilder.h"
+#include "MRMappedFile.h"
+#include "MRTextParse.h"
 #include "MRTimer.h"
+#include "MRGTest.h"
+#include "MRPch/MRTBB.h"
+#include <sstream>
 
 namespace MR
 {
@@ -9,10 +14,101 @@ namespace MR
 namespace MeshLoad
 {
 
+namespace
+{
+
+// the records parsed from one chunk of OBJ-file
+struct ObjChunk
+{
+    std::vector<Vector3f> points;
+    Triangulation t;
+    // the corners ( 3 * triangle + corner ) in t referencing the vertices by negative (relative) indices,
+    // which are resolved with respect to the points of this chunk, other corners have absolute indices
+    std::vector<size_t> relativeCorners;
+    // the index of first triangle in t after the object name, and the name
+    std::vector<std::pair<size_t, std::string>> objects;
+    std::string error;
+};
+
+} // anonymous namespace
+
+static void parseObjChunk( const char * begin, const char * end, ObjChunk & chunk )
+{
+    std::vector<int> poly;
+    std::vector<char> polyRelative;
+    for ( const char * line = begin; line < end; )
+    {
+        const char * lineEnd = skipLine( line, end );
+        const char * p = skipSpaces( line, lineEnd );
+        line = lineEnd;
+        if ( p + 1 >= lineEnd || ( p[1] != ' ' && p[1] != '\t' ) )
+            continue; // empty line or unsupported record like 'vn', 'vt'
+
+        if ( *p == 'v' )
+        {
+            double x, y, z; // double is used to correctly open coordinates like 1e-55 which are under of float-precision
+            if ( !( p = parseNumber( p + 1, lineEnd, x ) ) || !( p = parseNumber( p, lineEnd, y ) ) || !( p = parseNumber( p, lineEnd, z ) ) )
+            {
+                chunk.error = "OBJ-format vertex read error";
+                return;
+            }
+            chunk.points.emplace_back( Vector3d{ x, y, z } );
+        }
+        else if ( *p == 'f' )
+        {
+            poly.clear();
+            polyRelative.clear();
+            for ( p = skipSpaces( p + 1, lineEnd ); p < lineEnd && *p != '\n' && *p != '#'; p = skipSpaces( p, lineEnd ) )
+            {
+                int v = 0;
+                if ( !( p = parseNumber( p, lineEnd, v ) ) || v == 0 )
+                {
+                    chunk.error = "OBJ-format face read error";
+                    return;
+                }
+                const bool relative = v < 0;
+                if ( relative )
+                    v += int( chunk.points.size() );
+                else
+                    --v;
+                poly.push_back( v );
+                polyRelative.push_back( relative );
+                // skip texture and normal indices
+                p = skipToken( p, lineEnd );
+            }
+            if ( poly.size() < 3 )
+            {
+                chunk.error = "OBJ-format face read error";
+                return;
+            }
+            // triangulate polygon by a fan
+            for ( size_t i = 2; i < poly.size(); ++i )
+            {
+                const size_t corners[3] = { 0, i - 1, i };
+                for ( int j = 0; j < 3; ++j )
+                    if ( polyRelative[corners[j]] )
+                        chunk.relativeCorners.push_back( 3 * chunk.t.size() + j );
+                chunk.t.push_back( { VertId( poly[0] ), VertId( poly[i - 1] ), VertId( poly[i] ) } );
+            }
+        }
+        else if ( *p == 'o' )
+        {
+            p = skipSpaces( p + 1, lineEnd );
+            const char * nameEnd = lineEnd;
+            while ( nameEnd > p && std::isspace( (unsigned char)nameEnd[-1] ) )
+                --nameEnd;
+            chunk.objects.emplace_back( chunk.t.size(), std::string( p, nameEnd ) );
+        }
+    }
+}
+
 tl::expected<std::vector<NamedMesh>, std::string> fromSceneObjFile( const std::filesystem::path& file, bool combineAllObjects,
                                                                     ProgressCallback callback )
 {
-    std::ifstream in( file );
+    if ( auto mapped = MappedFile::open( file ) )
+        return addFileNameInError( fromSceneObjFile( mapped->data(), mapped->size(), combineAllObjects, callback ), file );
+
+    std::ifstream in( file, std::ifstream::binary );
     if ( !in )
         return tl::make_unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
 
@@ -24,114 +120,170 @@ tl::expected<std::vector<NamedMesh>, std::string> fromSceneObjFile( std::istream
 {
     MR_TIMER
 
-    std::vector<NamedMesh> res;
-    std::string currentObjName;
-    std::vector<Vector3f> points;
-    Triangulation t;
+    std::ostringstream oss;
+    oss << in.rdbuf();
+    if ( !in )
+        return tl::make_unexpected( std::string( "OBJ-format read error" ) );
+    const auto buf = std::move( oss ).str();
+    return fromSceneObjFile( buf.data(), buf.size(), combineAllObjects, callback );
+}
+
+tl::expected<std::vector<NamedMesh>, std::string> fromSceneObjFile( const char* data, size_t size, bool combineAllObjects,
+                                                                    ProgressCallback callback )
+{
+    MR_TIMER
 
-    auto finishObject = [&]() 
+    const auto offsets = splitTextByLines( data, size );
+    const size_t numChunks = offsets.size() - 1;
+    std::vector<ObjChunk> chunks( numChunks );
+    if ( !parallelForChunks( numChunks, [&]( size_t i )
     {
-        if ( !t.empty() )
+        parseObjChunk( data + offsets[i], data + offsets[i + 1], chunks[i] );
+    }, callback ) )
+        return tl::make_unexpected( std::string( "Loading canceled" ) );
+
+    // merge chunks in the order of file
+    std::vector<size_t> pointOffsets( numChunks + 1, 0 ), triOffsets( numChunks + 1, 0 );
+    for ( size_t i = 0; i < numChunks; ++i )
+    {
+        if ( !chunks[i].error.empty() )
+            return tl::make_unexpected( std::move( chunks[i].error ) );
+        pointOffsets[i + 1] = pointOffsets[i] + chunks[i].points.size();
+        triOffsets[i + 1] = triOffsets[i] + chunks[i].t.size();
+    }
+
+    std::vector<Vector3f> points( pointOffsets.back() );
+    Triangulation t( triOffsets.back() );
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, numChunks, 1 ), [&]( const tbb::blocked_range<size_t> & range )
+    {
+        for ( size_t i = range.begin(); i < range.end(); ++i )
         {
-            res.emplace_back();
-            res.back().name = std::move( currentObjName );
+            auto & chunk = chunks[i];
+            for ( auto c : chunk.relativeCorners )
+            {
+                auto & v = chunk.t[FaceId( c / 3 )][c % 3];
+                v = VertId( int( v ) + int( pointOffsets[i] ) );
+            }
+            std::copy( chunk.points.begin(), chunk.points.end(), points.begin() + pointOffsets[i] );
+            std::copy( chunk.t.vec_.begin(), chunk.t.vec_.end(), t.vec_.begin() + triOffsets[i] );
+            chunk.points = {};
+            chunk.t = {};
+        }
+    } );
 
+    std::vector<NamedMesh> res;
+    std::string currentObjName;
+    size_t objBegin = 0;
+    auto finishObject = [&]( size_t objEnd ) -> tl::expected<void, std::string>
+    {
+        if ( objEnd > objBegin )
+        {
             // copy only minimal span of vertices for this object
             VertId minV(INT_MAX), maxV(-1);
-            for ( const auto & vs : t )
+            for ( size_t i = objBegin; i < objEnd; ++i )
             {
+                const auto & vs = t[FaceId( i )];
                 minV = std::min( { minV, vs[0], vs[1], vs[2] } );
                 maxV = std::max( { maxV, vs[0], vs[1], vs[2] } );
             }
-            for ( auto & vs : t )
+            if ( int( minV ) < 0 || int( maxV ) >= int( points.size() ) )
+                return tl::make_unexpected( std::string( "OBJ-format vertex index is out of range" ) );
+            Triangulation objT( t.vec_.begin() + objBegin, t.vec_.begin() + objEnd );
+            for ( auto & vs : objT )
             {
                 for ( int i = 0; i < 3; ++i )
                     vs[i] -= minV;
             }
 
+            res.emplace_back();
+            res.back().name = std::move( currentObjName );
             res.back().mesh = Mesh::fromTrianglesDuplicatingNonManifoldVertices(
-                VertCoords( points.begin() + minV, points.begin() + maxV + 1 ), t );
-            t.clear();
+                VertCoords( points.begin() + minV, points.begin() + maxV + 1 ), objT );
         }
         currentObjName.clear();
+        objBegin = objEnd;
+        return {};
     };
 
-    const auto posStart = in.tellg();
-    in.seekg( 0, std::ios_base::end );
-    const auto posEnd = in.tellg();
-    in.seekg( posStart );
-    const float streamSize = float( posEnd - posStart );
-
-    for ( int i = 0;; ++i )
+    for ( size_t i = 0; i < numChunks; ++i )
     {
-        if ( !in )
-            return tl::make_unexpected( std::string( "OBJ-format read error" ) );
-        char ch = 0;
-        in >> ch;
-        if ( in.eof() )
-            break;
-        if ( ch == 'v' && in.peek() != 'n' )
-        {
-            float x, y, z;
-            in >> x >> y >> z;
-            points.emplace_back( x, y, z );
-        }
-        else if ( ch == 'f' )
-        {
-            auto readVert = [&]()
-            {
-                int v;
-                in >> v;
-                auto s = (char)in.peek();
-                if ( s == '/' )
-                {
-                    (void)in.get();
-                    auto s1 = (char)in.peek();
-                    if ( s1 == '/' )
-                    {
-                        (void)in.get();
-                        int x; //just skip for now
-                        in >> x;
-                    }
-                }
-                return v;
-            };
-
-            int a = readVert();
-            int b = readVert();
-            int c = readVert();
-            t.push_back( { VertId( a-1 ), VertId( b-1 ), VertId( c-1 ) } );
-        }
-        else if ( ch == 'o' )
+        for ( auto & [firstTri, name] : chunks[i].objects )
         {
             if ( !combineAllObjects )
-                finishObject();
-            // next object
-            getline( in, currentObjName );
-            while ( !currentObjName.empty() && currentObjName[0] == ' ' )
-                currentObjName.erase( currentObjName.begin() );
             {
-
+                if ( auto fin = finishObject( triOffsets[i] + firstTri ); !fin )
+                    return tl::make_unexpected( std::move( fin.error() ) );
             }
+            currentObjName = std::move( name );
         }
-        else
-        {
-            // skip unknown line
-            std::string str;
-            std::getline( in, str );
-        }
-        if ( callback && !(i & 0x3FF) )
+    }
+    if ( auto fin = finishObject( t.size() ); !fin )
+        return tl::make_unexpected( std::move( fin.error() ) );
+    return res;
+}
+
+TEST(MRMesh, LoadObj)
+{
+    const std::string text =
+        "# comment\n"
+        "o first\n"
+        "v 0 0 0\n"
+        "v 1 0 0\r\n"
+        "v 1 1 0\n"
+        "v 0 1 0\n"
+        "vn 0 0 1\n"
+        "f 1//1 2//1 3//1 4//1\n"
+        "o second\n"
+        "v 0 0 1\n"
+        "v 1 0 1\n"
+        "v 1 1 1e-55\n"
+        "f -3/1/1 -2/2/1 -1/3/1\n";
+    std::istringstream in( text );
+    auto objs = fromSceneObjFile( in, false );
+    ASSERT_TRUE( objs.has_value() );
+    ASSERT_EQ( objs->size(), 2 );
+    EXPECT_EQ( (*objs)[0].name, "first" );
+    EXPECT_EQ( (*objs)[0].mesh.topology.numValidFaces(), 2 );
+    EXPECT_EQ( (*objs)[0].mesh.topology.numValidVerts(), 4 );
+    EXPECT_EQ( (*objs)[1].name, "second" );
+    EXPECT_EQ( (*objs)[1].mesh.topology.numValidFaces(), 1 );
+    EXPECT_EQ( (*objs)[1].mesh.points.back(), Vector3f( 1, 1, 0 ) );
+
+    objs = fromSceneObjFile( text.data(), text.size(), true );
+    ASSERT_TRUE( objs.has_value() );
+    ASSERT_EQ( objs->size(), 1 );
+    EXPECT_EQ( (*objs)[0].name, "second" );
+    EXPECT_EQ( (*objs)[0].mesh.topology.numValidFaces(), 3 );
+
+    const std::string bad = "v 0 0 0\nf 1 2 3\n";
+    EXPECT_FALSE( fromSceneObjFile( bad.data(), bad.size(), true ).has_value() );
+}
+
+TEST(MRMesh, LoadObjMixedIndices)
+{
+    // a strip of unit squares, each face mixes absolute indices of previous vertices and relative indices of new ones,
+    // and the file is long enough to be parsed in several chunks
+    constexpr int N = 50000;
+    std::string text;
+    for ( int i = 0; i < N; ++i )
+    {
+        text += "v " + std::to_string( i ) + " 0 0\nv " + std::to_string( i ) + " 1 0\n";
+        if ( i > 0 )
         {
-            const float progress = int( in.tellg() - posStart ) / streamSize;
-            if ( !callback( progress ) )
-                return tl::make_unexpected( std::string( "Loading canceled" ));
+            text += "f " + std::to_string( 2 * i - 1 ) + " -2 -1\n";
+            text += "f " + std::to_string( 2 * i - 1 ) + " -1 " + std::to_string( 2 * i ) + "\n";
         }
-        if ( in.eof() )
-            break;
     }
+    ASSERT_GT( splitTextByLines( text.data(), text.size() ).size(), 3 );
 
-    finishObject();
-    return res;
+    auto objs = fromSceneObjFile( text.data(), text.size(), true );
+    ASSERT_TRUE( objs.has_value() ) << objs.error();
+    ASSERT_EQ( objs->size(), 1 );
+    const auto & mesh = (*objs)[0].mesh;
+    EXPECT_EQ( mesh.topology.numValidFaces(), 2 * ( N - 1 ) );
+    EXPECT_EQ( mesh.topology.numValidVerts(), 2 * N );
+    for ( auto f : mesh.topology.getValidFaces() )
+        EXPECT_NEAR( mesh.dblArea( f ), 1.0f, 1e-3f );
 }
 
 } //namespace MeshLoad
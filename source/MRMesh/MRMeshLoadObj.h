@@ -27,6 +27,10 @@ MRMESH_API tl::expected<std::vector<NamedMesh>, std::string> fromSceneObjFile( c
                                                                                ProgressCallback callback = {} );
 MRMESH_API tl::expected<std::vector<NamedMesh>, std::string> fromSceneObjFile( std::istream& in, bool combineAllObjects,
                                                                                ProgressCallback callback = {} );
+/// loads scene from obj file content in memory buffer;
+/// the buffer is split on chunks at line boundaries, which are parsed in parallel threads
+MRMESH_API tl::expected<std::vector<NamedMesh>, std::string> fromSceneObjFile( const char* data, size_t size, bool combineAllObjects,
+                                                                               ProgressCallback callback = {} );
 
 /// \}
 
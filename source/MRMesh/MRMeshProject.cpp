@@ -1,13 +1,98 @@
 #include "MRMeshProject.h"
 #include "MRAABBTree.h"
+#include "MRWideAABBTree.h"
 #include "MRMesh.h"
 #include "MRClosestPointInTriangle.h"
 
 namespace MR
 {
 
-MeshProjectionResult findProjection( const Vector3f & pt, const MeshPart & mp, float upDistLimitSq, const AffineXf3f * xf, float loDistLimitSq )
+// the same as findProjection but traverses the wide tree computing the distances to all children boxes of a node at once
+static MeshProjectionResult findProjectionWide( const Vector3f & pt, const MeshPart & mp, const WideAABBTree & tree, float upDistLimitSq, float loDistLimitSq )
 {
+    MeshProjectionResult res;
+    res.distSq = upDistLimitSq;
+    if ( tree.nodes().empty() )
+    {
+        assert( false );
+        return res;
+    }
+
+    struct SubTask
+    {
+        WideAABBTree::NodeId n;
+        float distSq = 0;
+    };
+
+    constexpr int MaxStackSize = 128; // to avoid allocations
+    SubTask subtasks[MaxStackSize];
+    int stackSize = 0;
+    subtasks[stackSize++] = { tree.rootNodeId(), 0.0f };
+
+    while( stackSize > 0 )
+    {
+        const auto s = subtasks[--stackSize];
+        if ( s.distSq >= res.distSq )
+            continue;
+
+        const auto & node = tree[s.n];
+        float childDistSq[WideAABBTree::Width];
+        distSqToChildren( node, pt, childDistSq );
+
+        // not-leaf children to visit, sorted in decreasing order of distance
+        SubTask toVisit[WideAABBTree::Width];
+        int numToVisit = 0;
+        bool stop = false;
+        for ( int i = 0; i < WideAABBTree::Width && !node.empty( i ); ++i )
+        {
+            if ( !( childDistSq[i] < res.distSq ) )
+                continue;
+            if ( !node.leaf( i ) )
+            {
+                int j = numToVisit++;
+                for ( ; j > 0 && toVisit[j - 1].distSq < childDistSq[i]; --j )
+                    toVisit[j] = toVisit[j - 1];
+                toVisit[j] = { node.child( i ), childDistSq[i] };
+                continue;
+            }
+            const auto face = node.leafId( i );
+            if ( mp.region && !mp.region->test( face ) )
+                continue;
+            Vector3f a, b, c;
+            mp.mesh.getTriPoints( face, a, b, c );
+            auto [proj, bary] = closestPointInTriangle( pt, a, b, c );
+
+            float distSq = ( proj - pt ).lengthSq();
+            if ( distSq < res.distSq )
+            {
+                res.distSq = distSq;
+                res.proj.point = proj;
+                res.proj.face = face;
+                res.mtp = MeshTriPoint{ mp.mesh.topology.edgeWithLeft( face ), bary };
+                if ( distSq <= loDistLimitSq )
+                {
+                    stop = true;
+                    break;
+                }
+            }
+        }
+        if ( stop )
+            break;
+        for ( int j = 0; j < numToVisit; ++j )
+        {
+            assert( stackSize < MaxStackSize );
+            subtasks[stackSize++] = toVisit[j];
+        }
+    }
+
+    return res;
+}
+
+MeshProjectionResult findProjection( const Vector3f & pt, const MeshPart & mp, float upDistLimitSq, const AffineXf3f * xf, float loDistLimitSq, bool useWideTree )
+{
+    if ( useWideTree && !xf )
+        return findProjectionWide( pt, mp, mp.mesh.getWideAABBTree(), upDistLimitSq, loDistLimitSq );
+
     const AABBTree & tree = mp.mesh.getAABBTree();
 
     MeshProjectionResult res;
@@ -27,11 +27,13 @@ struct MeshProjectionResult
  * \param upDistLimitSq upper limit on the distance in question, if the real distance is larger than the function exits returning upDistLimitSq and no valid point
  * \param xf mesh-to-point transformation, if not specified then identity transformation is assumed
  * \param loDistLimitSq low limit on the distance in question, if a point is found within this distance then it is immediately returned without searching for a closer one
+ * \param useWideTree if true and xf is not given, then Mesh::getWideAABBTree() (created if necessary) is traversed instead of binary AABB tree
  */
 MRMESH_API MeshProjectionResult findProjection( const Vector3f & pt, const MeshPart & mp,
     float upDistLimitSq = FLT_MAX,
     const AffineXf3f * xf = nullptr,
-    float loDistLimitSq = 0 );
+    float loDistLimitSq = 0,
+    bool useWideTree = false );
 
 struct SignedDistanceToMeshResult
 {
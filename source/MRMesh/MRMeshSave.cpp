@@ -18,6 +18,7 @@ namespace MeshSave
 const IOFilters Filters =
 {
     {"MrMesh (.mrmesh)",  "*.mrmesh"},
+    {"Compressed MrMesh (.mrcmesh)", "*.mrcmesh"},
     {"Binary STL (.stl)", "*.stl"},
     {"OFF (.off)",        "*.off"},
     {"OBJ (.obj)",        "*.obj"},
@@ -482,6 +483,8 @@ tl::expected<void, std::string> toAnySupportedFormat( const Mesh& mesh, const st
 #endif
     else if ( ext == ".mrmesh" )
         res = MR::MeshSave::toMrmesh( mesh, file, callback );
+    else if ( ext == ".mrcmesh" )
+        res = MR::MeshSave::toCompressedMrmesh( mesh, file, {}, callback );
     return res;
 }
 
@@ -507,6 +510,8 @@ tl::expected<void, std::string> toAnySupportedFormat( const Mesh& mesh, std::ost
 #endif
     else if ( ext == ".mrmesh" )
         res = MR::MeshSave::toMrmesh( mesh, out, callback );
+    else if ( ext == ".mrcmesh" )
+        res = MR::MeshSave::toCompressedMrmesh( mesh, out, {}, callback );
     return res;
 }
 
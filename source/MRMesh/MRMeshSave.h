@@ -51,6 +51,23 @@ MRMESH_API tl::expected<void, std::string> toPly( const Mesh& mesh, const std::f
 MRMESH_API tl::expected<void, std::string> toPly( const Mesh & mesh, std::ostream & out, const Vector<Color, VertId>* colors = nullptr,
                                                   ProgressCallback callback = {} );
 
+struct CompressedMrmeshSaveOptions
+{
+    /// the number of bits in quantized vertex coordinates, in [1, 31];
+    /// each coordinate is rounded to one of 2^positionBits values uniformly distributed in the bounding box of the mesh
+    int positionBits = 21;
+    /// the number of vertices or triangles in one block of the file, the blocks are encoded and decoded independently in parallel
+    int blockSize = 1 << 16;
+};
+
+/// saves in compressed internal file format (.mrcmesh): an indexed triangle list with quantized positions and varint-coded deltas;
+/// the blocks are encoded in parallel threads and written to the stream as soon as they are ready;
+/// the vertices are saved in the order of their first reference from valid faces
+MRMESH_API tl::expected<void, std::string> toCompressedMrmesh( const Mesh & mesh, const std::filesystem::path & file,
+                                                               const CompressedMrmeshSaveOptions & options = {}, ProgressCallback callback = {} );
+MRMESH_API tl::expected<void, std::string> toCompressedMrmesh( const Mesh & mesh, std::ostream & out,
+                                                               const CompressedMrmeshSaveOptions & options = {}, ProgressCallback callback = {} );
+
 struct CtmSaveOptions
 {
     enum class MeshCompression
@@ -3,10 +3,12 @@
 #include "MRRegionBoundary.h"
 #include "MREdgeIterator.h"
 #include "MREdgePaths.h"
+#include "MRBitSetParallelFor.h"
 #include "MRphmap.h"
 #include "MRTimer.h"
 #include "MRPch/MRTBB.h"
 #include "MRProgressReadWrite.h"
+#include <cstring>
 
 namespace MR
 {
@@ -778,6 +780,72 @@ EdgeId MeshTopology::splitEdge( EdgeId e, FaceBitSet * region )
     return e0;
 }
 
+EdgeId MeshTopology::splitEdgeBeforeComputeValids( EdgeId e, EdgeId e0, EdgeId el, EdgeId er, FaceId fl, FaceId fr, VertId newv )
+{
+    assert( isLoneEdge( e0 ) );
+    FaceId l = left( e );
+    if ( l.valid() )
+    {
+        assert( isLeftTri( e ) );
+        setLeft_( e, FaceId{} );
+    }
+    FaceId r = right( e );
+    if ( r.valid() )
+    {
+        assert( isLeftTri( e.sym() ) );
+        setLeft_( e.sym(), FaceId{} );
+    }
+
+    // disconnect edge e from its origin
+    EdgeId ePrev = prev( e );
+    VertId v0;
+    if ( ePrev != e )
+    {
+        splice( ePrev, e );
+    }
+    else
+    {
+        v0 = org( e );
+        setOrgBeforeComputeValids( e, {} );
+    }
+
+    // e now becomes the second part of split edge, add first part to it
+    assert( !org(e) );
+    splice( e, e0.sym() );
+    if ( ePrev != e )
+        splice( ePrev, e0 );
+    else
+        setOrgBeforeComputeValids( e0, v0 );
+
+    // subdivide left and right triangles
+    EdgeId eSymPrev = prev( e.sym() );
+    if ( l.valid() && e.sym() != eSymPrev )
+    {
+        assert( isLoneEdge( el ) );
+        splice( e, el );
+        splice( prev( eSymPrev.sym() ), el.sym() );
+        setLeftBeforeComputeValids( el, fl );
+    }
+    if ( r.valid() && ePrev != e )
+    {
+        assert( isLoneEdge( er ) );
+        splice( e0.sym(), er );
+        splice( prev( ePrev.sym() ), er.sym() );
+        setLeftBeforeComputeValids( er.sym(), fr );
+    }
+
+    setLeft_( e, l );
+    setLeft_( e.sym(), r );
+
+    if ( l.valid() )
+        edgePerFace_[l] = e;
+    if ( r.valid() )
+        edgePerFace_[r] = e.sym();
+
+    setOrgBeforeComputeValids( e, newv );
+    return e0;
+}
+
 VertId MeshTopology::splitFace( FaceId f, FaceBitSet * region )
 {
     assert( !region || region->test( f ) );
@@ -1035,21 +1103,60 @@ void MeshTopology::computeValidsFromEdges()
 {
     MR_TIMER
 
-    numValidVerts_ = 0;
-    for ( VertId v{0}; v < edgePerVertex_.size(); ++v )
+    // bits of the elements deleted before the call are reset as well
+    validVerts_.clear();
+    validVerts_.resize( edgePerVertex_.size() );
+    BitSetParallelForAll( validVerts_, [&]( VertId v )
+    {
         if ( edgePerVertex_[v].valid() )
-        {
             validVerts_.set( v );
-            ++numValidVerts_;
-        }
+    } );
+    numValidVerts_ = (int)validVerts_.count();
 
-    numValidFaces_ = 0;
-    for ( FaceId f{0}; f < edgePerFace_.size(); ++f )
+    validFaces_.clear();
+    validFaces_.resize( edgePerFace_.size() );
+    BitSetParallelForAll( validFaces_, [&]( FaceId f )
+    {
         if ( edgePerFace_[f].valid() )
-        {
             validFaces_.set( f );
-            ++numValidFaces_;
-        }
+    } );
+    numValidFaces_ = (int)validFaces_.count();
+}
+
+void MeshTopology::setLeftBeforeComputeValids( EdgeId a, FaceId f )
+{
+    auto oldF = left( a );
+    if ( f == oldF )
+        return;
+    setLeft_( a, f );
+    if ( oldF.valid() )
+    {
+        assert( edgePerFace_[oldF].valid() );
+        edgePerFace_[oldF] = EdgeId();
+    }
+    if ( f.valid() )
+    {
+        assert( f < edgePerFace_.size() && !edgePerFace_[f].valid() );
+        edgePerFace_[f] = a;
+    }
+}
+
+void MeshTopology::setOrgBeforeComputeValids( EdgeId a, VertId v )
+{
+    auto oldV = org( a );
+    if ( v == oldV )
+        return;
+    setOrg_( a, v );
+    if ( oldV.valid() )
+    {
+        assert( edgePerVertex_[oldV].valid() );
+        edgePerVertex_[oldV] = EdgeId();
+    }
+    if ( v.valid() )
+    {
+        assert( v < edgePerVertex_.size() && !edgePerVertex_[v].valid() );
+        edgePerVertex_[v] = a;
+    }
 }
 
 void MeshTopology::computeAllFromEdges_()
@@ -1359,6 +1466,48 @@ void MeshTopology::pack( FaceMap * outFmap, VertMap * outVmap, WholeEdgeMap * ou
     *this = std::move( packed );
 }
 
+void MeshTopology::pack( const FaceMap & fmap, const VertMap & vmap, const WholeEdgeMap & emap )
+{
+    MR_TIMER
+
+    MeshTopology packed;
+    size_t numEdges = 0;
+    for ( const auto & e : emap )
+        if ( e.valid() )
+            ++numEdges;
+    packed.edges_.resize( 2 * numEdges );
+    tbb::parallel_for( tbb::blocked_range( 0_ue, UndirectedEdgeId( emap.size() ) ),
+        [&]( const tbb::blocked_range<UndirectedEdgeId> & range )
+    {
+        for ( UndirectedEdgeId ue = range.begin(); ue < range.end(); ++ue )
+        {
+            const auto ne = emap[ue];
+            if ( !ne.valid() )
+                continue;
+            assert( ne.even() );
+            auto & r = packed.edges_[ne];
+            auto & rsym = packed.edges_[ne.sym()];
+            r = edges_[EdgeId( ue )];
+            rsym = edges_[EdgeId( ue ).sym()];
+            translate_( r, rsym, fmap, vmap, emap, false );
+        }
+    } );
+
+    packed.edgePerVertex_.resize( numValidVerts_ );
+    for ( auto v : validVerts_ )
+        packed.edgePerVertex_[vmap[v]] = mapEdge( emap, edgePerVertex_[v] );
+    packed.validVerts_.resize( numValidVerts_, true );
+    packed.numValidVerts_ = numValidVerts_;
+
+    packed.edgePerFace_.resize( numValidFaces_ );
+    for ( auto f : validFaces_ )
+        packed.edgePerFace_[fmap[f]] = mapEdge( emap, edgePerFace_[f] );
+    packed.validFaces_.resize( numValidFaces_, true );
+    packed.numValidFaces_ = numValidFaces_;
+
+    *this = std::move( packed );
+}
+
 void MeshTopology::write( std::ostream & s ) const
 {
     // write edges
@@ -1437,6 +1586,68 @@ tl::expected<void, std::string> MeshTopology::read( std::istream & s, ProgressCa
     return {};
 }
 
+tl::expected<size_t, std::string> MeshTopology::read( const char * data, size_t size, ProgressCallback callback )
+{
+    MR_TIMER
+    size_t pos = 0;
+    // reads the number of elements and checks that the buffer contains all of them
+    auto readNum = [&]( std::uint32_t & num, size_t elemSize )
+    {
+        if ( size - pos < 4 )
+            return false;
+        std::memcpy( &num, data + pos, 4 );
+        pos += 4;
+        return size - pos >= num * elemSize;
+    };
+
+    // read edges
+    std::uint32_t numEdges;
+    if ( !readNum( numEdges, sizeof( HalfEdgeRecord ) ) )
+        return tl::make_unexpected( std::string( "Buffer reading error: buffer is too short" ) );
+    edges_.resize( numEdges );
+    if ( !copyByBlocks( ( char* )edges_.data(), data + pos, edges_.size() * sizeof( HalfEdgeRecord ),
+        callback ? [callback] ( float v )
+    {
+        return callback( v / 3.f );
+    } : callback ) )
+        return tl::make_unexpected( std::string( "Loading canceled" ) );
+    pos += edges_.size() * sizeof( HalfEdgeRecord );
+
+    // read verts
+    std::uint32_t numVerts;
+    if ( !readNum( numVerts, sizeof( EdgeId ) ) )
+        return tl::make_unexpected( std::string( "Buffer reading error: buffer is too short" ) );
+    edgePerVertex_.resize( numVerts );
+    validVerts_.resize( numVerts );
+    if ( !copyByBlocks( (char*)edgePerVertex_.data(), data + pos, edgePerVertex_.size() * sizeof( EdgeId ),
+        callback ? [callback] ( float v )
+    {
+        return callback( ( 1.f + v ) / 3.f );
+    } : callback ) )
+        return tl::make_unexpected( std::string( "Loading canceled" ) );
+    pos += edgePerVertex_.size() * sizeof( EdgeId );
+
+    // read faces
+    std::uint32_t numFaces;
+    if ( !readNum( numFaces, sizeof( EdgeId ) ) )
+        return tl::make_unexpected( std::string( "Buffer reading error: buffer is too short" ) );
+    edgePerFace_.resize( numFaces );
+    validFaces_.resize( numFaces );
+    if ( !copyByBlocks( (char*)edgePerFace_.data(), data + pos, edgePerFace_.size() * sizeof( EdgeId ),
+        callback ? [callback] ( float v )
+    {
+        return callback( ( 2.f + v ) / 3.f );
+    } : callback ) )
+        return tl::make_unexpected( std::string( "Loading canceled" ) );
+    pos += edgePerFace_.size() * sizeof( EdgeId );
+
+    computeValidsFromEdges();
+
+    if ( !checkValidity() )
+        return tl::make_unexpected( std::string( "Data is invalid" ) );
+    return pos;
+}
+
 #define CHECK(x) { assert(x); if (!(x)) return false; }
 
 bool MeshTopology::checkValidity() const
@@ -216,6 +216,12 @@ public:
     /// \details left and right faces of given edge if valid are also subdivided on two parts each;
     /// if left or right faces of the original edge were in the region, then include new parts of these faces in the region
     MRMESH_API EdgeId splitEdge( EdgeId e, FaceBitSet * region = nullptr );
+    /// the same as splitEdge, but instead of allocating new elements uses given lone edges (e0, el, er) and unused ids (fl, fr, newv),
+    /// which shall be reserved in advance by makeEdge, faceResize and vertResize; el and fl are used only if left( e ) is valid, er and fr - if right( e ) is valid;
+    /// updates edgePerVertex_ and edgePerFace_ tables, but not validVerts_, validFaces_ and their counts,
+    /// so it can be called in parallel for edges without common vertices in their left and right triangles;
+    /// computeValidsFromEdges() must be called after all such calls
+    MRMESH_API EdgeId splitEdgeBeforeComputeValids( EdgeId e, EdgeId e0, EdgeId el, EdgeId er, FaceId fl, FaceId fr, VertId newv );
 
     /// split given triangle on three triangles, introducing new vertex (which is returned) inside original triangle and connecting it to its vertices
     /// \details if region is given, then it must include (f) and new faces will be added there as well
@@ -248,12 +254,20 @@ public:
     /// \param rearrangeTriangles if true then calls rotateTriangles() 
     /// and selects the order of triangles according to the order of their vertices
     MRMESH_API void pack( FaceMap * outFmap = nullptr, VertMap * outVmap = nullptr, WholeEdgeMap * outEmap = nullptr, bool rearrangeTriangles = false );
+    /// tightly packs all arrays placing the elements in the order given by the maps: old.id -> new.id;
+    /// the maps must be defined for all valid faces, verts and not-lone edges, and be bijections on [0, number of valid elements);
+    /// edges must be mapped on even edge ids (without orientation change)
+    MRMESH_API void pack( const FaceMap & fmap, const VertMap & vmap, const WholeEdgeMap & emap );
 
     /// saves in binary stream
     MRMESH_API void write( std::ostream & s ) const;
     /// loads from binary stream
     /// \return text of error if any
     MRMESH_API tl::expected<void, std::string> read( std::istream& s, ProgressCallback callback = {} );
+    /// loads from memory buffer in the same format as written by write( std::ostream & ), e.g. from memory-mapped file;
+    /// each array is filled by single bulk copy
+    /// \return the number of bytes consumed from the buffer or text of error
+    MRMESH_API tl::expected<size_t, std::string> read( const char * data, size_t size, ProgressCallback callback = {} );
 
     /// compare that two topologies are exactly the same
     [[nodiscard]] MRMESH_API bool operator ==( const MeshTopology & b ) const;
@@ -270,6 +284,12 @@ public:
     /// 1) numValidVerts_ and validVerts_ from edgePerVertex_
     /// 2) numValidFaces_ and validFaces_ from edgePerFace_
     MRMESH_API void computeValidsFromEdges();
+    /// sets new left face (or invalid id to delete the face) to the full left ring including this edge and updates edgePerFace_ table, but not validFaces_ and numValidFaces_,
+    /// so it can be called in parallel for distinct faces; computeValidsFromEdges() must be called after all such calls
+    MRMESH_API void setLeftBeforeComputeValids( EdgeId a, FaceId f );
+    /// sets new origin (or invalid id to delete the vertex) to the full origin ring including this edge and updates edgePerVertex_ table, but not validVerts_ and numValidVerts_,
+    /// so it can be called in parallel for distinct vertices; computeValidsFromEdges() must be called after all such calls
+    MRMESH_API void setOrgBeforeComputeValids( EdgeId a, VertId v );
 
     /// verifies that all internal data structures are valid
     MRMESH_API bool checkValidity() const;
@@ -416,7 +416,7 @@ void ObjectMeshHolder::setDirtyFlags( uint32_t mask )
         worldBox_.get().reset();
         totalArea_.reset();
         if ( mesh_ )
-            mesh_->invalidateCaches();
+            mesh_->invalidateCaches( !( mask & DIRTY_FACE ) );
     }
 }
 
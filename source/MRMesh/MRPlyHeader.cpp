@@ -0,0 +1,241 @@
+#include "MRPlyHeader.h"
+#include "MRGTest.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <sstream>
+
+namespace MR
+{
+
+namespace detail
+{
+
+static PlyType parsePlyType( const std::string& s )
+{
+    if ( s == "char" || s == "int8" )
+        return PlyType::Int8;
+    if ( s == "uchar" || s == "uint8" )
+        return PlyType::UInt8;
+    if ( s == "short" || s == "int16" )
+        return PlyType::Int16;
+    if ( s == "ushort" || s == "uint16" )
+        return PlyType::UInt16;
+    if ( s == "int" || s == "int32" )
+        return PlyType::Int32;
+    if ( s == "uint" || s == "uint32" )
+        return PlyType::UInt32;
+    if ( s == "float" || s == "float32" )
+        return PlyType::Float32;
+    if ( s == "double" || s == "float64" )
+        return PlyType::Float64;
+    return PlyType::Unknown;
+}
+
+size_t plyTypeSize( PlyType t )
+{
+    switch ( t )
+    {
+    case PlyType::Int8:
+    case PlyType::UInt8:
+        return 1;
+    case PlyType::Int16:
+    case PlyType::UInt16:
+        return 2;
+    case PlyType::Int32:
+    case PlyType::UInt32:
+    case PlyType::Float32:
+        return 4;
+    case PlyType::Float64:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+template <typename T>
+static double readPlyValueAs( const char* p, bool swapBytes )
+{
+    char buf[sizeof( T )];
+    std::memcpy( buf, p, sizeof( T ) );
+    if ( swapBytes )
+        std::reverse( buf, buf + sizeof( T ) );
+    T res;
+    std::memcpy( &res, buf, sizeof( T ) );
+    return double( res );
+}
+
+double readPlyValue( const char* p, PlyType t, bool swapBytes )
+{
+    switch ( t )
+    {
+    case PlyType::Int8:
+        return readPlyValueAs<int8_t>( p, false );
+    case PlyType::UInt8:
+        return readPlyValueAs<uint8_t>( p, false );
+    case PlyType::Int16:
+        return readPlyValueAs<int16_t>( p, swapBytes );
+    case PlyType::UInt16:
+        return readPlyValueAs<uint16_t>( p, swapBytes );
+    case PlyType::Int32:
+        return readPlyValueAs<int32_t>( p, swapBytes );
+    case PlyType::UInt32:
+        return readPlyValueAs<uint32_t>( p, swapBytes );
+    case PlyType::Float32:
+        return readPlyValueAs<float>( p, swapBytes );
+    case PlyType::Float64:
+        return readPlyValueAs<double>( p, swapBytes );
+    default:
+        return 0;
+    }
+}
+
+int PlyElement::find( const char* n ) const
+{
+    for ( int i = 0; i < props.size(); ++i )
+        if ( props[i].name == n )
+            return i;
+    return -1;
+}
+
+bool PlyElement::hasLists() const
+{
+    return std::any_of( props.begin(), props.end(), []( const PlyProperty& prop ) { return prop.isList(); } );
+}
+
+size_t PlyElement::rowSize() const
+{
+    assert( !hasLists() );
+    size_t res = 0;
+    for ( const auto& prop : props )
+        res += plyTypeSize( prop.type );
+    return res;
+}
+
+int PlyHeader::find( const char* n ) const
+{
+    for ( int i = 0; i < elements.size(); ++i )
+        if ( elements[i].name == n )
+            return i;
+    return -1;
+}
+
+// reads one header line without the new line symbols,
+// returns false on the end of stream or if the line is too long to be a part of the header
+static bool readHeaderLine( std::istream& in, std::string& line )
+{
+    constexpr size_t MaxLineLength = 4096;
+    line.clear();
+    for ( int c = in.get(); c != std::char_traits<char>::eof(); c = in.get() )
+    {
+        if ( c == '\n' )
+        {
+            if ( !line.empty() && line.back() == '\r' )
+                line.pop_back();
+            return true;
+        }
+        if ( line.size() >= MaxLineLength )
+            return false;
+        line.push_back( char( c ) );
+    }
+    return false;
+}
+
+tl::expected<PlyHeader, std::string> readPlyHeader( std::istream& in )
+{
+    PlyHeader res;
+    std::string line;
+    if ( !readHeaderLine( in, line ) || line.rfind( "ply", 0 ) != 0 )
+        return tl::make_unexpected( std::string( "PLY header is not found" ) );
+    for ( ;; )
+    {
+        if ( !readHeaderLine( in, line ) )
+            return tl::make_unexpected( std::string( "PLY header is damaged" ) );
+        std::istringstream ls( line );
+        std::string keyword;
+        ls >> keyword;
+        if ( keyword == "end_header" )
+            return res;
+        if ( keyword.empty() || keyword == "comment" || keyword == "obj_info" )
+            continue;
+        if ( keyword == "format" )
+        {
+            std::string f;
+            ls >> f;
+            if ( f == "ascii" )
+                res.format = PlyFormat::Ascii;
+            else if ( f == "binary_little_endian" )
+                res.format = PlyFormat::BinaryLittleEndian;
+            else if ( f == "binary_big_endian" )
+                res.format = PlyFormat::BinaryBigEndian;
+            else
+                return tl::make_unexpected( "Unknown PLY format " + f );
+        }
+        else if ( keyword == "element" )
+        {
+            PlyElement elem;
+            if ( !( ls >> elem.name >> elem.count ) )
+                return tl::make_unexpected( "PLY header is damaged: " + line );
+            res.elements.push_back( std::move( elem ) );
+        }
+        else if ( keyword == "property" && !res.elements.empty() )
+        {
+            PlyProperty prop;
+            std::string type;
+            ls >> type;
+            if ( type == "list" )
+            {
+                std::string countType;
+                ls >> countType >> type;
+                prop.countType = parsePlyType( countType );
+                if ( prop.countType == PlyType::Unknown || prop.countType == PlyType::Float32 || prop.countType == PlyType::Float64 )
+                    return tl::make_unexpected( "Unknown type in PLY property: " + line );
+            }
+            prop.type = parsePlyType( type );
+            if ( prop.type == PlyType::Unknown || !( ls >> prop.name ) )
+                return tl::make_unexpected( "Unknown type in PLY property: " + line );
+            res.elements.back().props.push_back( std::move( prop ) );
+        }
+        else
+            return tl::make_unexpected( "PLY header is damaged: " + line );
+    }
+}
+
+TEST(MRMesh, PlyHeader)
+{
+    // Windows line endings, the keyword in a comment, and big-endian binary data
+    std::string text = "ply\r\nformat binary_big_endian 1.0\r\ncomment no end_header here\r\n"
+        "element vertex 1\r\nproperty float x\r\nproperty uchar red\r\n"
+        "element face 2\r\nproperty list uchar int vertex_indices\r\nend_header\r\n";
+    const auto dataStart = text.size();
+    text.append( "\x3f\x80\x00\x00", 4 );
+    std::istringstream in( text );
+    auto header = readPlyHeader( in );
+    ASSERT_TRUE( header.has_value() );
+    EXPECT_EQ( header->format, PlyFormat::BinaryBigEndian );
+    ASSERT_EQ( header->elements.size(), 2 );
+    EXPECT_EQ( header->find( "face" ), 1 );
+    const auto& vertex = header->elements[0];
+    EXPECT_EQ( vertex.count, 1 );
+    EXPECT_EQ( vertex.find( "red" ), 1 );
+    EXPECT_EQ( vertex.rowSize(), 5 );
+    const auto& face = header->elements[1];
+    ASSERT_EQ( face.props.size(), 1 );
+    EXPECT_TRUE( face.props[0].isList() );
+    EXPECT_EQ( face.props[0].type, PlyType::Int32 );
+    EXPECT_TRUE( face.hasLists() );
+    EXPECT_FALSE( vertex.hasLists() );
+    EXPECT_EQ( size_t( in.tellg() ), dataStart );
+    EXPECT_EQ( readPlyValue( text.data() + dataStart, PlyType::Float32, true ), 1.0 );
+
+    std::istringstream noEnd( "ply\nformat ascii 1.0\nelement vertex 1\n" );
+    EXPECT_FALSE( readPlyHeader( noEnd ).has_value() );
+    std::istringstream notPly( "solid ascii\n" );
+    EXPECT_FALSE( readPlyHeader( notPly ).has_value() );
+}
+
+} //namespace detail
+
+} //namespace MR
@@ -0,0 +1,70 @@
+#pragma once
+
+// the reader of PLY header shared by the streaming loaders of points and triangles,
+// it is not a part of public API
+
+#include <tl/expected.hpp>
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace MR
+{
+
+namespace detail
+{
+
+enum class PlyType
+{
+    Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Unknown
+};
+
+/// returns the size in bytes of one value of given type in binary PLY, 0 for unknown type
+size_t plyTypeSize( PlyType t );
+
+/// reads one value of given type from binary PLY data, swapping the bytes for big-endian files
+double readPlyValue( const char* p, PlyType t, bool swapBytes );
+
+struct PlyProperty
+{
+    std::string name;
+    PlyType type = PlyType::Unknown; ///< the type of the value or of list items
+    PlyType countType = PlyType::Unknown; ///< the type of list size, not Unknown only for lists
+    bool isList() const { return countType != PlyType::Unknown; }
+};
+
+struct PlyElement
+{
+    std::string name;
+    size_t count = 0;
+    std::vector<PlyProperty> props;
+
+    /// returns the index of the property with given name or -1
+    int find( const char* n ) const;
+    /// returns true if the element has at least one list property, so its size in binary PLY varies
+    bool hasLists() const;
+    /// returns the size of one element in binary PLY, valid only if it has no list properties
+    size_t rowSize() const;
+};
+
+enum class PlyFormat
+{
+    Ascii, BinaryLittleEndian, BinaryBigEndian
+};
+
+struct PlyHeader
+{
+    PlyFormat format = PlyFormat::Ascii;
+    std::vector<PlyElement> elements;
+
+    /// returns the index of the element with given name or -1
+    int find( const char* n ) const;
+};
+
+/// reads PLY header line by line up to end_header keyword, leaving the stream on the first byte of the data
+tl::expected<PlyHeader, std::string> readPlyHeader( std::istream& in );
+
+} //namespace detail
+
+} //namespace MR
@@ -83,6 +83,12 @@ const AABBTreePoints& PointCloud::getAABBTree() const
     return AABBTreeOwner_.getOrCreate( [this]{ return AABBTreePoints( *this ); } );
 }
 
+const AABBTreePoints& PointCloud::rebuildAABBTree( const AABBTreeSettings & settings )
+{
+    AABBTreeOwner_.reset();
+    return AABBTreeOwner_.getOrCreate( [this, &settings]{ return AABBTreePoints( *this, settings ); } );
+}
+
 size_t PointCloud::heapBytes() const
 {
     return points.heapBytes()
@@ -23,6 +23,9 @@ public:
     MRMESH_API const AABBTreePoints& getAABBTree() const;
     /// returns cached aabb-tree for this point cloud, but does not create it if it did not exist
     const AABBTreePoints * getAABBTreeNotCreate() const { return AABBTreeOwner_.get(); }
+    /// replaces cached aabb-tree for this point cloud with the one built using given settings,
+    /// the tree will be rebuilt with default settings after next invalidateCaches()
+    MRMESH_API const AABBTreePoints& rebuildAABBTree( const AABBTreeSettings & settings );
 
     /// returns the minimal bounding box containing all valid vertices (implemented via getAABBTree())
     MRMESH_API Box3f getBoundingBox() const;
@@ -5,10 +5,13 @@
 #include "MRBox.h"
 #include "MRBitSetParallelFor.h"
 #include "MRBestFit.h"
-#include "MRPointsInBall.h"
+#include "MRPointsKNearest.h"
 #include "MRTimer.h"
 #include "MRPlane3.h"
-#include "MRPointCloudRadius.h"
+#include "MRConstants.h"
+#include "MRGTest.h"
+#include "MRPch/MRTBB.h"
+#include <algorithm>
 #include <cfloat>
 #include <queue>
 
@@ -30,84 +33,387 @@ bool operator < ( const NormalCandidate& l, const NormalCandidate& r )
     return l.weight > r.weight;
 }
 
-VertCoords makeNormals( const PointCloud& pointCloud, int avgNeighborhoodSize )
+// returns [first,last) range of ordered points in the subtree with given root
+static std::pair<int, int> getSubtreePointRange( const AABBTreePoints& tree, AABBTreePoints::NodeId root )
 {
-    MR_TIMER;
+    auto first = root;
+    while ( !tree[first].leaf() )
+        first = tree[first].leftOrFirst;
+    auto last = root;
+    while ( !tree[last].leaf() )
+        last = tree[last].rightOrLast;
+    return { tree[first].getLeafPointRange().first, tree[last].getLeafPointRange().second };
+}
 
-    VertCoords normals( pointCloud.points.size() );
-    const auto& tree = pointCloud.getAABBTree();
-    AABBTreePoints::NodeId nodeId = tree.rootNodeId();
-    while ( !tree[nodeId].leaf() )
-        nodeId = tree[nodeId].leftOrFirst;
+// splits the tree on subtrees having at most maxPartSize points each (or on leaves),
+// returns the ranges of ordered points in the subtrees
+static std::vector<std::pair<int, int>> splitOnSubtrees( const AABBTreePoints& tree, int maxPartSize )
+{
+    std::vector<std::pair<int, int>> res;
+    if ( tree.nodes().empty() )
+        return res;
+    std::vector<AABBTreePoints::NodeId> stack{ tree.rootNodeId() };
+    while ( !stack.empty() )
+    {
+        const auto n = stack.back();
+        stack.pop_back();
+        const auto range = getSubtreePointRange( tree, n );
+        const auto& node = tree[n];
+        if ( node.leaf() || range.second - range.first <= maxPartSize )
+        {
+            res.push_back( range );
+            continue;
+        }
+        // right child first to have the parts in the order of points
+        stack.push_back( node.rightOrLast );
+        stack.push_back( node.leftOrFirst );
+    }
+    return res;
+}
 
-    auto firstLeafRadius = findAvgPointsRadius( pointCloud, avgNeighborhoodSize );
+// returns the graph with added reverse edges, so the orientation propagates both from a point to its nearest neighbors
+// and from the neighbors to the point, even if the point is not among the nearest neighbors of any other point
+static NearestPointsTable makeSymmetric( const NearestPointsTable& graph )
+{
+    MR_TIMER
+    const size_t n = graph.size();
+    // reverse edges in compact form
+    std::vector<size_t> revOffsets( n + 1, 0 );
+    for ( const auto& p : graph.neighbors )
+        ++revOffsets[p.id + 1];
+    for ( size_t i = 0; i < n; ++i )
+        revOffsets[i + 1] += revOffsets[i];
+    std::vector<NearestPoint> rev( graph.neighbors.size() );
+    {
+        auto pos = revOffsets;
+        for ( size_t i = 0; i < n; ++i )
+            for ( auto p = graph.begin( i ); p != graph.end( i ); ++p )
+                rev[pos[p->id]++] = { VertId( int( i ) ), p->distSq };
+    }
 
-    BitSetParallelFor( pointCloud.validPoints, [&]( VertId vid )
+    NearestPointsTable res;
+    res.offsets.resize( n + 1, 0 );
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, n ), [&]( const tbb::blocked_range<size_t>& range )
     {
-        PointAccumulator accum;
-        findPointsInBall( pointCloud, pointCloud.points[vid], firstLeafRadius, 
-                          [&]( VertId, const Vector3f& coord )
+        // sorted ids of forward neighbors of current point
+        std::vector<VertId> fwdIds;
+        for ( size_t i = range.begin(); i < range.end(); ++i )
         {
-            accum.addPoint( Vector3d( coord ) );
-        } );
-        normals[vid] = Vector3f( accum.getBestPlane().n ).normalized();
+            fwdIds.clear();
+            for ( auto p = graph.begin( i ); p != graph.end( i ); ++p )
+                fwdIds.push_back( p->id );
+            std::sort( fwdIds.begin(), fwdIds.end() );
+            // invalidate the reverse edges already present among forward ones (the ranges of different points do not intersect)
+            size_t numNew = 0;
+            for ( size_t j = revOffsets[i]; j < revOffsets[i + 1]; ++j )
+            {
+                if ( std::binary_search( fwdIds.begin(), fwdIds.end(), rev[j].id ) )
+                    rev[j].id = VertId();
+                else
+                    ++numNew;
+            }
+            res.offsets[i + 1] = graph.numNeighbors( i ) + numNew;
+        }
+    } );
+    for ( size_t i = 0; i < n; ++i )
+        res.offsets[i + 1] += res.offsets[i];
+    res.neighbors.resize( res.offsets.back() );
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, n ), [&]( const tbb::blocked_range<size_t>& range )
+    {
+        for ( size_t i = range.begin(); i < range.end(); ++i )
+        {
+            auto first = res.neighbors.begin() + res.offsets[i];
+            auto last = std::copy( graph.begin( i ), graph.end( i ), first );
+            last = std::copy_if( rev.begin() + revOffsets[i], rev.begin() + revOffsets[i + 1], last, []( const NearestPoint& r ) { return r.id.valid(); } );
+            assert( last == res.neighbors.begin() + res.offsets[i + 1] );
+            std::sort( first, last, []( const NearestPoint& a, const NearestPoint& b ) { return a.distSq < b.distSq; } );
+        }
     } );
+    return res;
+}
 
-    Vector<float, VertId> minWeights( normals.size(), FLT_MAX );
-    std::priority_queue<NormalCandidate> queue;
+class NormalsOrienter
+{
+public:
+    NormalsOrienter( const PointCloud& pointCloud, const NearestPointsTable& knnGraph, VertCoords& normals )
+        : pointCloud_( pointCloud ), knnGraph_( knnGraph ), normals_( normals ), minWeights_( normals.size(), FLT_MAX )
+    {
+    }
+
+    // propagates orientation over all valid points in one thread
+    void orientSerial();
+    // orients the parts of the cloud in parallel, then resolves relative flips of the parts
+    void orientParallel( int maxPartSize );
 
-    auto enweight = [&]( VertId base, VertId candidate )
+private:
+    const PointCloud& pointCloud_;
+    const NearestPointsTable& knnGraph_;
+    VertCoords& normals_;
+    Vector<float, VertId> minWeights_;
+
+    // small weight means reliable propagation of orientation from base to candidate
+    float weight_( VertId base, VertId candidate ) const
     {
-        Vector3f cb = pointCloud.points[base] - pointCloud.points[candidate];
-        return 0.1f * cb.lengthSq() + sqr( dot( cb, normals[base] ) ) + sqr( dot( cb, normals[candidate] ) );
-    };
+        Vector3f cb = pointCloud_.points[base] - pointCloud_.points[candidate];
+        return 0.1f * cb.lengthSq() + sqr( dot( cb, normals_[base] ) ) + sqr( dot( cb, normals_[candidate] ) );
+    }
 
+    // orients all points reachable from the seed via nearest neighbor connections satisfying inRegion( v ),
+    // most reliable connections first; calls onVisit( v ) for each oriented point
+    template<typename InRegion, typename OnVisit>
+    void orientFrom_( VertId seed, std::priority_queue<NormalCandidate>& queue, InRegion&& inRegion, OnVisit&& onVisit );
+};
+
+template<typename InRegion, typename OnVisit>
+void NormalsOrienter::orientFrom_( VertId seed, std::priority_queue<NormalCandidate>& queue, InRegion&& inRegion, OnVisit&& onVisit )
+{
+    assert( queue.empty() );
     auto enqueueNeighbors = [&]( VertId base )
     {
-        findPointsInBall( pointCloud, pointCloud.points[base], firstLeafRadius,
-                          [&]( VertId v, const Vector3f& )
+        for ( auto p = knnGraph_.begin( base ); p != knnGraph_.end( base ); ++p )
         {
-            if ( v == base )
-                return;
-            float weight = enweight( base, v );
-            if ( weight < minWeights[v] )
+            const VertId v = p->id;
+            if ( !inRegion( v ) )
+                continue;
+            float weight = weight_( base, v );
+            if ( weight < minWeights_[v] )
             {
                 queue.emplace( v, base, weight );
-                minWeights[v] = weight;
+                minWeights_[v] = weight;
             }
-        } );
+        }
     };
 
-    auto findFirst = [&]()->VertId
+    minWeights_[seed] = 0.0f;
+    onVisit( seed );
+    enqueueNeighbors( seed );
+    while ( !queue.empty() )
+    {
+        NormalCandidate current = queue.top(); // cannot use std::move unfortunately since top() returns const reference
+        queue.pop();
+        if ( current.weight > minWeights_[current.id] )
+            continue;
+        if ( dot( normals_[current.baseId], normals_[current.id] ) < 0.0f )
+            normals_[current.id] = -normals_[current.id];
+        onVisit( current.id );
+        enqueueNeighbors( current.id );
+    }
+}
+
+void NormalsOrienter::orientSerial()
+{
+    MR_TIMER
+    std::priority_queue<NormalCandidate> queue;
+    for ( auto v : pointCloud_.validPoints )
+    {
+        if ( minWeights_[v] == FLT_MAX )
+            orientFrom_( v, queue, []( VertId ) { return true; }, []( VertId ) {} );
+    }
+}
+
+void NormalsOrienter::orientParallel( int maxPartSize )
+{
+    MR_TIMER
+    const auto& tree = pointCloud_.getAABBTree();
+    const auto& orderedPoints = tree.orderedPoints();
+    const auto parts = splitOnSubtrees( tree, maxPartSize );
+
+    Vector<int, VertId> partOf( normals_.size(), -1 );
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, parts.size(), 1 ), [&]( const tbb::blocked_range<size_t>& range )
+    {
+        for ( size_t p = range.begin(); p < range.end(); ++p )
+            for ( int i = parts[p].first; i < parts[p].second; ++i )
+                partOf[orderedPoints[i].id] = int( p );
+    } );
+
+    // orient each part independently, a part can consist of several connected components
+    Vector<int, VertId> compOf( normals_.size(), -1 );
+    std::vector<int> firstComp( parts.size() + 1, 0 );
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, parts.size(), 1 ), withTimerParent( [&]( const tbb::blocked_range<size_t>& range )
     {
-        for ( auto v : pointCloud.validPoints )
-            if ( minWeights[v] == FLT_MAX )
+        std::priority_queue<NormalCandidate> queue;
+        for ( size_t p = range.begin(); p < range.end(); ++p )
+        {
+            int numComps = 0;
+            for ( int i = parts[p].first; i < parts[p].second; ++i )
             {
-                minWeights[v] = 0.0f;
-                return v;
+                const auto v = orderedPoints[i].id;
+                if ( minWeights_[v] != FLT_MAX )
+                    continue;
+                orientFrom_( v, queue,
+                    [&]( VertId u ) { return partOf[u] == int( p ); },
+                    [&]( VertId u ) { compOf[u] = numComps; } );
+                ++numComps;
             }
-        return VertId{};
+            firstComp[p + 1] = numComps;
+        }
+    } ) );
+    for ( size_t p = 0; p < parts.size(); ++p )
+        firstComp[p + 1] += firstComp[p];
+    const int numComps = firstComp.back();
+    auto globalComp = [&]( VertId v ) { return firstComp[partOf[v]] + compOf[v]; };
+
+    // vote for relative orientation of each pair of connected components by nearest neighbors on their boundaries
+    struct CompLink
+    {
+        int a = 0, b = 0;
+        float vote = 0; // positive if the components are oriented consistently
     };
+    tbb::enumerable_thread_specific<std::vector<CompLink>> threadLinks;
+    BitSetParallelFor( pointCloud_.validPoints, [&]( VertId v )
+    {
+        const int cv = globalComp( v );
+        for ( auto p = knnGraph_.begin( v ); p != knnGraph_.end( v ); ++p )
+        {
+            const int cu = globalComp( p->id );
+            if ( cu != cv )
+                threadLinks.local().push_back( { std::min( cv, cu ), std::max( cv, cu ), dot( normals_[v], normals_[p->id] ) } );
+        }
+    } );
+    std::vector<CompLink> links;
+    for ( const auto& tl : threadLinks )
+        links.insert( links.end(), tl.begin(), tl.end() );
+    std::sort( links.begin(), links.end(), []( const CompLink& l, const CompLink& r )
+    {
+        return std::tie( l.a, l.b ) < std::tie( r.a, r.b );
+    } );
+    // merge the votes of each pair, and store each link in both directions
+    std::vector<CompLink> adjacency;
+    for ( size_t i = 0; i < links.size(); )
+    {
+        CompLink sum = links[i];
+        for ( ++i; i < links.size() && links[i].a == sum.a && links[i].b == sum.b; ++i )
+            sum.vote += links[i].vote;
+        adjacency.push_back( sum );
+        adjacency.push_back( { sum.b, sum.a, sum.vote } );
+    }
+    std::sort( adjacency.begin(), adjacency.end(), []( const CompLink& l, const CompLink& r ) { return l.a < r.a; } );
+    std::vector<size_t> adjacencyStart( numComps + 1, 0 );
+    for ( const auto& l : adjacency )
+        ++adjacencyStart[l.a + 1];
+    for ( int c = 0; c < numComps; ++c )
+        adjacencyStart[c + 1] += adjacencyStart[c];
 
-    NormalCandidate current;
-    VertId first = findFirst();
-    while ( first.valid() )
+    // resolve flips of the components along maximum spanning tree of the most confident votes
+    std::vector<char> flip( numComps, 0 ), visited( numComps, 0 );
+    struct Candidate
+    {
+        float confidence = 0;
+        int comp = 0;
+        char flip = 0;
+        bool operator <( const Candidate& r ) const { return confidence < r.confidence; }
+    };
+    std::priority_queue<Candidate> compQueue;
+    for ( int seed = 0; seed < numComps; ++seed )
     {
-        enqueueNeighbors( first );
-        while ( !queue.empty() )
+        if ( visited[seed] )
+            continue;
+        compQueue.push( { 0.0f, seed, 0 } );
+        while ( !compQueue.empty() )
         {
-            current = queue.top(); // cannot use std::move unfortunately since top() returns const reference
-            queue.pop();
-            if ( current.weight > minWeights[current.id] )
+            const auto current = compQueue.top();
+            compQueue.pop();
+            if ( visited[current.comp] )
                 continue;
-            if ( dot( normals[current.baseId], normals[current.id] ) < 0.0f )
-                normals[current.id] = -normals[current.id];
-            enqueueNeighbors( current.id );
+            visited[current.comp] = 1;
+            flip[current.comp] = current.flip;
+            for ( size_t i = adjacencyStart[current.comp]; i < adjacencyStart[current.comp + 1]; ++i )
+            {
+                const auto& l = adjacency[i];
+                if ( !visited[l.b] )
+                    compQueue.push( { std::abs( l.vote ), l.b, char( current.flip ^ ( l.vote < 0 ) ) } );
+            }
         }
-        first = findFirst();
     }
 
+    BitSetParallelFor( pointCloud_.validPoints, [&]( VertId v )
+    {
+        if ( flip[globalComp( v )] )
+            normals_[v] = -normals_[v];
+    } );
+}
+
+VertCoords makeNormals( const PointCloud& pointCloud, int avgNeighborhoodSize, bool parallelOrientation )
+{
+    MR_TIMER;
+
+    VertCoords normals( pointCloud.points.size() );
+
+    // k nearest neighbors adapt to local density unlike the points in the ball of global radius;
+    // they are found once and reused for orientation
+    const auto knnGraph = buildKNearestGraph( pointCloud, avgNeighborhoodSize );
+    BitSetParallelFor( pointCloud.validPoints, [&]( VertId vid )
+    {
+        PointAccumulator accum;
+        accum.addPoint( Vector3d( pointCloud.points[vid] ) );
+        for ( auto p = knnGraph.begin( vid ); p != knnGraph.end( vid ); ++p )
+            accum.addPoint( Vector3d( pointCloud.points[p->id] ) );
+        normals[vid] = Vector3f( accum.getBestPlane().n ).normalized();
+    } );
+
+    const auto orientGraph = makeSymmetric( knnGraph );
+    NormalsOrienter orienter( pointCloud, orientGraph, normals );
+    // the parts are large enough to make boundary effects negligible, and numerous enough to load all threads
+    constexpr int MinPartSize = 16 * 1024;
+    const int numPoints = int( pointCloud.validPoints.count() );
+    const int maxPartSize = std::max( MinPartSize, numPoints / ( 4 * tbb::this_task_arena::max_concurrency() ) + 1 );
+    if ( parallelOrientation && numPoints > maxPartSize )
+        orienter.orientParallel( maxPartSize );
+    else
+        orienter.orientSerial();
+
     return normals;
 }
 
+TEST(MRMesh, MakeNormalsParallelOrientation)
+{
+    // evenly distributed points on a sphere (Fibonacci lattice), normals must be all outside or all inside
+    PointCloud cloud;
+    constexpr int NumPoints = 80000;
+    const float goldenAngle = PI_F * ( 3 - std::sqrt( 5.0f ) );
+    for ( int i = 0; i < NumPoints; ++i )
+    {
+        const float z = 1 - 2 * ( i + 0.5f ) / NumPoints;
+        const float r = std::sqrt( 1 - z * z );
+        const float phi = goldenAngle * i;
+        cloud.points.emplace_back( r * std::cos( phi ), r * std::sin( phi ), z );
+    }
+    cloud.validPoints.resize( cloud.points.size(), true );
+
+    for ( bool parallel : { false, true } )
+    {
+        const auto normals = makeNormals( cloud, 16, parallel );
+        int numOutside = 0;
+        for ( auto v : cloud.validPoints )
+        {
+            EXPECT_GT( std::abs( dot( normals[v], cloud.points[v] ) ), 0.9f );
+            if ( dot( normals[v], cloud.points[v] ) > 0 )
+                ++numOutside;
+        }
+        EXPECT_TRUE( numOutside == 0 || numOutside == int( cloud.points.size() ) );
+    }
+}
+
+
+TEST(MRMesh, MakeNormalsNotNearestOfOthers)
+{
+    // a plane grid and the points above it, which have grid points among their nearest neighbors,
+    // but are not nearest neighbors of any grid point
+    PointCloud cloud;
+    constexpr int GridSize = 40;
+    for ( int y = 0; y < GridSize; ++y )
+        for ( int x = 0; x < GridSize; ++x )
+            cloud.points.emplace_back( float( x ), float( y ), 0.0f );
+    for ( int i = 0; i < 8; ++i )
+        cloud.points.emplace_back( 4.0f * i + 5.3f, 0.7f * i + 10.1f, i % 2 ? 3.0f : -3.0f );
+    cloud.validPoints.resize( cloud.points.size(), true );
+
+    const auto normals = makeNormals( cloud, 16, false );
+    int numUp = 0;
+    for ( auto v : cloud.validPoints )
+        if ( normals[v].z > 0 )
+            ++numUp;
+    EXPECT_TRUE( numUp == 0 || numUp == int( cloud.points.size() ) );
+}
+
 }
@@ -9,7 +9,10 @@ struct PointCloud;
 
 /// \brief Makes consistent normals for valid points of given point cloud
 /// \param avgNeighborhoodSize avg num of neighbors of each individual point
+/// \param parallelOrientation if true then large clouds are split on parts (subtrees of AABB tree) oriented in parallel threads,
+/// and then the relative flips of the parts are resolved using the votes of nearest neighbors on part boundaries
 /// \ingroup PointCloudGroup
 MRMESH_API VertCoords makeNormals( const PointCloud& pointCloud, 
-                                   int avgNeighborhoodSize = 3 * AABBTreePoints::MaxNumPointsInLeaf );
+                                   int avgNeighborhoodSize = 3 * AABBTreePoints::MaxNumPointsInLeaf,
+                                   bool parallelOrientation = true );
 }
\ No newline at end of file
@@ -0,0 +1,552 @@
+#include "MRPointCloudTiledTriangulation.h"
+#include "MRPointsTiling.h"
+#include "MRPointCloud.h"
+#include "MRPointCloudMakeNormals.h"
+#include "MRPointCloudRadius.h"
+#include "MRMeshFillHole.h"
+#include "MRMeshLoad.h"
+#include "MRPlyHeader.h"
+#include "MRHash.h"
+#include "MRSerializer.h"
+#include "MRStringConvert.h"
+#include "MRBox.h"
+#include "MRConstants.h"
+#include "MRTimer.h"
+#include "MRGTest.h"
+#include "MRPch/MRSpdlog.h"
+#include <parallel_hashmap/phmap.h>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <fstream>
+#include <optional>
+#include <queue>
+
+namespace MR
+{
+
+// a point spilled in the file of a tile
+struct TilePoint
+{
+    Vector3f p;
+    Vector3f n;
+    int id = 0; // the index of the point in the stream
+    int flags = 0;
+};
+
+enum TilePointFlags : int
+{
+    CorePoint = 1,  // the point is in the core of the tile
+    SharedPoint = 2 // the core point is also in the margins of other tiles
+};
+
+tl::expected<void, std::string> triangulatePointCloudTiled( const PointsStream& points, const std::filesystem::path& outPlyFile,
+    const TiledTriangulationParameters& params, ProgressCallback progressCb )
+{
+    MR_TIMER
+    using namespace detail;
+    // stages: bounding box 0-5%, histogram 5-10%, spilling the tiles 10-20%, triangulation of the tiles 20-90%, saving 90-100%
+    bool canceled = false;
+    auto report = [&]( float from, float to, float p )
+    {
+        if ( progressCb && !progressCb( from + ( to - from ) * p ) )
+            canceled = true;
+        return !canceled;
+    };
+    auto cancelError = []() { return tl::make_unexpected( std::string( "Operation was canceled" ) ); };
+
+    Box3f box;
+    size_t numPoints = 0;
+    bool hasNormals = true;
+    auto res = points( [&]( const PointsChunk& chunk )
+    {
+        for ( size_t i = 0; i < chunk.size; ++i )
+            box.include( chunk.points[i] );
+        numPoints += chunk.size;
+        hasNormals = hasNormals && chunk.normals;
+        return report( 0.0f, 0.05f, 0.0f );
+    } );
+    if ( !res )
+        return res;
+    if ( canceled )
+        return cancelError();
+    if ( numPoints == 0 )
+        return tl::make_unexpected( std::string( "No points to triangulate" ) );
+    if ( numPoints > size_t( INT_MAX ) )
+        return tl::make_unexpected( std::string( "Too many points to triangulate in one mesh" ) );
+
+    const PointsGrid grid( box );
+    PointsHistogram hist;
+    size_t streamed = 0;
+    res = points( [&]( const PointsChunk& chunk )
+    {
+        for ( size_t i = 0; i < chunk.size; ++i )
+            hist.add( grid.cell( chunk.points[i] ) );
+        streamed += chunk.size;
+        return report( 0.05f, 0.1f, float( streamed ) / numPoints );
+    } );
+    if ( !res )
+        return res;
+    if ( canceled )
+        return cancelError();
+
+    const auto& triParamsIn = params.triangulation;
+    // estimate the distance between points assuming that each non-empty cell is crossed by a surface,
+    // which area in the cell is on average 2/3 of the area of cell's face
+    double sumSpacing = 0;
+    {
+        const float cellArea = std::pow( grid.cellSize.x * grid.cellSize.y * grid.cellSize.z, 2.0f / 3.0f ) * 2.0f / 3.0f;
+        for ( int z = 0; z < HistRes; ++z )
+            for ( int y = 0; y < HistRes; ++y )
+                for ( int x = 0; x < HistRes; ++x )
+                    sumSpacing += std::sqrt( double( hist.cellCount( { x, y, z } ) ) * cellArea );
+    }
+    const float spacing = float( sumSpacing / numPoints );
+    auto triParams = triParamsIn;
+    if ( triParams.radius <= 0 )
+    {
+        // same radius in all tiles is necessary to get same triangles on the seams,
+        // so it is found from the density of all points and not from one tile
+        triParams.radius = spacing * std::sqrt( triParams.avgNumNeighbours / PI_F );
+    }
+    float overlap = params.overlap;
+    if ( overlap <= 0 )
+    {
+        // the points within the radius of triangulation, their fans and normals must be the same as in neighbor tile
+        overlap = 4 * spacing * std::sqrt( triParamsIn.avgNumNeighbours / PI_F );
+    }
+    if ( 3 * triParams.radius > overlap )
+        spdlog::warn( "Tiled triangulation: overlap {} is small for triangulation radius {}", overlap, triParams.radius );
+    hist.accumulate();
+
+    Vector3i marginCells;
+    for ( int i = 0; i < 3; ++i )
+        marginCells[i] = int( std::ceil( overlap / grid.cellSize[i] ) );
+    // rough estimation of the memory per point needed for in-core triangulation
+    const size_t bytesPerPoint = 256 + 8 * size_t( std::max( triParamsIn.avgNumNeighbours, 1 ) ) + sizeof( TilePoint );
+    const size_t maxTilePoints = std::max( params.memoryBudget / bytesPerPoint, size_t( 1024 ) );
+
+    std::vector<Tile> tiles;
+    res = splitOnTiles( grid, hist, marginCells, maxTilePoints, { 0, 0, 0 }, { HistRes, HistRes, HistRes }, tiles );
+    if ( !res )
+        return res;
+    std::vector<int> cellOwner( size_t( HistRes ) * HistRes * HistRes, -1 );
+    std::vector<std::vector<int>> cellTiles( cellOwner.size() ); // all tiles which expanded boxes touch each cell
+    for ( int t = 0; t < tiles.size(); ++t )
+    {
+        auto& tile = tiles[t];
+        tile.expanded = Box3f( tile.core.min - Vector3f::diagonal( overlap ), tile.core.max + Vector3f::diagonal( overlap ) );
+        for ( int z = tile.lo.z; z < tile.hi.z; ++z )
+            for ( int y = tile.lo.y; y < tile.hi.y; ++y )
+                for ( int x = tile.lo.x; x < tile.hi.x; ++x )
+                    cellOwner[PointsGrid::index( { x, y, z } )] = t;
+        const auto elo = grid.cell( tile.expanded.min );
+        const auto ehi = grid.cell( tile.expanded.max );
+        for ( int z = elo.z; z <= ehi.z; ++z )
+            for ( int y = elo.y; y <= ehi.y; ++y )
+                for ( int x = elo.x; x <= ehi.x; ++x )
+                    cellTiles[PointsGrid::index( { x, y, z } )].push_back( t );
+    }
+    spdlog::info( "Tiled triangulation: {} points in {} tiles, overlap {}, radius {}", numPoints, tiles.size(), overlap, triParams.radius );
+
+    std::optional<UniqueTemporaryFolder> tempFolder;
+    std::filesystem::path tempDir = params.tempDir;
+    if ( tempDir.empty() )
+    {
+        tempFolder.emplace( FolderCallback{} );
+        if ( !*tempFolder )
+            return tl::make_unexpected( std::string( "Cannot create temporary folder" ) );
+        tempDir = *tempFolder;
+    }
+    TempFiles tempFiles;
+    for ( int t = 0; t < tiles.size(); ++t )
+        tempFiles.files.push_back( tempDir / ( "tile" + std::to_string( t ) + ".bin" ) );
+    const auto trianglesPath = tempDir / "triangles.bin";
+    tempFiles.files.push_back( trianglesPath );
+    // the tile files are appended, so remove the files left by previous runs
+    for ( const auto& f : tempFiles.files )
+    {
+        std::error_code ec;
+        std::filesystem::remove( f, ec );
+    }
+
+    // spill the points of each tile with its margins in the file of the tile
+    {
+        const size_t bufferSize = std::clamp( params.memoryBudget / 4 / tiles.size() / sizeof( TilePoint ), size_t( 1024 ), size_t( 65536 ) );
+        std::vector<std::vector<TilePoint>> buffers( tiles.size() );
+        bool writeFailed = false;
+        auto flush = [&]( int t )
+        {
+            auto& buf = buffers[t];
+            std::ofstream out( tempFiles.files[t], std::ios::binary | std::ios::app );
+            out.write( (const char*)buf.data(), buf.size() * sizeof( TilePoint ) );
+            writeFailed = writeFailed || !out;
+            buf.clear();
+        };
+        auto push = [&]( int t, const TilePoint& tp )
+        {
+            buffers[t].push_back( tp );
+            if ( buffers[t].size() >= bufferSize )
+                flush( t );
+        };
+
+        streamed = 0;
+        res = points( [&]( const PointsChunk& chunk )
+        {
+            for ( size_t i = 0; i < chunk.size; ++i )
+            {
+                const auto ci = PointsGrid::index( grid.cell( chunk.points[i] ) );
+                const int own = cellOwner[ci];
+                assert( own >= 0 );
+                TilePoint tp{ chunk.points[i], hasNormals ? chunk.normals[i] : Vector3f{}, int( streamed + i ), CorePoint };
+                for ( int t : cellTiles[ci] )
+                {
+                    if ( t == own || !tiles[t].expanded.contains( chunk.points[i] ) )
+                        continue;
+                    tp.flags |= SharedPoint;
+                    auto marginPoint = tp;
+                    marginPoint.flags = 0;
+                    push( t, marginPoint );
+                }
+                push( own, tp );
+            }
+            streamed += chunk.size;
+            return !writeFailed && report( 0.1f, 0.2f, float( streamed ) / numPoints );
+        } );
+        for ( int t = 0; t < tiles.size(); ++t )
+            if ( !buffers[t].empty() )
+                flush( t );
+        if ( !res )
+            return res;
+        if ( canceled )
+            return cancelError();
+        if ( writeFailed )
+            return tl::make_unexpected( "Cannot write temporary file in " + utf8string( tempDir ) );
+        if ( streamed != numPoints )
+            return tl::make_unexpected( std::string( "The stream of points has changed between the passes" ) );
+    }
+
+    // triangulate the tiles starting from each tile its neighbors to orient the normals consistently
+    std::vector<int> order;
+    {
+        std::vector<char> queued( tiles.size(), 0 );
+        std::queue<int> queue;
+        for ( int seed = 0; seed < tiles.size(); ++seed )
+        {
+            if ( queued[seed] )
+                continue;
+            queued[seed] = 1;
+            queue.push( seed );
+            while ( !queue.empty() )
+            {
+                const int t = queue.front();
+                queue.pop();
+                order.push_back( t );
+                for ( int u = 0; u < tiles.size(); ++u )
+                {
+                    if ( !queued[u] && tiles[t].expanded.intersects( tiles[u].core ) )
+                    {
+                        queued[u] = 1;
+                        queue.push( u );
+                    }
+                }
+            }
+        }
+    }
+
+    size_t totalTilePoints = 0;
+    for ( int t = 0; t < tiles.size(); ++t )
+    {
+        std::error_code ec;
+        const auto size = std::filesystem::file_size( tempFiles.files[t], ec );
+        if ( !ec )
+            totalTilePoints += size / sizeof( TilePoint );
+    }
+
+    std::ofstream trianglesOut( trianglesPath, std::ios::binary );
+    if ( !trianglesOut )
+        return tl::make_unexpected( "Cannot write temporary file " + utf8string( trianglesPath ) );
+    size_t numTriangles = 0;
+    size_t processedPoints = 0;
+    // holes are filled below only if they are located entirely in the core of one tile
+    triParams.critHoleLength = 0;
+    const auto bigLength = triParamsIn.critHoleLength >= 0.0f ? triParamsIn.critHoleLength : box.diagonal() * 0.7f;
+    // known normals of the points in the margins of not processed yet tiles
+    phmap::flat_hash_map<int, Vector3f> seamNormals;
+
+    for ( int t : order )
+    {
+        std::vector<TilePoint> tilePoints;
+        {
+            const auto& path = tempFiles.files[t];
+            std::error_code ec;
+            const auto size = std::filesystem::file_size( path, ec );
+            if ( ec )
+                continue; // no points in the tile
+            tilePoints.resize( size / sizeof( TilePoint ) );
+            std::ifstream in( path, std::ios::binary );
+            in.read( (char*)tilePoints.data(), tilePoints.size() * sizeof( TilePoint ) );
+            if ( !in )
+                return tl::make_unexpected( "Cannot read temporary file " + utf8string( path ) );
+            in.close();
+            std::filesystem::remove( path, ec );
+        }
+        const auto tileStart = float( processedPoints ) / totalTilePoints;
+        const auto tileEnd = float( processedPoints + tilePoints.size() ) / totalTilePoints;
+        processedPoints += tilePoints.size();
+
+        PointCloud cloud;
+        cloud.points.resize( tilePoints.size() );
+        if ( hasNormals )
+            cloud.normals.resize( tilePoints.size() );
+        for ( VertId v{ 0 }; v < tilePoints.size(); ++v )
+        {
+            cloud.points[v] = tilePoints[v].p;
+            if ( hasNormals )
+                cloud.normals[v] = tilePoints[v].n;
+        }
+        cloud.validPoints.resize( tilePoints.size(), true );
+
+        if ( !hasNormals )
+        {
+            cloud.normals = makeNormals( cloud, triParams.avgNumNeighbours );
+            float vote = 0;
+            for ( VertId v{ 0 }; v < tilePoints.size(); ++v )
+            {
+                if ( tilePoints[v].flags & CorePoint )
+                    continue;
+                auto it = seamNormals.find( tilePoints[v].id );
+                if ( it != seamNormals.end() )
+                    vote += dot( cloud.normals[v], it->second );
+            }
+            if ( vote < 0 )
+                for ( auto& n : cloud.normals )
+                    n = -n;
+            for ( VertId v{ 0 }; v < tilePoints.size(); ++v )
+                if ( tilePoints[v].flags & SharedPoint )
+                    seamNormals[tilePoints[v].id] = cloud.normals[v];
+        }
+
+        auto mesh = triangulatePointCloud( cloud, triParams, [&]( float p )
+        {
+            return report( 0.2f, 0.9f, tileStart + ( tileEnd - tileStart ) * p );
+        } );
+        if ( !mesh || canceled )
+            return cancelError();
+
+        if ( bigLength > 0 )
+        {
+            for ( const auto& boundary : mesh->topology.findBoundary() )
+            {
+                bool inCore = true;
+                float length = 0.0f;
+                for ( auto e : boundary )
+                {
+                    if ( !( tilePoints[mesh->topology.org( e )].flags & CorePoint ) )
+                    {
+                        inCore = false;
+                        break;
+                    }
+                    length += mesh->edgeLength( e );
+                }
+                if ( inCore && length < bigLength )
+                    fillHole( *mesh, boundary.front() );
+            }
+        }
+
+        // keep only the triangles which smallest vertex is in the core of this tile
+        std::vector<int> triangles;
+        for ( auto f : mesh->topology.getValidFaces() )
+        {
+            VertId v[3];
+            mesh->topology.getTriVerts( f, v );
+            int m = 0;
+            for ( int j = 1; j < 3; ++j )
+                if ( tilePoints[v[j]].id < tilePoints[v[m]].id )
+                    m = j;
+            if ( !( tilePoints[v[m]].flags & CorePoint ) )
+                continue;
+            for ( int j = 0; j < 3; ++j )
+                triangles.push_back( tilePoints[v[j]].id );
+        }
+        trianglesOut.write( (const char*)triangles.data(), triangles.size() * sizeof( int ) );
+        if ( !trianglesOut )
+            return tl::make_unexpected( "Cannot write temporary file " + utf8string( trianglesPath ) );
+        numTriangles += triangles.size() / 3;
+    }
+    trianglesOut.close();
+    seamNormals = {};
+
+    std::ofstream out( outPlyFile, std::ofstream::binary );
+    if ( !out )
+        return tl::make_unexpected( std::string( "Cannot open file for writing " ) + utf8string( outPlyFile ) );
+    out << "ply\nformat binary_little_endian 1.0\ncomment MeshInspector.com\n"
+        "element vertex " << numPoints << "\nproperty float x\nproperty float y\nproperty float z\n"
+        "element face " << numTriangles << "\nproperty list uchar int vertex_indices\nend_header\n";
+
+    static_assert( sizeof( Vector3f ) == 12, "wrong size of Vector3f" );
+    streamed = 0;
+    res = points( [&]( const PointsChunk& chunk )
+    {
+        out.write( (const char*)chunk.points, chunk.size * sizeof( Vector3f ) );
+        streamed += chunk.size;
+        return report( 0.9f, 0.95f, float( streamed ) / numPoints );
+    } );
+    if ( !res )
+        return res;
+    if ( canceled )
+        return cancelError();
+    if ( streamed != numPoints )
+        return tl::make_unexpected( std::string( "The stream of points has changed between the passes" ) );
+
+    #pragma pack(push, 1)
+    struct PlyTriangle
+    {
+        char cnt = 3;
+        int v[3];
+    };
+    #pragma pack(pop)
+    static_assert( sizeof( PlyTriangle ) == 13, "check your padding" );
+
+    std::ifstream trianglesIn( trianglesPath, std::ios::binary );
+    constexpr size_t BlockTriangles = 1 << 16;
+    std::vector<int> block( 3 * BlockTriangles );
+    std::vector<PlyTriangle> plyBlock( BlockTriangles );
+    for ( size_t first = 0; first < numTriangles; first += BlockTriangles )
+    {
+        const size_t n = std::min( BlockTriangles, numTriangles - first );
+        if ( !trianglesIn.read( (char*)block.data(), 3 * n * sizeof( int ) ) )
+            return tl::make_unexpected( "Cannot read temporary file " + utf8string( trianglesPath ) );
+        for ( size_t i = 0; i < n; ++i )
+            for ( int j = 0; j < 3; ++j )
+                plyBlock[i].v[j] = block[3 * i + j];
+        out.write( (const char*)plyBlock.data(), n * sizeof( PlyTriangle ) );
+        if ( !report( 0.95f, 1.0f, float( first + n ) / numTriangles ) )
+            return cancelError();
+    }
+    if ( !out )
+        return tl::make_unexpected( std::string( "Error saving in PLY-format" ) );
+
+    return {};
+}
+
+// the statistics of triangles, which are counted on raw vertex indices to see the seams' defects not hidden by MeshBuilder
+struct TrianglesStats
+{
+    size_t numDuplicated = 0; ///< triangles with same vertices as another triangle
+    size_t numBoundaryEdges = 0; ///< edges of one triangle
+    size_t numNonManifoldEdges = 0; ///< edges of more than two triangles
+};
+
+static TrianglesStats computeTrianglesStats( std::vector<ThreeVertIds> tris )
+{
+    TrianglesStats res;
+    phmap::flat_hash_map<std::pair<VertId, VertId>, int> edgeTris;
+    for ( auto& t : tris )
+    {
+        for ( int j = 0; j < 3; ++j )
+            ++edgeTris[std::minmax( t[j], t[( j + 1 ) % 3] )];
+        std::sort( t.begin(), t.end() );
+    }
+    std::sort( tris.begin(), tris.end() );
+    for ( size_t i = 1; i < tris.size(); ++i )
+        if ( tris[i] == tris[i - 1] )
+            ++res.numDuplicated;
+    for ( const auto& [e, n] : edgeTris )
+    {
+        if ( n == 1 )
+            ++res.numBoundaryEdges;
+        else if ( n > 2 )
+            ++res.numNonManifoldEdges;
+    }
+    return res;
+}
+
+// reads the triangles as they are written by triangulatePointCloudTiled, returns empty vector on error
+static std::vector<ThreeVertIds> readRawPlyTriangles( const std::filesystem::path& path )
+{
+    std::ifstream in( path, std::ios::binary );
+    auto header = detail::readPlyHeader( in );
+    if ( !header || header->elements.size() != 2 )
+        return {};
+    const auto& vertex = header->elements[0];
+    in.seekg( vertex.count * vertex.rowSize(), std::ios::cur );
+    std::vector<ThreeVertIds> res( header->elements[1].count );
+    for ( auto& t : res )
+    {
+        char cnt = 0;
+        int v[3];
+        in.read( &cnt, 1 );
+        in.read( (char*)v, sizeof( v ) );
+        if ( !in || cnt != 3 )
+            return {};
+        t = { VertId( v[0] ), VertId( v[1] ), VertId( v[2] ) };
+    }
+    return res;
+}
+
+TEST(MRMesh, TriangulatePointCloudTiled)
+{
+    // evenly distributed points on a sphere (Fibonacci lattice)
+    PointCloud cloud;
+    constexpr int NumPoints = 20000;
+    const float goldenAngle = PI_F * ( 3 - std::sqrt( 5.0f ) );
+    for ( int i = 0; i < NumPoints; ++i )
+    {
+        const float z = 1 - 2 * ( i + 0.5f ) / NumPoints;
+        const float r = std::sqrt( 1 - z * z );
+        const float phi = goldenAngle * i;
+        cloud.points.emplace_back( r * std::cos( phi ), r * std::sin( phi ), z );
+    }
+    cloud.validPoints.resize( NumPoints, true );
+
+    UniqueTemporaryFolder folder( {} );
+    ASSERT_TRUE( bool( folder ) );
+    const auto path = folder / "tiled.ply";
+
+    TiledTriangulationParameters params;
+    params.tempDir = folder;
+    // several thousands of points per tile
+    params.memoryBudget = size_t( 5000 ) * ( 256 + 8 * params.triangulation.avgNumNeighbours );
+    auto res = triangulatePointCloudTiled( pointsStreamFromCloud( cloud ), path, params );
+    ASSERT_TRUE( res.has_value() ) << res.error();
+
+    // the triangles are checked as they are in the file, without the defects hidden by MeshBuilder
+    const auto tris = readRawPlyTriangles( path );
+    ASSERT_FALSE( tris.empty() );
+    const auto stats = computeTrianglesStats( tris );
+    EXPECT_EQ( stats.numDuplicated, 0 );
+    EXPECT_EQ( stats.numNonManifoldEdges, 0 );
+
+    auto mesh = MeshLoad::fromPly( path );
+    ASSERT_TRUE( mesh.has_value() ) << mesh.error();
+    EXPECT_EQ( mesh->points.size(), NumPoints );
+    EXPECT_TRUE( mesh->topology.checkValidity() );
+    // closed sphere has 2 * NumPoints - 4 triangles
+    const int numFaces = mesh->topology.numValidFaces();
+    EXPECT_EQ( numFaces, tris.size() );
+    EXPECT_GT( numFaces, 2 * NumPoints * 9 / 10 );
+    EXPECT_LE( numFaces, 2 * NumPoints );
+    int numOutside = 0;
+    for ( auto f : mesh->topology.getValidFaces() )
+        if ( dot( mesh->normal( f ), mesh->triCenter( f ) ) > 0 )
+            ++numOutside;
+    EXPECT_LT( std::min( numOutside, numFaces - numOutside ), numFaces / 100 );
+
+    // with the radius of in-core triangulation the seams must not have more defects than in-core result
+    params.triangulation.radius = findAvgPointsRadius( cloud, params.triangulation.avgNumNeighbours );
+    res = triangulatePointCloudTiled( pointsStreamFromCloud( cloud ), path, params );
+    ASSERT_TRUE( res.has_value() ) << res.error();
+    const auto tiledTris = readRawPlyTriangles( path );
+    ASSERT_FALSE( tiledTris.empty() );
+    const auto tiledStats = computeTrianglesStats( tiledTris );
+    auto inCoreMesh = triangulatePointCloud( cloud, params.triangulation );
+    ASSERT_TRUE( inCoreMesh.has_value() );
+    const auto inCoreStats = computeTrianglesStats( inCoreMesh->topology.getAllTriVerts() );
+    EXPECT_EQ( tiledStats.numDuplicated, 0 );
+    EXPECT_LE( tiledStats.numNonManifoldEdges, inCoreStats.numNonManifoldEdges );
+    EXPECT_LE( tiledStats.numBoundaryEdges, inCoreStats.numBoundaryEdges );
+    EXPECT_EQ( tiledTris.size(), inCoreMesh->topology.numValidFaces() );
+}
+
+} //namespace MR
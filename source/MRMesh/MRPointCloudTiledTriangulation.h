@@ -0,0 +1,44 @@
+#pragma once
+
+#include "MRPointCloudTriangulation.h"
+#include "MRPointsStream.h"
+#include <filesystem>
+
+namespace MR
+{
+
+/**
+ * \brief Parameters of out-of-core point cloud triangulation
+ * \ingroup PointCloudTriangulationGroup
+ *
+ * \sa \ref triangulatePointCloudTiled
+ */
+struct TiledTriangulationParameters
+{
+    /// parameters of triangulation inside each tile;
+    /// holes crossing the seams of tiles are not filled, and if the radius is not set then it is estimated from the density of all points
+    TriangulationParameters triangulation;
+    /// approximate upper limit in bytes of the memory consumed by triangulation of one tile
+    /// (the operation fails if the densest 1/64 part of the bounding box along each dimension does not fit in it)
+    size_t memoryBudget = size_t( 4 ) << 30;
+    /// width of the margins added to each tile to triangulate the seams exactly as neighbor tiles do;
+    /// if not positive then it is estimated from the density of points and avgNumNeighbours
+    float overlap = 0;
+    /// directory for temporary files, which need the space for all points (with margins) and all triangles;
+    /// if empty then new folder in system temporary directory is used
+    std::filesystem::path tempDir;
+};
+
+/**
+ * \brief Triangulates the point cloud that can be larger than available memory, and saves the result in binary PLY file
+ * \details The space is split on tiles with approximately equal number of points (including the margins) fitting in memory budget.
+ * The points of each tile with the margins are spilled on disk, then the tiles are triangulated one by one,
+ * and each tile keeps only the triangles, which smallest vertex is in its core, so the seams are stitched deterministically.
+ * If the stream has no normals, then the normals of each tile are flipped to agree with already triangulated neighbor tiles.
+ * The vertices of the resulting mesh are the points of the stream in the same order.
+ * \ingroup PointCloudTriangulationGroup
+ */
+MRMESH_API tl::expected<void, std::string> triangulatePointCloudTiled( const PointsStream& points, const std::filesystem::path& outPlyFile,
+    const TiledTriangulationParameters& params = {}, ProgressCallback progressCb = {} );
+
+} //namespace MR
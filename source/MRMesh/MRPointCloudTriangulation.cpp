@@ -55,7 +55,7 @@ std::optional<Mesh> PointCloudTriangulator::triangulate( ProgressCallback progre
 bool PointCloudTriangulator::optimizeAll_( ProgressCallback progressCb )
 {
     MR_TIMER;
-    float radius = findAvgPointsRadius( pointCloud_, params_.avgNumNeighbours );
+    const float radius = params_.radius > 0 ? params_.radius : findAvgPointsRadius( pointCloud_, params_.avgNumNeighbours );
     // const ref should prolong makeNormals lifetime
     const VertCoords& normals = pointCloud_.normals.empty() ? makeNormals( pointCloud_, params_.avgNumNeighbours ) : pointCloud_.normals;
 
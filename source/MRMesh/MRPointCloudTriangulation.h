@@ -54,6 +54,11 @@ struct TriangulationParameters
      * \details If value is subzero it is set automaticly to 0.7*bbox.diagonal()
      */
     float critHoleLength{-FLT_MAX};
+    /**
+     * \brief Radius of local triangulation zone
+     * \details If value is not positive, it is found automatically from \ref avgNumNeighbours
+     */
+    float radius{0.0f};
 };
 
 /**
@@ -0,0 +1,263 @@
+#include "MRPointsKNearest.h"
+#include "MRPointCloud.h"
+#include "MRAABBTreePoints.h"
+#include "MRTimer.h"
+#include "MRGTest.h"
+#include "MRPch/MRTBB.h"
+#include <algorithm>
+#include <random>
+
+namespace MR
+{
+
+// the order of points in the heap: the farthest point is on top
+static bool closer( const NearestPoint & a, const NearestPoint & b )
+{
+    return a.distSq < b.distSq || ( a.distSq == b.distSq && a.id < b.id );
+}
+
+void findKNearestPoints( const AABBTreePoints& tree, const Vector3f& center, int k, std::vector<NearestPoint>& res, float maxDistSq )
+{
+    res.clear();
+    if ( k <= 0 || tree.nodes().empty() )
+        return;
+
+    const auto& orderedPoints = tree.orderedPoints();
+    // only the points and the nodes closer than this are of interest
+    float boundSq = maxDistSq;
+
+    struct SubTask
+    {
+        AABBTreePoints::NodeId n;
+        float distSq = 0;
+        SubTask() = default;
+        SubTask( AABBTreePoints::NodeId n, float dd ) : n( n ), distSq( dd ){}
+    };
+
+    constexpr int MaxStackSize = 32; // to avoid allocations
+    SubTask subtasks[MaxStackSize];
+    int stackSize = 0;
+
+    auto addSubTask = [&]( const SubTask& s )
+    {
+        if ( s.distSq < boundSq )
+        {
+            assert( stackSize < MaxStackSize );
+            subtasks[stackSize++] = s;
+        }
+    };
+
+    auto getSubTask = [&]( AABBTreePoints::NodeId n )
+    {
+        float distSq = ( tree.nodes()[n].box.getBoxClosestPointTo( center ) - center ).lengthSq();
+        return SubTask( n, distSq );
+    };
+
+    addSubTask( getSubTask( tree.rootNodeId() ) );
+
+    while ( stackSize > 0 )
+    {
+        const auto s = subtasks[--stackSize];
+        if ( !( s.distSq < boundSq ) )
+            continue; // the bound has decreased since the node was added
+        const auto& node = tree[s.n];
+
+        if ( node.leaf() )
+        {
+            auto [first, last] = node.getLeafPointRange();
+            for ( int i = first; i < last; ++i )
+            {
+                const float distSq = ( orderedPoints[i].coord - center ).lengthSq();
+                if ( !( distSq < boundSq ) )
+                    continue;
+                if ( res.size() < size_t( k ) )
+                {
+                    res.push_back( { orderedPoints[i].id, distSq } );
+                    std::push_heap( res.begin(), res.end(), closer );
+                }
+                else
+                {
+                    std::pop_heap( res.begin(), res.end(), closer );
+                    res.back() = { orderedPoints[i].id, distSq };
+                    std::push_heap( res.begin(), res.end(), closer );
+                }
+                if ( res.size() == size_t( k ) )
+                    boundSq = std::min( boundSq, res.front().distSq );
+            }
+            continue;
+        }
+
+        auto s1 = getSubTask( node.leftOrFirst );
+        auto s2 = getSubTask( node.rightOrLast );
+        if ( s1.distSq < s2.distSq )
+            std::swap( s1, s2 );
+        assert( s1.distSq >= s2.distSq );
+        addSubTask( s1 ); // larger distance to look later
+        addSubTask( s2 ); // smaller distance to look first
+    }
+
+    std::sort_heap( res.begin(), res.end(), closer );
+}
+
+std::vector<NearestPoint> findKNearestPoints( const PointCloud& pointCloud, const Vector3f& center, int k, float maxDistSq )
+{
+    std::vector<NearestPoint> res;
+    findKNearestPoints( pointCloud.getAABBTree(), center, k, res, maxDistSq );
+    return res;
+}
+
+// makes the table with numRows rows of up to k neighbors each:
+// query( fill ) must call fill( row, found ) exactly once for each row (possibly from parallel threads)
+template<typename Q>
+static NearestPointsTable makeNearestPointsTable( size_t numRows, int k, Q && query )
+{
+    MR_TIMER
+    NearestPointsTable res;
+    res.offsets.resize( numRows + 1, 0 );
+    if ( k <= 0 || numRows == 0 )
+        return res;
+
+    // rows of fixed size k are filled first
+    std::vector<NearestPoint> fixedRows( numRows * k );
+    auto fill = [&]( size_t row, const std::vector<NearestPoint> & found )
+    {
+        assert( found.size() <= size_t( k ) );
+        std::copy( found.begin(), found.end(), fixedRows.begin() + row * k );
+        res.offsets[row + 1] = found.size();
+    };
+    query( fill );
+
+    for ( size_t i = 0; i < numRows; ++i )
+        res.offsets[i + 1] += res.offsets[i];
+    if ( res.offsets.back() == fixedRows.size() )
+    {
+        // all rows are full
+        res.neighbors = std::move( fixedRows );
+        return res;
+    }
+
+    res.neighbors.resize( res.offsets.back() );
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, numRows ), [&]( const tbb::blocked_range<size_t> & range )
+    {
+        for ( size_t i = range.begin(); i < range.end(); ++i )
+            std::copy( fixedRows.begin() + i * k, fixedRows.begin() + i * k + res.numNeighbors( i ), res.neighbors.begin() + res.offsets[i] );
+    } );
+    return res;
+}
+
+NearestPointsTable findKNearestPoints( const AABBTreePoints& tree, const std::vector<Vector3f>& centers, int k, float maxDistSq )
+{
+    MR_TIMER
+    return makeNearestPointsTable( centers.size(), k, [&]( auto && fill )
+    {
+        tbb::parallel_for( tbb::blocked_range<size_t>( 0, centers.size() ), [&]( const tbb::blocked_range<size_t> & range )
+        {
+            std::vector<NearestPoint> found;
+            for ( size_t i = range.begin(); i < range.end(); ++i )
+            {
+                findKNearestPoints( tree, centers[i], k, found, maxDistSq );
+                fill( i, found );
+            }
+        } );
+    } );
+}
+
+NearestPointsTable buildKNearestGraph( const PointCloud& pointCloud, int k, float maxDistSq )
+{
+    MR_TIMER
+    const auto & tree = pointCloud.getAABBTree();
+    const auto & orderedPoints = tree.orderedPoints();
+    return makeNearestPointsTable( pointCloud.points.size(), k, [&]( auto && fill )
+    {
+        // the points are processed in the order of the tree to query nearby points in a thread one after another
+        tbb::parallel_for( tbb::blocked_range<size_t>( 0, orderedPoints.size() ), [&]( const tbb::blocked_range<size_t> & range )
+        {
+            std::vector<NearestPoint> found;
+            for ( size_t i = range.begin(); i < range.end(); ++i )
+            {
+                const auto & p = orderedPoints[i];
+                findKNearestPoints( tree, p.coord, k + 1, found, maxDistSq );
+                // exclude the point itself, which can be not the first in case of coinciding points
+                auto it = std::find_if( found.begin(), found.end(), [&]( const NearestPoint & n ) { return n.id == p.id; } );
+                if ( it != found.end() )
+                    found.erase( it );
+                else if ( found.size() > size_t( k ) )
+                    found.pop_back();
+                fill( size_t( p.id ), found );
+            }
+        } );
+    } );
+}
+
+TEST(MRMesh, PointsKNearest)
+{
+    PointCloud cloud;
+    std::mt19937 rng( 1 );
+    std::uniform_real_distribution<float> coord( -1.0f, 1.0f );
+    constexpr int NumPoints = 5000;
+    for ( int i = 0; i < NumPoints; ++i )
+        cloud.points.emplace_back( coord( rng ), coord( rng ), coord( rng ) );
+    cloud.validPoints.resize( NumPoints, true );
+    cloud.validPoints.reset( 7_v ); // one invalid point
+
+    constexpr int K = 10;
+    auto bruteForce = [&]( const Vector3f & center, float maxDistSq )
+    {
+        std::vector<NearestPoint> all;
+        for ( auto v : cloud.validPoints )
+        {
+            const float distSq = ( cloud.points[v] - center ).lengthSq();
+            if ( distSq < maxDistSq )
+                all.push_back( { v, distSq } );
+        }
+        std::sort( all.begin(), all.end(), closer );
+        if ( all.size() > K )
+            all.resize( K );
+        return all;
+    };
+
+    std::vector<Vector3f> centers;
+    for ( int i = 0; i < 100; ++i )
+        centers.emplace_back( coord( rng ), coord( rng ), coord( rng ) );
+    centers.emplace_back( 10.0f, 10.0f, 10.0f );
+    for ( const auto & c : centers )
+    {
+        const auto found = findKNearestPoints( cloud, c, K );
+        const auto expected = bruteForce( c, FLT_MAX );
+        ASSERT_EQ( found.size(), expected.size() );
+        for ( size_t i = 0; i < found.size(); ++i )
+        {
+            EXPECT_EQ( found[i].id, expected[i].id );
+            EXPECT_EQ( found[i].distSq, expected[i].distSq );
+        }
+    }
+
+    // limited distance gives incomplete rows
+    const float maxDistSq = 0.01f;
+    const auto table = findKNearestPoints( cloud.getAABBTree(), centers, K, maxDistSq );
+    ASSERT_EQ( table.size(), centers.size() );
+    EXPECT_EQ( table.numNeighbors( centers.size() - 1 ), 0 );
+    for ( size_t i = 0; i < centers.size(); ++i )
+    {
+        const auto expected = bruteForce( centers[i], maxDistSq );
+        ASSERT_EQ( table.numNeighbors( i ), expected.size() );
+        for ( size_t j = 0; j < expected.size(); ++j )
+            EXPECT_EQ( table.begin( i )[j].id, expected[j].id );
+    }
+
+    const auto graph = buildKNearestGraph( cloud, K );
+    ASSERT_EQ( graph.size(), cloud.points.size() );
+    EXPECT_EQ( graph.numNeighbors( 7 ), 0 );
+    for ( auto v : cloud.validPoints )
+    {
+        ASSERT_EQ( graph.numNeighbors( v ), K );
+        for ( auto p = graph.begin( v ); p != graph.end( v ); ++p )
+        {
+            EXPECT_NE( p->id, v );
+            EXPECT_TRUE( cloud.validPoints.test( p->id ) );
+        }
+        EXPECT_TRUE( std::is_sorted( graph.begin( v ), graph.end( v ), closer ) );
+    }
+}
+
+} //namespace MR
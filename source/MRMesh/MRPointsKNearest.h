@@ -0,0 +1,59 @@
+#pragma once
+#include "MRMeshFwd.h"
+#include "MRId.h"
+#include <cfloat>
+#include <vector>
+
+namespace MR
+{
+
+/// \addtogroup AABBTreeGroup
+/// \{
+
+/// one point found by k-nearest neighbors search
+struct NearestPoint
+{
+    VertId id;
+    float distSq = FLT_MAX;
+};
+
+/// compact (CSR) table of nearest neighbors for many queries:
+/// the neighbors of i-th query are stored in neighbors[offsets[i], offsets[i+1]) in the order of increasing distance
+struct NearestPointsTable
+{
+    std::vector<size_t> offsets;
+    std::vector<NearestPoint> neighbors;
+
+    /// returns the number of queries in the table
+    [[nodiscard]] size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    /// returns the pointer on the first neighbor of i-th query
+    [[nodiscard]] const NearestPoint * begin( size_t i ) const { return neighbors.data() + offsets[i]; }
+    /// returns the pointer after the last neighbor of i-th query
+    [[nodiscard]] const NearestPoint * end( size_t i ) const { return neighbors.data() + offsets[i + 1]; }
+    /// returns the number of neighbors of i-th query
+    [[nodiscard]] size_t numNeighbors( size_t i ) const { return offsets[i + 1] - offsets[i]; }
+};
+
+/// finds up to k points of the tree nearest to given center and located closer than sqrt( maxDistSq ) from it;
+/// the tree is traversed from the nodes closest to the center, and the found points are kept in a bounded max-heap,
+/// which prunes all nodes farther than current k-th nearest point;
+/// \param res receives the found points sorted by increasing distance (previous content is lost)
+MRMESH_API void findKNearestPoints( const AABBTreePoints& tree, const Vector3f& center, int k, std::vector<NearestPoint>& res,
+    float maxDistSq = FLT_MAX );
+
+/// finds up to k valid points of the cloud nearest to given center, see findKNearestPoints above
+[[nodiscard]] MRMESH_API std::vector<NearestPoint> findKNearestPoints( const PointCloud& pointCloud, const Vector3f& center, int k,
+    float maxDistSq = FLT_MAX );
+
+/// finds up to k nearest points of the tree for each of given centers in parallel threads;
+/// the result has one row per center in the same order
+[[nodiscard]] MRMESH_API NearestPointsTable findKNearestPoints( const AABBTreePoints& tree, const std::vector<Vector3f>& centers, int k,
+    float maxDistSq = FLT_MAX );
+
+/// builds the graph of k nearest neighbors for all valid points of the cloud in parallel threads (the point itself is excluded);
+/// the result has one row per VertId (empty for invalid points) and can be reused by several algorithms
+[[nodiscard]] MRMESH_API NearestPointsTable buildKNearestGraph( const PointCloud& pointCloud, int k, float maxDistSq = FLT_MAX );
+
+/// \}
+
+} // namespace MR
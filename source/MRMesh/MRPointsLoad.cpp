@@ -6,7 +6,15 @@
 #include "MRStreamOperators.h"
 #include "MRProgressReadWrite.h"
 #include "MRPointCloud.h"
+#include "MRTextParse.h"
+#include "MRPlyHeader.h"
+#include "MRPointsSave.h"
+#include "MRSerializer.h"
+#include "MRGTest.h"
+#include <cstring>
 #include <fstream>
+#include <optional>
+#include <sstream>
 
 #ifndef MRMESH_NO_OPENCTM
 #include "OpenCTM/openctm.h"
@@ -360,5 +368,473 @@ tl::expected<MR::PointCloud, std::string> fromAnySupportedFormat( std::istream&
     return res;
 }
 
+// collects the points and passes them to the receiver by chunks of fixed size
+class PointsChunkEmitter
+{
+public:
+    PointsChunkEmitter( const PointsChunkCallback& onChunk, size_t chunkSize ) : onChunk_( onChunk ), chunkSize_( std::max( chunkSize, size_t( 1 ) ) ) {}
+
+    // these properties can be changed only before the first point is added
+    void setHasNormals( bool on ) { assert( points_.empty() ); hasNormals_ = on; }
+    void setHasColors( bool on ) { assert( points_.empty() ); hasColors_ = on; }
+
+    // passes collected points with their normals and colors to the receiver, and stops collecting normals and colors of next points;
+    // returns false if the receiver has stopped the streaming
+    bool dropExtras()
+    {
+        const bool res = flush();
+        hasNormals_ = false;
+        hasColors_ = false;
+        return res;
+    }
+
+    // adds next point, returns false if the receiver has stopped the streaming
+    bool add( const Vector3f& p, const Vector3f& n = {}, const Color& c = {} )
+    {
+        points_.push_back( p );
+        if ( hasNormals_ )
+            normals_.push_back( n );
+        if ( hasColors_ )
+            colors_.push_back( c );
+        return points_.size() < chunkSize_ || flush();
+    }
+
+    // passes all collected points to the receiver, returns false if the receiver has stopped the streaming
+    bool flush()
+    {
+        if ( points_.empty() )
+            return true;
+        PointsChunk chunk;
+        chunk.points = points_.data();
+        chunk.normals = hasNormals_ ? normals_.data() : nullptr;
+        chunk.colors = hasColors_ ? colors_.data() : nullptr;
+        chunk.size = points_.size();
+        const bool res = onChunk_( chunk );
+        points_.clear();
+        normals_.clear();
+        colors_.clear();
+        return res;
+    }
+
+private:
+    const PointsChunkCallback& onChunk_;
+    size_t chunkSize_ = 0;
+    bool hasNormals_ = false;
+    bool hasColors_ = false;
+    std::vector<Vector3f> points_, normals_;
+    std::vector<Color> colors_;
+};
+
+// parses one line of text file with a point and optionally three additional numbers (normal or color),
+// returns the number of parsed numbers: 0 if the line has no point, 3 or 6, or -1 in case of error
+using PointLineParser = int( * )( const char* p, const char* end, Vector3f& point, Vector3f& extra );
+
+static int parseThreeNumbers( const char* & p, const char* end, Vector3f& v )
+{
+    for ( int i = 0; i < 3; ++i )
+    {
+        p = parseNumber( p, end, v[i] );
+        if ( !p )
+            return i;
+    }
+    return 3;
+}
+
+static int parsePointAndExtra( const char* p, const char* end, Vector3f& point, Vector3f& extra )
+{
+    if ( parseThreeNumbers( p, end, point ) != 3 )
+        return -1;
+    return parseThreeNumbers( p, end, extra ) == 3 ? 6 : 3;
+}
+
+static int parseAscLine( const char* p, const char* end, Vector3f& point, Vector3f& normal )
+{
+    p = skipSpaces( p, end );
+    if ( p == end || *p == '#' )
+        return 0;
+    return parsePointAndExtra( p, end, point, normal );
+}
+
+static int parseObjLine( const char* p, const char* end, Vector3f& point, Vector3f& color )
+{
+    p = skipSpaces( p, end );
+    if ( end - p < 2 || p[0] != 'v' || ( p[1] != ' ' && p[1] != '\t' ) )
+        return 0;
+    return parsePointAndExtra( p + 1, end, point, color );
+}
+
+// the points parsed from a part of text
+struct TextPoints
+{
+    std::vector<Vector3f> points;
+    std::vector<Vector3f> extras; // for the first points, while all of them have extras
+    bool error = false;
+};
+
+// reads text file by large blocks of whole lines, parses the lines of each block in parallel,
+// and passes the points to the emitter in the order of the file
+static tl::expected<void, std::string> streamTextPoints( const std::filesystem::path& file, PointLineParser parseLine, bool extraIsColor,
+    const PointsChunkCallback& onChunk, size_t chunkSize, ProgressCallback callback, const char* formatName )
+{
+    MR_TIMER
+    std::ifstream in( file, std::ifstream::binary );
+    if ( !in )
+        return tl::make_unexpected( std::string( "Cannot open file for reading" ) );
+    std::error_code ec;
+    const float fileSize = float( std::filesystem::file_size( file, ec ) );
+
+    PointsChunkEmitter emitter( onChunk, chunkSize );
+    std::optional<bool> hasExtras; // decided by the first point
+    constexpr size_t BlockSize = size_t( 16 ) << 20;
+    std::string block;
+    size_t carried = 0; // the beginning of not finished line from previous block
+    size_t readBytes = 0;
+    for ( bool eof = false; !eof; )
+    {
+        block.resize( carried + BlockSize );
+        in.read( block.data() + carried, BlockSize );
+        const size_t got = size_t( in.gcount() );
+        readBytes += got;
+        eof = got < BlockSize;
+        if ( !eof && in.fail() )
+            return tl::make_unexpected( std::string( formatName ) + "-stream read error" );
+        const size_t size = carried + got;
+        size_t end = size;
+        if ( !eof )
+        {
+            const auto lastNewLine = block.rfind( '\n', size - 1 );
+            if ( lastNewLine == std::string::npos )
+            {
+                carried = size; // the line is longer than the block
+                continue;
+            }
+            end = lastNewLine + 1;
+        }
+
+        const auto offsets = splitTextByLines( block.data(), end );
+        std::vector<TextPoints> parts( offsets.size() - 1 );
+        parallelForChunks( parts.size(), [&]( size_t i )
+        {
+            auto& part = parts[i];
+            const char* p = block.data() + offsets[i];
+            const char* partEnd = block.data() + offsets[i + 1];
+            Vector3f point, extra;
+            while ( p < partEnd )
+            {
+                const char* lineEnd = (const char*)std::memchr( p, '\n', partEnd - p );
+                if ( !lineEnd )
+                    lineEnd = partEnd;
+                const int n = parseLine( p, lineEnd, point, extra );
+                if ( n < 0 )
+                {
+                    part.error = true;
+                    return;
+                }
+                if ( n > 0 )
+                {
+                    if ( n == 6 && part.extras.size() == part.points.size() )
+                        part.extras.push_back( extra );
+                    part.points.push_back( point );
+                }
+                p = lineEnd + 1;
+            }
+        } );
+
+        for ( const auto& part : parts )
+        {
+            if ( part.error )
+                return tl::make_unexpected( std::string( formatName ) + "-format parse error" );
+            if ( part.points.empty() )
+                continue;
+            if ( !hasExtras )
+            {
+                hasExtras = !part.extras.empty();
+                if ( extraIsColor )
+                    emitter.setHasColors( *hasExtras );
+                else
+                    emitter.setHasNormals( *hasExtras );
+            }
+            for ( size_t i = 0; i < part.points.size(); ++i )
+            {
+                if ( *hasExtras && i >= part.extras.size() )
+                {
+                    // same as in-core loading: the extras are dropped once a point without them is met
+                    hasExtras = false;
+                    if ( !emitter.dropExtras() )
+                        return {};
+                }
+                bool go = true;
+                if ( !*hasExtras )
+                    go = emitter.add( part.points[i] );
+                else if ( extraIsColor )
+                    go = emitter.add( part.points[i], {}, Color( part.extras[i].x, part.extras[i].y, part.extras[i].z ) );
+                else
+                    go = emitter.add( part.points[i], part.extras[i] );
+                if ( !go )
+                    return {};
+            }
+        }
+
+        carried = size - end;
+        std::memmove( block.data(), block.data() + end, carried );
+        if ( callback && fileSize > 0 && !callback( readBytes / fileSize ) )
+            return tl::make_unexpected( std::string( "Loading canceled" ) );
+    }
+    emitter.flush();
+    return {};
+}
+
+tl::expected<void, std::string> streamFromObj( const std::filesystem::path& file, const PointsChunkCallback& onChunk, size_t chunkSize, ProgressCallback callback )
+{
+    return addFileNameInError( streamTextPoints( file, parseObjLine, true, onChunk, chunkSize, callback, "OBJ" ), file );
+}
+
+tl::expected<void, std::string> streamFromAsc( const std::filesystem::path& file, const PointsChunkCallback& onChunk, size_t chunkSize, ProgressCallback callback )
+{
+    return addFileNameInError( streamTextPoints( file, parseAscLine, false, onChunk, chunkSize, callback, "ASC" ), file );
+}
+
+tl::expected<void, std::string> streamFromPly( const std::filesystem::path& file, const PointsChunkCallback& onChunk, size_t chunkSize, ProgressCallback callback )
+{
+    MR_TIMER
+    using namespace detail;
+    std::ifstream in( file, std::ifstream::binary );
+    if ( !in )
+        return tl::make_unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
+    std::error_code ec;
+    const float fileSize = float( std::filesystem::file_size( file, ec ) );
+    auto error = [&]( const char* msg )
+    {
+        return tl::make_unexpected( std::string( msg ) + ": " + utf8string( file ) );
+    };
+
+    const auto header = readPlyHeader( in );
+    if ( !header )
+        return error( header.error().c_str() );
+    const auto& elements = header->elements;
+    const auto format = header->format;
+    std::string line;
+
+    const int vertexElement = header->find( "vertex" );
+    if ( vertexElement < 0 )
+        return error( "PLY file does not contain vertices" );
+
+    // skip preceding elements
+    for ( int e = 0; e < vertexElement; ++e )
+    {
+        const auto& el = elements[e];
+        if ( format == PlyFormat::Ascii )
+        {
+            for ( size_t i = 0; i < el.count; ++i )
+                std::getline( in, line );
+            continue;
+        }
+        if ( el.hasLists() )
+            return error( "PLY file has the element with lists before vertices" );
+        in.seekg( el.count * el.rowSize(), std::ios_base::cur );
+    }
+
+    const auto& vel = elements[vertexElement];
+    if ( vel.hasLists() )
+        return error( "PLY file has list property in vertices" );
+    const int pos[3] = { vel.find( "x" ), vel.find( "y" ), vel.find( "z" ) };
+    if ( pos[0] < 0 || pos[1] < 0 || pos[2] < 0 )
+        return error( "PLY file does not contain vertex coordinates" );
+    const int norm[3] = { vel.find( "nx" ), vel.find( "ny" ), vel.find( "nz" ) };
+    const bool hasNormals = norm[0] >= 0 && norm[1] >= 0 && norm[2] >= 0;
+    int col[3] = { vel.find( "red" ), vel.find( "green" ), vel.find( "blue" ) };
+    if ( col[0] < 0 || col[1] < 0 || col[2] < 0 )
+    {
+        col[0] = vel.find( "r" );
+        col[1] = vel.find( "g" );
+        col[2] = vel.find( "b" );
+    }
+    const bool hasColors = col[0] >= 0 && col[1] >= 0 && col[2] >= 0;
+
+    PointsChunkEmitter emitter( onChunk, chunkSize );
+    emitter.setHasNormals( hasNormals );
+    emitter.setHasColors( hasColors );
+
+    std::vector<double> values( vel.props.size() );
+    auto emitRow = [&]()
+    {
+        Vector3f p, n;
+        Color c;
+        for ( int i = 0; i < 3; ++i )
+            p[i] = float( values[pos[i]] );
+        if ( hasNormals )
+            for ( int i = 0; i < 3; ++i )
+                n[i] = float( values[norm[i]] );
+        if ( hasColors )
+        {
+            // floating-point colors are in [0,1], integer ones are in [0,255]
+            const bool floatColor = vel.props[col[0]].type == PlyType::Float32 || vel.props[col[0]].type == PlyType::Float64;
+            const auto channel = [&]( int i ) { return std::clamp( int( floatColor ? values[col[i]] * 255 + 0.5 : values[col[i]] ), 0, 255 ); };
+            c = Color( channel( 0 ), channel( 1 ), channel( 2 ) );
+        }
+        return emitter.add( p, n, c );
+    };
+
+    if ( format == PlyFormat::Ascii )
+    {
+        for ( size_t i = 0; i < vel.count; ++i )
+        {
+            if ( !std::getline( in, line ) )
+                return error( "PLY file read error" );
+            const char* p = line.data();
+            const char* end = p + line.size();
+            for ( auto& v : values )
+            {
+                p = parseNumber( p, end, v );
+                if ( !p )
+                    return error( "PLY file parse error" );
+            }
+            if ( !emitRow() )
+                return {};
+            if ( callback && !( i & 0xFFFF ) && !callback( float( in.tellg() ) / fileSize ) )
+                return tl::make_unexpected( std::string( "Loading canceled" ) );
+        }
+        emitter.flush();
+        return {};
+    }
+
+    const bool swapBytes = format == PlyFormat::BinaryBigEndian;
+    std::vector<size_t> offsets( vel.props.size() );
+    size_t rowSize = 0;
+    for ( size_t i = 0; i < vel.props.size(); ++i )
+    {
+        offsets[i] = rowSize;
+        rowSize += plyTypeSize( vel.props[i].type );
+    }
+    const size_t blockRows = std::max( chunkSize, size_t( 1 ) );
+    std::vector<char> block( blockRows * rowSize );
+    for ( size_t first = 0; first < vel.count; first += blockRows )
+    {
+        const size_t numRows = std::min( blockRows, vel.count - first );
+        if ( !in.read( block.data(), numRows * rowSize ) )
+            return error( "PLY file read error" );
+        for ( size_t r = 0; r < numRows; ++r )
+        {
+            const char* row = block.data() + r * rowSize;
+            for ( size_t i = 0; i < values.size(); ++i )
+                values[i] = readPlyValue( row + offsets[i], vel.props[i].type, swapBytes );
+            if ( !emitRow() )
+                return {};
+        }
+        if ( callback && !callback( float( in.tellg() ) / fileSize ) )
+            return tl::make_unexpected( std::string( "Loading canceled" ) );
+    }
+    emitter.flush();
+    return {};
 }
+
+tl::expected<void, std::string> streamFromAnySupportedFormat( const std::filesystem::path& file, const PointsChunkCallback& onChunk,
+                                                              size_t chunkSize, ProgressCallback callback )
+{
+    auto ext = utf8string( file.extension() );
+    for ( auto& c : ext )
+        c = (char) tolower( c );
+
+    if ( ext == ".ply" )
+        return streamFromPly( file, onChunk, chunkSize, callback );
+    if ( ext == ".obj" )
+        return streamFromObj( file, onChunk, chunkSize, callback );
+    if ( ext == ".asc" )
+        return streamFromAsc( file, onChunk, chunkSize, callback );
+    return tl::make_unexpected( std::string( "unsupported file extension for streaming" ) );
+}
+
+PointsStream makePointsStream( const std::filesystem::path& file, size_t chunkSize )
+{
+    return [file, chunkSize]( const PointsChunkCallback& onChunk )
+    {
+        return streamFromAnySupportedFormat( file, onChunk, chunkSize );
+    };
+}
+
+} // namespace PointsLoad
+
+TEST(MRMesh, PointsStreamLoad)
+{
+    UniqueTemporaryFolder folder( {} );
+    ASSERT_TRUE( bool( folder ) );
+
+    PointCloud cloud;
+    for ( int i = 0; i < 1000; ++i )
+        cloud.points.emplace_back( float( i ), 0.5f * i, -0.25f * i );
+    cloud.validPoints.resize( cloud.points.size(), true );
+
+    auto collect = [&]( const std::filesystem::path& path, size_t chunkSize, bool expectNormals )
+    {
+        std::vector<Vector3f> points;
+        auto res = PointsLoad::streamFromAnySupportedFormat( path, [&]( const PointsChunk& chunk )
+        {
+            EXPECT_LE( chunk.size, chunkSize );
+            EXPECT_EQ( chunk.normals != nullptr, expectNormals );
+            points.insert( points.end(), chunk.points, chunk.points + chunk.size );
+            return true;
+        }, chunkSize );
+        EXPECT_TRUE( res.has_value() );
+        return points;
+    };
+
+    const auto plyPath = folder / "points.ply";
+    ASSERT_TRUE( PointsSave::toPly( cloud, plyPath ).has_value() );
+    EXPECT_EQ( collect( plyPath, 7, false ), cloud.points.vec_ );
+
+    const auto ascPath = folder / "points.asc";
+    {
+        std::ofstream out( ascPath );
+        out << "# comment\n";
+        for ( const auto& p : cloud.points )
+            out << p.x << ' ' << p.y << ' ' << p.z << " 0 0 1\r\n";
+    }
+    EXPECT_EQ( collect( ascPath, 100, true ), cloud.points.vec_ );
+
+    // the normals are passed only for the points before the first point without normal
+    const auto mixedAscPath = folder / "mixed.asc";
+    {
+        std::ofstream out( mixedAscPath );
+        for ( int i = 0; i < cloud.points.size(); ++i )
+        {
+            const auto& p = cloud.points[VertId( i )];
+            out << p.x << ' ' << p.y << ' ' << p.z << ( i == 550 ? "\n" : " 0 0 1\n" );
+        }
+    }
+    std::vector<Vector3f> mixedPoints;
+    size_t numWithNormals = 0;
+    auto mixedRes = PointsLoad::streamFromAsc( mixedAscPath, [&]( const PointsChunk& chunk )
+    {
+        if ( chunk.normals )
+        {
+            EXPECT_EQ( numWithNormals, mixedPoints.size() );
+            numWithNormals += chunk.size;
+        }
+        mixedPoints.insert( mixedPoints.end(), chunk.points, chunk.points + chunk.size );
+        return true;
+    }, 100 );
+    EXPECT_TRUE( mixedRes.has_value() );
+    EXPECT_EQ( mixedPoints, cloud.points.vec_ );
+    EXPECT_EQ( numWithNormals, 550 );
+    EXPECT_TRUE( PointsLoad::fromAsc( mixedAscPath ).has_value() );
+
+    const auto objPath = folder / "points.obj";
+    {
+        std::ofstream out( objPath );
+        for ( const auto& p : cloud.points )
+            out << "v " << p.x << ' ' << p.y << ' ' << p.z << "\nvn 0 0 1\n";
+    }
+    EXPECT_EQ( collect( objPath, 1000, false ), cloud.points.vec_ );
+
+    // stopping by the receiver
+    size_t numPoints = 0;
+    auto res = PointsLoad::streamFromPly( plyPath, [&]( const PointsChunk& chunk )
+    {
+        numPoints += chunk.size;
+        return false;
+    }, 10 );
+    EXPECT_TRUE( res.has_value() );
+    EXPECT_EQ( numPoints, 10 );
 }
+
+} // namespace MR
@@ -3,6 +3,7 @@
 #include "MRMeshFwd.h"
 #include "MRIOFilters.h"
 #include "MRProgressCallback.h"
+#include "MRPointsStream.h"
 #include <tl/expected.hpp>
 #include <filesystem>
 #include <istream>
@@ -49,6 +50,31 @@ MRMESH_API tl::expected<PointCloud, std::string> fromAnySupportedFormat( const s
 MRMESH_API tl::expected<PointCloud, std::string> fromAnySupportedFormat( std::istream& in, const std::string& extension, Vector<Color, VertId>* colors = nullptr,
                                                                          ProgressCallback callback = {} );
 
+/// reads the points from .ply file and passes them to onChunk by chunks of given size without loading whole cloud in memory;
+/// the vertex element can be preceded only by elements without lists in binary files
+MRMESH_API tl::expected<void, std::string> streamFromPly( const std::filesystem::path& file, const PointsChunkCallback& onChunk,
+                                                          size_t chunkSize = DefaultPointsChunkSize, ProgressCallback callback = {} );
+
+/// reads the points (and the colors if the first vertex has them) from .obj file and passes them to onChunk by chunks of given size;
+/// once a vertex without color is met, the colors are not passed for it and all next vertices (chunk.colors is nullptr);
+/// the lines of the file are parsed in parallel by large blocks
+MRMESH_API tl::expected<void, std::string> streamFromObj( const std::filesystem::path& file, const PointsChunkCallback& onChunk,
+                                                          size_t chunkSize = DefaultPointsChunkSize, ProgressCallback callback = {} );
+
+/// reads the points (and the normals if the first point has them) from .asc file and passes them to onChunk by chunks of given size;
+/// once a point without normal is met, the normals are not passed for it and all next points (chunk.normals is nullptr),
+/// while fromAsc drops the normals of all points in this case;
+/// the lines of the file are parsed in parallel by large blocks
+MRMESH_API tl::expected<void, std::string> streamFromAsc( const std::filesystem::path& file, const PointsChunkCallback& onChunk,
+                                                          size_t chunkSize = DefaultPointsChunkSize, ProgressCallback callback = {} );
+
+/// detects the format from file extension and streams the points from it
+MRMESH_API tl::expected<void, std::string> streamFromAnySupportedFormat( const std::filesystem::path& file, const PointsChunkCallback& onChunk,
+                                                                         size_t chunkSize = DefaultPointsChunkSize, ProgressCallback callback = {} );
+
+/// returns the stream reading the points from given file each time it is started
+[[nodiscard]] MRMESH_API PointsStream makePointsStream( const std::filesystem::path& file, size_t chunkSize = DefaultPointsChunkSize );
+
 /// \}
 
 } // namespace PointsLoad
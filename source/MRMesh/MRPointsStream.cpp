@@ -0,0 +1,155 @@
+#include "MRPointsStream.h"
+#include "MRPointCloud.h"
+#include "MRColor.h"
+#include "MRTimer.h"
+#include "MRGTest.h"
+#include "MRPch/MRTBB.h"
+#include <cfloat>
+
+namespace MR
+{
+
+PointsStream pointsStreamFromCloud( const PointCloud& pointCloud, const Vector<Color, VertId>* colors, size_t chunkSize )
+{
+    return [&pointCloud, colors, chunkSize]( const PointsChunkCallback& callback ) -> tl::expected<void, std::string>
+    {
+        const bool hasNormals = pointCloud.normals.size() >= pointCloud.points.size();
+        const bool hasColors = colors && colors->size() >= pointCloud.points.size();
+        std::vector<Vector3f> points, normals;
+        std::vector<Color> chunkColors;
+        auto flush = [&]()
+        {
+            PointsChunk chunk;
+            chunk.points = points.data();
+            chunk.normals = hasNormals ? normals.data() : nullptr;
+            chunk.colors = hasColors ? chunkColors.data() : nullptr;
+            chunk.size = points.size();
+            const bool res = callback( chunk );
+            points.clear();
+            normals.clear();
+            chunkColors.clear();
+            return res;
+        };
+        for ( auto v : pointCloud.validPoints )
+        {
+            points.push_back( pointCloud.points[v] );
+            if ( hasNormals )
+                normals.push_back( pointCloud.normals[v] );
+            if ( hasColors )
+                chunkColors.push_back( ( *colors )[v] );
+            if ( points.size() >= chunkSize && !flush() )
+                return {};
+        }
+        if ( !points.empty() )
+            flush();
+        return {};
+    };
+}
+
+tl::expected<Box3f, std::string> computeBoundingBox( const PointsStream& stream )
+{
+    MR_TIMER
+    Box3f box;
+    auto res = stream( [&]( const PointsChunk& chunk )
+    {
+        box.include( tbb::parallel_reduce( tbb::blocked_range<size_t>( 0, chunk.size ), Box3f{},
+            [&]( const tbb::blocked_range<size_t>& range, Box3f curr )
+        {
+            for ( size_t i = range.begin(); i < range.end(); ++i )
+                curr.include( chunk.points[i] );
+            return curr;
+        },
+            []( Box3f a, const Box3f& b )
+        {
+            a.include( b );
+            return a;
+        } ) );
+        return true;
+    } );
+    if ( !res )
+        return tl::make_unexpected( std::move( res.error() ) );
+    return box;
+}
+
+tl::expected<Histogram, std::string> computeHistogram( const PointsStream& stream, const std::function<float( const Vector3f& )>& func,
+    size_t numBins, float min, float max )
+{
+    MR_TIMER
+    if ( min >= max )
+    {
+        min = FLT_MAX;
+        max = -FLT_MAX;
+        auto res = stream( [&]( const PointsChunk& chunk )
+        {
+            for ( size_t i = 0; i < chunk.size; ++i )
+            {
+                const float value = func( chunk.points[i] );
+                min = std::min( min, value );
+                max = std::max( max, value );
+            }
+            return true;
+        } );
+        if ( !res )
+            return tl::make_unexpected( std::move( res.error() ) );
+        if ( min > max )
+            return Histogram( 0, 0, numBins ); // empty stream
+    }
+
+    Histogram hist( min, max, numBins );
+    auto res = stream( [&]( const PointsChunk& chunk )
+    {
+        hist.addHistogram( tbb::parallel_reduce( tbb::blocked_range<size_t>( 0, chunk.size ), Histogram( min, max, numBins ),
+            [&]( const tbb::blocked_range<size_t>& range, Histogram curr )
+        {
+            for ( size_t i = range.begin(); i < range.end(); ++i )
+                curr.addSample( func( chunk.points[i] ) );
+            return curr;
+        },
+            []( Histogram a, const Histogram& b )
+        {
+            a.addHistogram( b );
+            return a;
+        } ) );
+        return true;
+    } );
+    if ( !res )
+        return tl::make_unexpected( std::move( res.error() ) );
+    return hist;
+}
+
+TEST(MRMesh, PointsStream)
+{
+    PointCloud cloud;
+    for ( int i = 0; i < 1000; ++i )
+        cloud.points.emplace_back( float( i ), float( i % 10 ), 0.0f );
+    cloud.validPoints.resize( cloud.points.size(), true );
+    cloud.validPoints.reset( 999_v );
+
+    const auto stream = pointsStreamFromCloud( cloud, nullptr, 64 );
+    size_t numPoints = 0;
+    auto res = stream( [&]( const PointsChunk& chunk )
+    {
+        EXPECT_LE( chunk.size, 64 );
+        EXPECT_EQ( chunk.normals, nullptr );
+        numPoints += chunk.size;
+        return true;
+    } );
+    EXPECT_TRUE( res.has_value() );
+    EXPECT_EQ( numPoints, 999 );
+
+    const auto box = computeBoundingBox( stream );
+    ASSERT_TRUE( box.has_value() );
+    EXPECT_EQ( box->min, Vector3f( 0, 0, 0 ) );
+    EXPECT_EQ( box->max, Vector3f( 998, 9, 0 ) );
+
+    const auto hist = computeHistogram( stream, []( const Vector3f& p ) { return p.y; }, 10 );
+    ASSERT_TRUE( hist.has_value() );
+    EXPECT_EQ( hist->getBins().size(), 10 );
+    size_t sum = 0;
+    for ( auto b : hist->getBins() )
+        sum += b;
+    EXPECT_EQ( sum, 999 );
+    EXPECT_EQ( hist->getBins().front(), 100 );
+}
+
+} //namespace MR
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "MRMeshFwd.h"
+#include "MRHistogram.h"
+#include "MRBox.h"
+#include <tl/expected.hpp>
+#include <functional>
+#include <string>
+
+namespace MR
+{
+
+/// \addtogroup PointCloudGroup
+/// \{
+
+/// default number of points in one chunk of streamed point cloud
+constexpr size_t DefaultPointsChunkSize = size_t( 1 ) << 16;
+
+/// next chunk of points passed while a point cloud is streamed
+struct PointsChunk
+{
+    const Vector3f* points = nullptr;
+    /// the normals of the points in the chunk, or nullptr if the stream has no normals
+    const Vector3f* normals = nullptr;
+    /// the colors of the points in the chunk, or nullptr if the stream has no colors
+    const Color* colors = nullptr;
+    size_t size = 0;
+};
+
+/// receives next chunk of streamed points;
+/// \return false to stop the streaming
+using PointsChunkCallback = std::function<bool( const PointsChunk& )>;
+
+/// passes all points of some cloud to the callback by consecutive chunks;
+/// a stream can be started several times, and it shall pass the same points in the same order each time
+using PointsStream = std::function<tl::expected<void, std::string>( const PointsChunkCallback& )>;
+
+/// makes the stream of valid points of given cloud (the cloud and colors must outlive the stream)
+[[nodiscard]] MRMESH_API PointsStream pointsStreamFromCloud( const PointCloud& pointCloud, const Vector<Color, VertId>* colors = nullptr,
+    size_t chunkSize = DefaultPointsChunkSize );
+
+/// finds the bounding box of all points in the stream in one pass
+MRMESH_API tl::expected<Box3f, std::string> computeBoundingBox( const PointsStream& stream );
+
+/// computes the histogram of given function of points in the stream;
+/// if min >= max, then the range of the function is found in additional pass over the stream
+MRMESH_API tl::expected<Histogram, std::string> computeHistogram( const PointsStream& stream, const std::function<float( const Vector3f& )>& func,
+    size_t numBins, float min = 0, float max = 0 );
+
+/// \}
+
+} // namespace MR
@@ -0,0 +1,192 @@
+#pragma once
+
+// the helpers to split the space on tiles with approximately equal numbers of points for out-of-core processing,
+// they are not a part of public API
+
+#include "MRBox.h"
+#include "MRVector3.h"
+#include <tl/expected.hpp>
+#include <algorithm>
+#include <climits>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace MR
+{
+
+namespace detail
+{
+
+// number of cells along each dimension of the histogram of points used for tiling
+constexpr int HistRes = 64;
+
+// uniform grid of HistRes^3 cells covering the bounding box of all points
+struct PointsGrid
+{
+    Box3f box;
+    Vector3f cellSize;
+
+    explicit PointsGrid( const Box3f& b ) : box( b )
+    {
+        // avoid zero cell size for flat clouds
+        const float minSize = std::max( box.diagonal(), 1.0f ) * 1e-6f;
+        for ( int i = 0; i < 3; ++i )
+            cellSize[i] = std::max( box.max[i] - box.min[i], minSize ) / HistRes;
+    }
+
+    Vector3i cell( const Vector3f& p ) const
+    {
+        Vector3i res;
+        for ( int i = 0; i < 3; ++i )
+            res[i] = std::clamp( int( ( p[i] - box.min[i] ) / cellSize[i] ), 0, HistRes - 1 );
+        return res;
+    }
+
+    static size_t index( const Vector3i& c )
+    {
+        return ( size_t( c.z ) * HistRes + c.y ) * HistRes + c.x;
+    }
+
+    // returns the box in space of cells [lo, hi)
+    Box3f cellsBox( const Vector3i& lo, const Vector3i& hi ) const
+    {
+        Box3f res;
+        for ( int i = 0; i < 3; ++i )
+        {
+            res.min[i] = box.min[i] + lo[i] * cellSize[i];
+            res.max[i] = box.min[i] + hi[i] * cellSize[i];
+        }
+        return res;
+    }
+};
+
+// the number of points in the cells of the grid, which can be summed over any box of cells in constant time
+class PointsHistogram
+{
+public:
+    PointsHistogram() : sums_( size_t( HistRes + 1 ) * ( HistRes + 1 ) * ( HistRes + 1 ), 0 ) {}
+
+    void add( const Vector3i& c ) { ++sums_[idx_( c.x + 1, c.y + 1, c.z + 1 )]; }
+
+    // returns the number of points in given cell, valid only before accumulate()
+    size_t cellCount( const Vector3i& c ) const { return sums_[idx_( c.x + 1, c.y + 1, c.z + 1 )]; }
+
+    // converts the numbers of points in the cells into prefix sums, must be called after all add()
+    void accumulate()
+    {
+        for ( int z = 1; z <= HistRes; ++z )
+            for ( int y = 1; y <= HistRes; ++y )
+                for ( int x = 1; x <= HistRes; ++x )
+                    sums_[idx_( x, y, z )] += sums_[idx_( x - 1, y, z )];
+        for ( int z = 1; z <= HistRes; ++z )
+            for ( int y = 1; y <= HistRes; ++y )
+                for ( int x = 1; x <= HistRes; ++x )
+                    sums_[idx_( x, y, z )] += sums_[idx_( x, y - 1, z )];
+        for ( int z = 1; z <= HistRes; ++z )
+            for ( int y = 1; y <= HistRes; ++y )
+                for ( int x = 1; x <= HistRes; ++x )
+                    sums_[idx_( x, y, z )] += sums_[idx_( x, y, z - 1 )];
+    }
+
+    // returns the number of points in the cells [lo, hi) clipped by the grid, valid only after accumulate()
+    size_t count( Vector3i lo, Vector3i hi ) const
+    {
+        for ( int i = 0; i < 3; ++i )
+        {
+            lo[i] = std::clamp( lo[i], 0, HistRes );
+            hi[i] = std::clamp( hi[i], 0, HistRes );
+            if ( lo[i] >= hi[i] )
+                return 0;
+        }
+        // the intermediate sums can wrap around, but the final result is correct in unsigned arithmetic
+        return sums_[idx_( hi.x, hi.y, hi.z )]
+            - sums_[idx_( lo.x, hi.y, hi.z )] - sums_[idx_( hi.x, lo.y, hi.z )] - sums_[idx_( hi.x, hi.y, lo.z )]
+            + sums_[idx_( lo.x, lo.y, hi.z )] + sums_[idx_( lo.x, hi.y, lo.z )] + sums_[idx_( hi.x, lo.y, lo.z )]
+            - sums_[idx_( lo.x, lo.y, lo.z )];
+    }
+
+private:
+    static size_t idx_( int x, int y, int z ) { return ( size_t( z ) * ( HistRes + 1 ) + y ) * ( HistRes + 1 ) + x; }
+    std::vector<size_t> sums_;
+};
+
+struct Tile
+{
+    Vector3i lo, hi; // the range of grid cells in the core of the tile
+    Box3f core;
+    Box3f expanded; // the core with the margins
+};
+
+// splits the cells [lo, hi) in kd-tree manner until the number of points in each tile with its margins fits in maxTilePoints;
+// returns error if a single cell with its margins has more points
+inline tl::expected<void, std::string> splitOnTiles( const PointsGrid& grid, const PointsHistogram& hist, const Vector3i& marginCells, size_t maxTilePoints,
+    const Vector3i& lo, const Vector3i& hi, std::vector<Tile>& tiles )
+{
+    const size_t corePoints = hist.count( lo, hi );
+    if ( corePoints == 0 )
+        return {};
+
+    int splitDim = -1;
+    float maxSize = 0;
+    for ( int i = 0; i < 3; ++i )
+    {
+        const float size = ( hi[i] - lo[i] ) * grid.cellSize[i];
+        if ( hi[i] - lo[i] > 1 && size > maxSize )
+        {
+            splitDim = i;
+            maxSize = size;
+        }
+    }
+    const size_t tilePoints = hist.count( lo - marginCells, hi + marginCells );
+    if ( tilePoints <= maxTilePoints )
+    {
+        tiles.push_back( { lo, hi, grid.cellsBox( lo, hi ), Box3f{} } );
+        return {};
+    }
+    if ( splitDim < 0 )
+        return tl::make_unexpected( "The densest part of the input has " + std::to_string( tilePoints ) +
+            " elements, which do not fit in the memory budget for " + std::to_string( maxTilePoints ) + " elements" );
+
+    // find the plane between cells balancing the numbers of points on both sides
+    int bestSplit = lo[splitDim] + 1;
+    size_t bestDiff = SIZE_MAX;
+    for ( int s = lo[splitDim] + 1; s < hi[splitDim]; ++s )
+    {
+        auto leftHi = hi;
+        leftHi[splitDim] = s;
+        const size_t left2 = 2 * hist.count( lo, leftHi );
+        const size_t diff = left2 > corePoints ? left2 - corePoints : corePoints - left2;
+        if ( diff < bestDiff )
+        {
+            bestDiff = diff;
+            bestSplit = s;
+        }
+    }
+    auto leftHi = hi;
+    leftHi[splitDim] = bestSplit;
+    auto rightLo = lo;
+    rightLo[splitDim] = bestSplit;
+    auto res = splitOnTiles( grid, hist, marginCells, maxTilePoints, lo, leftHi, tiles );
+    if ( !res )
+        return res;
+    return splitOnTiles( grid, hist, marginCells, maxTilePoints, rightLo, hi, tiles );
+}
+
+// removes temporary files on exit
+struct TempFiles
+{
+    std::vector<std::filesystem::path> files;
+    ~TempFiles()
+    {
+        for ( const auto& f : files )
+        {
+            std::error_code ec;
+            std::filesystem::remove( f, ec );
+        }
+    }
+};
+
+} //namespace detail
+
+} //namespace MR
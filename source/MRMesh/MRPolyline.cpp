@@ -257,6 +257,13 @@ const AABBTreePolyline<V>& Polyline<V>::getAABBTree() const
     return AABBTreeOwner_.getOrCreate( [this]{ return AABBTreePolyline<V>( *this ); } );
 }
 
+template<typename V>
+const AABBTreePolyline<V>& Polyline<V>::rebuildAABBTree( const AABBTreeSettings & settings )
+{
+    AABBTreeOwner_.reset();
+    return AABBTreeOwner_.getOrCreate( [this, &settings]{ return AABBTreePolyline<V>( *this, settings ); } );
+}
+
 template<typename V>
 size_t Polyline<V>::heapBytes() const
 {
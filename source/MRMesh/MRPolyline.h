@@ -61,6 +61,9 @@ public:
     MRMESH_API const AABBTreePolyline<V>& getAABBTree() const;
     /// returns cached aabb-tree for this polyline, but does not create it if it did not exist
     const AABBTreePolyline<V> * getAABBTreeNotCreate() const { return AABBTreeOwner_.get(); }
+    /// replaces cached aabb-tree for this polyline with the one built using given settings,
+    /// the tree will be rebuilt with default settings after next invalidateCaches()
+    MRMESH_API const AABBTreePolyline<V>& rebuildAABBTree( const AABBTreeSettings & settings );
 
     /// returns the minimal bounding box containing all valid vertices (implemented via getAABBTree())
     MRMESH_API Box<V> getBoundingBox() const;
@@ -2,12 +2,42 @@
 #include "MRHighPrecision.h"
 #include "MRVector2.h"
 #include "MRGTest.h"
+#include <cfloat>
 
 namespace MR
 {
 
+namespace
+{
+
+// the bound of relative error of 3x3 determinant computed in doubles from exactly represented inputs,
+// see o3derrboundA in J.R.Shewchuk "Adaptive Precision Floating-Point Arithmetic and Fast Robust Geometric Predicates"
+constexpr double cOrient3dErrBound = ( 7.0 + 56.0 * ( DBL_EPSILON / 2 ) ) * ( DBL_EPSILON / 2 );
+
+// computes the sign of determinant with rows (ax,ay,az), (bx,by,bz), (cx,cy,cz) in doubles;
+// returns 0 if the sign cannot be determined reliably this way
+inline int orient3dFiltered( double ax, double ay, double az, double bx, double by, double bz, double cx, double cy, double cz )
+{
+    const double bycz = by * cz, bzcy = bz * cy;
+    const double bzcx = bz * cx, bxcz = bx * cz;
+    const double bxcy = bx * cy, bycx = by * cx;
+    const double det = ax * ( bycz - bzcy ) + ay * ( bzcx - bxcz ) + az * ( bxcy - bycx );
+    const double permanent =
+        std::abs( ax ) * ( std::abs( bycz ) + std::abs( bzcy ) ) +
+        std::abs( ay ) * ( std::abs( bzcx ) + std::abs( bxcz ) ) +
+        std::abs( az ) * ( std::abs( bxcy ) + std::abs( bycx ) );
+    const double errBound = cOrient3dErrBound * permanent;
+    return ( det > errBound ) - ( det < -errBound );
+}
+
+} // anonymous namespace
+
 bool orient3d( const Vector3i & a, const Vector3i & b, const Vector3i & c )
 {
+    // all int coordinates are exactly represented in doubles, so floating-point filter resolves all but nearly degenerate cases
+    if ( auto s = orient3dFiltered( a.x, a.y, a.z, b.x, b.y, b.z, c.x, c.y, c.z ) )
+        return s > 0;
+
     auto vhp = mixed( Vector3hp{ a }, Vector3hp{ b }, Vector3hp{ c } );
     if ( vhp ) return vhp > 0;
 
@@ -108,6 +138,76 @@ TriangleSegmentIntersectResult doTriangleSegmentIntersect( const std::array<Prec
     return res;
 }
 
+void doTriangleSegmentIntersect( const std::array<PreciseVertCoords, 5> * vs, TriangleSegmentIntersectResult * res, size_t n )
+{
+    // the batch is processed by blocks, within each block the coordinates are stored by lanes (structure of arrays),
+    // so the loops computing filtered determinants for all lanes are vectorized by the compiler
+    constexpr int BlockSize = 64;
+    // the same order of points in orientation tests as in scalar doTriangleSegmentIntersect
+    constexpr int NumTests = 5;
+    constexpr int tests[NumTests][4] = { { 0, 1, 2, 3 }, { 0, 1, 2, 4 }, { 0, 1, 3, 4 }, { 1, 2, 3, 4 }, { 0, 2, 3, 4 } };
+
+    double coords[5][3][BlockSize];
+    int signs[NumTests][BlockSize];
+    for ( size_t block = 0; block < n; block += BlockSize )
+    {
+        const int blockSize = int( std::min<size_t>( BlockSize, n - block ) );
+        for ( int p = 0; p < 5; ++p )
+            for ( int i = 0; i < blockSize; ++i )
+            {
+                const auto& pt = vs[block + i][p].pt;
+                coords[p][0][i] = pt.x;
+                coords[p][1][i] = pt.y;
+                coords[p][2][i] = pt.z;
+            }
+
+        for ( int t = 0; t < NumTests; ++t )
+        {
+            const auto& ps = tests[t];
+            const auto& p0 = coords[ps[0]];
+            const auto& p1 = coords[ps[1]];
+            const auto& p2 = coords[ps[2]];
+            const auto& p3 = coords[ps[3]];
+            for ( int i = 0; i < blockSize; ++i )
+            {
+                signs[t][i] = orient3dFiltered(
+                    p0[0][i] - p3[0][i], p0[1][i] - p3[1][i], p0[2][i] - p3[2][i],
+                    p1[0][i] - p3[0][i], p1[1][i] - p3[1][i], p1[2][i] - p3[2][i],
+                    p2[0][i] - p3[0][i], p2[1][i] - p3[1][i], p2[2][i] - p3[2][i] );
+            }
+        }
+
+        for ( int i = 0; i < blockSize; ++i )
+        {
+            const auto& v = vs[block + i];
+            // the exact predicate with simulation-of-simplicity is called only if floating-point sign is not reliable
+            auto orient3d = [&]( int t )
+            {
+                if ( signs[t][i] )
+                    return signs[t][i] > 0;
+                const auto& ps = tests[t];
+                return MR::orient3d( { v[ps[0]], v[ps[1]], v[ps[2]], v[ps[3]] } );
+            };
+
+            auto& r = res[block + i];
+            r = {};
+            const auto abcd = orient3d( 0 );
+            r.dIsLeftFromABC = abcd;
+            const auto abce = orient3d( 1 );
+            if ( abcd == abce )
+                continue;
+            const auto dabe = orient3d( 2 );
+            const auto dbce = orient3d( 3 );
+            if ( dabe != dbce )
+                continue;
+            const auto dcae = !orient3d( 4 );
+            if ( dbce != dcae )
+                continue;
+            r.doIntersect = true;
+        }
+    }
+}
+
 Vector3f findTriangleSegmentIntersectionPrecise( 
     const Vector3f& a, const Vector3f& b, const Vector3f& c, 
     const Vector3f& d, const Vector3f& e, 
@@ -144,6 +244,31 @@ TEST( MRMesh, PrecisePredicates3 )
 
     EXPECT_TRUE( res.doIntersect );
     EXPECT_TRUE( res.dIsLeftFromABC );
+
+    // nearly degenerate and exactly degenerate cases are resolved by exact predicates
+    const int big = 1 << 30;
+    EXPECT_TRUE( orient3d( Vector3i( big, 0, 0 ), Vector3i( 0, big, 0 ), Vector3i( 0, 0, big ) ) );
+    EXPECT_FALSE( orient3d( Vector3i( big, 0, 0 ), Vector3i( 0, 0, big ), Vector3i( 0, big, 0 ) ) );
+    EXPECT_EQ( orient3d( Vector3i( big, big - 1, big ), Vector3i( big - 1, big, big ), Vector3i( 1, 1, 2 ) ),
+        mixed( Vector3hp{ Vector3i( big, big - 1, big ) }, Vector3hp{ Vector3i( big - 1, big, big ) }, Vector3hp{ Vector3i( 1, 1, 2 ) } ) > 0 );
+
+    // batched version gives the same results as scalar one
+    std::vector<std::array<PreciseVertCoords, 5>> batch;
+    for ( int i = 0; i < 100; ++i )
+    {
+        auto v = vs;
+        v[3].pt.z = i % 3 - 1; // d is below, on or above the plane of triangle
+        v[4].pt = Vector3i{ i % 7 - 3, i % 5 - 2, 1 };
+        batch.push_back( v );
+    }
+    std::vector<TriangleSegmentIntersectResult> batchRes( batch.size() );
+    doTriangleSegmentIntersect( batch.data(), batchRes.data(), batch.size() );
+    for ( int i = 0; i < batch.size(); ++i )
+    {
+        const auto r = doTriangleSegmentIntersect( batch[i] );
+        EXPECT_EQ( r.doIntersect, batchRes[i].doIntersect );
+        EXPECT_EQ( r.dIsLeftFromABC, batchRes[i].dIsLeftFromABC );
+    }
 }
 
 } //namespace MR
@@ -44,6 +44,11 @@ struct TriangleSegmentIntersectResult
 [[nodiscard]] MRMESH_API TriangleSegmentIntersectResult doTriangleSegmentIntersect(
     const std::array<PreciseVertCoords, 5> & vs );
 
+/// checks n pairs of triangle ABC (indices 012) and segment DE (indices 34) for intersection with the same results as above;
+/// the orientations of all pairs are first evaluated in floating-point by blocks of many pairs at once (in SIMD lanes),
+/// and exact predicates are called only for the orientations which floating-point sign is not reliable
+MRMESH_API void doTriangleSegmentIntersect( const std::array<PreciseVertCoords, 5> * vs, TriangleSegmentIntersectResult * res, size_t n );
+
 /// finds intersection precise, using high precision int inside
 /// this function input should have intersection
 [[nodiscard]] MRMESH_API Vector3f findTriangleSegmentIntersectionPrecise( 
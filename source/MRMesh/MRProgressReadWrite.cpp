@@ -1,4 +1,6 @@
 #include "MRProgressReadWrite.h"
+#include "MRPch/MRTBB.h"
+#include <cstring>
 
 namespace MR
 {
@@ -51,4 +53,21 @@ bool readByBlocks( std::istream& in, char* data, size_t dataSize, ProgressCallba
     return true;
 }
 
+bool copyByBlocks( char* data, const char* src, size_t dataSize, ProgressCallback callback /*= {}*/, size_t blockSize /*= ( size_t( 1 ) << 24 )*/ )
+{
+    // parallel copy makes the system to load the pages of memory-mapped file in several threads
+    constexpr size_t SubBlockSize = size_t( 1 ) << 20;
+    for ( size_t blockStart = 0; blockStart < dataSize; blockStart += blockSize )
+    {
+        const size_t blockEnd = std::min( dataSize, blockStart + blockSize );
+        tbb::parallel_for( tbb::blocked_range<size_t>( blockStart, blockEnd, SubBlockSize ), [&]( const tbb::blocked_range<size_t>& range )
+        {
+            std::memcpy( data + range.begin(), src + range.begin(), range.size() );
+        } );
+        if ( callback && !callback( float( blockEnd ) / dataSize ) )
+            return false;
+    }
+    return true;
+}
+
 }
@@ -22,4 +22,11 @@ MRMESH_API bool writeByBlocks( std::ostream& out, const char* data, size_t dataS
  */
 MRMESH_API bool readByBlocks( std::istream& in, char* data, size_t dataSize, ProgressCallback callback = {}, size_t blockSize = ( size_t( 1 ) << 16 ) );
 
+/**
+ * \brief copy dataSize bytes from src (e.g. memory-mapped file) to data by blocks blockSize bytes
+ * \details each block is copied in parallel threads, and progress callback is called after each block
+ * \return false if process was canceled (callback is set and return false )
+ */
+MRMESH_API bool copyByBlocks( char* data, const char* src, size_t dataSize, ProgressCallback callback = {}, size_t blockSize = ( size_t( 1 ) << 24 ) );
+
 }
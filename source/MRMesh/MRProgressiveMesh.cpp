@@ -0,0 +1,360 @@
+#include "MRProgressiveMesh.h"
+#include "MRMesh.h"
+#include "MRStringConvert.h"
+#include "MRTorus.h"
+#include "MRTimer.h"
+#include "MRGTest.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace MR
+{
+
+void ProgressiveMesh::setLevel( size_t level )
+{
+    level = std::min( level, splits_.size() );
+    while ( level_ < level )
+    {
+        const auto& split = splits_[level_];
+        const VertId newVert( numBaseVerts_ + int( level_ ) );
+        points_[split.keep] = split.finePos;
+        for ( auto i = level_ > 0 ? splits_[level_ - 1].cornersEnd : 0; i < split.cornersEnd; ++i )
+            tris_[FaceId( int( corners_[i] / 3 ) )][corners_[i] % 3] = newVert;
+        ++level_;
+    }
+    while ( level_ > level )
+    {
+        --level_;
+        const auto& split = splits_[level_];
+        points_[split.keep] = split.coarsePos;
+        for ( auto i = level_ > 0 ? splits_[level_ - 1].cornersEnd : 0; i < split.cornersEnd; ++i )
+            tris_[FaceId( int( corners_[i] / 3 ) )][corners_[i] % 3] = split.keep;
+    }
+}
+
+void ProgressiveMesh::setNumFaces( int numFaces )
+{
+    // the number of faces grows with each split
+    auto it = std::upper_bound( splits_.begin(), splits_.end(), numFaces, []( int n, const VertexSplit& split )
+    {
+        return n < split.facesEnd;
+    } );
+    setLevel( it - splits_.begin() );
+}
+
+Mesh ProgressiveMesh::mesh() const
+{
+    MR_TIMER
+    VertCoords points( begin( points_ ), begin( points_ ) + numVerts() );
+    const Triangulation t( begin( tris_ ), begin( tris_ ) + numFaces() );
+    return Mesh::fromTriangles( std::move( points ), t );
+}
+
+// the format is: the signature, the sizes, and the arrays
+static constexpr char ProgressiveMeshSignature[8] = { 'M', 'R', 'P', 'M', '0', '0', '0', '1' };
+
+void ProgressiveMesh::write( std::ostream & s ) const
+{
+    MR_TIMER
+    s.write( ProgressiveMeshSignature, sizeof( ProgressiveMeshSignature ) );
+    const std::uint32_t sizes[] = {
+        std::uint32_t( numBaseVerts_ ), std::uint32_t( numBaseFaces_ ), std::uint32_t( points_.size() ), std::uint32_t( tris_.size() ),
+        std::uint32_t( splits_.size() ), std::uint32_t( corners_.size() ), std::uint32_t( level_ ) };
+    s.write( (const char*)sizes, sizeof( sizes ) );
+    s.write( (const char*)points_.data(), points_.size() * sizeof( Vector3f ) );
+    s.write( (const char*)tris_.data(), tris_.size() * sizeof( ThreeVertIds ) );
+    s.write( (const char*)splits_.data(), splits_.size() * sizeof( VertexSplit ) );
+    s.write( (const char*)corners_.data(), corners_.size() * sizeof( std::uint32_t ) );
+}
+
+tl::expected<void, std::string> ProgressiveMesh::read( std::istream & s )
+{
+    MR_TIMER
+    char signature[sizeof( ProgressiveMeshSignature )];
+    s.read( signature, sizeof( signature ) );
+    if ( !s || std::memcmp( signature, ProgressiveMeshSignature, sizeof( signature ) ) != 0 )
+        return tl::make_unexpected( std::string( "Not a progressive mesh" ) );
+    std::uint32_t sizes[7];
+    s.read( (char*)sizes, sizeof( sizes ) );
+    if ( !s )
+        return tl::make_unexpected( std::string( "Stream reading error" ) );
+    const auto [numBaseVerts, numBaseFaces, numVerts, numFaces, numSplits, numCorners, level] = sizes;
+    if ( numBaseVerts > INT_MAX || numVerts > INT_MAX || numFaces > INT_MAX || numBaseFaces > numFaces
+        || size_t( numBaseVerts ) + numSplits != numVerts || level > numSplits )
+        return tl::make_unexpected( std::string( "Wrong sizes of progressive mesh" ) );
+
+    const auto posCur = s.tellg();
+    s.seekg( 0, std::ios_base::end );
+    const auto posEnd = s.tellg();
+    s.seekg( posCur );
+    const size_t dataSize = numVerts * sizeof( Vector3f ) + numFaces * sizeof( ThreeVertIds )
+        + numSplits * sizeof( VertexSplit ) + numCorners * sizeof( std::uint32_t );
+    if ( size_t( posEnd - posCur ) < dataSize )
+        return tl::make_unexpected( std::string( "Stream is too short" ) );
+
+    ProgressiveMesh pm;
+    pm.points_.resize( numVerts );
+    pm.tris_.resize( numFaces );
+    pm.splits_.resize( numSplits );
+    pm.corners_.resize( numCorners );
+    s.read( (char*)pm.points_.data(), pm.points_.size() * sizeof( Vector3f ) );
+    s.read( (char*)pm.tris_.data(), pm.tris_.size() * sizeof( ThreeVertIds ) );
+    s.read( (char*)pm.splits_.data(), pm.splits_.size() * sizeof( VertexSplit ) );
+    s.read( (char*)pm.corners_.data(), pm.corners_.size() * sizeof( std::uint32_t ) );
+    if ( !s )
+        return tl::make_unexpected( std::string( "Stream reading error" ) );
+
+    // validate all indices to make any level safe
+    for ( const auto& t : pm.tris_ )
+        for ( auto v : t )
+            if ( v < 0 || v >= int( numVerts ) )
+                return tl::make_unexpected( std::string( "Wrong vertex in progressive mesh" ) );
+    int facesEnd = int( numBaseFaces );
+    std::uint32_t cornersEnd = 0;
+    for ( const auto& split : pm.splits_ )
+    {
+        if ( split.facesEnd < facesEnd || split.facesEnd > int( numFaces ) || split.cornersEnd < cornersEnd || split.cornersEnd > numCorners
+            || split.keep < 0 || split.keep >= int( numVerts ) )
+            return tl::make_unexpected( std::string( "Wrong vertex split in progressive mesh" ) );
+        facesEnd = split.facesEnd;
+        cornersEnd = split.cornersEnd;
+    }
+    for ( auto c : pm.corners_ )
+        if ( c >= 3 * size_t( numFaces ) )
+            return tl::make_unexpected( std::string( "Wrong corner in progressive mesh" ) );
+
+    pm.numBaseVerts_ = int( numBaseVerts );
+    pm.numBaseFaces_ = int( numBaseFaces );
+    pm.level_ = level;
+    *this = std::move( pm );
+    return {};
+}
+
+tl::expected<ProgressiveMesh, std::string> makeProgressiveMesh( const Mesh & mesh, const DecimateSettings & settings )
+{
+    MR_TIMER
+    const auto& topology = mesh.topology;
+    if ( size_t( topology.faceSize() ) * 3 > UINT32_MAX )
+        return tl::make_unexpected( std::string( "Too many faces for progressive mesh" ) );
+
+    // decimate the copy of the mesh recording the collapses
+    struct Collapse
+    {
+        VertId keep, removed;
+        Vector3f finePos, coarsePos;
+    };
+    std::vector<Collapse> collapses;
+    Mesh coarse = mesh;
+    DecimateSettings decSettings = settings;
+    decSettings.packMesh = false;
+    decSettings.preCollapse = [&coarse, &collapses, userPreCollapse = settings.preCollapse]( EdgeId e, const Vector3f & newPos )
+    {
+        if ( userPreCollapse && !userPreCollapse( e, newPos ) )
+            return false;
+        const auto o = coarse.topology.org( e );
+        collapses.push_back( { o, coarse.topology.dest( e ), coarse.points[o], newPos } );
+        return true;
+    };
+    if ( decimateMesh( coarse, decSettings ).cancelled )
+        return tl::make_unexpected( std::string( "Operation was canceled" ) );
+
+    // replay the collapses on the triangles: the faces with both vertices of the edge are deleted,
+    // and the other faces of removed vertex get kept vertex in the corners
+    Triangulation tris( topology.faceSize() );
+    std::vector<std::vector<FaceId>> vertFaces( topology.vertSize() );
+    for ( auto f : topology.getValidFaces() )
+    {
+        topology.getTriVerts( f, tris[f] );
+        for ( auto v : tris[f] )
+            vertFaces[v].push_back( f );
+    }
+    constexpr int Alive = -1;
+    Vector<int, FaceId> faceDeletedBy( tris.size(), Alive );
+    Vector<int, VertId> vertDeletedBy( topology.vertSize(), Alive );
+    std::vector<std::uint32_t> corners;
+    std::vector<std::uint32_t> cornersEnd( collapses.size() );
+    for ( int k = 0; k < collapses.size(); ++k )
+    {
+        const auto [keep, removed, finePos, coarsePos] = collapses[k];
+        auto& keepFaces = vertFaces[keep];
+        for ( auto f : vertFaces[removed] )
+        {
+            if ( faceDeletedBy[f] != Alive )
+                continue;
+            auto& t = tris[f];
+            if ( t[0] == keep || t[1] == keep || t[2] == keep )
+            {
+                faceDeletedBy[f] = k;
+                continue;
+            }
+            const int j = t[0] == removed ? 0 : t[1] == removed ? 1 : 2;
+            t[j] = keep;
+            corners.push_back( 3 * std::uint32_t( f ) + j );
+            keepFaces.push_back( f );
+        }
+        vertFaces[removed] = {};
+        vertDeletedBy[removed] = k;
+        cornersEnd[k] = std::uint32_t( corners.size() );
+        std::erase_if( keepFaces, [&]( FaceId f ) { return faceDeletedBy[f] != Alive; } );
+    }
+    vertFaces = {};
+
+    // the remaining triangles must be the same as in decimated mesh
+    for ( auto f : topology.getValidFaces() )
+    {
+        if ( coarse.topology.hasFace( f ) != ( faceDeletedBy[f] == Alive ) )
+            return tl::make_unexpected( std::string( "Decimation changed the mesh not only by edge collapses" ) );
+        if ( faceDeletedBy[f] != Alive )
+            continue;
+        ThreeVertIds v;
+        coarse.topology.getTriVerts( f, v );
+        if ( !std::is_permutation( v.begin(), v.end(), tris[f].begin() ) )
+            return tl::make_unexpected( std::string( "Decimation changed the mesh not only by edge collapses" ) );
+    }
+
+    // the elements of coarse mesh, then the elements restored by the splits in the order inverse to the collapses
+    const int numCollapses = int( collapses.size() );
+    ProgressiveMesh res;
+    VertMap newVert( topology.vertSize() );
+    for ( auto v : topology.getValidVerts() )
+        if ( vertDeletedBy[v] == Alive )
+            newVert[v] = VertId( res.numBaseVerts_++ );
+    for ( int k = 0; k < numCollapses; ++k )
+        newVert[collapses[k].removed] = VertId( res.numBaseVerts_ + numCollapses - 1 - k );
+
+    // sort the faces by the splits restoring them, 0 - the faces of coarse mesh
+    auto splitOfFace = [&]( FaceId f )
+    {
+        return faceDeletedBy[f] == Alive ? 0 : numCollapses - faceDeletedBy[f];
+    };
+    std::vector<int> facesEnd( numCollapses + 1, 0 );
+    for ( auto f : topology.getValidFaces() )
+        ++facesEnd[splitOfFace( f )];
+    for ( int i = 1; i <= numCollapses; ++i )
+        facesEnd[i] += facesEnd[i - 1];
+    FaceMap newFace( topology.faceSize() );
+    {
+        auto facesBegin = facesEnd;
+        facesBegin.insert( facesBegin.begin(), 0 );
+        for ( auto f : topology.getValidFaces() )
+            newFace[f] = FaceId( facesBegin[splitOfFace( f )]++ );
+    }
+    res.numBaseFaces_ = facesEnd[0];
+
+    res.points_.resize( numCollapses + res.numBaseVerts_ );
+    for ( auto v : topology.getValidVerts() )
+        res.points_[newVert[v]] = coarse.points[v];
+    res.tris_.resize( facesEnd.back() );
+    for ( auto f : topology.getValidFaces() )
+        for ( int j = 0; j < 3; ++j )
+            res.tris_[newFace[f]][j] = newVert[tris[f][j]];
+    res.splits_.resize( numCollapses );
+    res.corners_.reserve( corners.size() );
+    for ( int i = 0; i < numCollapses; ++i )
+    {
+        const int k = numCollapses - 1 - i;
+        const auto& c = collapses[k];
+        for ( auto j = k > 0 ? cornersEnd[k - 1] : 0; j < cornersEnd[k]; ++j )
+            res.corners_.push_back( 3 * std::uint32_t( newFace[FaceId( int( corners[j] / 3 ) )] ) + corners[j] % 3 );
+        res.splits_[i] = { newVert[c.keep], c.coarsePos, c.finePos, std::uint32_t( res.corners_.size() ), facesEnd[i + 1] };
+    }
+    res.setLevel( res.numSplits() );
+    return res;
+}
+
+tl::expected<void, std::string> saveProgressiveMesh( const ProgressiveMesh & pm, const std::filesystem::path & file )
+{
+    std::ofstream out( file, std::ofstream::binary );
+    if ( !out )
+        return tl::make_unexpected( std::string( "Cannot open file for writing " ) + utf8string( file ) );
+    pm.write( out );
+    if ( !out )
+        return tl::make_unexpected( std::string( "Error saving progressive mesh" ) );
+    return {};
+}
+
+tl::expected<ProgressiveMesh, std::string> loadProgressiveMesh( const std::filesystem::path & file )
+{
+    std::ifstream in( file, std::ifstream::binary );
+    if ( !in )
+        return tl::make_unexpected( std::string( "Cannot open file for reading " ) + utf8string( file ) );
+    ProgressiveMesh pm;
+    auto res = pm.read( in );
+    if ( !res )
+        return tl::make_unexpected( res.error() + ": " + utf8string( file ) );
+    return pm;
+}
+
+TEST(MRMesh, ProgressiveMesh)
+{
+    const Mesh torus = makeTorus( 1.0f, 0.3f, 64, 32 );
+    DecimateSettings settings;
+    settings.maxError = 0.05f;
+    auto pm = makeProgressiveMesh( torus, settings );
+    ASSERT_TRUE( pm.has_value() );
+    ASSERT_GT( pm->numSplits(), 1000 );
+    const auto fine = *pm;
+
+    // the finest level is the original mesh, and the coarsest one is the decimated mesh
+    EXPECT_EQ( pm->level(), pm->numSplits() );
+    EXPECT_EQ( pm->numFaces(), torus.topology.numValidFaces() );
+    EXPECT_EQ( pm->numVerts(), torus.topology.numValidVerts() );
+    EXPECT_NEAR( pm->mesh().area(), torus.area(), 1e-4 );
+    Mesh decimated = torus;
+    decimateMesh( decimated, settings );
+    pm->setLevel( 0 );
+    EXPECT_EQ( pm->numFaces(), decimated.topology.numValidFaces() );
+    EXPECT_NEAR( pm->mesh().area(), decimated.area(), 1e-4 );
+
+    // any level is a closed mesh of the same genus
+    for ( size_t level : { size_t( 0 ), pm->numSplits() / 3, pm->numSplits() / 2 + 1, pm->numSplits() - 1 } )
+    {
+        pm->setLevel( level );
+        const auto m = pm->mesh();
+        EXPECT_EQ( m.topology.numValidFaces(), pm->numFaces() );
+        EXPECT_TRUE( m.topology.findHoleRepresentiveEdges().empty() );
+        EXPECT_EQ( m.topology.numValidVerts() + m.topology.numValidFaces(), int( m.topology.undirectedEdgeSize() ) );
+
+        // the same mesh is obtained by coarsening from the finest level
+        auto pm2 = fine;
+        pm2.setLevel( level );
+        EXPECT_TRUE( std::equal( begin( pm2.triangulation() ), begin( pm2.triangulation() ) + pm2.numFaces(), begin( pm->triangulation() ) ) );
+        EXPECT_TRUE( std::equal( begin( pm2.points() ), begin( pm2.points() ) + pm2.numVerts(), begin( pm->points() ) ) );
+    }
+
+    const int targetFaces = torus.topology.numValidFaces() / 2;
+    pm->setNumFaces( targetFaces );
+    EXPECT_LE( pm->numFaces(), targetFaces );
+    EXPECT_GT( pm->numFacesAtLevel( pm->level() + 1 ), targetFaces );
+
+    std::stringstream ss;
+    pm->write( ss );
+    ProgressiveMesh loaded;
+    ASSERT_TRUE( loaded.read( ss ).has_value() );
+    EXPECT_EQ( loaded.level(), pm->level() );
+    EXPECT_TRUE( loaded.points() == pm->points() );
+    EXPECT_TRUE( loaded.triangulation() == pm->triangulation() );
+    loaded.setLevel( loaded.numSplits() );
+    EXPECT_TRUE( loaded.points() == fine.points() );
+    EXPECT_TRUE( loaded.triangulation() == fine.triangulation() );
+
+    std::stringstream bad( "MRPM0001 short" );
+    EXPECT_FALSE( loaded.read( bad ).has_value() );
+
+    // the mesh with boundary and deleted elements
+    Mesh open = torus;
+    FaceBitSet deleted( 300 );
+    deleted.set();
+    open.topology.deleteFaces( deleted );
+    auto pmOpen = makeProgressiveMesh( open, settings );
+    ASSERT_TRUE( pmOpen.has_value() );
+    EXPECT_EQ( pmOpen->numFaces(), open.topology.numValidFaces() );
+    EXPECT_NEAR( pmOpen->mesh().area(), open.area(), 1e-4 );
+    pmOpen->setLevel( pmOpen->numSplits() / 2 );
+    EXPECT_EQ( pmOpen->mesh().topology.numValidFaces(), pmOpen->numFaces() );
+}
+
+} //namespace MR
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "MRMeshDecimate.h"
+#include "MRId.h"
+#include "MRVector.h"
+#include "MRVector3.h"
+#include <tl/expected.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace MR
+{
+
+/**
+ * \brief Progressive mesh: the coarsest mesh and the sequence of vertex splits restoring the original mesh
+ * \details The vertices and the faces are ordered by their appearance: the elements of the coarsest mesh go first,
+ * and each split adds one vertex and one or two faces at the end, so the mesh of any level consists of
+ * the first numVerts() vertices and the first numFaces() triangles of the arrays.
+ * The level is changed by applying the splits or their inverse collapses in time proportional to the difference of the levels.
+ * \ingroup DecimateGroup
+ *
+ * \sa \ref makeProgressiveMesh
+ */
+class ProgressiveMesh
+{
+public:
+    /// the total number of vertex splits, equal to the number of collapses performed by the decimation
+    [[nodiscard]] size_t numSplits() const { return splits_.size(); }
+    /// the number of splits applied to the coarsest mesh: 0 - the coarsest mesh, numSplits() - the original mesh
+    [[nodiscard]] size_t level() const { return level_; }
+
+    /// the number of vertices and faces in the mesh of current level
+    [[nodiscard]] int numVerts() const { return numBaseVerts_ + int( level_ ); }
+    [[nodiscard]] int numFaces() const { return numFacesAtLevel( level_ ); }
+    /// the number of faces in the mesh of given level
+    [[nodiscard]] int numFacesAtLevel( size_t level ) const { return level == 0 ? numBaseFaces_ : splits_[level - 1].facesEnd; }
+
+    /// refines or coarsens the mesh to given level (clamped by numSplits()) in O(|level - level()|) time
+    MRMESH_API void setLevel( size_t level );
+    /// sets the finest level having not more than given number of faces (the coarsest if all levels have more),
+    /// finding it in O(log(numSplits())) and switching to it in O(|new level - level()|) time
+    MRMESH_API void setNumFaces( int numFaces );
+
+    /// the coordinates of the vertices, only the first numVerts() are in the mesh of current level
+    [[nodiscard]] const VertCoords & points() const { return points_; }
+    /// the vertices of the triangles, only the first numFaces() are in the mesh of current level
+    [[nodiscard]] const Triangulation & triangulation() const { return tris_; }
+    /// makes the mesh of current level
+    [[nodiscard]] MRMESH_API Mesh mesh() const;
+
+    /// saves in binary stream
+    MRMESH_API void write( std::ostream & s ) const;
+    /// loads from binary stream
+    /// \return text of error if any
+    MRMESH_API tl::expected<void, std::string> read( std::istream & s );
+
+private:
+    friend MRMESH_API tl::expected<ProgressiveMesh, std::string> makeProgressiveMesh( const Mesh & mesh, const DecimateSettings & settings );
+
+    /// the split of one vertex in two, inverse to an edge collapse
+    struct VertexSplit
+    {
+        VertId keep;       ///< the vertex remaining after the collapse, the new vertex is numVerts() before the split
+        Vector3f coarsePos; ///< the position of keep vertex before the split
+        Vector3f finePos;   ///< the position of keep vertex after the split
+        std::uint32_t cornersEnd = 0; ///< the end of the corners of this split in corners_
+        int facesEnd = 0; ///< the number of faces after the split
+    };
+    static_assert( sizeof( VertexSplit ) == 36, "check your padding" );
+
+    VertCoords points_;
+    Triangulation tris_;
+    std::vector<VertexSplit> splits_;
+    /// the corners (3 * face + index in triangle) changing the vertex from keep to the new one in each split
+    std::vector<std::uint32_t> corners_;
+    int numBaseVerts_ = 0;
+    int numBaseFaces_ = 0;
+    size_t level_ = 0;
+};
+
+/**
+ * \brief Decimates the copy of given mesh by \ref decimateMesh recording all collapses, and returns the progressive mesh at the finest level
+ * \details packMesh of the settings is ignored; the invalid elements of the mesh are skipped, and the others are renumbered
+ * \ingroup DecimateGroup
+ */
+MRMESH_API tl::expected<ProgressiveMesh, std::string> makeProgressiveMesh( const Mesh & mesh, const DecimateSettings & settings = {} );
+
+/// saves progressive mesh in binary file (.mrpm), e.g. next to the .mrmesh file of the original mesh
+MRMESH_API tl::expected<void, std::string> saveProgressiveMesh( const ProgressiveMesh & pm, const std::filesystem::path & file );
+/// loads progressive mesh from binary file (.mrpm)
+MRMESH_API tl::expected<ProgressiveMesh, std::string> loadProgressiveMesh( const std::filesystem::path & file );
+
+} //namespace MR
@@ -0,0 +1,89 @@
+#include "MRTextParse.h"
+#include "MRTimer.h"
+#include "MRGTest.h"
+#include "MRPch/MRTBB.h"
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+
+namespace MR
+{
+
+std::vector<size_t> splitTextByLines( const char * data, size_t size, size_t chunkSize )
+{
+    assert( chunkSize > 0 );
+    std::vector<size_t> res;
+    res.push_back( 0 );
+    size_t pos = 0;
+    while ( size - pos > chunkSize )
+    {
+        const char * lineEnd = (const char *)std::memchr( data + pos + chunkSize, '\n', size - pos - chunkSize );
+        if ( !lineEnd )
+            break;
+        pos = size_t( lineEnd - data ) + 1;
+        if ( pos < size )
+            res.push_back( pos );
+    }
+    res.push_back( size );
+    return res;
+}
+
+bool parallelForChunks( size_t numChunks, const std::function<void( size_t )> & f, ProgressCallback callback )
+{
+    MR_TIMER
+    const auto mainThreadId = std::this_thread::get_id();
+    std::atomic<bool> keepGoing{ true };
+    std::atomic<size_t> numFinished{ 0 };
+    tbb::parallel_for( tbb::blocked_range<size_t>( 0, numChunks, 1 ), withTimerParent( [&]( const tbb::blocked_range<size_t> & range )
+    {
+        for ( size_t i = range.begin(); i < range.end(); ++i )
+        {
+            if ( !keepGoing.load( std::memory_order_relaxed ) )
+                break;
+            f( i );
+            const auto finished = ++numFinished;
+            if ( callback && std::this_thread::get_id() == mainThreadId && !callback( float( finished ) / numChunks ) )
+                keepGoing.store( false, std::memory_order_relaxed );
+        }
+    } ) );
+    return keepGoing.load( std::memory_order_relaxed );
+}
+
+TEST(MRMesh, SplitTextByLines)
+{
+    const std::string text = "v 1 2 3\nv 4 5 6\r\nf 1 2 3\n\nf -1 -2 -3";
+    for ( size_t chunkSize = 1; chunkSize <= text.size() + 1; ++chunkSize )
+    {
+        const auto offsets = splitTextByLines( text.data(), text.size(), chunkSize );
+        ASSERT_GE( offsets.size(), 2 );
+        EXPECT_EQ( offsets.front(), 0 );
+        EXPECT_EQ( offsets.back(), text.size() );
+        for ( size_t i = 1; i + 1 < offsets.size(); ++i )
+        {
+            EXPECT_LT( offsets[i - 1], offsets[i] );
+            EXPECT_EQ( text[offsets[i] - 1], '\n' );
+        }
+    }
+
+    const char * p = text.data();
+    const char * end = p + text.size();
+    double x = 0;
+    int i = 0;
+    p = parseNumber( p + 1, end, x );
+    ASSERT_TRUE( p );
+    EXPECT_EQ( x, 1 );
+    p = skipLine( p, end );
+    p = skipLine( p, end );
+    p = parseNumber( p + 1, end, i );
+    ASSERT_TRUE( p );
+    EXPECT_EQ( i, 1 );
+    p = parseNumber( p, end, i );
+    ASSERT_TRUE( p );
+    EXPECT_EQ( i, 2 );
+
+    const std::string bad = "+abc";
+    EXPECT_EQ( parseNumber( bad.data(), bad.data() + bad.size(), x ), nullptr );
+}
+
+} //namespace MR
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "MRMeshFwd.h"
+#include "MRProgressCallback.h"
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include <functional>
+#include <vector>
+
+namespace MR
+{
+
+/// \defgroup TextParseGroup Text Parse
+/// \ingroup IOGroup
+/// \{
+
+/// splits text buffer on chunks of approximately given size, each chunk (except the last one) ends right after a new line symbol;
+/// \return the offsets of chunk beginnings, followed by the size of the buffer
+MRMESH_API std::vector<size_t> splitTextByLines( const char * data, size_t size, size_t chunkSize = size_t( 1 ) << 20 );
+
+/// calls f( i ) for each chunk index in [0, numChunks) in parallel threads;
+/// progress callback is called only from the calling thread with the fraction of finished chunks;
+/// the timers inside f are attributed to the active timer of the calling thread
+/// \return false if the processing was canceled by the callback
+MRMESH_API bool parallelForChunks( size_t numChunks, const std::function<void( size_t )> & f, ProgressCallback callback = {} );
+
+/// returns the pointer on the first symbol after spaces and tabs
+inline const char * skipSpaces( const char * p, const char * end )
+{
+    while ( p < end && ( *p == ' ' || *p == '\t' || *p == '\r' ) )
+        ++p;
+    return p;
+}
+
+/// returns the pointer on the first symbol after the current line with its new line symbol
+inline const char * skipLine( const char * p, const char * end )
+{
+    while ( p < end && *p != '\n' )
+        ++p;
+    return p < end ? p + 1 : p;
+}
+
+/// returns the pointer on the first space, tab or new line symbol
+inline const char * skipToken( const char * p, const char * end )
+{
+    while ( p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n' )
+        ++p;
+    return p;
+}
+
+/// skips spaces and parses one number (integer or floating-point) without locale dependency
+/// (except for floating-point numbers in standard libraries without std::from_chars for them, where "C" locale is expected);
+/// \return the pointer after the number or nullptr if no number was found
+template <typename T>
+const char * parseNumber( const char * p, const char * end, T & res )
+{
+    p = skipSpaces( p, end );
+    // from_chars does not accept explicit plus
+    if ( p < end && *p == '+' )
+        ++p;
+#ifndef __cpp_lib_to_chars
+    // floating-point from_chars is missing in some standard libraries (e.g. libc++), so parse the zero-terminated copy of the token there
+    if constexpr ( std::is_floating_point_v<T> )
+    {
+        char buf[64];
+        const auto len = size_t( skipToken( p, end ) - p );
+        if ( len >= sizeof( buf ) )
+            return nullptr;
+        std::memcpy( buf, p, len );
+        buf[len] = 0;
+        char * bufEnd = nullptr;
+        errno = 0;
+        T x;
+        if constexpr ( std::is_same_v<T, float> )
+            x = std::strtof( buf, &bufEnd );
+        else if constexpr ( std::is_same_v<T, double> )
+            x = std::strtod( buf, &bufEnd );
+        else
+            x = T( std::strtold( buf, &bufEnd ) );
+        if ( bufEnd == buf || errno == ERANGE )
+            return nullptr;
+        res = x;
+        return p + ( bufEnd - buf );
+    }
+    else
+#endif
+    {
+        const auto [ptr, ec] = std::from_chars( p, end, res );
+        return ec == std::errc() ? ptr : nullptr;
+    }
+}
+
+/// \}
+
+} // namespace MR
@@ -1,6 +1,15 @@
 #include "MRTimer.h"
 #include "MRLog.h"
+#include "MRStringConvert.h"
+#include "MRGTest.h"
+#include "MRPch/MRTBB.h"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <fstream>
 #include <map>
+#include <mutex>
+#include <unordered_map>
 #include <thread>
 #include <sstream>
 
@@ -12,29 +21,35 @@ namespace MR
 struct TimeRecord
 {
     TimeRecord* parent = nullptr;
-    int count = 0;
-    nanoseconds time = {};
+    // points on the key of this record in parent's children
+    const std::string* name = nullptr;
+    // the statistics merged from all threads
+    std::atomic<long long> count{ 0 };
+    std::atomic<long long> nanos{ 0 };
+    // modified only under RootTimeRecord::treeMutex
     std::map<std::string, TimeRecord> children;
 
+    nanoseconds time() const { return nanoseconds( nanos.load( std::memory_order_relaxed ) ); }
+
     // returns summed time of immediate children
     nanoseconds childTime() const;
 
-    double seconds() const { return time.count() * 1e-9; }
-    double mySeconds() const { return ( time - childTime() ).count() * 1e-9; }
+    double seconds() const { return time().count() * 1e-9; }
+    double mySeconds() const { return std::max( time() - childTime(), nanoseconds{ 0 } ).count() * 1e-9; }
 };
 
 nanoseconds TimeRecord::childTime() const
 {
     auto res = nanoseconds{ 0 };
     for ( const auto& child : children )
-        res += child.second.time;
+        res += child.second.time();
     return res;
 }
 
 void printTimeRecord( const TimeRecord& timeRecord, const std::string& name, int indent, const std::shared_ptr<spdlog::logger>& loggerHandle )
 {
     std::stringstream ss;
-    ss << std::setw( 9 )  << std::right << timeRecord.count;
+    ss << std::setw( 9 )  << std::right << timeRecord.count.load();
     ss << std::setw( 12 ) << std::right << std::fixed << std::setprecision( 3 ) << timeRecord.seconds();
     ss << std::setw( 12 ) << std::right << std::fixed << std::setprecision( 3 ) << timeRecord.mySeconds();
     ss << std::string( indent, ' ' ) << name;
@@ -44,15 +59,35 @@ void printTimeRecord( const TimeRecord& timeRecord, const std::string& name, int
         printTimeRecord( child.second, child.first, indent + 4, loggerHandle );
 }
 
+// one finished timer interval recorded for Chrome trace
+struct TraceEvent
+{
+    const TimeRecord* record = nullptr;
+    int thread = 0;
+    long long startNanos = 0; // since RootTimeRecord::started
+    long long durNanos = 0;
+};
+
+static void mergeAllThreadSlots();
+
 struct RootTimeRecord : TimeRecord
 {
+    const std::string rootName = "(total)";
     time_point<high_resolution_clock> started = high_resolution_clock::now();
     bool printTreeInDtor = true;
+    // protects the structure of the tree (children maps) and the trace
+    std::mutex treeMutex;
+    std::vector<TraceEvent> traceEvents;
     // prolong logger life
     std::shared_ptr<spdlog::logger> loggerHandle = Logger::instance().getSpdLogger();
     RootTimeRecord()
     {
         count = 1;
+        name = &rootName;
+    }
+    void updateTime()
+    {
+        nanos = duration_cast<nanoseconds>( high_resolution_clock::now() - started ).count();
     }
     void printTree()
     {
@@ -63,31 +98,194 @@ struct RootTimeRecord : TimeRecord
         ss << std::setw( 12 ) << std::right << "Self time";
         ss << "    Name";
         loggerHandle->info( ss.str() );
-        time = high_resolution_clock::now() - started;
-        printTimeRecord( *this, "(total)", 4, loggerHandle );
+        updateTime();
+        mergeAllThreadSlots();
+        std::unique_lock lock( treeMutex );
+        printTimeRecord( *this, rootName, 4, loggerHandle );
     }
-    ~RootTimeRecord()
+};
+
+// never destroyed, since the threads can start and finish timers after static objects destruction
+static RootTimeRecord& rootTimeRecord()
+{
+    static auto* root = new RootTimeRecord;
+    return *root;
+}
+
+// prints the timing tree at the end of the application if requested
+static struct TimingTreeAtExitPrinter
+{
+    // the logger is created before and destroyed after this object
+    TimingTreeAtExitPrinter() { rootTimeRecord(); }
+    ~TimingTreeAtExitPrinter()
+    {
+        auto& root = rootTimeRecord();
+        if ( root.printTreeInDtor )
+            root.printTree();
+    }
+} timingTreeAtExitPrinter;
+
+// the record of the innermost active timer in this thread or of TimerParentScope
+static thread_local TimeRecord* currentRecord = nullptr;
+
+// accumulates the statistics of one record in one thread
+struct TimerThreadSlot
+{
+    TimeRecord* record = nullptr;
+    // modified only by the owning thread, so plain load + store is enough
+    std::atomic<long long> count{ 0 };
+    std::atomic<long long> nanos{ 0 };
+    // the values already added in the record, accessed only under the lock of slotsRegistry()
+    long long mergedCount = 0;
+    long long mergedNanos = 0;
+
+    void add( long long dur )
     {
-        if ( !printTreeInDtor )
-            return;
-        printTree();
+        count.store( count.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+        nanos.store( nanos.load( std::memory_order_relaxed ) + dur, std::memory_order_relaxed );
     }
 };
 
-static RootTimeRecord rootTimeRecord;
-static TimeRecord* currentRecord = &rootTimeRecord;
-static auto mainThreadId = std::this_thread::get_id();
+// all slots of one thread
+struct ThreadTimerSlots
+{
+    // guards the sequence of slots: they are appended by the owning thread and read during merge
+    std::mutex mutex;
+    std::deque<TimerThreadSlot> slots;
+
+    struct Key
+    {
+        const TimeRecord* parent = nullptr;
+        std::string_view name;
+        bool operator ==( const Key& ) const = default;
+    };
+    struct KeyHash
+    {
+        size_t operator()( const Key& k ) const
+        {
+            return std::hash<const void*>()( k.parent ) ^ ( std::hash<std::string_view>()( k.name ) * 31 );
+        }
+    };
+    // accessed only by the owning thread, the names point on the keys in the children of the parent
+    std::unordered_map<Key, TimerThreadSlot*, KeyHash> index;
+    // the slot found last time to avoid hashing in loops with the same timer
+    TimerThreadSlot* lastSlot = nullptr;
+
+    // returns the slot of the child of given record, creating both if necessary
+    TimerThreadSlot* getSlot( TimeRecord* parent, std::string_view name );
+};
+
+struct ThreadTimerSlotsRegistry
+{
+    // protects the list of all threads' slots and merged values in them
+    std::mutex mutex;
+    std::vector<ThreadTimerSlots*> allThreadSlots;
+};
+
+// never destroyed, since the threads can finish after static objects destruction
+static ThreadTimerSlotsRegistry& slotsRegistry()
+{
+    static auto* registry = new ThreadTimerSlotsRegistry;
+    return *registry;
+}
+
+TimerThreadSlot* ThreadTimerSlots::getSlot( TimeRecord* parent, std::string_view name )
+{
+    if ( lastSlot && lastSlot->record->parent == parent && *lastSlot->record->name == name )
+        return lastSlot;
+    if ( auto it = index.find( { parent, name } ); it != index.end() )
+        return lastSlot = it->second;
+
+    TimeRecord* record = nullptr;
+    {
+        std::unique_lock lock( rootTimeRecord().treeMutex );
+        auto [it, inserted] = parent->children.try_emplace( std::string( name ) );
+        record = &it->second;
+        if ( inserted )
+        {
+            record->parent = parent;
+            record->name = &it->first;
+        }
+    }
+    TimerThreadSlot* slot = nullptr;
+    {
+        std::unique_lock lock( mutex );
+        slot = &slots.emplace_back();
+        slot->record = record;
+    }
+    index.emplace( Key{ parent, *record->name }, slot );
+    return lastSlot = slot;
+}
+
+// adds not merged yet statistics of the thread in the records, the lock of slotsRegistry() must be held
+static void mergeSlots( ThreadTimerSlots& s )
+{
+    std::unique_lock lock( s.mutex );
+    for ( auto& slot : s.slots )
+    {
+        const auto count = slot.count.load( std::memory_order_relaxed );
+        const auto nanos = slot.nanos.load( std::memory_order_relaxed );
+        slot.record->count += count - slot.mergedCount;
+        slot.record->nanos += nanos - slot.mergedNanos;
+        slot.mergedCount = count;
+        slot.mergedNanos = nanos;
+    }
+}
+
+static void mergeAllThreadSlots()
+{
+    auto& registry = slotsRegistry();
+    std::unique_lock lock( registry.mutex );
+    for ( auto s : registry.allThreadSlots )
+        mergeSlots( *s );
+}
+
+// registers the slots of the thread and merges them on thread exit,
+// which is safe even after static objects destruction since both the registry and the records are never destroyed
+struct ThreadTimerSlotsOwner
+{
+    ThreadTimerSlots slots;
+    ThreadTimerSlotsOwner()
+    {
+        auto& registry = slotsRegistry();
+        std::unique_lock lock( registry.mutex );
+        registry.allThreadSlots.push_back( &slots );
+    }
+    ~ThreadTimerSlotsOwner()
+    {
+        auto& registry = slotsRegistry();
+        std::unique_lock lock( registry.mutex );
+        mergeSlots( slots );
+        std::erase( registry.allThreadSlots, &slots );
+    }
+};
+
+static ThreadTimerSlots& getThreadSlots()
+{
+    static thread_local ThreadTimerSlotsOwner owner;
+    return owner.slots;
+}
+
+static std::atomic<bool> traceOn{ false };
+
+// returns small consecutive number of this thread, 0 for the first thread that asked
+static int getThreadIndex()
+{
+    static std::atomic<int> numThreads{ 0 };
+    static thread_local int index = numThreads++;
+    return index;
+}
 
 void printTimingTreeAtEnd( bool on )
 {
-    rootTimeRecord.printTreeInDtor = on;
+    rootTimeRecord().printTreeInDtor = on;
 }
 
 void printCurrentTimerBranch()
 {
     Timer t( "Print Timer branch leaf" );
     const TimeRecord* active = currentRecord;
-    auto& logger = rootTimeRecord.loggerHandle;
+    auto& logger = rootTimeRecord().loggerHandle;
     if ( !logger )
         return;
     while ( active )
@@ -97,52 +295,283 @@ void printCurrentTimerBranch()
             logger->info( "Root" );
             break;
         }
-        for ( const auto& child : active->parent->children )
-        {
-            if ( &child.second != active )
-                continue;
-            logger->info( child.first );
-            break;
-        }
+        logger->info( *active->name );
         active = active->parent;
     }
 }
 
 void printTimingTreeAndStop()
 {
-    rootTimeRecord.printTree();
+    rootTimeRecord().printTree();
     printTimingTreeAtEnd( false );
 }
 
-void Timer::restart( const std::string& name )
+static TimerRecordStats getStats( const TimeRecord& r )
+{
+    TimerRecordStats res;
+    res.name = *r.name;
+    res.count = r.count;
+    res.seconds = r.seconds();
+    res.selfSeconds = r.mySeconds();
+    res.children.reserve( r.children.size() );
+    for ( const auto& child : r.children )
+        res.children.push_back( getStats( child.second ) );
+    return res;
+}
+
+TimerRecordStats getTimingTree()
+{
+    auto& root = rootTimeRecord();
+    root.updateTime();
+    mergeAllThreadSlots();
+    std::unique_lock lock( root.treeMutex );
+    return getStats( root );
+}
+
+static void resetRecord( TimeRecord& r )
+{
+    r.count = 0;
+    r.nanos = 0;
+    for ( auto& child : r.children )
+        resetRecord( child.second );
+}
+
+void resetTimingTree()
+{
+    auto& root = rootTimeRecord();
+    mergeAllThreadSlots();
+    std::unique_lock lock( root.treeMutex );
+    resetRecord( root );
+    root.count = 1;
+    root.started = high_resolution_clock::now();
+    root.traceEvents.clear();
+}
+
+void recordTimerTrace( bool on )
+{
+    traceOn = on;
+}
+
+static void writeCsvRecord( std::ostream& out, const TimerRecordStats& r, const std::string& parentPath )
+{
+    const auto path = parentPath.empty() ? r.name : parentPath + '/' + r.name;
+    std::string quoted;
+    for ( char c : path )
+    {
+        if ( c == '"' )
+            quoted += '"';
+        quoted += c;
+    }
+    out << '"' << quoted << "\"," << r.count << ',' << r.seconds << ',' << r.selfSeconds << '\n';
+    for ( const auto& child : r.children )
+        writeCsvRecord( out, child, path );
+}
+
+tl::expected<void, std::string> saveTimingTreeCsv( const std::filesystem::path& file )
+{
+    std::ofstream out( file );
+    if ( !out )
+        return tl::make_unexpected( std::string( "Cannot open file for writing " ) + utf8string( file ) );
+
+    out << "Name,Count,Time,Self time\n";
+    out << std::setprecision( 9 );
+    writeCsvRecord( out, getTimingTree(), {} );
+
+    if ( !out )
+        return tl::make_unexpected( std::string( "Error saving in file " ) + utf8string( file ) );
+    return {};
+}
+
+static std::string jsonEscape( const std::string& s )
+{
+    std::string res;
+    res.reserve( s.size() );
+    for ( char c : s )
+    {
+        if ( c == '"' || c == '\\' )
+            res += '\\';
+        if ( (unsigned char)c < 0x20 )
+            continue;
+        res += c;
+    }
+    return res;
+}
+
+static void writeTraceEvent( std::ostream& out, bool& first, const std::string& name, int thread, double startMicros, double durMicros )
+{
+    if ( !first )
+        out << ",\n";
+    first = false;
+    out << "{\"name\":\"" << jsonEscape( name ) << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << thread
+        << ",\"ts\":" << startMicros << ",\"dur\":" << durMicros << '}';
+}
+
+// places the children of each record one after another starting from the start of the parent
+static void writeSyntheticTrace( std::ostream& out, bool& first, const TimerRecordStats& r, double startMicros )
+{
+    writeTraceEvent( out, first, r.name, 0, startMicros, r.seconds * 1e6 );
+    for ( const auto& child : r.children )
+    {
+        writeSyntheticTrace( out, first, child, startMicros );
+        startMicros += child.seconds * 1e6;
+    }
+}
+
+tl::expected<void, std::string> saveTimingChromeTrace( const std::filesystem::path& file )
+{
+    std::ofstream out( file );
+    if ( !out )
+        return tl::make_unexpected( std::string( "Cannot open file for writing " ) + utf8string( file ) );
+
+    out << "{\"traceEvents\":[\n" << std::fixed << std::setprecision( 3 );
+    bool first = true;
+    {
+        auto& root = rootTimeRecord();
+        std::unique_lock lock( root.treeMutex );
+        for ( const auto& e : root.traceEvents )
+            writeTraceEvent( out, first, *e.record->name, e.thread, e.startNanos * 1e-3, e.durNanos * 1e-3 );
+    }
+    if ( first )
+    {
+        auto tree = getTimingTree();
+        // the root itself is not shown as a timer
+        double startMicros = 0;
+        for ( const auto& child : tree.children )
+        {
+            writeSyntheticTrace( out, first, child, startMicros );
+            startMicros += child.seconds * 1e6;
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    if ( !out )
+        return tl::make_unexpected( std::string( "Error saving in file " ) + utf8string( file ) );
+    return {};
+}
+
+void Timer::restart( std::string_view name )
 {
     finish();
     start( name );
 }
 
-void Timer::start( const std::string& name )
+void Timer::start( std::string_view name )
 {
-    if ( std::this_thread::get_id() != mainThreadId )
-        return;
-    started_ = true;
+    prevRecord_ = currentRecord;
+    slot_ = getThreadSlots().getSlot( prevRecord_ ? prevRecord_ : &rootTimeRecord(), name );
+    currentRecord = slot_->record;
     start_ = high_resolution_clock::now();
-    auto parent = currentRecord;
-    currentRecord = &parent->children[name];
-    currentRecord->parent = parent;
 }
 
 void Timer::finish()
 {
-    if ( !started_ )
-        return;
-    auto currentParent = currentRecord->parent;
-    if ( !currentParent )
+    if ( !slot_ )
         return;
 
-    currentRecord->time += high_resolution_clock::now() - start_;
-    ++currentRecord->count;
+    const auto dur = duration_cast<nanoseconds>( high_resolution_clock::now() - start_ ).count();
+    slot_->add( dur );
 
-    currentRecord = currentParent;
+    if ( traceOn.load( std::memory_order_relaxed ) )
+    {
+        TraceEvent e;
+        e.record = slot_->record;
+        e.thread = getThreadIndex();
+        e.durNanos = dur;
+        auto& root = rootTimeRecord();
+        std::unique_lock lock( root.treeMutex );
+        e.startNanos = duration_cast<nanoseconds>( start_ - root.started ).count();
+        root.traceEvents.push_back( e );
+    }
+
+    currentRecord = prevRecord_;
+    slot_ = nullptr;
+}
+
+TimeRecord* currentTimerRecord()
+{
+    return currentRecord;
+}
+
+TimerParentScope::TimerParentScope( TimeRecord* parent )
+    : prevRecord_( currentRecord )
+{
+    currentRecord = parent;
+}
+
+TimerParentScope::~TimerParentScope()
+{
+    currentRecord = prevRecord_;
+}
+
+static const TimerRecordStats* findRecord( const TimerRecordStats& r, const std::string& name )
+{
+    if ( r.name == name )
+        return &r;
+    for ( const auto& child : r.children )
+        if ( auto res = findRecord( child, name ) )
+            return res;
+    return nullptr;
+}
+
+TEST(MRMesh, TimingTree)
+{
+    {
+        Timer t( "TimingTreeTest" );
+        const auto timerParent = currentTimerRecord();
+        tbb::parallel_for( tbb::blocked_range<int>( 0, 100, 1 ), [&]( const tbb::blocked_range<int>& range )
+        {
+            TimerParentScope timerScope( timerParent );
+            for ( int i = range.begin(); i < range.end(); ++i )
+            {
+                Timer leaf( "TimingTreeTestLeaf" );
+                std::this_thread::sleep_for( microseconds( 10 ) );
+            }
+        } );
+        tbb::parallel_for( tbb::blocked_range<int>( 0, 50, 1 ), withTimerParent( [&]( const tbb::blocked_range<int>& range )
+        {
+            for ( int i = range.begin(); i < range.end(); ++i )
+                Timer wrapped( "TimingTreeTestWrapped" );
+        } ) );
+    }
+
+    const auto tree = getTimingTree();
+    const auto* test = findRecord( tree, "TimingTreeTest" );
+    ASSERT_NE( test, nullptr );
+    EXPECT_EQ( test->count, 1 );
+    ASSERT_EQ( test->children.size(), 2 );
+    const auto& leaf = test->children.front();
+    EXPECT_EQ( leaf.name, "TimingTreeTestLeaf" );
+    EXPECT_EQ( test->children.back().name, "TimingTreeTestWrapped" );
+    EXPECT_EQ( test->children.back().count, 50 );
+    EXPECT_EQ( leaf.count, 100 );
+    EXPECT_GE( leaf.seconds, 100 * 10e-6 );
+    EXPECT_GE( test->selfSeconds, 0.0 );
+    EXPECT_DOUBLE_EQ( leaf.selfSeconds, leaf.seconds );
+
+    const auto file = std::filesystem::temp_directory_path() / "MRTimingTreeTest.csv";
+    EXPECT_TRUE( saveTimingTreeCsv( file ).has_value() );
+    std::ifstream in( file );
+    std::string header;
+    std::getline( in, header );
+    EXPECT_EQ( header, "Name,Count,Time,Self time" );
+    in.close();
+    std::error_code ec;
+    std::filesystem::remove( file, ec );
+
+    // the timers of another thread without active timers go in the root, whatever timer is active in this thread
+    {
+        Timer busy( "TimingTreeTestBusy" );
+        std::thread( []
+        {
+            Timer other( "TimingTreeTestOtherThread" );
+        } ).join();
+    }
+    const auto tree2 = getTimingTree();
+    const auto* busy = findRecord( tree2, "TimingTreeTestBusy" );
+    ASSERT_NE( busy, nullptr );
+    EXPECT_TRUE( busy->children.empty() );
+    EXPECT_TRUE( std::any_of( tree2.children.begin(), tree2.children.end(),
+        []( const TimerRecordStats& r ) { return r.name == "TimingTreeTestOtherThread"; } ) );
 }
 
 } //namespace MR
@@ -1,8 +1,13 @@
 #pragma once
 
 #include "MRMeshFwd.h"
+#include <tl/expected.hpp>
 #include <chrono>
+#include <filesystem>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 namespace MR
 {
@@ -11,15 +16,22 @@ namespace MR
 /// \{
 
 struct TimeRecord;
+struct TimerThreadSlot;
 
+/// measures the time from construction till destruction (or finish) and accumulates it in the timing tree;
+/// the parent of the timer is the innermost active timer of the same thread; the timers started in a thread without active timers
+/// (e.g. inside tbb::parallel_for) are attributed to the root unless the parent was passed there by \ref TimerParentScope
+/// (BitSetParallelFor, parallelForChunks and the bodies wrapped in \ref withTimerParent do it, but plain tbb calls do not);
+/// after the first start with given name and parent in a thread, the timer neither locks nor allocates:
+/// the time is accumulated in thread-local buffers, which are merged in the tree only on reports
 class Timer
 {
 public:
-    Timer( const std::string& name ) { start( name ); }
+    Timer( std::string_view name ) { start( name ); }
     ~Timer() { finish(); }
 
-    MRMESH_API void restart( const std::string& name );
-    MRMESH_API void start( const std::string& name );
+    MRMESH_API void restart( std::string_view name );
+    MRMESH_API void start( std::string_view name );
     MRMESH_API void finish();
 
     Timer( const Timer & ) = delete;
@@ -31,9 +43,48 @@ public:
 
 private:
     std::chrono::time_point<std::chrono::high_resolution_clock> start_;
-    bool started_{ false };
+    TimerThreadSlot* slot_ = nullptr;
+    TimeRecord* prevRecord_ = nullptr; // current record of this thread before this timer started
 };
 
+/// returns the record of the innermost active timer in this thread (or nullptr) to be passed in parallel tasks by \ref TimerParentScope
+[[nodiscard]] MRMESH_API TimeRecord* currentTimerRecord();
+
+/// makes given record the parent of the timers started in this thread till the end of the scope;
+/// it is intended for the bodies of parallel tasks to attribute their timers to the timer of the thread that started parallel work:
+/// \code
+/// auto timerParent = currentTimerRecord();
+/// tbb::parallel_for( range, [&]( const auto & r ) { TimerParentScope timerScope( timerParent ); ... } );
+/// \endcode
+class TimerParentScope
+{
+public:
+    MRMESH_API explicit TimerParentScope( TimeRecord* parent );
+    MRMESH_API ~TimerParentScope();
+
+    TimerParentScope( const TimerParentScope & ) = delete;
+    TimerParentScope & operator =( const TimerParentScope & ) = delete;
+
+private:
+    TimeRecord* prevRecord_ = nullptr;
+};
+
+/// returns the copy of f, which makes the active timer of this thread the parent of the timers started inside f in any thread;
+/// it is a shortcut for \ref TimerParentScope in the bodies of parallel algorithms and tasks:
+/// \code
+/// tbb::parallel_for( range, withTimerParent( [&]( const auto & r ) { ... } ) );
+/// group.run( withTimerParent( [&] { ... } ) );
+/// \endcode
+template <typename F>
+[[nodiscard]] auto withTimerParent( F f )
+{
+    return [f = std::move( f ), timerParent = currentTimerRecord()]( auto && ... args ) -> decltype( auto )
+    {
+        TimerParentScope timerScope( timerParent );
+        return f( std::forward<decltype( args )>( args )... );
+    };
+}
+
 /// enables or disables printing of timing tree when application terminates
 MRMESH_API void printTimingTreeAtEnd( bool on );
 
@@ -43,9 +94,47 @@ MRMESH_API void printCurrentTimerBranch();
 /// prints the current timing tree, then calls printTimingTreeAtEnd( false );
 MRMESH_API void printTimingTreeAndStop();
 
+/// statistics of one node of the timing tree
+struct TimerRecordStats
+{
+    std::string name;
+    /// the number of finished timers with this name and parent
+    long long count = 0;
+    /// summed time of all finished timers in all threads
+    double seconds = 0;
+    /// seconds minus summed time of children, it is underestimated if the children worked in parallel threads
+    double selfSeconds = 0;
+    std::vector<TimerRecordStats> children;
+};
+
+/// returns the copy of current timing tree, the root has the time passed since the start of application or last reset
+[[nodiscard]] MRMESH_API TimerRecordStats getTimingTree();
+
+/// zeroes the statistics of all records in the timing tree and removes all recorded trace events
+MRMESH_API void resetTimingTree();
+
+/// starts or stops recording of individual timer intervals (with start time and thread) for Chrome trace export;
+/// each finished timer takes memory and a lock while recording is on
+MRMESH_API void recordTimerTrace( bool on );
+
+/// saves the timing tree in flat CSV table with one row per record: path of names from the root, count, total and self seconds
+MRMESH_API tl::expected<void, std::string> saveTimingTreeCsv( const std::filesystem::path& file );
+
+/// saves recorded timer intervals in Chrome trace JSON format (open in chrome://tracing or Perfetto);
+/// if nothing was recorded, then the timing tree is saved with the children of each record placed one after another
+MRMESH_API tl::expected<void, std::string> saveTimingChromeTrace( const std::filesystem::path& file );
+
 /// \}
 
 } // namespace MR
 
 #define MR_TIMER MR::Timer _timer( __FUNCTION__ );
 #define MR_NAMED_TIMER(name) MR::Timer _named_timer( name );
+
+/// the timer for fine-grained functions called many times, e.g. per element from parallel loops;
+/// it is compiled out if MRMESH_NO_LEAF_TIMERS is defined to remove even small timer overhead from such functions
+#ifdef MRMESH_NO_LEAF_TIMERS
+#define MR_LEAF_TIMER
+#else
+#define MR_LEAF_TIMER MR_TIMER
+#endif
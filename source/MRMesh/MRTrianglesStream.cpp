@@ -0,0 +1,63 @@
+#include "MRTrianglesStream.h"
+#include "MRMesh.h"
+#include "MRTimer.h"
+#include "MRPch/MRTBB.h"
+
+namespace MR
+{
+
+TrianglesStream trianglesStreamFromMesh( const MeshPart& mp, size_t chunkSize )
+{
+    return [mp, chunkSize]( const TrianglesChunkCallback& callback ) -> tl::expected<void, std::string>
+    {
+        std::vector<MeshBuilder::ThreePoints> triangles;
+        triangles.reserve( chunkSize );
+        auto flush = [&]()
+        {
+            const bool res = callback( TrianglesChunk{ triangles.data(), triangles.size() } );
+            triangles.clear();
+            return res;
+        };
+        for ( auto f : mp.mesh.topology.getFaceIds( mp.region ) )
+        {
+            if ( !mp.mesh.topology.hasFace( f ) )
+                continue;
+            MeshBuilder::ThreePoints t;
+            mp.mesh.getTriPoints( f, t[0], t[1], t[2] );
+            triangles.push_back( t );
+            if ( triangles.size() >= chunkSize && !flush() )
+                return {};
+        }
+        if ( !triangles.empty() )
+            flush();
+        return {};
+    };
+}
+
+tl::expected<Box3f, std::string> computeBoundingBox( const TrianglesStream& stream )
+{
+    MR_TIMER
+    Box3f box;
+    auto res = stream( [&]( const TrianglesChunk& chunk )
+    {
+        box.include( tbb::parallel_reduce( tbb::blocked_range<size_t>( 0, chunk.size ), Box3f{},
+            [&]( const tbb::blocked_range<size_t>& range, Box3f curr )
+        {
+            for ( size_t i = range.begin(); i < range.end(); ++i )
+                for ( const auto& p : chunk.triangles[i] )
+                    curr.include( p );
+            return curr;
+        },
+            []( Box3f a, const Box3f& b )
+        {
+            a.include( b );
+            return a;
+        } ) );
+        return true;
+    } );
+    if ( !res )
+        return tl::make_unexpected( std::move( res.error() ) );
+    return box;
+}
+
+} // namespace MR
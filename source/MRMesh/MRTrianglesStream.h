@@ -0,0 +1,43 @@
+#pragma once
+
+#include "MRMeshFwd.h"
+#include "MRMeshBuilderTypes.h"
+#include "MRBox.h"
+#include <tl/expected.hpp>
+#include <functional>
+#include <string>
+
+namespace MR
+{
+
+/// \addtogroup MeshGroup
+/// \{
+
+/// default number of triangles in one chunk of streamed mesh
+constexpr size_t DefaultTrianglesChunkSize = size_t( 1 ) << 16;
+
+/// next chunk of triangles passed while a mesh is streamed as triangle soup;
+/// the vertices shared by several triangles are identified by exactly equal coordinates
+struct TrianglesChunk
+{
+    const MeshBuilder::ThreePoints* triangles = nullptr;
+    size_t size = 0;
+};
+
+/// receives next chunk of streamed triangles;
+/// \return false to stop the streaming
+using TrianglesChunkCallback = std::function<bool( const TrianglesChunk& )>;
+
+/// passes all triangles of some mesh to the callback by consecutive chunks;
+/// a stream can be started several times, and it shall pass the same triangles in the same order each time
+using TrianglesStream = std::function<tl::expected<void, std::string>( const TrianglesChunkCallback& )>;
+
+/// makes the stream of valid triangles of given mesh part (the mesh and the region must outlive the stream)
+[[nodiscard]] MRMESH_API TrianglesStream trianglesStreamFromMesh( const MeshPart& mp, size_t chunkSize = DefaultTrianglesChunkSize );
+
+/// finds the bounding box of all triangles in the stream in one pass
+MRMESH_API tl::expected<Box3f, std::string> computeBoundingBox( const TrianglesStream& stream );
+
+/// \}
+
+} // namespace MR
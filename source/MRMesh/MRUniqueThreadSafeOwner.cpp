@@ -2,24 +2,40 @@
 #include "MRAABBTree.h"
 #include "MRAABBTreePolyline.h"
 #include "MRAABBTreePoints.h"
+#include "MRWideAABBTree.h"
 #include "MRHeapBytes.h"
+#include "MRVector.h"
+#include "MRMesh.h"
+#include "MRTorus.h"
+#include "MRGTest.h"
 #include "MRPch/MRTBB.h"
 #include <cassert>
+#include <thread>
 
 namespace MR
 {
 
+template<typename T>
+struct UniqueThreadSafeOwner<T>::Builder
+{
+    /// the threads inside this arena take only the tasks of the object creation
+    tbb::task_arena arena;
+    tbb::task_group group;
+};
+
 template<typename T>
 UniqueThreadSafeOwner<T>::UniqueThreadSafeOwner() = default;
 
 template<typename T>
-UniqueThreadSafeOwner<T>::UniqueThreadSafeOwner( const UniqueThreadSafeOwner& b ) 
+UniqueThreadSafeOwner<T>::UniqueThreadSafeOwner( const UniqueThreadSafeOwner& b )
 { 
     assert( this != &b );
     // do not lock this since nobody can use it before the end of construction
     std::unique_lock lock( b.mutex_ );
     if ( b.obj_ )
         obj_.reset( new T( *b.obj_ ) );
+    needsUpdate_ = b.needsUpdate_.load();
+    ready_ = needsUpdate_ ? nullptr : obj_.get();
 }
 
 template<typename T>
@@ -28,9 +44,12 @@ UniqueThreadSafeOwner<T>& UniqueThreadSafeOwner<T>::operator =( const UniqueThre
     if ( this != &b )
     {
         std::scoped_lock lock( mutex_, b.mutex_ );
+        ready_ = nullptr;
         obj_.reset();
         if ( b.obj_ )
             obj_.reset( new T( *b.obj_ ) );
+        needsUpdate_ = b.needsUpdate_.load();
+        ready_ = needsUpdate_ ? nullptr : obj_.get();
     }
     return *this; 
 }
@@ -42,6 +61,9 @@ UniqueThreadSafeOwner<T>::UniqueThreadSafeOwner( UniqueThreadSafeOwner&& b ) noe
     // do not lock this since nobody can use it before the end of construction
     std::unique_lock lock( b.mutex_ );
     obj_ = std::move( b.obj_ );
+    needsUpdate_ = b.needsUpdate_.exchange( false );
+    ready_ = b.ready_.exchange( nullptr );
+    builder_ = b.builder_.exchange( nullptr );
 }
 
 template<typename T>
@@ -51,37 +73,104 @@ UniqueThreadSafeOwner<T>& UniqueThreadSafeOwner<T>::operator =( UniqueThreadSafe
     {
         std::scoped_lock lock( mutex_, b.mutex_ );
         obj_ = std::move( b.obj_ );
+        needsUpdate_ = b.needsUpdate_.exchange( false );
+        ready_ = b.ready_.exchange( nullptr );
+        // exchange the builders to avoid both allocation and deallocation here
+        builder_ = b.builder_.exchange( builder_.load() );
     }
     return *this;
 }
 
 template<typename T>
-UniqueThreadSafeOwner<T>::~UniqueThreadSafeOwner() = default;
+UniqueThreadSafeOwner<T>::~UniqueThreadSafeOwner()
+{
+    delete builder_.load();
+}
 
 template<typename T>
 void UniqueThreadSafeOwner<T>::reset()
 {
     std::unique_lock lock( mutex_ );
+    ready_ = nullptr;
     obj_.reset();
+    needsUpdate_ = false;
 }
 
 template<typename T>
-const T & UniqueThreadSafeOwner<T>::getOrCreate( const std::function<T()> & creator )
+void UniqueThreadSafeOwner<T>::markNeedsUpdate()
 {
-    if ( obj_ ) // fast path to avoid locking when everything is ready
-        return *obj_;
-    assert( creator );
     std::unique_lock lock( mutex_ );
-    if ( !obj_ )
+    if ( obj_ )
+    {
+        ready_ = nullptr;
+        needsUpdate_ = true;
+    }
+}
+
+template<typename T>
+const T & UniqueThreadSafeOwner<T>::getOrCreate( const std::function<T()> & creator, const std::function<void(T&)> & updater )
+{
+    for ( ;; )
     {
-        // we do not want this thread while inside creator steal outside piece of work 
-        // and call UniqueThreadSafeOwner<T>::getOrCreate recursively
-        tbb::this_task_arena::isolate( [&]
+        if ( auto res = ready_.load( std::memory_order_acquire ) ) // fast path to avoid any waiting when everything is ready
+            return *res;
+
+        bool expected = false;
+        if ( building_.compare_exchange_strong( expected, true, std::memory_order_acq_rel ) )
         {
-            obj_ = std::make_unique<T>( creator() );
-        } );
+            // this thread is the builder
+            struct ResetBuilding
+            {
+                std::atomic<bool> & building;
+                ~ResetBuilding()
+                {
+                    building.store( false, std::memory_order_release );
+                    building.notify_all();
+                }
+            } resetBuilding{ building_ };
+
+            if ( auto res = ready_.load( std::memory_order_acquire ) )
+                return *res;
+            assert( creator );
+            // the builder is created only here, so the objects which caches are never built do not pay for it
+            auto builder = builder_.load( std::memory_order_acquire );
+            if ( !builder )
+            {
+                builder = new Builder;
+                builder_.store( builder, std::memory_order_release );
+            }
+            // we do not want this thread while inside creator steal outside piece of work
+            // and call UniqueThreadSafeOwner<T>::getOrCreate recursively, so the work is done inside own arena
+            builder->arena.execute( [&]
+            {
+                builder->group.run_and_wait( [&]
+                {
+                    if ( obj_ && needsUpdate_ && updater )
+                        updater( *obj_ );
+                    else
+                        obj_ = std::make_unique<T>( creator() );
+                } );
+            } );
+            needsUpdate_ = false;
+            ready_.store( obj_.get(), std::memory_order_release );
+            return *obj_;
+        }
+
+#if TBB_VERSION_MAJOR >= 2021
+        // other thread is the builder: help it by executing the tasks it spawned
+        // (concurrent waiting on the same task group is supported only since oneTBB);
+        // the builder is not destroyed till the destruction of this, but it can be not created yet
+        if ( auto builder = builder_.load( std::memory_order_acquire ) )
+        {
+            builder->arena.execute( [&]
+            {
+                builder->group.wait();
+            } );
+        }
+#endif
+        // no more tasks to help with (or old TBB): block till the builder finishes instead of spinning
+        building_.wait( true, std::memory_order_acquire );
     }
-    return *obj_;
 }
 
 template<typename T>
@@ -95,5 +184,23 @@ template class UniqueThreadSafeOwner<AABBTree>;
 template class UniqueThreadSafeOwner<AABBTreePolyline2>;
 template class UniqueThreadSafeOwner<AABBTreePolyline3>;
 template class UniqueThreadSafeOwner<AABBTreePoints>;
+template class UniqueThreadSafeOwner<WideAABBTree>;
+template class UniqueThreadSafeOwner<VertNormals>;
+template class UniqueThreadSafeOwner<UndirectedEdgeScalars>;
+
+TEST(MRMesh, UniqueThreadSafeOwnerConcurrent)
+{
+    // many threads request the same tree at once, only one builds it, and the others wait for it
+    const Mesh torus = makeTorus( 1.0f, 0.3f, 256, 256 );
+    constexpr int NumThreads = 16;
+    std::vector<const AABBTree *> trees( NumThreads, nullptr );
+    std::vector<std::thread> threads;
+    for ( int i = 0; i < NumThreads; ++i )
+        threads.emplace_back( [&, i] { trees[i] = &torus.getAABBTree(); } );
+    for ( auto & t : threads )
+        t.join();
+    for ( auto tree : trees )
+        EXPECT_EQ( tree, torus.getAABBTreeNotCreate() );
+}
 
 } //namespace MR
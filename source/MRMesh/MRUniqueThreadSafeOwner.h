@@ -1,6 +1,7 @@
 #pragma once
 
 #include "MRMeshFwd.h"
+#include <atomic>
 #include <functional>
 #include <mutex>
 #include <memory>
@@ -12,7 +13,10 @@ namespace MR
 /// \{
 
 /// This class is base class for unique thread safe owning of some objects, for example AABBTree
-/// classes derived from this one should have function like getOrCreate
+/// classes derived from this one should have function like getOrCreate;
+/// the object is created only once by one thread, and the other threads requesting it at the same time
+/// first join the work of the creator (if it spawns tbb tasks), and then block till the end of creation;
+/// after creation the object is returned by a single atomic load without any locking
 template<typename T>
 class UniqueThreadSafeOwner
 {
@@ -26,16 +30,31 @@ public:
 
     /// deletes owned object
     MRMESH_API void reset();
-    /// returns existing owned object and does not create new one
-    const T * get() { return obj_.get(); }
-    /// returns existing owned object or creates new one using creator function
-    MRMESH_API const T & getOrCreate( const std::function<T()> & creator );
+    /// marks owned object (if any) as outdated, so it will be updated instead of recreated on next getOrCreate call
+    MRMESH_API void markNeedsUpdate();
+    /// returns true if owned object exists, but it is outdated and must be updated before use
+    bool needsUpdate() const { return needsUpdate_; }
+    /// returns existing up-to-date owned object and does not create new one
+    const T * get() { return ready_.load( std::memory_order_acquire ); }
+    /// returns existing owned object or creates new one using creator function;
+    /// if the object was marked as outdated, then it is updated in place by updater function (or recreated if updater is not given)
+    MRMESH_API const T & getOrCreate( const std::function<T()> & creator, const std::function<void(T&)> & updater = {} );
     /// returns the amount of memory this object occupies on heap
     [[nodiscard]] MRMESH_API size_t heapBytes() const;
 
 protected:
+    /// guards obj_ in copy, move, reset and heapBytes, which are not expected to be called concurrently with getOrCreate
     mutable std::mutex mutex_;
     std::unique_ptr<T> obj_;
+    std::atomic<bool> needsUpdate_{ false };
+    /// obj_.get() if it exists and up-to-date, otherwise nullptr
+    std::atomic<const T *> ready_{ nullptr };
+    /// true while some thread creates or updates the object
+    std::atomic<bool> building_{ false };
+    /// task arena and task group of the object creation, which the waiting threads join;
+    /// created by the first thread that builds the object, and owned by this
+    struct Builder;
+    std::atomic<Builder *> builder_{ nullptr };
 };
 
 /// \}
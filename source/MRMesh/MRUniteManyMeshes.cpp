@@ -6,21 +6,25 @@
 #include "MRMeshBoolean.h"
 #include "MRMeshFixer.h"
 #include "MRMeshDecimate.h"
+#include "MRAABBTreeMaker.h"
+#include "MRCube.h"
+#include "MRGTest.h"
 #include <random>
 
 namespace MR
 {
 
-tl::expected<Mesh, std::string> unitePairOfMeshes( const Mesh& a, const Mesh& b, 
+tl::expected<Mesh, std::string> booleanPairOfMeshes( const Mesh& a, const Mesh& b, BooleanOperation operation,
     bool fixDegenerations, float maxError, const Vector3f* shift = nullptr )
 {
+    assert( operation == BooleanOperation::Union || operation == BooleanOperation::Intersection || operation == BooleanOperation::DifferenceAB );
     if ( a.points.empty() )
-        return b;
+        return operation == BooleanOperation::Union ? b : Mesh{};
     else if ( b.points.empty() )
-        return a;
+        return operation == BooleanOperation::Intersection ? Mesh{} : a;
 
     AffineXf3f xf = AffineXf3f::translation( shift ? *shift : Vector3f() );
-    auto res = MR::boolean( a, b, BooleanOperation::Union, shift ? &xf : nullptr );
+    auto res = MR::boolean( a, b, operation, shift ? &xf : nullptr );
     if ( !res.valid() )
         return tl::make_unexpected( res.errorString );
 
@@ -30,135 +34,292 @@ tl::expected<Mesh, std::string> unitePairOfMeshes( const Mesh& a, const Mesh& b,
     return res.mesh;
 }
 
-class BooleanReduce
+using ObjTreeNodeVec = AABBTreeNodeVec<ObjTreeTraits>;
+using ObjNodeId = AABBTreeNodeId<ObjTreeTraits>;
+
+// combines many meshes by the same boolean operation bottom-up over the tree of their bounding boxes
+class ManyMeshesBoolean
 {
 public:
-    BooleanReduce( std::vector<Mesh>& mehses, const std::vector<Vector3f>& shifts, float maxError, bool fixDegenerations ) :
-        maxError_{ maxError },
-        fixDegenerations_{ fixDegenerations },
-        mergedMeshes_{ mehses },
-        shifts_{ shifts }
+    ManyMeshesBoolean( std::vector<const Mesh*> operands, BooleanOperation operation, const UniteManyMeshesParams& params ) :
+        operands_{ std::move( operands ) },
+        operation_{ operation },
+        params_{ params }
     {}
 
-    BooleanReduce( BooleanReduce& x, tbb::split ) :
-        error{ x.error },
-        maxError_{ x.maxError_ },
-        fixDegenerations_{ x.fixDegenerations_ },
-        mergedMeshes_{ x.mergedMeshes_ },
-        shifts_{ x.shifts_ }
-    {
-    }
+    tl::expected<Mesh, std::string> run();
 
-    void join( const BooleanReduce& y )
+private:
+    // mesh combined from the operands of some subtree, and its random shift
+    struct Part
     {
-        if ( !error.empty() )
-            return;
-        if ( !y.error.empty() )
-        {
-            error = y.error;
-            return;
-        }
-        Vector3f shift = y.resShift - resShift;
-        auto res = unitePairOfMeshes( resultMesh, y.resultMesh, fixDegenerations_, maxError_, shifts_.empty() ? nullptr : &shift );
-        if ( res.has_value() )
-            resultMesh = std::move( res.value() );
-        else
-            error = std::move( res.error() );
-    }
+        Mesh mesh;
+        Vector3f shift;
+    };
 
-    void operator()( const tbb::blocked_range<int>& r )
-    {
-        assert( r.size() == 1 );
-        assert( resultMesh.points.empty() );
-        if ( !shifts_.empty() )
-            resShift = shifts_[r.begin()];
-        resultMesh = std::move( mergedMeshes_[r.begin()] );
-    }
+    // numbers the leaves in the order of depth-first traversal and stores the range of leaves of each subtree
+    void numberLeaves_( ObjNodeId nodeId, int& counter );
+    // finds the pairs of operands with colliding surfaces, checking only the pairs with overlapping boxes
+    std::vector<std::pair<int, int>> findCollidingOperands_() const;
+    // marks the nodes, where the operands of left and right subtrees collide
+    void markCollidingNodes_();
+    tl::expected<Part, std::string> combine_( ObjNodeId nodeId ) const;
 
-    Mesh resultMesh;
-    std::string error;
-    Vector3f resShift;
-private:
-    float maxError_{ 0.0f };
-    bool fixDegenerations_{ false };
-    std::vector<Mesh>& mergedMeshes_;
-    const std::vector<Vector3f>& shifts_;
+    std::vector<const Mesh*> operands_;
+    BooleanOperation operation_;
+    const UniteManyMeshesParams& params_;
+    std::vector<Box3f> boxes_;
+    std::vector<Vector3f> shifts_;
+    ObjTreeNodeVec nodes_;
+    // [first, last) leaves of each subtree in the order of depth-first traversal
+    Vector<std::pair<int, int>, ObjNodeId> leafRanges_;
+    // the position of each operand in the order of depth-first traversal
+    std::vector<int> leafPos_;
+    // true for the nodes where the boolean is necessary, otherwise the subtrees are simply merged
+    std::vector<bool> collidingNodes_;
 };
 
-tl::expected<Mesh, std::string> uniteManyMeshes( 
-    const std::vector<const Mesh*>& meshes, const UniteManyMeshesParams& params /*= {} */ )
+void ManyMeshesBoolean::numberLeaves_( ObjNodeId nodeId, int& counter )
 {
-    MR_TIMER;
-    if ( meshes.empty() )
-        return Mesh{};
+    const auto& node = nodes_[nodeId];
+    const int first = counter;
+    if ( node.leaf() )
+        leafPos_[int( node.leafId() )] = counter++;
+    else
+    {
+        numberLeaves_( node.l, counter );
+        numberLeaves_( node.r, counter );
+    }
+    leafRanges_[nodeId] = { first, counter };
+}
 
-    // find non intersecting groups for simple merge instead of union
-    std::vector<std::vector<int>> nonIntersectingGroups;
-    for ( int m = 0; m < meshes.size(); ++m )
+std::vector<std::pair<int, int>> ManyMeshesBoolean::findCollidingOperands_() const
+{
+    MR_TIMER;
+    tbb::enumerable_thread_specific<std::vector<std::pair<int, int>>> collidingPerThread;
+    tbb::parallel_for( tbb::blocked_range<int>( 0, int( operands_.size() ), 1 ), withTimerParent( [&] ( const tbb::blocked_range<int>& range )
     {
-        const auto& mesh = meshes[m];
-        if ( !mesh )
-            continue;
-        bool merged = false;
-        for ( auto& group : nonIntersectingGroups )
+        auto& local = collidingPerThread.local();
+        for ( int i = range.begin(); i < range.end(); ++i )
         {
-            tbb::enumerable_thread_specific<bool> intersectPerTread( false );
-            tbb::parallel_for( tbb::blocked_range<int>( 0, int( group.size() ) ),
-                               [&] ( const tbb::blocked_range<int>& range )
+            const auto& box = boxes_[i];
+            constexpr int MaxStackSize = 32; // to avoid allocations
+            ObjNodeId subtasks[MaxStackSize];
+            int stackSize = 0;
+            subtasks[stackSize++] = ObjNodeId{ 0 };
+            while ( stackSize > 0 )
             {
-                auto& localIntersect = intersectPerTread.local();
-                if ( localIntersect )
-                    return;
-                for ( int i = range.begin(); i < range.end(); ++i )
+                const auto& node = nodes_[subtasks[--stackSize]];
+                if ( !node.box.intersects( box ) )
+                    continue;
+                if ( node.leaf() )
                 {
-                    localIntersect = !findCollidingTriangles( *mesh, *meshes[group[i]], nullptr, true ).empty();
-                    if ( localIntersect )
-                        return;
+                    const int j = int( node.leafId() );
+                    if ( j > i && !findCollidingTriangles( *operands_[i], *operands_[j], nullptr, true ).empty() )
+                        local.emplace_back( i, j );
+                    continue;
                 }
-            } );
-            merged = std::none_of( intersectPerTread.begin(), intersectPerTread.end(), [] ( auto inter ) { return inter; } );
-            if ( merged )
-            {
-                group.emplace_back( m );
-                break;
+                assert( stackSize + 2 <= MaxStackSize );
+                subtasks[stackSize++] = node.r;
+                subtasks[stackSize++] = node.l;
             }
         }
-        if ( !merged )
+    } ) );
+
+    std::vector<std::pair<int, int>> res;
+    for ( const auto& local : collidingPerThread )
+        res.insert( res.end(), local.begin(), local.end() );
+    return res;
+}
+
+void ManyMeshesBoolean::markCollidingNodes_()
+{
+    MR_TIMER;
+    collidingNodes_.assign( nodes_.size(), false );
+    for ( const auto& [i, j] : findCollidingOperands_() )
+    {
+        const int pi = leafPos_[i];
+        const int pj = leafPos_[j];
+        // descend to the lowest common ancestor of both leaves
+        ObjNodeId nodeId{ 0 };
+        for ( ;; )
         {
-            nonIntersectingGroups.emplace_back();
-            nonIntersectingGroups.back().emplace_back( m );
+            const auto& node = nodes_[nodeId];
+            assert( !node.leaf() );
+            const auto [lFirst, lLast] = leafRanges_[node.l];
+            const bool iLeft = pi >= lFirst && pi < lLast;
+            const bool jLeft = pj >= lFirst && pj < lLast;
+            if ( iLeft != jLeft )
+                break;
+            nodeId = iLeft ? node.l : node.r;
         }
+        collidingNodes_[nodeId] = true;
     }
+}
 
-    // merge non intersecting groups
-    std::vector<Mesh> mergedMeshes( nonIntersectingGroups.size() );
-    tbb::parallel_for( tbb::blocked_range<int>( 0, int( nonIntersectingGroups.size() ) ),
-                       [&] ( const tbb::blocked_range<int>& range )
+auto ManyMeshesBoolean::combine_( ObjNodeId nodeId ) const -> tl::expected<Part, std::string>
+{
+    const auto& node = nodes_[nodeId];
+    if ( node.leaf() )
+    {
+        const int i = int( node.leafId() );
+        return Part{ *operands_[i], shifts_.empty() ? Vector3f() : shifts_[i] };
+    }
+
+    tl::expected<Part, std::string> left, right;
+    tbb::task_group group;
+    group.run( withTimerParent( [&] { left = combine_( node.l ); } ) );
+    right = combine_( node.r );
+    group.wait();
+    if ( !left.has_value() )
+        return left;
+    if ( !right.has_value() )
+        return right;
+
+    // the result is kept in the shifted space of the left part
+    const Vector3f shift = right->shift - left->shift;
+    if ( operation_ == BooleanOperation::Union && !collidingNodes_[nodeId] )
+    {
+        if ( !shifts_.empty() )
+            right->mesh.transform( AffineXf3f::translation( shift ) );
+        left->mesh.addPart( right->mesh );
+        return left;
+    }
+
+    auto res = booleanPairOfMeshes( left->mesh, right->mesh, operation_, params_.fixDegenerations, params_.maxAllowedError,
+        shifts_.empty() ? nullptr : &shift );
+    if ( !res.has_value() )
+        return tl::make_unexpected( std::move( res.error() ) );
+    left->mesh = std::move( res.value() );
+    return left;
+}
+
+tl::expected<Mesh, std::string> ManyMeshesBoolean::run()
+{
+    MR_TIMER;
+    const auto emptyIt = std::remove_if( operands_.begin(), operands_.end(), [] ( const Mesh* m ) { return !m || m->points.empty(); } );
+    if ( emptyIt != operands_.end() && operation_ == BooleanOperation::Intersection )
+        return Mesh{};
+    operands_.erase( emptyIt, operands_.end() );
+    if ( operands_.empty() )
+        return Mesh{};
+
+    // the boxes are computed from the AABB trees of operands, which are necessary for collision and boolean anyway
+    boxes_.resize( operands_.size() );
+    tbb::parallel_for( tbb::blocked_range<int>( 0, int( operands_.size() ), 1 ), withTimerParent( [&] ( const tbb::blocked_range<int>& range )
     {
         for ( int i = range.begin(); i < range.end(); ++i )
-            for ( int j = 0; j < nonIntersectingGroups[i].size(); ++j )
-                mergedMeshes[i].addPart( *meshes[nonIntersectingGroups[i][j]] );
-    } );
+            boxes_[i] = operands_[i]->getBoundingBox();
+    } ) );
 
-    std::vector<Vector3f> randomShifts;
-    if ( params.useRandomShifts )
+    if ( operation_ == BooleanOperation::Intersection )
     {
-        randomShifts.resize( mergedMeshes.size() );
+        Box3f commonBox = boxes_.front();
+        for ( const auto& box : boxes_ )
+            commonBox.intersect( box );
+        if ( !commonBox.valid() )
+            return Mesh{};
+    }
+
+    std::vector<BoxedLeaf<ObjTreeTraits>> boxedLeaves( operands_.size() );
+    for ( int i = 0; i < operands_.size(); ++i )
+        boxedLeaves[i] = { ObjId( i ), boxes_[i] };
+    nodes_ = makeAABBTreeNodeVec( std::move( boxedLeaves ) );
+
+    leafRanges_.resize( nodes_.size() );
+    leafPos_.resize( operands_.size() );
+    int counter = 0;
+    numberLeaves_( ObjNodeId{ 0 }, counter );
+    assert( counter == operands_.size() );
+
+    if ( operation_ == BooleanOperation::Union )
+        markCollidingNodes_();
+
+    if ( params_.useRandomShifts )
+    {
+        shifts_.resize( operands_.size() );
         std::random_device rd;
         std::mt19937 mt( rd() );
-        std::uniform_real_distribution<float> dist( -params.maxAllowedError * 0.5f, params.maxAllowedError * 0.5f );
-        for ( auto& shift : randomShifts )
+        std::uniform_real_distribution<float> dist( -params_.maxAllowedError * 0.5f, params_.maxAllowedError * 0.5f );
+        for ( auto& shift : shifts_ )
             for ( int i = 0; i < 3; ++i )
                 shift[i] = dist( mt );
     }
 
-    // parallel reduce unite merged meshes
-    BooleanReduce reducer( mergedMeshes, randomShifts, params.maxAllowedError, params.fixDegenerations );
-    tbb::parallel_reduce( tbb::blocked_range<int>( 0, int( mergedMeshes.size() ), 1 ), reducer );
-    if ( !reducer.error.empty() )
-        return tl::make_unexpected( "Error while uniting meshes: " + reducer.error );
+    auto res = combine_( ObjNodeId{ 0 } );
+    if ( !res.has_value() )
+        return tl::make_unexpected( std::move( res.error() ) );
+    return std::move( res->mesh );
+}
+
+tl::expected<Mesh, std::string> uniteManyMeshes( 
+    const std::vector<const Mesh*>& meshes, const UniteManyMeshesParams& params /*= {} */ )
+{
+    MR_TIMER;
+    auto res = ManyMeshesBoolean( meshes, BooleanOperation::Union, params ).run();
+    if ( !res.has_value() )
+        return tl::make_unexpected( "Error while uniting meshes: " + res.error() );
+    return res;
+}
+
+tl::expected<Mesh, std::string> intersectManyMeshes(
+    const std::vector<const Mesh*>& meshes, const UniteManyMeshesParams& params /*= {} */ )
+{
+    MR_TIMER;
+    auto res = ManyMeshesBoolean( meshes, BooleanOperation::Intersection, params ).run();
+    if ( !res.has_value() )
+        return tl::make_unexpected( "Error while intersecting meshes: " + res.error() );
+    return res;
+}
+
+tl::expected<Mesh, std::string> subtractManyMeshes( const std::vector<const Mesh*>& minuends,
+    const std::vector<const Mesh*>& subtrahends, const UniteManyMeshesParams& params /*= {} */ )
+{
+    MR_TIMER;
+    auto minuend = uniteManyMeshes( minuends, params );
+    if ( !minuend.has_value() || minuend->points.empty() )
+        return minuend;
+
+    const auto box = minuend->getBoundingBox();
+    std::vector<const Mesh*> relevantSubtrahends;
+    for ( const auto* mesh : subtrahends )
+        if ( mesh && mesh->getBoundingBox().intersects( box ) )
+            relevantSubtrahends.push_back( mesh );
+    if ( relevantSubtrahends.empty() )
+        return minuend;
+
+    auto subtrahend = uniteManyMeshes( relevantSubtrahends, params );
+    if ( !subtrahend.has_value() )
+        return subtrahend;
+
+    auto res = booleanPairOfMeshes( *minuend, *subtrahend, BooleanOperation::DifferenceAB, params.fixDegenerations, params.maxAllowedError );
+    if ( !res.has_value() )
+        return tl::make_unexpected( "Error while subtracting meshes: " + res.error() );
+    return res;
+}
+
+TEST( MRMesh, ManyMeshesBoolean )
+{
+    const auto cubeA = makeCube( Vector3f::diagonal( 1 ), Vector3f( 0, 0, 0 ) );
+    const auto cubeB = makeCube( Vector3f::diagonal( 1 ), Vector3f( 0.5f, 0.25f, 0.25f ) );
+    const auto cubeFar = makeCube( Vector3f::diagonal( 1 ), Vector3f( 10, 0, 0 ) );
+    const double overlap = 0.5 * 0.75 * 0.75;
+
+    auto united = uniteManyMeshes( { &cubeA, &cubeFar, nullptr, &cubeB } );
+    ASSERT_TRUE( united.has_value() );
+    EXPECT_NEAR( united->volume(), 3 - overlap, 1e-5 );
+
+    auto intersected = intersectManyMeshes( { &cubeA, &cubeB } );
+    ASSERT_TRUE( intersected.has_value() );
+    EXPECT_NEAR( intersected->volume(), overlap, 1e-5 );
+
+    intersected = intersectManyMeshes( { &cubeA, &cubeB, &cubeFar } );
+    ASSERT_TRUE( intersected.has_value() );
+    EXPECT_TRUE( intersected->points.empty() );
 
-    return reducer.resultMesh;
+    auto subtracted = subtractManyMeshes( { &cubeA }, { &cubeB, &cubeFar } );
+    ASSERT_TRUE( subtracted.has_value() );
+    EXPECT_NEAR( subtracted->volume(), 1 - overlap, 1e-5 );
 }
 
 }
@@ -22,9 +22,20 @@ struct UniteManyMeshesParams
 };
 
 // Computes the surface of objects' union each of which is defined by its own surface mesh
-// - merge non intersecting meshes first
-// - unite merged groups
+// - builds the tree of meshes' bounding boxes and finds the pairs of meshes with colliding surfaces in parallel
+// - combines the meshes bottom-up over the tree, so nearby meshes are united first and each boolean cuts only small surfaces
+// - the subtrees without colliding meshes in between are merged without boolean
 MRMESH_API tl::expected<Mesh, std::string> uniteManyMeshes( const std::vector<const Mesh*>& meshes, 
     const UniteManyMeshesParams& params = {} );
 
+// Computes the surface of objects' intersection each of which is defined by its own surface mesh,
+// the meshes are intersected bottom-up over the tree of their bounding boxes as in uniteManyMeshes
+MRMESH_API tl::expected<Mesh, std::string> intersectManyMeshes( const std::vector<const Mesh*>& meshes,
+    const UniteManyMeshesParams& params = {} );
+
+// Computes the surface of the union of minuends minus the union of subtrahends,
+// the subtrahends with bounding boxes not intersecting the box of minuends are ignored
+MRMESH_API tl::expected<Mesh, std::string> subtractManyMeshes( const std::vector<const Mesh*>& minuends,
+    const std::vector<const Mesh*>& subtrahends, const UniteManyMeshesParams& params = {} );
+
 }
\ No newline at end of file
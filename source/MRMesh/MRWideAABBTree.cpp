@@ -0,0 +1,170 @@
+#include "MRWideAABBTree.h"
+#include "MRAABBTreeMaker.h"
+#include "MRMesh.h"
+#include "MRMeshIntersect.h"
+#include "MRMeshProject.h"
+#include "MRMeshCollide.h"
+#include "MRLine3.h"
+#include "MRTorus.h"
+#include "MRTimer.h"
+#include "MRGTest.h"
+
+namespace MR
+{
+
+WideAABBTree::WideAABBTree( const AABBTree & tree )
+{
+    MR_TIMER;
+    if ( tree.nodes().empty() )
+        return;
+
+    // each wide node takes at least two binary nodes
+    nodes_.reserve( tree.nodes().size() / 2 + 1 );
+    nodes_.resize( 1 );
+
+    // binary nodes to be collapsed and the wide nodes to receive the result
+    std::vector<std::pair<AABBTree::NodeId, NodeId>> stack;
+    stack.emplace_back( tree.rootNodeId(), rootNodeId() );
+
+    while ( !stack.empty() )
+    {
+        const auto [bn, wn] = stack.back();
+        stack.pop_back();
+
+        AABBTree::NodeId children[Width];
+        int numChildren = 0;
+        if ( tree[bn].leaf() )
+        {
+            // only the root of single-face tree
+            children[numChildren++] = bn;
+        }
+        else
+        {
+            children[numChildren++] = tree[bn].l;
+            children[numChildren++] = tree[bn].r;
+            while ( numChildren < Width )
+            {
+                // open not-leaf child with the largest box surface area
+                int best = -1;
+                float bestArea = -1;
+                for ( int i = 0; i < numChildren; ++i )
+                {
+                    const auto & child = tree[children[i]];
+                    if ( child.leaf() )
+                        continue;
+                    const auto area = boxSurfaceArea( child.box );
+                    if ( area > bestArea )
+                    {
+                        best = i;
+                        bestArea = area;
+                    }
+                }
+                if ( best < 0 )
+                    break;
+                const auto & opened = tree[children[best]];
+                children[best] = opened.l;
+                children[numChildren++] = opened.r;
+            }
+        }
+
+        Node node;
+        for ( int i = 0; i < numChildren; ++i )
+        {
+            const auto & child = tree[children[i]];
+            node.setBox( i, child.box );
+            if ( child.leaf() )
+                node.setLeaf( i, child.leafId() );
+            else
+            {
+                const NodeId wc( nodes_.size() );
+                nodes_.emplace_back();
+                node.setChild( i, wc );
+                stack.emplace_back( children[i], wc );
+            }
+        }
+        nodes_[wn] = node;
+    }
+}
+
+Box3f WideAABBTree::getBoundingBox() const
+{
+    Box3f res;
+    if ( nodes_.empty() )
+        return res;
+    const auto & root = nodes_[rootNodeId()];
+    for ( int i = 0; i < Width && !root.empty( i ); ++i )
+        res.include( root.box( i ) );
+    return res;
+}
+
+TEST(MRMesh, WideAABBTree)
+{
+    Mesh torus = makeTorus( 1, 0.3f, 32, 16 );
+    const auto & tree = torus.getAABBTree();
+    const WideAABBTree wideTree( tree );
+    EXPECT_EQ( wideTree.getBoundingBox(), tree.getBoundingBox() );
+
+    FaceBitSet faces;
+    for ( const auto & node : wideTree.nodes() )
+    {
+        EXPECT_FALSE( node.empty( 0 ) );
+        for ( int i = 0; i < WideAABBTree::Width && !node.empty( i ); ++i )
+        {
+            if ( !node.leaf( i ) )
+                continue;
+            EXPECT_FALSE( faces.test( node.leafId( i ) ) );
+            faces.autoResizeSet( node.leafId( i ) );
+        }
+    }
+    EXPECT_EQ( faces, torus.topology.getValidFaces() );
+}
+
+// compares the results of queries using binary and wide trees
+TEST(MRMesh, WideAABBTreeQueries)
+{
+    const Mesh torus = makeTorus( 1, 0.3f, 32, 16 );
+    const auto box = torus.computeBoundingBox();
+    constexpr int RaysPerDim = 32;
+    const Vector3f rayDir = Vector3f( 0.1f, 0.2f, -1.0f ).normalized();
+    for ( int y = 0; y < RaysPerDim; ++y )
+        for ( int x = 0; x < RaysPerDim; ++x )
+        {
+            const Line3f ray{ Vector3f(
+                box.min.x + box.size().x * ( x + 0.5f ) / RaysPerDim,
+                box.min.y + box.size().y * ( y + 0.5f ) / RaysPerDim,
+                box.max.z + 1 ), rayDir };
+            const auto binaryHit = rayMeshIntersect( torus, ray );
+            const auto wideHit = rayMeshIntersect( torus, ray, 0.0f, FLT_MAX, nullptr, true, true );
+            ASSERT_EQ( bool( binaryHit ), bool( wideHit ) );
+            if ( binaryHit )
+            {
+                EXPECT_NEAR( binaryHit->distanceAlongLine, wideHit->distanceAlongLine, 1e-5f );
+            }
+        }
+
+    constexpr int PointsPerDim = 8;
+    for ( int z = 0; z < PointsPerDim; ++z )
+        for ( int y = 0; y < PointsPerDim; ++y )
+            for ( int x = 0; x < PointsPerDim; ++x )
+            {
+                const auto pt = box.min + mult( box.size(), Vector3f( x + 0.5f, y + 0.5f, z + 0.5f ) / float( PointsPerDim ) );
+                EXPECT_NEAR( findProjection( pt, torus ).distSq, findProjection( pt, torus, FLT_MAX, nullptr, 0, true ).distSq, 1e-6f );
+            }
+
+    const Mesh otherTorus = makeTorus( 1, 0.3f, 24, 12 );
+    const auto rigidB2A = AffineXf3f::xfAround( Matrix3f::rotation( Vector3f( 1, 1, 0 ).normalized(), 0.3f ), Vector3f( 0.5f, 0, 0 ) );
+    auto sortedCollisions = [&]( bool useWideTrees )
+    {
+        auto res = findCollidingTriangles( torus, otherTorus, &rigidB2A, false, useWideTrees );
+        std::sort( res.begin(), res.end(), []( const FaceFace & a, const FaceFace & b )
+        {
+            return std::tie( a.aFace, a.bFace ) < std::tie( b.aFace, b.bFace );
+        } );
+        return res;
+    };
+    const auto binaryCollisions = sortedCollisions( false );
+    EXPECT_FALSE( binaryCollisions.empty() );
+    EXPECT_EQ( binaryCollisions, sortedCollisions( true ) );
+}
+
+} //namespace MR
@@ -0,0 +1,217 @@
+#pragma once
+
+#include "MRAABBTree.h"
+#include "MRBox.h"
+#include <climits>
+
+/* CPU(X86_64) - AMD64 / Intel64 / x86_64 64-bit */
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace MR
+{
+
+/// \addtogroup AABBTreeGroup
+/// \{
+
+/// collapsed bounding volume hierarchy, where each node has up to 4 children (instead of 2 in AABBTree);
+/// the boxes of all children are stored in the node in structure-of-arrays layout,
+/// so a ray, a point or a box is tested against all of them by few SSE instructions
+class WideAABBTree
+{
+public:
+    /// maximal number of children in a node
+    static constexpr int Width = 4;
+
+    class NodeTag;
+    using NodeId = Id<NodeTag>;
+
+    struct alignas( 16 ) Node
+    {
+        /// minimal and maximal coordinates of children boxes: boxMin[axis][child];
+        /// empty children slots have invalid boxes
+        float boxMin[3][Width];
+        float boxMax[3][Width];
+        /// >= 0 for a child node, < 0 for a face in the leaf: -1 - faceId, EmptyChild for not-used slot;
+        /// not-used slots are always located after all used ones
+        int children[Width];
+
+        static constexpr int EmptyChild = INT_MIN;
+
+        Node()
+        {
+            for ( int i = 0; i < Width; ++i )
+                setEmpty( i );
+        }
+        /// returns true if i-th slot is not used
+        bool empty( int i ) const { return children[i] == EmptyChild; }
+        /// returns true if i-th child is a face
+        bool leaf( int i ) const { assert( !empty( i ) ); return children[i] < 0; }
+        /// returns the face of i-th child (for leaf child only)
+        FaceId leafId( int i ) const { assert( leaf( i ) ); return FaceId( -1 - children[i] ); }
+        /// returns the node of i-th child (for not-leaf child only)
+        NodeId child( int i ) const { assert( !leaf( i ) ); return NodeId( children[i] ); }
+        /// returns the box of i-th child
+        Box3f box( int i ) const
+        {
+            return { { boxMin[0][i], boxMin[1][i], boxMin[2][i] }, { boxMax[0][i], boxMax[1][i], boxMax[2][i] } };
+        }
+
+        void setBox( int i, const Box3f & box )
+        {
+            for ( int k = 0; k < 3; ++k )
+            {
+                boxMin[k][i] = box.min[k];
+                boxMax[k][i] = box.max[k];
+            }
+        }
+        void setLeaf( int i, FaceId f ) { children[i] = -1 - int( f ); }
+        void setChild( int i, NodeId n ) { children[i] = int( n ); }
+        void setEmpty( int i ) { setBox( i, Box3f{} ); children[i] = EmptyChild; }
+    };
+
+    using NodeVec = Vector<Node, NodeId>;
+    [[nodiscard]] const NodeVec & nodes() const { return nodes_; }
+    [[nodiscard]] const Node & operator[]( NodeId nid ) const { return nodes_[nid]; }
+    [[nodiscard]] static NodeId rootNodeId() { return NodeId{ 0 }; }
+    /// returns the union of root node children boxes
+    [[nodiscard]] MRMESH_API Box3f getBoundingBox() const;
+
+    /// collapses given binary tree: each node takes up to 4 descendants of binary node with the largest boxes as children
+    MRMESH_API explicit WideAABBTree( const AABBTree & tree );
+
+    WideAABBTree( WideAABBTree && ) noexcept = default;
+    WideAABBTree & operator =( WideAABBTree && ) noexcept = default;
+
+    /// returns the amount of memory this object occupies on heap
+    [[nodiscard]] size_t heapBytes() const { return nodes_.heapBytes(); }
+
+private:
+    NodeVec nodes_;
+
+    WideAABBTree( const WideAABBTree & ) = default;
+    WideAABBTree & operator =( const WideAABBTree & ) = default;
+    friend class UniqueThreadSafeOwner<WideAABBTree>;
+};
+
+/// precomputed values of a ray for intersection with all children boxes of WideAABBTree node
+struct WideRayPrecomputes
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    __m128 origin[3];
+    __m128 invDir[3];
+    WideRayPrecomputes( const Vector3f & o, const Vector3f & d )
+    {
+        for ( int k = 0; k < 3; ++k )
+        {
+            origin[k] = _mm_set1_ps( o[k] );
+            invDir[k] = _mm_set1_ps( ( d[k] == 0 ) ? std::numeric_limits<float>::max() : 1 / d[k] );
+        }
+    }
+#else
+    float origin[3];
+    float invDir[3];
+    WideRayPrecomputes( const Vector3f & o, const Vector3f & d )
+    {
+        for ( int k = 0; k < 3; ++k )
+        {
+            origin[k] = o[k];
+            invDir[k] = ( d[k] == 0 ) ? std::numeric_limits<float>::max() : 1 / d[k];
+        }
+    }
+#endif
+};
+
+/// finds intersections of the ray within [t0, t1] with all children boxes of given node;
+/// returns the bit mask of intersected children and the ray parameters of entering each box;
+/// the bits of empty slots must be ignored by the caller
+inline int rayBoxIntersectChildren( const WideAABBTree::Node & node, const WideRayPrecomputes & ray, float t0, float t1,
+    float (&tEnter)[WideAABBTree::Width] )
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    __m128 tNear = _mm_set1_ps( t0 );
+    __m128 tFar = _mm_set1_ps( t1 );
+    for ( int k = 0; k < 3; ++k )
+    {
+        const __m128 l = _mm_mul_ps( _mm_sub_ps( _mm_load_ps( node.boxMin[k] ), ray.origin[k] ), ray.invDir[k] );
+        const __m128 r = _mm_mul_ps( _mm_sub_ps( _mm_load_ps( node.boxMax[k] ), ray.origin[k] ), ray.invDir[k] );
+        tNear = _mm_max_ps( tNear, _mm_min_ps( l, r ) );
+        tFar = _mm_min_ps( tFar, _mm_max_ps( l, r ) );
+    }
+    _mm_storeu_ps( tEnter, tNear );
+    return _mm_movemask_ps( _mm_cmple_ps( tNear, tFar ) );
+#else
+    int res = 0;
+    for ( int i = 0; i < WideAABBTree::Width; ++i )
+    {
+        float tNear = t0, tFar = t1;
+        for ( int k = 0; k < 3; ++k )
+        {
+            const float l = ( node.boxMin[k][i] - ray.origin[k] ) * ray.invDir[k];
+            const float r = ( node.boxMax[k][i] - ray.origin[k] ) * ray.invDir[k];
+            tNear = std::max( tNear, std::min( l, r ) );
+            tFar = std::min( tFar, std::max( l, r ) );
+        }
+        tEnter[i] = tNear;
+        if ( tNear <= tFar )
+            res |= 1 << i;
+    }
+    return res;
+#endif
+}
+
+/// computes squared distances from given point to all children boxes of given node (zero for the point inside a box)
+inline void distSqToChildren( const WideAABBTree::Node & node, const Vector3f & pt, float (&distSq)[WideAABBTree::Width] )
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    __m128 acc = _mm_setzero_ps();
+    for ( int k = 0; k < 3; ++k )
+    {
+        const __m128 p = _mm_set1_ps( pt[k] );
+        const __m128 d = _mm_max_ps( _mm_max_ps( _mm_sub_ps( _mm_load_ps( node.boxMin[k] ), p ), _mm_sub_ps( p, _mm_load_ps( node.boxMax[k] ) ) ), _mm_setzero_ps() );
+        acc = _mm_add_ps( acc, _mm_mul_ps( d, d ) );
+    }
+    _mm_storeu_ps( distSq, acc );
+#else
+    for ( int i = 0; i < WideAABBTree::Width; ++i )
+    {
+        float acc = 0;
+        for ( int k = 0; k < 3; ++k )
+        {
+            const float d = std::max( { node.boxMin[k][i] - pt[k], pt[k] - node.boxMax[k][i], 0.0f } );
+            acc += d * d;
+        }
+        distSq[i] = acc;
+    }
+#endif
+}
+
+/// returns the bit mask of node children, which boxes intersect or touch given box
+inline int boxIntersectChildren( const WideAABBTree::Node & node, const Box3f & box )
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    __m128 m = _mm_castsi128_ps( _mm_set1_epi32( -1 ) );
+    for ( int k = 0; k < 3; ++k )
+    {
+        m = _mm_and_ps( m, _mm_cmple_ps( _mm_load_ps( node.boxMin[k] ), _mm_set1_ps( box.max[k] ) ) );
+        m = _mm_and_ps( m, _mm_cmpge_ps( _mm_load_ps( node.boxMax[k] ), _mm_set1_ps( box.min[k] ) ) );
+    }
+    return _mm_movemask_ps( m );
+#else
+    int res = 0;
+    for ( int i = 0; i < WideAABBTree::Width; ++i )
+    {
+        bool overlap = true;
+        for ( int k = 0; k < 3; ++k )
+            overlap = overlap && node.boxMin[k][i] <= box.max[k] && node.boxMax[k][i] >= box.min[k];
+        if ( overlap )
+            res |= 1 << i;
+    }
+    return res;
+#endif
+}
+
+/// \}
+
+} // namespace MR
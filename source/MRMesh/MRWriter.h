@@ -14,4 +14,16 @@ struct Writer
 
 #define MR_WRITER( obj ) MR::Writer _writer( obj );
 
+// the same as Writer, but for the changes of point coordinates only without topology modification,
+// so the object can update its caches instead of recreating them
+template<class T>
+struct GeometryWriter
+{
+    T & obj;
+    GeometryWriter( T & o ) : obj( o ) { }
+    ~GeometryWriter() { obj.invalidateCaches( true ); }
+};
+
+#define MR_GEOMETRY_WRITER( obj ) MR::GeometryWriter _writer( obj );
+
 } //namespace MR
@@ -179,7 +179,9 @@ MR_ADD_PYTHON_CUSTOM_DEF( mrmeshpy, Mesh, [] ( pybind11::module_& m )
         def_readwrite( "points", &MR::Mesh::points ).
         def( "triPoint", ( MR::Vector3f( MR::Mesh::* )( const MR::MeshTriPoint& )const )& MR::Mesh::triPoint, pybind11::arg( "p" ), "returns interpolated coordinates of given point" ).
         def( "edgePoint", ( MR::Vector3f( MR::Mesh::* )( const MR::MeshEdgePoint& )const )& MR::Mesh::edgePoint, pybind11::arg( "ep" ), "returns a point on the edge: origin point for f=0 and destination point for f=1" ).
-        def( "invalidateCaches", &MR::Mesh::invalidateCaches, "Invalidates caches (e.g. aabb-tree) after a change in mesh geometry or topology" ).
+        def( "invalidateCaches", &MR::Mesh::invalidateCaches, pybind11::arg( "geometryOnly" ) = false,
+            "Invalidates caches (e.g. aabb-tree) after a change in mesh geometry or topology;\n"
+            "if geometryOnly then only the coordinates of points have changed, and existing aabb-tree is refit lazily instead of rebuild" ).
         def( "transform", ( void( MR::Mesh::* ) ( const AffineXf3f& ) )& MR::Mesh::transform, pybind11::arg( "xf" ), "applies given transformation to all valid mesh vertices" ).
         def( pybind11::self == pybind11::self, "compare that two meshes are exactly the same" );
 
@@ -433,9 +435,11 @@ MR_ADD_PYTHON_CUSTOM_DEF( mrmeshpy, SimpleFunctions, [] ( pybind11::module_& m )
 
     m.def( "findCollidingTriangles", &MR::findCollidingTriangles, 
         pybind11::arg( "a" ), pybind11::arg( "b" ), pybind11::arg( "rigidB2A" ) = nullptr, pybind11::arg( "firstIntersectionOnly" ) = false, 
+        pybind11::arg( "useWideTrees" ) = false,
         "finds all pairs of colliding triangles from two meshes or two mesh regions\n"
         "\trigidB2A - rigid transformation from B-mesh space to A mesh space, nullptr considered as identity transformation\n"
-        "\tfirstIntersectionOnly - if true then the function returns at most one pair of intersecting triangles and returns faster" );
+        "\tfirstIntersectionOnly - if true then the function returns at most one pair of intersecting triangles and returns faster\n"
+        "\tuseWideTrees - if true then wide (4-ary) AABB trees of the meshes are traversed instead of binary ones" );
 } )
 
 MR_ADD_PYTHON_VEC( mrmeshpy, vectorFaceFace, MR::FaceFace )
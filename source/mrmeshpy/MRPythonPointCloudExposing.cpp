@@ -27,7 +27,10 @@ MR_ADD_PYTHON_CUSTOM_DEF( mrmeshpy, PointCloud, [] ( pybind11::module_& m )
         def_readwrite( "critAngle", &MR::TriangulationParameters::critAngle, "Critical angle of triangles in local triangulation (angle between triangles in fan should be less then this value)" ).
         def_readwrite( "critHoleLength", &MR::TriangulationParameters::critHoleLength,
             "Critical length of hole (all holes with length less then this value will be filled)\n"
-            "If value is subzero it is set automaticly to 0.7*bbox.diagonal()" );
+            "If value is subzero it is set automaticly to 0.7*bbox.diagonal()" ).
+        def_readwrite( "radius", &MR::TriangulationParameters::radius,
+            "Radius of local triangulation zone\n"
+            "If value is not positive, it is found automatically from avgNumNeighbours" );
 
     m.def( "triangulatePointCloud", &MR::triangulatePointCloud,
         pybind11::arg( "pointCloud" ), pybind11::arg( "params" ) = MR::TriangulationParameters{}, pybind11::arg( "progressCb" ) = MR::ProgressCallback{},
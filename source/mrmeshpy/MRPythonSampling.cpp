@@ -5,7 +5,7 @@
 
 MR_ADD_PYTHON_CUSTOM_DEF( mrmeshpy, PointsSampling, [] ( pybind11::module_& m )
 {
-    m.def( "pointGridSampling", &MR::pointGridSampling, pybind11::arg( "cloud" ), pybind11::arg( "voxelSize " ),
+    m.def( "pointGridSampling", ( MR::VertBitSet( * )( const MR::PointCloud&, float ) )&MR::pointGridSampling, pybind11::arg( "cloud" ), pybind11::arg( "voxelSize " ),
         "performs sampling of point cloud vertices;\n"
         "subdivides point cloud bounding box on voxels of approximately given size and returns at most one vertex per voxel" );
 